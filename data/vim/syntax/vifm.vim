@@ -172,14 +172,15 @@ syntax keyword vifmOption contained aproposprg autocd autochpos caseoptions
 		\ cdpath cd chaselinks classify columns co confirm cf cpoptions cpo
 		\ cvoptions deleteprg dotdirs dotfiles dirsize extprompt fastrun fillchars
 		\ fcs findprg followlinks fusehome gdefault grepprg histcursor history hi
-		\ hloptions hlsearch hls iec ignorecase ic iooptions incsearch is keepsel
-		\ laststatus lines locateprg ls lsoptions lsview mediaprg milleroptions
-		\ millerview mintimeoutlen mouse navoptions number nu numberwidth nuw
-		\ previewoptions previewprg quickview relativenumber rnu rulerformat ruf
-		\ runexec scrollbind scb scrolloff sessionoptions ssop so sort sortgroups
-		\ sortorder sortnumbers shell sh shellflagcmd shcf shortmess shm showtabline
-		\ stal sizefmt slowfs smartcase scs statusline stl suggestoptions syncregs
-		\ syscalls tablabel tabline tabprefix tabscope tabstop tabsuffix tal timefmt
+		\ hloptions hlsearch hls iec ignorecase ic iooptions ioworkers incsearch is
+		\ keepsel laststatus lazylinks lines locateprg ls lsoptions lsview mediaprg
+		\ milleroptions millerview mintimeoutlen mouse navoptions number nu
+		\ numberwidth nuw previewoptions previewprg quickview relativenumber rnu
+		\ rulerformat ruf runexec scrollbind scb scrolloff sessionoptions ssop so
+		\ sort sortgroups sortorder sortnumbers shell sh shellflagcmd shcf shortmess
+		\ shm showtabline stal sizefmt slowfs smartcase scs statusline stl
+		\ statworkers suggestoptions syncregs syscalls tablabel tabline tabprefix
+		\ tabscope tabstop tabsuffix tal timefmt
 		\ timeoutlen title tm trash trashdir ts tuioptions to uioptions undolevels
 		\ ul vicmd viewcolumns vifminfo vimhelp vixcmd wildinc wildmenu wmnu
 		\ wildstyle wordchars wrap wrapscan ws
@@ -191,8 +192,8 @@ syntax keyword vifmOption contained aproposprg autocd autochpos caseoptions
 " Disabled boolean options
 syntax keyword vifmOption contained noautocd noautochpos nocf nochaselinks
 		\ nodotfiles nofastrun nofollowlinks nohlsearch nohls noiec noignorecase
-		\ noic noincsearch nois nokeepsel nolaststatus nols nolsview nomillerview
-		\ nonumber nonu noquickview norelativenumber nornu noscrollbind noscb
+		\ noic noincsearch nois nokeepsel nolaststatus nolazylinks nols nolsview
+		\ nomillerview nonumber nonu noquickview norelativenumber nornu noscrollbind noscb
 		\ norunexec nosmartcase noscs nosortnumbers nosyscalls notitle notrash
 		\ novimhelp nowildmenu nowmnu nowrap nowrapscan nows nogdefault
 		\ noprefervsplit nofilenamedispall noredolastcmdcfm nocdaftermkdir
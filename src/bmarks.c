@@ -159,6 +159,19 @@ bmarks_list(bmarks_find_cb cb, void *arg)
 	}
 }
 
+void
+bmarks_list_changed(time_t since, bmarks_find_cb cb, void *arg)
+{
+	size_t i;
+	for(i = 0U; i < bmark_count; ++i)
+	{
+		if(bmarks[i].timestamp >= since)
+		{
+			cb(bmarks[i].path, bmarks[i].tags, bmarks[i].timestamp, arg);
+		}
+	}
+}
+
 void
 bmarks_find(const char tags[], bmarks_find_cb cb, void *arg)
 {
@@ -257,12 +270,36 @@ bmarks_file_moved(const char src[], const char dst[])
 	make_canonic(src, canonic_src, sizeof(canonic_src));
 	make_canonic(dst, canonic_dst, sizeof(canonic_dst));
 
-	/* Renames bookmark. */
+	/* Renames bookmark by removing it and adding a new one, this way removal of
+	 * the old path is visible to bmarks_list_changed(). */
 	for(i = 0U; i < bmark_count; ++i)
 	{
 		if(stroscmp(canonic_src, bmarks[i].path) == 0)
 		{
-			(void)replace_string(&bmarks[i].path, canonic_dst);
+			if(bmarks[i].tags[0] == '\0')
+			{
+				break;
+			}
+
+			const time_t now = time(NULL);
+			char *tags = bmarks[i].tags;
+			bmarks[i].tags = strdup("");
+			if(bmarks[i].tags == NULL)
+			{
+				bmarks[i].tags = tags;
+				break;
+			}
+
+			if(bmarks_setup(canonic_dst, tags, now) != 0)
+			{
+				/* Keep the bookmark where it was. */
+				free(bmarks[i].tags);
+				bmarks[i].tags = tags;
+				break;
+			}
+
+			bmarks[i].timestamp = now;
+			free(tags);
 			break;
 		}
 	}
@@ -41,6 +41,10 @@ void bmarks_remove(const char path[]);
 /* Lists all available records by calling the callback. */
 void bmarks_list(bmarks_find_cb cb, void *arg);
 
+/* Lists records updated at or after the since time by calling the callback.
+ * Removed bookmarks are listed as well and have empty list of tags. */
+void bmarks_list_changed(time_t since, bmarks_find_cb cb, void *arg);
+
 /* Looks up paths with matching list of associated tags. */
 void bmarks_find(const char tags[], bmarks_find_cb cb, void *arg);
 
@@ -187,6 +187,10 @@ cfg_init(void)
 
 	cfg.slow_fs_list = strdup("");
 
+	cfg.stat_workers = 4;
+	cfg.io_workers = 4;
+	cfg.lazy_links = 0;
+
 	cfg.cd_path = strdup(env_get_def("CDPATH", DEFAULT_CD_PATH));
 	replace_char(cfg.cd_path, ':', ',');
 
@@ -241,6 +245,7 @@ cfg_init(void)
 
 	cfg.fast_file_cloning = 1;
 	cfg.data_sync = 1;
+	cfg.sparse_copying = 0;
 
 	cfg.cvoptions = 0;
 
@@ -147,7 +147,9 @@ enum
 	VINFO_SAVEDIRS  = 1 << 17, /* Restore last used directories on startup. */
 	VINFO_TABS      = 1 << 18, /* Restore global or pane tabs. */
 	VINFO_RATINGS   = 1 << 19, /* Restore rating records on startup. */
-	NUM_VINFO       = 20,      /* Number of VINFO_* constants. */
+	VINFO_DCACHE    = 1 << 20, /* Keep directory sizes cache between sessions. */
+	VINFO_HCACHE    = 1 << 21, /* Keep file digests cache between sessions. */
+	NUM_VINFO       = 22,      /* Number of VINFO_* constants. */
 
 	EMPTY_VINFO = 0,                   /* Empty set of flags. */
 	FULL_VINFO  = (1 << NUM_VINFO) - 1 /* Full set of flags. */
@@ -308,6 +310,10 @@ typedef struct config_t
 	/* Comma-separated list of file system types which are slow to respond. */
 	char *slow_fs_list;
 
+	int stat_workers; /* Number of threads that query information about files. */
+	int io_workers;   /* Number of threads that copy or move files. */
+	int lazy_links;   /* Resolve targets of symbolic links only on displaying. */
+
 	/* Comma-separated list of places to look for relative path to directories. */
 	char *cd_path;
 
@@ -380,6 +386,8 @@ typedef struct config_t
 	int fast_file_cloning;
 	/* Force writing data onto media during file copying. */
 	int data_sync;
+	/* Skip holes of all copied files, not only of sparse ones. */
+	int sparse_copying;
 
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
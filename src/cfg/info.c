@@ -19,12 +19,16 @@
 
 #include "info.h"
 
+#ifndef _WIN32
+#include <unistd.h> /* close() */
+#endif
+
 #include <assert.h> /* assert() */
 #include <ctype.h> /* isdigit() */
 #include <locale.h> /* setlocale() LC_ALL */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE fpos_t fclose() fgetpos() fgets() fprintf() fputc()
-                      fscanf() fsetpos() snprintf() */
+#include <stdio.h> /* FILE fpos_t fclose() fdopen() fgetpos() fgets() fprintf()
+                      fputc() fscanf() fsetpos() snprintf() */
 #include <stdlib.h> /* abs() free() */
 #include <string.h> /* memcpy() memset() strtol() strcmp() strchr() strlen() */
 #include <time.h> /* time_t time() */
@@ -39,6 +43,7 @@
 #include "../ui/fileview.h"
 #include "../ui/tabs.h"
 #include "../ui/ui.h"
+#include "../utils/alog.h"
 #include "../utils/file_streams.h"
 #include "../utils/filemon.h"
 #include "../utils/filter.h"
@@ -170,9 +175,14 @@
  *      text = "item1"
  *      ts = 1440801895 # timestamp (optional)
  *  } ]
+ *  ratings = [ {
+ *      star = 3
+ *      path = "/encrypted/path"
+ *  } ]
  *  active-gtab = 0
  *  use-term-multiplexer = true
  *  color-scheme = "almost-default"
+ *  vifminfo = 123 # flags of 'vifminfo' the file was written with (optional)
  *
  * Elements in history arrays are stored oldest to newest.
  *
@@ -182,8 +192,24 @@
  *  - for elements of arrays timestamps act more like generation numbers and
  *    while merging happens per element, effectively it's generations (defined
  *    by time of storing of the array) which are being merged
+ *
+ * Instead of rewriting vifminfo.json on every store, records are appended to
+ * vifminfo.journal file one per line.  A record is structured as the data
+ * above, but histories, marks, bookmarks and ratings in it contain only changes
+ * made since the previous store, the rest of the state is stored in full.
+ * Removed marks lack "dir" key, removed bookmarks have empty "tags" and
+ * removed ratings have zero stars.  On reading, records are replayed on top of
+ * vifminfo.json.  When the journal gets too big, it's compacted: merged into
+ * vifminfo.json by the usual merging and removed.  The journal is renamed
+ * before the merge, so all records of vifminfo.journal are always newer than
+ * vifminfo.json.  Appending and renaming happen under flock() of the journal,
+ * so that records aren't appended to a journal that's being merged.
  */
 
+/* Journal is compacted once it exceeds this size and a quarter of the size of
+ * vifminfo.json. */
+#define JOURNAL_MIN_LIMIT (64*1024)
+
 static JSON_Value * read_legacy_info_file(const char info_file[]);
 static void load_state(JSON_Object *root, int reread);
 static void load_gtabs(JSON_Object *root, int reread);
@@ -208,12 +234,42 @@ static void ensure_history_not_full(hist_t *hist);
 static void put_dhistory_entry(view_t *view, int reread, const char dir[],
 		const char file[], int rel_pos, time_t timestamp);
 static void set_manual_filter(view_t *view, const char value[]);
+static void get_info_paths(char info_file[], char journal_file[],
+		size_t buf_size);
+static JSON_Value * read_info_file(const char path[], const char journal[]);
+static void remember_snapshot(const JSON_Object *root);
+static void replay_journal(JSON_Object *state, const char journal[]);
+static void replay_record(JSON_Object *state, const JSON_Object *record);
+static void replay_gtabs(JSON_Object *state, const JSON_Object *record);
+static int is_single_tab(const JSON_Array *gtabs);
+static JSON_Object * get_single_ptab(const JSON_Array *gtabs, int pane);
+static void replay_value(JSON_Object *state, const JSON_Object *record,
+		const char node[]);
+static void replay_list(JSON_Object *state, const JSON_Object *record,
+		const char node[], const char field1[], const char field2[]);
+static char * make_entry_key(const JSON_Object *entry, const char field1[],
+		const char field2[]);
+static void replay_dict(JSON_Object *state, const JSON_Object *record,
+		const char node[], int timestamped);
+static void replay_history(JSON_Object *state, const JSON_Object *record,
+		const char node[]);
+static void drop_removed(JSON_Object *state);
+static void drop_removed_entries(JSON_Object *entries, const char field[]);
 TSTATIC void write_info_file(void);
+static int can_journal(const char info_file[], const char journal_file[]);
+static int append_journal_record(const char journal_file[]);
+static void compact_journal(const char info_file[], const char journal_file[]);
+static int restore_journal(const char claimed_file[],
+		const char journal_file[]);
+static FILE * open_journal(const char journal_file[]);
+static int append_file(const char src[], const char dst[]);
 static int copy_file(const char src[], const char dst[]);
-static void update_info_file(const char filename[], int vinfo, int merge);
+static void update_info_file(const char filename[], int vinfo, int merge,
+		const char journal[]);
 TSTATIC char * drop_locale(void);
 TSTATIC void restore_locale(char locale[]);
 TSTATIC JSON_Value * serialize_state(int vinfo);
+static JSON_Value * serialize(int vinfo, int delta);
 TSTATIC void merge_states(int vinfo, int session_load, JSON_Object *current,
 		const JSON_Object *admixture);
 static void merge_tabs(int vinfo, int session_load, JSON_Object *current,
@@ -245,15 +301,15 @@ static void store_pane(int vinfo, JSON_Object *pane, view_t *view, int right);
 static void store_ptab(int vinfo, JSON_Object *ptab, const char name[],
 		int preview, view_t *view);
 static void store_filters(JSON_Object *view_data, const view_t *view);
-static void store_history(JSON_Object *root, const char node[],
-		const hist_t *hist);
+static void store_history(JSON_Object *root, const char node[], hist_t *hist,
+		int delta);
 static void store_global_options(JSON_Object *root);
 static void store_view_options(JSON_Object *parent, const view_t *view);
 static void store_assocs(JSON_Object *root, const char node[],
 		assoc_list_t *assocs);
 static void store_cmds(JSON_Object *root);
-static void store_marks(JSON_Object *root);
-static void store_bmarks(JSON_Object *root);
+static void store_marks(JSON_Object *root, int delta);
+static void store_bmarks(JSON_Object *root, int delta);
 static void store_bmark(const char path[], const char tags[], time_t timestamp,
 		void *arg);
 static void store_regs(JSON_Object *root);
@@ -288,7 +344,8 @@ static void clone_array(JSON_Object *parent, const JSON_Array *array,
 		const char node[]);
 static void set_session(const char new_session[]);
 static void write_session_file(void);
-static void store_file(const char path[], filemon_t *mon, int vinfo);
+static int store_file(const char path[], filemon_t *mon, int vinfo,
+		const char journal[]);
 static void get_session_dir(char buf[], size_t buf_size);
 
 //add by sim1 ********************************************************
@@ -297,15 +354,25 @@ static void get_session_dir(char buf[], size_t buf_size);
 #define DECRYPTED 1
 
 static rating_entry_t *rating_list = NULL;
+/* Index of rating_list entries by their path, which spares walking the list on
+ * every lookup.  Removed keys are mapped onto NULL (trie lacks deletion). */
+static trie_t *rating_index = NULL;
 
 extern const char * local_getenv(const char envname[]);
 static void str_rot_encrypt(char *str);
 static void str_rot_decrypt(char *str);
+static void index_rating_entry(const char path[], rating_entry_t *entry);
+static void rename_rating_entry(rating_entry_t *entry, const char path[]);
 static void update_rating_star(rating_entry_t *entry, int star);
 static void update_rating_info(int star, char path[], int flag);
 static void save_rating_info(JSON_Object *root);
+static void store_rating_changes(JSON_Object *root);
 static void load_rating_info(JSON_Object *root);
 static rating_entry_t * create_rating_info(int star, char path[], int flag);
+static rating_entry_t * search_rating_info(const char path[]);
+static rating_entry_t * search_stored_rating(const char path[]);
+static void note_rating_change(const rating_entry_t *entry);
+static void forget_rating_changes(void);
 //add by sim1 ********************************************************
 
 /* Monitor to check for changes of vifminfo file. */
@@ -314,6 +381,16 @@ static filemon_t vifminfo_mon;
 static filemon_t session_mon;
 /* Callback to be invoked when active session has changed.  Can be NULL. */
 static sessions_changed session_changed_cb;
+/* Flags of 'vifminfo' with which vifminfo.json was written or -1 if they are
+ * unknown.  Changes are journaled only while the flags match the option. */
+static int snapshot_vinfo = -1;
+/* Changes of marks and bookmarks made at or after this time are journaled. */
+static time_t journal_since;
+/* Paths (in the form they are stored in) of ratings that were changed since
+ * the last store. */
+static strlist_t rating_changes;
+/* Set of elements of rating_changes for quick lookups. */
+static trie_t *rating_changes_set;
 
 void
 state_store(void)
@@ -329,13 +406,19 @@ state_store(void)
 void
 state_load(int reread)
 {
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	char info_file[PATH_MAX + 32], journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, journal_file, sizeof(info_file));
 
 	char *locale = drop_locale();
-	JSON_Value *state = json_parse_file(info_file);
+	JSON_Value *state = read_info_file(info_file, journal_file);
 	restore_locale(locale);
 
+	snapshot_vinfo = -1;
+	if(state != NULL)
+	{
+		remember_snapshot(json_object(state));
+	}
+
 	if(state == NULL)
 	{
 		char legacy_info_file[PATH_MAX + 16];
@@ -1321,14 +1404,625 @@ set_manual_filter(view_t *view, const char value[])
 	view->manual_filter = matcher;
 }
 
+/* Fills buffers with paths to vifminfo.json and its journal. */
+static void
+get_info_paths(char info_file[], char journal_file[], size_t buf_size)
+{
+	snprintf(info_file, buf_size, "%s/vifminfo.json", cfg.config_dir);
+	snprintf(journal_file, buf_size, "%s/vifminfo.journal", cfg.config_dir);
+}
+
+/* Reads JSON info file and replays records of the journal (can be NULL) on top
+ * of it.  Returns JSON value or NULL on error. */
+static JSON_Value *
+read_info_file(const char path[], const char journal[])
+{
+	JSON_Value *state = json_parse_file(path);
+	if(state != NULL && journal != NULL)
+	{
+		replay_journal(json_object(state), journal);
+	}
+	return state;
+}
+
+/* Remembers properties of just read vifminfo.json, which determine how further
+ * changes are stored. */
+static void
+remember_snapshot(const JSON_Object *root)
+{
+	if(!get_int(root, "vifminfo", &snapshot_vinfo))
+	{
+		snapshot_vinfo = -1;
+	}
+	journal_since = time(NULL);
+}
+
+/* Replays records of the journal on top of the state. */
+static void
+replay_journal(JSON_Object *state, const char journal[])
+{
+	int nrecords;
+	char **records = read_file_of_lines(journal, &nrecords);
+	if(records == NULL)
+	{
+		return;
+	}
+
+	/* Records are combined first, so that the state (which is likely to be much
+	 * bigger than the journal) is traversed only once. */
+	JSON_Value *changes_value = json_value_init_object();
+	JSON_Object *changes = json_object(changes_value);
+
+	int i;
+	for(i = 0; i < nrecords; ++i)
+	{
+		/* Last record can be incomplete if writing it was interrupted. */
+		JSON_Value *record = json_parse_string(records[i]);
+		if(record != NULL)
+		{
+			replay_record(changes, json_object(record));
+			json_value_free(record);
+		}
+	}
+	free_string_array(records, nrecords);
+
+	replay_record(state, changes);
+	drop_removed(state);
+
+	json_value_free(changes_value);
+}
+
+/* Applies a record of the journal to the state.  Removals are kept in the state
+ * as they might need to be applied to older data. */
+static void
+replay_record(JSON_Object *state, const JSON_Object *record)
+{
+	replay_gtabs(state, record);
+	replay_value(state, record, "active-gtab");
+	replay_list(state, record, "trash", "trashed", "original");
+	replay_value(state, record, "options");
+	replay_list(state, record, "assocs", "matchers", "cmd");
+	replay_list(state, record, "xassocs", "matchers", "cmd");
+	replay_list(state, record, "viewers", "matchers", "cmd");
+	replay_dict(state, record, "cmds", /*timestamped=*/0);
+	replay_dict(state, record, "marks", /*timestamped=*/1);
+	replay_dict(state, record, "bmarks", /*timestamped=*/1);
+	replay_history(state, record, "cmd-hist");
+	replay_history(state, record, "exprreg-hist");
+	replay_history(state, record, "search-hist");
+	replay_history(state, record, "prompt-hist");
+	replay_history(state, record, "lfilt-hist");
+	replay_history(state, record, "menu-cmd-hist");
+	replay_dict(state, record, "regs", /*timestamped=*/0);
+	replay_value(state, record, "dir-stack");
+	replay_list(state, record, "ratings", "path", NULL);
+	replay_value(state, record, "use-term-multiplexer");
+	replay_value(state, record, "color-scheme");
+}
+
+/* Replays tabs.  Tabs of the record replace tabs of the state, but directory
+ * histories are merged if both contain exactly one tab of any kind. */
+static void
+replay_gtabs(JSON_Object *state, const JSON_Object *record)
+{
+	const JSON_Value *gtabs = json_object_get_value(record, "gtabs");
+	if(gtabs == NULL)
+	{
+		return;
+	}
+
+	JSON_Value *merged_value = json_value_deep_copy(gtabs);
+	JSON_Array *merged = json_array(merged_value);
+	JSON_Array *current = json_object_get_array(state, "gtabs");
+
+	if(is_single_tab(merged) && is_single_tab(current))
+	{
+		int i;
+		for(i = 0; i < 2; ++i)
+		{
+			JSON_Object *ptab = get_single_ptab(merged, i);
+			if(json_object_has_value(ptab, "history"))
+			{
+				merge_dhistory(/*session_load=*/0, ptab, get_single_ptab(current, i));
+			}
+		}
+	}
+
+	json_object_set_value(state, "gtabs", merged_value);
+}
+
+/* Checks whether tabs consist of a single global tab with single pane tab in
+ * each pane.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_single_tab(const JSON_Array *gtabs)
+{
+	if(json_array_get_count(gtabs) != 1)
+	{
+		return 0;
+	}
+
+	JSON_Object *gtab = json_array_get_object(gtabs, 0);
+	JSON_Array *panes = json_object_get_array(gtab, "panes");
+	if(json_array_get_count(panes) != 2)
+	{
+		return 0;
+	}
+
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		JSON_Array *ptabs = json_object_get_array(json_array_get_object(panes, i),
+				"ptabs");
+		if(json_array_get_count(ptabs) != 1)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Retrieves pane tab of a pane of tabs accepted by is_single_tab().  Returns
+ * the tab. */
+static JSON_Object *
+get_single_ptab(const JSON_Array *gtabs, int pane)
+{
+	JSON_Object *gtab = json_array_get_object(gtabs, 0);
+	JSON_Array *panes = json_object_get_array(gtab, "panes");
+	JSON_Array *ptabs = json_object_get_array(json_array_get_object(panes, pane),
+			"ptabs");
+	return json_array_get_object(ptabs, 0);
+}
+
+/* Replaces value of the state with the one from the record, if it's there. */
+static void
+replay_value(JSON_Object *state, const JSON_Object *record, const char node[])
+{
+	const JSON_Value *value = json_object_get_value(record, node);
+	if(value != NULL)
+	{
+		json_object_set_value(state, node, json_value_deep_copy(value));
+	}
+}
+
+/* Replays a list of entries that are identified by one or two (field2 can be
+ * NULL) fields.  Entries of the record go first followed by entries of the
+ * state that aren't in the record. */
+static void
+replay_list(JSON_Object *state, const JSON_Object *record, const char node[],
+		const char field1[], const char field2[])
+{
+	const JSON_Value *updated_value = json_object_get_value(record, node);
+	JSON_Array *updated = json_array(updated_value);
+	if(updated == NULL)
+	{
+		return;
+	}
+
+	JSON_Array *entries = json_object_get_array(state, node);
+
+	JSON_Value *merged_value = json_value_deep_copy(updated_value);
+	JSON_Array *merged = json_array(merged_value);
+
+	trie_t *trie = trie_create(/*free_func=*/NULL);
+	int i, n;
+
+	for(i = 0, n = json_array_get_count(updated); i < n; ++i)
+	{
+		char *key = make_entry_key(json_array_get_object(updated, i), field1,
+				field2);
+		if(key != NULL)
+		{
+			(void)trie_put(trie, key);
+			free(key);
+		}
+	}
+
+	for(i = 0, n = json_array_get_count(entries); i < n; ++i)
+	{
+		JSON_Object *entry = json_array_get_object(entries, i);
+		char *key = make_entry_key(entry, field1, field2);
+
+		void *data;
+		if(key != NULL && trie_get(trie, key, &data) != 0)
+		{
+			JSON_Value *value = json_object_get_wrapping_value(entry);
+			json_array_append_value(merged, json_value_deep_copy(value));
+		}
+
+		free(key);
+	}
+
+	trie_free(trie);
+
+	json_object_set_value(state, node, merged_value);
+}
+
+/* Makes a key that identifies an entry by its one or two (field2 can be NULL)
+ * fields.  Returns newly allocated string or NULL if some of the fields are
+ * missing. */
+static char *
+make_entry_key(const JSON_Object *entry, const char field1[],
+		const char field2[])
+{
+	const char *value1, *value2;
+	if(!get_str(entry, field1, &value1))
+	{
+		return NULL;
+	}
+
+	if(field2 == NULL)
+	{
+		return strdup(value1);
+	}
+
+	if(!get_str(entry, field2, &value2))
+	{
+		return NULL;
+	}
+	return format_str("%s\n%s", value1, value2);
+}
+
+/* Replays a dictionary.  For timestamped entries the newer entry wins,
+ * otherwise entries of the record replace those of the state. */
+static void
+replay_dict(JSON_Object *state, const JSON_Object *record, const char node[],
+		int timestamped)
+{
+	JSON_Object *updated = json_object_get_object(record, node);
+	if(updated == NULL)
+	{
+		return;
+	}
+
+	JSON_Object *entries = json_object_get_object(state, node);
+	if(entries == NULL)
+	{
+		clone_object(state, updated, node);
+		return;
+	}
+
+	int i, n;
+	for(i = 0, n = json_object_get_count(updated); i < n; ++i)
+	{
+		const char *name = json_object_get_name(updated, i);
+		JSON_Value *value = json_object_get_value_at(updated, i);
+
+		double ts, current_ts;
+		if(timestamped && get_double(json_object(value), "ts", &ts) &&
+				get_double(json_object_get_object(entries, name), "ts", &current_ts) &&
+				current_ts > ts)
+		{
+			continue;
+		}
+
+		json_object_set_value(entries, name, json_value_deep_copy(value));
+	}
+}
+
+/* Replays a history by moving entries of the record to the end of the list
+ * (the newest position) and trimming the list to the size of histories. */
+static void
+replay_history(JSON_Object *state, const JSON_Object *record, const char node[])
+{
+	JSON_Array *updated = json_object_get_array(record, node);
+	if(json_array_get_count(updated) == 0)
+	{
+		return;
+	}
+
+	JSON_Array *entries = json_object_get_array(state, node);
+
+	const int n = json_array_get_count(entries);
+	const int m = json_array_get_count(updated);
+	JSON_Object **combined = reallocarray(NULL, n + m, sizeof(*combined));
+	if(combined == NULL)
+	{
+		return;
+	}
+
+	trie_t *trie = trie_create(/*free_func=*/NULL);
+	int i, total = 0;
+
+	for(i = 0; i < m; ++i)
+	{
+		const char *text;
+		if(get_str(json_array_get_object(updated, i), "text", &text))
+		{
+			(void)trie_put(trie, text);
+		}
+	}
+
+	for(i = 0; i < n; ++i)
+	{
+		JSON_Object *entry = json_array_get_object(entries, i);
+
+		void *data;
+		const char *text;
+		if(get_str(entry, "text", &text) && trie_get(trie, text, &data) != 0)
+		{
+			combined[total++] = entry;
+		}
+	}
+
+	trie_free(trie);
+
+	for(i = 0; i < m; ++i)
+	{
+		combined[total++] = json_array_get_object(updated, i);
+	}
+
+	JSON_Value *merged_value = json_value_init_array();
+	JSON_Array *merged = json_array(merged_value);
+
+	for(i = MAX(0, total - cfg.history_len); i < total; ++i)
+	{
+		JSON_Value *entry = json_object_get_wrapping_value(combined[i]);
+		json_array_append_value(merged, json_value_deep_copy(entry));
+	}
+
+	free(combined);
+
+	json_object_set_value(state, node, merged_value);
+}
+
+/* Removes entries that represent removals from the state. */
+static void
+drop_removed(JSON_Object *state)
+{
+	drop_removed_entries(json_object_get_object(state, "marks"), "dir");
+	drop_removed_entries(json_object_get_object(state, "bmarks"), "tags");
+
+	JSON_Array *ratings = json_object_get_array(state, "ratings");
+	int i;
+	for(i = json_array_get_count(ratings) - 1; i >= 0; --i)
+	{
+		int star;
+		if(!get_int(json_array_get_object(ratings, i), "star", &star) || star <= 0)
+		{
+			json_array_remove(ratings, i);
+		}
+	}
+}
+
+/* Removes entries which lack the field or have it empty. */
+static void
+drop_removed_entries(JSON_Object *entries, const char field[])
+{
+	size_t i = 0U;
+	while(i < json_object_get_count(entries))
+	{
+		JSON_Object *entry = json_object(json_object_get_value_at(entries, i));
+
+		const char *value;
+		if(get_str(entry, field, &value) && value[0] != '\0')
+		{
+			++i;
+			continue;
+		}
+
+		/* Removal moves the last entry in place of the removed one. */
+		char *name = strdup(json_object_get_name(entries, i));
+		if(name == NULL || json_object_remove(entries, name) != JSONSuccess)
+		{
+			++i;
+		}
+		free(name);
+	}
+}
+
 /* Writes vifminfo file updating it with state of the current instance. */
 TSTATIC void
 write_info_file(void)
 {
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
+	char info_file[PATH_MAX + 32], journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, journal_file, sizeof(info_file));
+
+	if(can_journal(info_file, journal_file) &&
+			append_journal_record(journal_file) == 0)
+	{
+		return;
+	}
+
+	compact_journal(info_file, journal_file);
+}
+
+/* Checks whether changes can be appended to the journal instead of updating
+ * vifminfo.json.  Returns non-zero if so, otherwise zero is returned. */
+static int
+can_journal(const char info_file[], const char journal_file[])
+{
+	if(snapshot_vinfo != cfg.vifm_info || !path_exists(info_file, DEREF))
+	{
+		return 0;
+	}
+
+	const uint64_t limit = MAX(JOURNAL_MIN_LIMIT, get_file_size(info_file)/4);
+	return (get_file_size(journal_file) < limit);
+}
+
+/* Appends changes made by current instance to the journal.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+append_journal_record(const char journal_file[])
+{
+	const time_t now = time(NULL);
+
+	char *locale = drop_locale();
+	JSON_Value *record = serialize(cfg.vifm_info, /*delta=*/1);
+	char *line = json_serialize_to_string(record);
+	json_value_free(record);
+	restore_locale(locale);
+
+	if(line == NULL)
+	{
+		return 1;
+	}
+
+	FILE *fp = open_journal(journal_file);
+	if(fp == NULL)
+	{
+		free(line);
+		return 1;
+	}
+
+	/* Closing the file flushes the record before releasing the lock. */
+	int error = (fputs(line, fp) == EOF || fputc('\n', fp) == EOF);
+	error |= (fclose(fp) != 0);
+	free(line);
+
+	if(error)
+	{
+		LOG_ERROR_MSG("Error appending state to: %s", journal_file);
+		return 1;
+	}
+
+	journal_since = now;
+	forget_rating_changes();
+	return 0;
+}
+
+/* Merges the journal along with the state of current instance into
+ * vifminfo.json and removes the journal. */
+static void
+compact_journal(const char info_file[], const char journal_file[])
+{
+	const time_t now = time(NULL);
+
+	/* Renaming claims the journal, other instances will start a new one which
+	 * will contain only records that are newer than updated vifminfo.json. */
+	char claimed_file[PATH_MAX + 64];
+	snprintf(claimed_file, sizeof(claimed_file), "%s_%u", journal_file,
+			get_pid());
+
+#ifndef _WIN32
+	/* Wait for appending to finish. */
+	FILE *journal = path_exists(journal_file, NODEREF)
+	              ? open_journal(journal_file)
+	              : NULL;
+#endif
+	const int claimed = (os_rename(journal_file, claimed_file) == 0);
+#ifndef _WIN32
+	if(journal != NULL)
+	{
+		fclose(journal);
+	}
+#endif
+
+	if(store_file(info_file, &vifminfo_mon, cfg.vifm_info, claimed_file) != 0)
+	{
+		/* Put records back to not lose them. */
+		if(claimed && restore_journal(claimed_file, journal_file) != 0)
+		{
+			LOG_ERROR_MSG("Failed to restore journal from: %s", claimed_file);
+			return;
+		}
+	}
+	else
+	{
+		snapshot_vinfo = cfg.vifm_info;
+		journal_since = now;
+		forget_rating_changes();
+	}
+
+	if(claimed)
+	{
+		(void)remove(claimed_file);
+	}
+}
+
+/* Puts claimed records back in front of records that were appended to the
+ * journal since it was claimed.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+restore_journal(const char claimed_file[], const char journal_file[])
+{
+#ifndef _WIN32
+	FILE *journal = open_journal(journal_file);
+	if(journal == NULL)
+	{
+		return 1;
+	}
+#endif
+
+	int error = (path_exists(journal_file, NODEREF) &&
+			append_file(journal_file, claimed_file) != 0);
+	if(!error)
+	{
+		error = rename_file(claimed_file, journal_file);
+	}
+
+#ifndef _WIN32
+	fclose(journal);
+#endif
+	return error;
+}
+
+/* Opens the journal for appending and locks it making sure that the lock is
+ * held on the file that's currently at the path (it could have been claimed by
+ * another instance in the meantime).  The lock is released by fclose().  There
+ * is no locking on Windows.  Returns the file or NULL on error. */
+static FILE *
+open_journal(const char journal_file[])
+{
+#ifndef _WIN32
+	int fd = alog_open_file(journal_file);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	int reopened;
+	if(alog_lock_file(journal_file, &fd, &reopened) != 0)
+	{
+		if(fd != -1)
+		{
+			close(fd);
+		}
+		return NULL;
+	}
+
+	FILE *const fp = fdopen(fd, "ab");
+	if(fp == NULL)
+	{
+		close(fd);
+	}
+	return fp;
+#else
+	return os_fopen(journal_file, "ab");
+#endif
+}
+
+/* Appends contents of one file to another one.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+append_file(const char src[], const char dst[])
+{
+	FILE *in = os_fopen(src, "rb");
+	if(in == NULL)
+	{
+		return 1;
+	}
+
+	FILE *out = os_fopen(dst, "ab");
+	if(out == NULL)
+	{
+		fclose(in);
+		return 1;
+	}
+
+	char buf[8192];
+	size_t n;
+	int error = 0;
+	while(!error && (n = fread(buf, 1, sizeof(buf), in)) != 0U)
+	{
+		error = (fwrite(buf, 1, n, out) != n);
+	}
 
-	store_file(info_file, &vifminfo_mon, cfg.vifm_info);
+	error |= ferror(in);
+	fclose(in);
+	error |= (fclose(out) != 0);
+	return error;
 }
 
 /* Copies the src file to the dst location.  Returns zero on success. */
@@ -1345,16 +2039,18 @@ copy_file(const char src[], const char dst[])
 }
 
 /* Reads contents of the filename file as a JSON info file and updates it with
- * the state of current instance. */
+ * the state of current instance.  Records of the journal (if it's not NULL)
+ * are replayed on top of the file before the merge. */
 static void
-update_info_file(const char filename[], int vinfo, int merge)
+update_info_file(const char filename[], int vinfo, int merge,
+		const char journal[])
 {
 	char *locale = drop_locale();
 	JSON_Value *current = serialize_state(vinfo);
 
 	if(merge)
 	{
-		JSON_Value *admixture = json_parse_file(filename);
+		JSON_Value *admixture = read_info_file(filename, journal);
 		if(admixture != NULL)
 		{
 			merge_states(vinfo, 0, json_object(current), json_object(admixture));
@@ -1362,6 +2058,11 @@ update_info_file(const char filename[], int vinfo, int merge)
 		}
 	}
 
+	if(journal != NULL)
+	{
+		set_int(json_object(current), "vifminfo", vinfo);
+	}
+
 	if(json_serialize_to_file(current, filename) == JSONError)
 	{
 		LOG_ERROR_MSG("Error storing state to: %s", filename);
@@ -1402,6 +2103,15 @@ restore_locale(char locale[])
  * the object. */
 TSTATIC JSON_Value *
 serialize_state(int vinfo)
+{
+	return serialize(vinfo, /*delta=*/0);
+}
+
+/* Serializes specified state of current instance into a JSON object.  In delta
+ * mode histories, marks, bookmarks, ratings and directory stack are serialized
+ * only if they changed since the last store.  Returns the object. */
+static JSON_Value *
+serialize(int vinfo, int delta)
 {
 	JSON_Value *root_value = json_value_init_object();
 	JSON_Object *root = json_object(root_value);
@@ -1449,42 +2159,42 @@ serialize_state(int vinfo)
 
 	if(vinfo & VINFO_MARKS)
 	{
-		store_marks(root);
+		store_marks(root, delta);
 	}
 
 	if(vinfo & VINFO_BOOKMARKS)
 	{
-		store_bmarks(root);
+		store_bmarks(root, delta);
 	}
 
 	if(vinfo & VINFO_CHISTORY)
 	{
-		store_history(root, "cmd-hist", &curr_stats.cmd_hist);
+		store_history(root, "cmd-hist", &curr_stats.cmd_hist, delta);
 	}
 
 	if(vinfo & VINFO_EHISTORY)
 	{
-		store_history(root, "exprreg-hist", &curr_stats.exprreg_hist);
+		store_history(root, "exprreg-hist", &curr_stats.exprreg_hist, delta);
 	}
 
 	if(vinfo & VINFO_SHISTORY)
 	{
-		store_history(root, "search-hist", &curr_stats.search_hist);
+		store_history(root, "search-hist", &curr_stats.search_hist, delta);
 	}
 
 	if(vinfo & VINFO_PHISTORY)
 	{
-		store_history(root, "prompt-hist", &curr_stats.prompt_hist);
+		store_history(root, "prompt-hist", &curr_stats.prompt_hist, delta);
 	}
 
 	if(vinfo & VINFO_FHISTORY)
 	{
-		store_history(root, "lfilt-hist", &curr_stats.filter_hist);
+		store_history(root, "lfilt-hist", &curr_stats.filter_hist, delta);
 	}
 
 	if(vinfo & VINFO_MCHISTORY)
 	{
-		store_history(root, "menu-cmd-hist", &curr_stats.menucmd_hist);
+		store_history(root, "menu-cmd-hist", &curr_stats.menucmd_hist, delta);
 	}
 
 	if(vinfo & VINFO_REGISTERS)
@@ -1492,7 +2202,7 @@ serialize_state(int vinfo)
 		store_regs(root);
 	}
 
-	if(vinfo & VINFO_DIRSTACK)
+	if((vinfo & VINFO_DIRSTACK) && (!delta || dir_stack_changed()))
 	{
 		store_dir_stack(root);
 	}
@@ -1500,7 +2210,14 @@ serialize_state(int vinfo)
 	//add by sim1
 	if(vinfo & VINFO_RATINGS)
 	{
-		save_rating_info(root);
+		if(delta)
+		{
+			store_rating_changes(root);
+		}
+		else
+		{
+			save_rating_info(root);
+		}
 	}
 	//add by sim1 --- END
 
@@ -2250,9 +2967,10 @@ store_filters(JSON_Object *view_data, const view_t *view)
 	set_str(filters, "auto", view->auto_filter.raw);
 }
 
-/* Serializes a history into JSON. */
+/* Serializes a history into JSON.  Entries that weren't stored before get
+ * their timestamps.  In delta mode only such entries are serialized. */
 static void
-store_history(JSON_Object *root, const char node[], const hist_t *hist)
+store_history(JSON_Object *root, const char node[], hist_t *hist, int delta)
 {
 	if(hist->size <= 0)
 	{
@@ -2263,20 +2981,27 @@ store_history(JSON_Object *root, const char node[], const hist_t *hist)
 	time_t ts = time(NULL);
 
 	int i;
-	JSON_Array *entries = add_array(root, node);
+	JSON_Array *entries = NULL;
 	for(i = hist->size - 1; i >= 0; i--)
 	{
+		if(delta && hist->items[i].timestamp != (time_t)-1)
+		{
+			continue;
+		}
+
+		if(entries == NULL)
+		{
+			entries = add_array(root, node);
+		}
+
 		JSON_Object *entry = append_object(entries);
 		set_str(entry, "text", hist->items[i].text);
 
 		if(hist->items[i].timestamp == (time_t)-1)
 		{
-			set_double(entry, "ts", ts);
-		}
-		else
-		{
-			set_double(entry, "ts", hist->items[i].timestamp);
+			hist->items[i].timestamp = ts;
 		}
+		set_double(entry, "ts", hist->items[i].timestamp);
 	}
 }
 
@@ -2322,6 +3047,7 @@ store_global_options(JSON_Object *root)
 	append_dstr(options, format_str("%skeepsel", cfg.keep_sel ? "" : "no"));
 	append_dstr(options, format_str("%slaststatus",
 				cfg.display_statusline ? "" : "no"));
+	append_dstr(options, format_str("%slazylinks", cfg.lazy_links ? "" : "no"));
 	append_dstr(options, format_str("%stitle", cfg.set_title ? "" : "no"));
 	append_dstr(options, format_str("lines=%d", cfg.lines));
 	append_dstr(options, format_str("locateprg=%s",
@@ -2358,6 +3084,7 @@ store_global_options(JSON_Object *root)
 				cfg.sort_numbers ? "" : "no"));
 	append_dstr(options, format_str("statusline=%s",
 				escape_spaces(cfg.status_line)));
+	append_dstr(options, format_str("statworkers=%d", cfg.stat_workers));
 	append_dstr(options, format_str("tabline=%s",
 				escape_spaces(vle_opts_get("tabline", OPT_GLOBAL))));
 	append_dstr(options, format_str("syncregs=%s",
@@ -2400,6 +3127,7 @@ store_global_options(JSON_Object *root)
 			escape_spaces(vle_opts_get("suggestoptions", OPT_GLOBAL))));
 	append_dstr(options, format_str("iooptions=%s",
 			escape_spaces(vle_opts_get("iooptions", OPT_GLOBAL))));
+	append_dstr(options, format_str("ioworkers=%d", cfg.io_workers));
 
 	append_dstr(options, format_str("dirsize=%s",
 				cfg.view_dir_size == VDS_SIZE ? "size" : "nitems"));
@@ -2535,12 +3263,37 @@ store_cmds(JSON_Object *root)
 	}
 }
 
-/* Serializes marks into JSON table. */
+/* Serializes marks into JSON table.  In delta mode only marks changed since
+ * the last store are serialized including removed ones. */
 static void
-store_marks(JSON_Object *root)
+store_marks(JSON_Object *root, int delta)
 {
 	JSON_Object *marks = add_object(root, "marks");
 
+	if(delta)
+	{
+		int i;
+		for(i = 0; i < NUM_MARKS; ++i)
+		{
+			const mark_t *const mark = marks_by_index(curr_view, i);
+			if(marks_is_special(i) || mark->timestamp == (time_t)-1 ||
+					mark->timestamp < journal_since)
+			{
+				continue;
+			}
+
+			char name[] = { marks_resolve_index(i), '\0' };
+			JSON_Object *entry = add_object(marks, name);
+			if(mark->directory != NULL)
+			{
+				set_str(entry, "dir", mark->directory);
+				set_str(entry, "file", mark->file);
+			}
+			set_double(entry, "ts", (double)mark->timestamp);
+		}
+		return;
+	}
+
 	int active_marks[NUM_MARKS];
 	const int len = marks_list_active(curr_view, marks_all, active_marks);
 
@@ -2562,12 +3315,20 @@ store_marks(JSON_Object *root)
 	}
 }
 
-/* Serializes bookmarks into JSON table. */
+/* Serializes bookmarks into JSON table.  In delta mode only bookmarks changed
+ * since the last store are serialized including removed ones. */
 static void
-store_bmarks(JSON_Object *root)
+store_bmarks(JSON_Object *root, int delta)
 {
 	JSON_Object *bmarks = add_object(root, "bmarks");
-	bmarks_list(&store_bmark, bmarks);
+	if(delta)
+	{
+		bmarks_list_changed(journal_since, &store_bmark, bmarks);
+	}
+	else
+	{
+		bmarks_list(&store_bmark, bmarks);
+	}
 }
 
 /* bmarks_list() callback that writes a bookmark into JSON. */
@@ -2665,31 +3426,55 @@ save_rating_info(JSON_Object *root)
 {
 	JSON_Array *ratings = add_array(root, "ratings");
 
+	/* The list is kept intact as the state can be stored more than once (e.g.,
+	 * by :write or on switching sessions). */
 	rating_entry_t *entry = rating_list;
 	while (entry != NULL)
 	{
-		rating_entry_t *temp = entry->next;
-
 		if (entry->star > 0)
 		{
+			char *path = strdup(entry->path);
+			if (path == NULL)
+			{
+				entry = entry->next;
+				continue;
+			}
+
 			if (entry->flag == DECRYPTED)
 			{
-				str_rot_encrypt(entry->path);
+				str_rot_encrypt(path);
 			}
 
 			JSON_Object *obj = append_object(ratings);
 			set_int(obj, "star", entry->star);
-			set_str(obj, "path", entry->path);
+			set_str(obj, "path", path);
+			free(path);
 		}
 
-		if (entry->path != NULL)
-		{
-			free(entry->path);
-		}
+		entry = entry->next;
+	}
+}
+
+/* Serializes ratings that were changed since the last store.  Removed ratings
+ * are stored with zero stars. */
+static void
+store_rating_changes(JSON_Object *root)
+{
+	if (rating_changes.nitems == 0)
+	{
+		return;
+	}
+
+	JSON_Array *ratings = add_array(root, "ratings");
 
-		free(entry);
+	int i;
+	for (i = 0; i < rating_changes.nitems; ++i)
+	{
+		const rating_entry_t *entry = search_stored_rating(rating_changes.items[i]);
 
-		entry = temp;
+		JSON_Object *obj = append_object(ratings);
+		set_int(obj, "star", (entry == NULL ? 0 : entry->star));
+		set_str(obj, "path", rating_changes.items[i]);
 	}
 }
 
@@ -2717,7 +3502,12 @@ load_rating_info(JSON_Object *root)
 				str_rot_encrypt(path);
 			}
 
-			(void)create_rating_info(star, path, flag);
+			/* Entries that are already known (on rereading the state) have more
+			 * recent values. */
+			if (search_rating_info(path) == NULL)
+			{
+				(void)create_rating_info(star, path, flag);
+			}
 		}
 	}
 }
@@ -3059,6 +3849,23 @@ get_rating_list()
 	return rating_list;
 }
 
+void
+clear_ratings(void)
+{
+	while (rating_list != NULL)
+	{
+		rating_entry_t *next = rating_list->next;
+		free(rating_list->path);
+		free(rating_list);
+		rating_list = next;
+	}
+
+	trie_free(rating_index);
+	rating_index = NULL;
+
+	forget_rating_changes();
+}
+
 static rating_entry_t *
 create_rating_info(int star, char path[], int flag)
 {
@@ -3087,10 +3894,48 @@ create_rating_info(int star, char path[], int flag)
 	//add this new entry into rating list
 	entry->next = rating_list;
 	rating_list = entry;
+	index_rating_entry(entry->path, entry);
 
 	return entry;
 }
 
+/* Maps path onto an entry in the rating index (NULL entry removes the path). */
+static void
+index_rating_entry(const char path[], rating_entry_t *entry)
+{
+	if (rating_index == NULL)
+	{
+		rating_index = trie_create(/*free_func=*/NULL);
+	}
+
+	if (trie_set(rating_index, path, entry) < 0)
+	{
+		/* Lookups will miss this entry, but that's better than keeping the index
+		 * in an inconsistent state. */
+		LOG_ERROR_MSG("Failed to index rating of %s", path);
+	}
+}
+
+/* Changes path of an entry keeping the index in sync. */
+static void
+rename_rating_entry(rating_entry_t *entry, const char path[])
+{
+	char *new_path = strdup(path);
+	if (new_path == NULL)
+	{
+		return;
+	}
+
+	if (search_rating_info(entry->path) == entry)
+	{
+		index_rating_entry(entry->path, NULL);
+	}
+
+	free(entry->path);
+	entry->path = new_path;
+	index_rating_entry(entry->path, entry);
+}
+
 static rating_entry_t *
 search_rating_info(const char path[])
 {
@@ -3099,18 +3944,88 @@ search_rating_info(const char path[])
 		return NULL;
 	}
 
-	rating_entry_t *entry = rating_list;
-	while (entry != NULL)
+	void *data;
+	if (trie_get(rating_index, path, &data) != 0)
 	{
-		if (!strcmp(entry->path, path))
-		{
-			return entry;
-		}
+		return NULL;
+	}
 
-		entry = entry->next;
+	/* Data is NULL for paths that were renamed. */
+	return data;
+}
+
+/* Looks up an entry by its path in the form it's stored in vifminfo.  Returns
+ * the entry or NULL. */
+static rating_entry_t *
+search_stored_rating(const char path[])
+{
+	rating_entry_t *entry = search_rating_info(path);
+	if (entry != NULL && entry->flag == ENCRYPTED)
+	{
+		return entry;
+	}
+
+	char *decrypted = strdup(path);
+	if (decrypted == NULL)
+	{
+		return NULL;
+	}
+
+	str_rot_decrypt(decrypted);
+	entry = search_rating_info(decrypted);
+	free(decrypted);
+
+	return (entry != NULL && entry->flag == DECRYPTED ? entry : NULL);
+}
+
+/* Remembers that rating of the entry has changed, so that the change gets into
+ * the journal. */
+static void
+note_rating_change(const rating_entry_t *entry)
+{
+	if (entry == NULL)
+	{
+		return;
+	}
+
+	char *path = strdup(entry->path);
+	if (path == NULL)
+	{
+		return;
+	}
+
+	if (entry->flag == DECRYPTED)
+	{
+		str_rot_encrypt(path);
+	}
+
+	if (rating_changes_set == NULL)
+	{
+		rating_changes_set = trie_create(/*free_func=*/NULL);
+	}
+
+	/* trie_put() returns zero only for new keys. */
+	if (trie_put(rating_changes_set, path) != 0 ||
+			put_into_string_array(&rating_changes.items, rating_changes.nitems,
+				path) != rating_changes.nitems + 1)
+	{
+		free(path);
+		return;
 	}
 
-	return NULL;
+	++rating_changes.nitems;
+}
+
+/* Empties list of changed ratings. */
+static void
+forget_rating_changes(void)
+{
+	free_string_array(rating_changes.items, rating_changes.nitems);
+	rating_changes.items = NULL;
+	rating_changes.nitems = 0;
+
+	trie_free(rating_changes_set);
+	rating_changes_set = NULL;
 }
 
 static void
@@ -3145,11 +4060,14 @@ update_rating_info(int star, char path[], int flag)
 	rating_entry_t *entry = search_rating_info(path);
 	if (NULL == entry)
 	{
-		(void)create_rating_info(star, path, flag);
-		return;
+		entry = create_rating_info(star, path, flag);
+	}
+	else
+	{
+		update_rating_star(entry, star);
 	}
 
-	update_rating_star(entry, star);
+	note_rating_change(entry);
 	return;
 }
 
@@ -3180,6 +4098,7 @@ set_rating_stars(int star, char path[])
 	if (entry != NULL)
 	{
 		entry->star = star;
+		note_rating_change(entry);
 	}
 }
 
@@ -3259,11 +4178,13 @@ copy_rating_info(const char src[], const char dst[], int op)
 	if (op == 0)  //rm
 	{
 		entry->star = 0;
+		note_rating_change(entry);
 	}
 	else if (op == 1)  //mv
 	{
-		free(entry->path);
-		entry->path = strdup(dst);
+		note_rating_change(entry);
+		rename_rating_entry(entry, dst);
+		note_rating_change(entry);
 	}
 	else if (op == 2)  //cp
 	{
@@ -3301,7 +4222,7 @@ decrypt_rating_path(char path[])
 	}
 
 	str_rot_decrypt(path);
-	entry->path = strdup(path);
+	rename_rating_entry(entry, path);
 	entry->flag = DECRYPTED;
 	return;
 }
@@ -3399,9 +4320,9 @@ sessions_load(const char name[])
 		return 1;
 	}
 
-	char info_file[PATH_MAX + 16];
-	snprintf(info_file, sizeof(info_file), "%s/vifminfo.json", cfg.config_dir);
-	JSON_Value *common = json_parse_file(info_file);
+	char info_file[PATH_MAX + 32], journal_file[PATH_MAX + 32];
+	get_info_paths(info_file, journal_file, sizeof(info_file));
+	JSON_Value *common = read_info_file(info_file, journal_file);
 	restore_locale(locale);
 
 	if(common != NULL)
@@ -3426,6 +4347,11 @@ static void
 set_session(const char new_session[])
 {
 	update_string(&cfg.session, new_session);
+
+	/* State of a different session might be missing from vifminfo.json, so
+	 * the next store should merge it in full instead of journaling changes. */
+	snapshot_vinfo = -1;
+
 	if(session_changed_cb != NULL)
 	{
 		session_changed_cb(sessions_current());
@@ -3450,12 +4376,15 @@ write_session_file(void)
 	snprintf(session_file, sizeof(session_file), "%s/%s.json", sessions_dir,
 			cfg.session);
 
-	store_file(session_file, &session_mon, cfg.session_options);
+	(void)store_file(session_file, &session_mon, cfg.session_options,
+			/*journal=*/NULL);
 }
 
-/* Writes file updating it with state of the current instance if necessary. */
-static void
-store_file(const char path[], filemon_t *mon, int vinfo)
+/* Writes file updating it with state of the current instance if necessary.
+ * Records of the journal (if it's not NULL) are merged in as well.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+store_file(const char path[], filemon_t *mon, int vinfo, const char journal[])
 {
 	char tmp_file[PATH_MAX + 64];
 	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", path, get_pid());
@@ -3464,17 +4393,22 @@ store_file(const char path[], filemon_t *mon, int vinfo)
 	{
 		filemon_t current_mon;
 		int file_changed = filemon_from_file(path, FMT_MODIFIED, &current_mon) != 0
-		                || !filemon_equal(mon, &current_mon);
+		                || !filemon_equal(mon, &current_mon)
+		                || (journal != NULL && path_exists(journal, NODEREF));
 
-		update_info_file(tmp_file, vinfo, file_changed);
+		update_info_file(tmp_file, vinfo, file_changed, journal);
 		(void)filemon_from_file(tmp_file, FMT_MODIFIED, mon);
 
 		if(rename_file(tmp_file, path) != 0)
 		{
 			LOG_ERROR_MSG("Can't replace \"%s\" file with updated temporary", path);
 			(void)remove(tmp_file);
+			return 1;
 		}
+		return 0;
 	}
+
+	return 1;
 }
 
 int
@@ -18,13 +18,18 @@
 
 #include "compare.h"
 
+#include <pthread.h> /* pthread_mutex_* */
+
 #include <assert.h> /* assert() */
+#include <inttypes.h> /* PRIx64 */
 #include <stddef.h> /* size_t */
-#include <stdint.h> /* INTPTR_MAX INT64_MAX */
-#include <stdio.h> /* FILE fclose() feof() fopen() fread() */
-#include <stdlib.h> /* free() malloc() */
-#include <string.h> /* memcmp() */
+#include <stdint.h> /* INTPTR_MAX INT64_MAX uint64_t */
+#include <stdio.h> /* FILE SEEK_SET fclose() feof() ferror() fopen() fread()
+                      fseeko() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcmp() strchr() strcmp() */
 
+#include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
 #include "compat/reallocarray.h"
@@ -32,22 +37,28 @@
 #include "ui/cancellation.h"
 #include "ui/statusbar.h"
 #include "ui/ui.h"
+#include "utils/cancellation.h"
 #include "utils/dynarray.h"
 #include "utils/fs.h"
 #include "utils/fsdata.h"
+#include "utils/log.h"
 #include "utils/macros.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/trie.h"
 #include "utils/utils.h"
+#include "background.h"
 #include "filelist.h"
 #include "filtering.h"
 #include "flist_sel.h"
 #include "fops_common.h"
 #include "fops_cpmv.h"
 #include "fops_misc.h"
+#include "hcache.h"
 #include "running.h"
+#include "status.h"
 #include "undo.h"
 
 /*
@@ -64,17 +75,31 @@
  *       * compute contents fingerprint for current file and insert it
  *   - there is more than one conflicting file:
  *       * compute contents fingerprint for current file and insert it
+ *
+ * Sizes of all files are known before matching starts, which allows finding
+ * files that will need contents fingerprint in advance.  Fingerprints of such
+ * files are computed by several threads at once and then are just picked up by
+ * the procedure described above, files of unique size are still never read.
+ *
+ * Precomputed fingerprints are obtained in two stages:
+ *  1. Head, middle and tail of files of non-unique size are hashed.
+ *  2. Whole contents of files whose samples collide are hashed (XXH3-128).
+ * Digests of whole files are trusted to identify contents, so each file is read
+ * at most once after sampling instead of being compared against every other
+ * file of the same fingerprint.  Byte-by-byte comparison remains only for
+ * fingerprints computed during matching (when prefetching has failed).
  */
 
-/* This is the only unit that uses xxhash, so import it directly here. */
+/* xxhash isn't compiled on its own, so import it directly here. */
 #define XXH_PRIVATE_API
 #include "utils/xxhash.h"
 
 /* Amount of data to read at once when comparing files in full. */
 #define BLOCK_SIZE (32*1024)
 
-/* Amount of data to hash for coarse comparison. */
-#define PREFIX_SIZE (4*1024)
+/* Size of each of the three samples of contents (head, middle and tail) to
+ * hash for coarse comparison. */
+#define SAMPLE_SIZE (4*1024)
 
 /* Entry in singly-bounded list of files that have matched fingerprints. */
 typedef struct compare_record_t
@@ -82,12 +107,92 @@ typedef struct compare_record_t
 	struct compare_record_t *next; /* Next entry in the list of conflicts. */
 	char *path;                    /* Full path to file with sample content. */
 	int id;                        /* Chosen id. */
+	char *fingerprint;             /* Precomputed contents fingerprint of a
+	                                  partial record or NULL. */
 	unsigned is_partial : 1;       /* Shows that fingerprinting was lazy. */
 	unsigned is_readable : 1;      /* Shows that this file can be read.  If not,
 	                                  its contents is assumed to be empty. */
 }
 compare_record_t;
 
+/* Files of one of the compared views. */
+typedef struct
+{
+	view_t *view;        /* View that provided the files. */
+	strlist_t files;     /* Paths to files in order of listing. */
+	entries_t entries;   /* Entries of the files, tag is an index in files. */
+	char **fingerprints; /* Precomputed contents fingerprints or NULLs indexed
+	                        the same way as files. */
+	int dups_only;       /* Whether files are only matched against those of
+	                        preceding views and aren't added for lookup. */
+}
+diff_side_t;
+
+/* State of comparison that runs in background.  Shared between the main thread
+ * and the background job. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects fields up to the ct field. */
+	int refs;             /* Number of owners (main thread and the job). */
+	int cancelled;        /* Whether results of comparison aren't needed. */
+	int finished;         /* Whether the job is done. */
+	int interrupted;      /* Whether the job was cancelled by the user. */
+
+	CompareType ct;       /* Type of comparison.  Doesn't change. */
+	ListType lt;          /* Type of resulting list.  Doesn't change. */
+	int flags;            /* Comparison flags.  Doesn't change. */
+	int nsides;           /* Number of compared views.  Doesn't change. */
+	diff_side_t sides[2]; /* Compared files.  Owned by the job until it's
+	                         finished. */
+	compare_counters_t counters; /* Counters of stages.  Owned by the job until
+	                                it's finished. */
+	char *dirs[2];        /* Locations of compared views at the start.  Accessed
+	                         only by the main thread. */
+}
+compare_job_t;
+
+/* Arguments of job_cancellation_hook(). */
+typedef struct
+{
+	compare_job_t *job; /* Comparison. */
+	bg_op_t *bg_op;     /* Background operation of the comparison. */
+}
+job_cancellation_t;
+
+/* Request for computing contents fingerprint of a file. */
+typedef struct
+{
+	const char *path;        /* Path to the file. */
+	unsigned long long size; /* Size of the file. */
+	int is_readable;         /* Whether contents of the file can be read. */
+	int dups_only;           /* Whether the file is only looked up. */
+	int cached;              /* Number of digests taken from the cache. */
+	char **fingerprint;      /* Where to store the result. */
+}
+hash_task_t;
+
+/* Arguments of hash_file(). */
+typedef struct
+{
+	hash_task_t *tasks;                 /* Files to process. */
+	const cancellation_t *cancellation; /* Cancellation of comparison. */
+	bg_op_t *bg_op;                     /* Progress or NULL in foreground. */
+	int full;                           /* Whether whole files are hashed. */
+}
+hash_args_t;
+
+static int run_comparison(diff_side_t sides[], int nsides, CompareType ct,
+		ListType lt, int flags);
+static int start_bg_comparison(diff_side_t sides[], int nsides,
+		CompareType ct, ListType lt, int flags);
+static void compare_bg(bg_op_t *bg_op, void *arg);
+static int job_cancellation_hook(void *arg);
+static void drop_bg_comparison(void);
+static void release_job(compare_job_t *job);
+static int show_results(diff_side_t sides[], int nsides, CompareType ct,
+		ListType lt, int flags);
+static int show_two_panes(entries_t curr, entries_t other, CompareType ct,
+		ListType lt, int flags);
 static void make_unique_lists(entries_t curr, entries_t other);
 static void leave_only_dups(entries_t *curr, entries_t *other);
 static int is_not_duplicate(view_t *view, const dir_entry_t *entry, void *arg);
@@ -99,9 +204,33 @@ static int compare_entries(dir_entry_t *curr, dir_entry_t *other, int flags);
 static void put_side_by_side_pair(dir_entry_t *curr, dir_entry_t *other,
 		int flags, compare_stats_t *stats);
 static int id_sorter(const void *first, const void *second);
+static int show_one_pane(view_t *view, entries_t curr, ListType lt,
+		int flags);
 static void put_or_free(view_t *view, dir_entry_t *entry, int id, int take);
-static entries_t make_diff_list(trie_t *trie, view_t *view, int *next_id,
-		CompareType ct, int dups_only, int flags);
+static void list_side(diff_side_t *side, int flags);
+static void match_sides(diff_side_t sides[], int nsides, CompareType ct,
+		int flags, const cancellation_t *cancellation, bg_op_t *bg_op,
+		compare_counters_t *counters);
+static void query_side(diff_side_t *side, int flags,
+		const cancellation_t *cancellation, bg_op_t *bg_op);
+static void prefetch_fingerprints(diff_side_t sides[], int nsides,
+		const cancellation_t *cancellation, bg_op_t *bg_op,
+		compare_counters_t *counters);
+static unsigned long long * collect_sizes(diff_side_t sides[], int nsides,
+		int dups_only, int *count);
+static int count_size(const unsigned long long sizes[], int count,
+		unsigned long long size);
+static int size_sorter(const void *first, const void *second);
+static int pick_sample_collisions(hash_task_t tasks[], int ntasks);
+static int task_sorter(const void *first, const void *second);
+static void hash_file(int i, void *arg);
+static void assign_ids(trie_t *trie, diff_side_t *side, int *next_id,
+		CompareType ct, int flags, const cancellation_t *cancellation,
+		bg_op_t *bg_op);
+static void free_side(diff_side_t *side);
+static void start_stage(bg_op_t *bg_op, const char stage[], int total);
+static void report_stage(bg_op_t *bg_op, const char stage[], int done,
+		int total);
 static void list_view_entries(const view_t *view, strlist_t *list);
 static int append_valid_nodes(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
@@ -110,27 +239,37 @@ static void list_files_recursively(const view_t *view, const char path[],
 static char * get_file_fingerprint(const char path[], const dir_entry_t *entry,
 		CompareType ct, int flags, int lazy);
 static char * get_contents_fingerprint(const char path[], int is_readable,
-		unsigned long long size);
+		unsigned long long size, int *cached);
+static size_t read_samples(FILE *in, unsigned long long size, char buf[]);
+static char * get_full_fingerprint(const char path[], int is_readable,
+		const char sample_fp[], int *cached);
+static int hash_whole_file(const char path[], uint64_t digest[2], int *cached);
+static int is_full_fingerprint(const char fingerprint[]);
 static int add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
-		CompareType ct, int dups_only, int flags, int *next_id);
+		const char contents_fp[], CompareType ct, int dups_only, int flags,
+		int *next_id);
 static int filetype_is_readable(FileType type);
 static int files_are_identical(const char a[], int a_readable, const char b[],
 		int b_readable);
 static int file_is_empty(const char path[]);
 static void put_file_id(trie_t *trie, const char path[],
 		const char fingerprint[], int id, int is_readable, int is_partial,
-		CompareType ct);
+		const char contents_fp[], CompareType ct);
 static void free_compare_records(void *ptr);
 static void compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx);
 
+/* Comparison that runs in background or NULL. */
+static compare_job_t *bg_comparison;
+
+/* Counters of the last comparison whose results were shown. */
+static compare_counters_t last_counters;
+
 int
 compare_two_panes(CompareType ct, ListType lt, int flags)
 {
 	assert((flags & (CF_IGNORE_CASE | CF_RESPECT_CASE)) !=
 			(CF_IGNORE_CASE | CF_RESPECT_CASE) && "Wrong combination of flags.");
 
-	const int group_paths = flags & CF_GROUP_PATHS;
-
 	/* We don't compare lists of files, so skip the check if at least one of the
 	 * views is a custom one. */
 	if(!flist_custom_active(&lwin) && !flist_custom_active(&rwin) &&
@@ -140,29 +279,288 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 		return 1;
 	}
 
-	int next_id = 1;
-	entries_t curr, other;
+	diff_side_t sides[] = {
+		{ .view = curr_view },
+		{ .view = other_view, .dups_only = (lt == LT_DUPS) },
+	};
+	return run_comparison(sides, ARRAY_LEN(sides), ct, lt, flags);
+}
+
+/* Lists files of views and matches them either right away or in background
+ * (results are displayed on completion in this case).  Returns non-zero if
+ * status bar message should be preserved. */
+static int
+run_comparison(diff_side_t sides[], int nsides, CompareType ct, ListType lt,
+		int flags)
+{
+	int i;
+
+	/* Results of previous comparison would overwrite these ones. */
+	drop_bg_comparison();
 
-	trie_t *const trie = trie_create(&free_compare_records);
 	ui_cancellation_push_on();
+	for(i = 0; i < nsides && !ui_cancellation_requested(); ++i)
+	{
+		list_side(&sides[i], flags);
+	}
+
+	/* Only reading files can take long enough to be worth doing in background.
+	 * Startup commands expect results to be available right away. */
+	if(!ui_cancellation_requested() && ct == CT_CONTENTS &&
+			curr_stats.load_stage >= 3 &&
+			start_bg_comparison(sides, nsides, ct, lt, flags) == 0)
+	{
+		ui_cancellation_pop();
+		ui_sb_quick_msg_clear();
+		return 0;
+	}
 
-	curr = make_diff_list(trie, curr_view, &next_id, ct, /*dups_only=*/0, flags);
-	other = make_diff_list(trie, other_view, &next_id, ct, lt == LT_DUPS, flags);
+	compare_counters_t counters = {};
+	if(!ui_cancellation_requested())
+	{
+		match_sides(sides, nsides, ct, flags, &ui_cancellation_info,
+				/*bg_op=*/NULL, &counters);
+	}
 
 	ui_cancellation_pop();
-	trie_free(trie);
 
-	/* Clear progress message displayed by make_diff_list(). */
+	/* Clear progress message displayed by match_sides(). */
 	ui_sb_quick_msg_clear();
 
+	int result;
 	if(ui_cancellation_requested())
 	{
-		free_dir_entries(&curr.entries, &curr.nentries);
-		free_dir_entries(&other.entries, &other.nentries);
 		ui_sb_msg("Comparison has been cancelled");
+		result = 1;
+	}
+	else
+	{
+		last_counters = counters;
+		result = show_results(sides, nsides, ct, lt, flags);
+	}
+
+	for(i = 0; i < nsides; ++i)
+	{
+		free_side(&sides[i]);
+	}
+	return result;
+}
+
+/* Starts matching files of views in background.  The sides are owned by the
+ * job on success.  Returns zero on success, otherwise non-zero is returned. */
+static int
+start_bg_comparison(diff_side_t sides[], int nsides, CompareType ct,
+		ListType lt, int flags)
+{
+	compare_job_t *const job = calloc(1, sizeof(*job));
+	if(job == NULL)
+	{
+		return 1;
+	}
+
+	if(pthread_mutex_init(&job->lock, NULL) != 0)
+	{
+		free(job);
 		return 1;
 	}
 
+	job->refs = 2;
+	job->ct = ct;
+	job->lt = lt;
+	job->flags = flags;
+	job->nsides = nsides;
+
+	int i;
+	for(i = 0; i < nsides; ++i)
+	{
+		job->sides[i] = sides[i];
+		job->dirs[i] = strdup(flist_get_dir(sides[i].view));
+	}
+
+	if(bg_execute("Comparing files", job->dirs[0], BG_UNDEFINED_TOTAL,
+				/*important=*/0, &compare_bg, job) != 0)
+	{
+		/* The sides are still owned by the caller. */
+		job->nsides = 0;
+		job->refs = 1;
+		release_job(job);
+		return 1;
+	}
+
+	for(i = 0; i < nsides; ++i)
+	{
+		sides[i] = (diff_side_t){ .view = sides[i].view };
+	}
+
+	bg_comparison = job;
+	return 0;
+}
+
+/* Entry point of the background job that matches files. */
+static void
+compare_bg(bg_op_t *bg_op, void *arg)
+{
+	compare_job_t *const job = arg;
+
+	job_cancellation_t cancellation_arg = { .job = job, .bg_op = bg_op };
+	const cancellation_t cancellation = {
+		.arg = &cancellation_arg,
+		.hook = &job_cancellation_hook,
+	};
+
+	match_sides(job->sides, job->nsides, job->ct, job->flags, &cancellation,
+			bg_op, &job->counters);
+
+	pthread_mutex_lock(&job->lock);
+	job->finished = 1;
+	job->interrupted = bg_op_cancelled(bg_op);
+	pthread_mutex_unlock(&job->lock);
+
+	release_job(job);
+}
+
+/* Implementation of cancellation hook for background comparison.  Returns
+ * non-zero if comparison should stop. */
+static int
+job_cancellation_hook(void *arg)
+{
+	job_cancellation_t *const cancellation_arg = arg;
+	compare_job_t *const job = cancellation_arg->job;
+
+	pthread_mutex_lock(&job->lock);
+	const int cancelled = job->cancelled;
+	pthread_mutex_unlock(&job->lock);
+
+	return cancelled || bg_op_cancelled(cancellation_arg->bg_op);
+}
+
+int
+compare_update_from_job(void)
+{
+	compare_job_t *const job = bg_comparison;
+	if(job == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&job->lock);
+	const int finished = job->finished;
+	const int interrupted = job->interrupted;
+	pthread_mutex_unlock(&job->lock);
+
+	if(!finished)
+	{
+		return 1;
+	}
+
+	bg_comparison = NULL;
+
+	int i;
+	int moved = 0;
+	for(i = 0; i < job->nsides; ++i)
+	{
+		if(job->dirs[i] == NULL ||
+				stroscmp(job->dirs[i], flist_get_dir(job->sides[i].view)) != 0)
+		{
+			moved = 1;
+		}
+	}
+
+	if(interrupted)
+	{
+		ui_sb_msg("Comparison has been cancelled");
+	}
+	else if(moved)
+	{
+		ui_sb_msg("Comparison results were dropped due to change of location");
+	}
+	else
+	{
+		/* Roles of views might have changed in the meantime, while comparison is
+		 * framed in terms of the current view. */
+		view_t *const view = job->sides[0].view;
+		view_t *old_curr, *old_other;
+		ui_view_pick(view, &old_curr, &old_other);
+		last_counters = job->counters;
+		(void)show_results(job->sides, job->nsides, job->ct, job->lt, job->flags);
+		ui_view_unpick(view, old_curr, old_other);
+	}
+
+	release_job(job);
+	return 0;
+}
+
+/* Stops comparison that runs in background, if any. */
+static void
+drop_bg_comparison(void)
+{
+	compare_job_t *const job = bg_comparison;
+	if(job == NULL)
+	{
+		return;
+	}
+
+	bg_comparison = NULL;
+
+	pthread_mutex_lock(&job->lock);
+	job->cancelled = 1;
+	pthread_mutex_unlock(&job->lock);
+
+	release_job(job);
+}
+
+/* Drops a reference to the job freeing it after the last one. */
+static void
+release_job(compare_job_t *job)
+{
+	pthread_mutex_lock(&job->lock);
+	const int last = (--job->refs == 0);
+	pthread_mutex_unlock(&job->lock);
+
+	if(last)
+	{
+		int i;
+		for(i = 0; i < job->nsides; ++i)
+		{
+			free_side(&job->sides[i]);
+		}
+		for(i = 0; i < (int)ARRAY_LEN(job->dirs); ++i)
+		{
+			free(job->dirs[i]);
+		}
+		pthread_mutex_destroy(&job->lock);
+		free(job);
+	}
+}
+
+/* Displays results of matching files in one or two views.  Entries are moved
+ * out of the sides.  Returns non-zero if status bar message should be
+ * preserved. */
+static int
+show_results(diff_side_t sides[], int nsides, CompareType ct, ListType lt,
+		int flags)
+{
+	entries_t curr = sides[0].entries;
+	sides[0].entries = (entries_t){};
+
+	if(nsides == 1)
+	{
+		return show_one_pane(sides[0].view, curr, lt, flags);
+	}
+
+	entries_t other = sides[1].entries;
+	sides[1].entries = (entries_t){};
+	return show_two_panes(curr, other, ct, lt, flags);
+}
+
+/* Fills both views with results of comparison.  Takes ownership of the
+ * entries.  Returns non-zero if status bar message should be preserved. */
+static int
+show_two_panes(entries_t curr, entries_t other, CompareType ct, ListType lt,
+		int flags)
+{
+	const int group_paths = flags & CF_GROUP_PATHS;
+
 	if(!group_paths || lt != LT_ALL)
 	{
 		/* Sort both lists according to unique file numbers to group identical files
@@ -602,32 +1000,21 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags)
 	assert((flags & (CF_IGNORE_CASE | CF_RESPECT_CASE)) !=
 			(CF_IGNORE_CASE | CF_RESPECT_CASE) && "Wrong combination of flags.");
 
+	diff_side_t side = { .view = view };
+	return run_comparison(&side, 1, ct, lt, flags);
+}
+
+/* Fills the view with results of comparison of its files.  Takes ownership of
+ * the entries.  Returns non-zero if status bar message should be preserved. */
+static int
+show_one_pane(view_t *view, entries_t curr, ListType lt, int flags)
+{
 	int i, dup_id;
+	int next_id;
 	view_t *other = (view == curr_view) ? other_view : curr_view;
 	const char *const title = (lt == LT_ALL)  ? "compare"
 	                        : (lt == LT_DUPS) ? "dups" : "nondups";
 
-	int next_id = 1;
-	entries_t curr;
-
-	trie_t *trie = trie_create(&free_compare_records);
-	ui_cancellation_push_on();
-
-	curr = make_diff_list(trie, view, &next_id, ct, /*dups_only=*/0, flags);
-
-	ui_cancellation_pop();
-	trie_free(trie);
-
-	/* Clear progress message displayed by make_diff_list(). */
-	ui_sb_quick_msg_clear();
-
-	if(ui_cancellation_requested())
-	{
-		free_dir_entries(&curr.entries, &curr.nentries);
-		ui_sb_msg("Comparison has been cancelled");
-		return 1;
-	}
-
 	safe_qsort(curr.entries, curr.nentries, sizeof(*curr.entries), &id_sorter);
 
 	flist_custom_start(view, title);
@@ -715,39 +1102,74 @@ put_or_free(view_t *view, dir_entry_t *entry, int id, int take)
 	}
 }
 
-/* Makes sorted by path list of entries that.  The trie is used to keep track of
- * identical files.  With non-zero dups_only, new files aren't added to the
- * trie. */
-static entries_t
-make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
-		int dups_only, int flags)
+/* Collects paths of files of the view to be compared. */
+static void
+list_side(diff_side_t *side, int flags)
 {
-	const int skip_empty = flags & CF_SKIP_EMPTY;
-
-	int i;
-	strlist_t files = {};
-	entries_t r = {};
-	int last_progress = 0;
+	view_t *const view = side->view;
 
 	show_progress("Listing...", 0);
 	if(flist_custom_active(view) &&
 			ONE_OF(view->custom.type, CV_REGULAR, CV_VERY))
 	{
-		list_view_entries(view, &files);
+		list_view_entries(view, &side->files);
 	}
 	else
 	{
 		list_files_recursively(view, flist_get_dir(view), view->hide_dot, flags,
-				&files);
+				&side->files);
+	}
+}
+
+/* Queries information about listed files and assigns ids to them so that
+ * identical files share the same id.  Entries of files that should be skipped
+ * are freed.  Order of files is preserved. */
+static void
+match_sides(diff_side_t sides[], int nsides, CompareType ct, int flags,
+		const cancellation_t *cancellation, bg_op_t *bg_op,
+		compare_counters_t *counters)
+{
+	int i;
+
+	for(i = 0; i < nsides && !cancellation_requested(cancellation); ++i)
+	{
+		query_side(&sides[i], flags, cancellation, bg_op);
+		counters->files += sides[i].entries.nentries;
+	}
+
+	if(ct == CT_CONTENTS && !cancellation_requested(cancellation))
+	{
+		prefetch_fingerprints(sides, nsides, cancellation, bg_op, counters);
+		LOG_INFO_MSG("Comparing %d files: %d sampled, %d hashed, %d cached",
+				counters->files, counters->sampled, counters->hashed,
+				counters->cached);
+	}
+
+	int next_id = 1;
+	trie_t *const trie = trie_create(&free_compare_records);
+	for(i = 0; i < nsides && !cancellation_requested(cancellation); ++i)
+	{
+		assign_ids(trie, &sides[i], &next_id, ct, flags, cancellation, bg_op);
 	}
+	trie_free(trie);
+}
 
-	show_progress("Querying...", 0);
-	for(i = 0; i < files.nitems && !ui_cancellation_requested(); ++i)
+/* Makes list of entries of listed files, which is sorted by path. */
+static void
+query_side(diff_side_t *side, int flags, const cancellation_t *cancellation,
+		bg_op_t *bg_op)
+{
+	const int skip_empty = flags & CF_SKIP_EMPTY;
+	strlist_t *const files = &side->files;
+	entries_t *const r = &side->entries;
+
+	int i;
+	start_stage(bg_op, "Querying...", files->nitems);
+	for(i = 0; i < files->nitems && !cancellation_requested(cancellation); ++i)
 	{
-		int progress;
-		const char *const path = files.items[i];
-		dir_entry_t *const entry = entry_list_add(view, &r.entries, &r.nentries,
-				path);
+		const char *const path = files->items[i];
+		dir_entry_t *const entry = entry_list_add(/*view=*/NULL, &r->entries,
+				&r->nentries, path);
 		if(entry == NULL)
 		{
 			/* Maybe the file doesn't exist anymore, maybe we've lost access to it or
@@ -758,34 +1180,396 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 		if(skip_empty && entry->size == 0)
 		{
 			fentry_free(entry);
-			--r.nentries;
+			--r->nentries;
 			continue;
 		}
 
 		entry->tag = i;
-		entry->id = add_file_to_diff(trie, path, entry, ct, dups_only, flags,
-				next_id);
+		report_stage(bg_op, "Querying...", i, files->nitems);
+	}
+}
+
+/* Computes contents fingerprints of all files which can't be told apart by
+ * size, i.e. of those that are going to be fingerprinted during matching
+ * anyway.  Files which can't be told apart by samples of contents get digest
+ * of whole contents.  Fingerprints are computed in parallel. */
+static void
+prefetch_fingerprints(diff_side_t sides[], int nsides,
+		const cancellation_t *cancellation, bg_op_t *bg_op,
+		compare_counters_t *counters)
+{
+	int i, j;
+
+	/* Sizes of files that are put into the trie and of those that are only
+	 * looked up there. */
+	int nprimary, nlookup;
+	unsigned long long *const primary = collect_sizes(sides, nsides,
+			/*dups_only=*/0, &nprimary);
+	unsigned long long *const lookup = collect_sizes(sides, nsides,
+			/*dups_only=*/1, &nlookup);
+
+	hash_task_t *tasks = NULL;
+	int ntasks = 0;
+
+	for(i = 0; i < nsides; ++i)
+	{
+		diff_side_t *const side = &sides[i];
+		if(side->entries.nentries == 0)
+		{
+			continue;
+		}
+
+		side->fingerprints = calloc(side->files.nitems,
+				sizeof(*side->fingerprints));
+		if(side->fingerprints == NULL)
+		{
+			/* Matching will compute fingerprints on its own. */
+			continue;
+		}
+
+		for(j = 0; j < side->entries.nentries; ++j)
+		{
+			const dir_entry_t *const entry = &side->entries.entries[j];
+
+			/* A file is read during matching if there is some other file of the same
+			 * size that is or will be put into the trie.  Files that are put into
+			 * the trie also conflict with files that are looked up later. */
+			int nsame = count_size(primary, nprimary, entry->size);
+			if(!side->dups_only)
+			{
+				nsame += count_size(lookup, nlookup, entry->size) - 1;
+			}
+			if(nsame == 0)
+			{
+				continue;
+			}
+
+			hash_task_t *const extended = dynarray_extend(tasks, sizeof(*tasks));
+			if(extended == NULL)
+			{
+				continue;
+			}
+
+			tasks = extended;
+			hash_task_t *const task = &tasks[ntasks];
+			task->path = side->files.items[entry->tag];
+			task->size = entry->size;
+			task->is_readable = filetype_is_readable(entry->type);
+			task->dups_only = side->dups_only;
+			task->cached = 0;
+			task->fingerprint = &side->fingerprints[entry->tag];
+			++ntasks;
+		}
+	}
+
+	free(primary);
+	free(lookup);
+
+	hash_args_t args = {
+		.tasks = tasks,
+		.cancellation = cancellation,
+		.bg_op = bg_op,
+		.full = 0,
+	};
+
+	/* Number of workers also limits number of files read at the same time. */
+	start_stage(bg_op, "Sampling...", ntasks);
+	parallel_for(ntasks, cfg.stat_workers, &hash_file, &args);
+	counters->sampled = ntasks;
+
+	/* Candidates that survived sampling are moved to the front. */
+	const int nfull = cancellation_requested(cancellation)
+	                ? 0
+	                : pick_sample_collisions(tasks, ntasks);
+
+	args.full = 1;
+	start_stage(bg_op, "Hashing...", nfull);
+	parallel_for(nfull, cfg.stat_workers, &hash_file, &args);
+	counters->hashed = nfull;
+
+	for(i = 0; i < ntasks; ++i)
+	{
+		counters->cached += tasks[i].cached;
+	}
+
+	dynarray_free(tasks);
+}
+
+/* Collects sorted list of sizes of files of sides which are either matched only
+ * against other files (non-zero dups_only) or not.  Returns the list, which is
+ * NULL if it's empty or on error. */
+static unsigned long long *
+collect_sizes(diff_side_t sides[], int nsides, int dups_only, int *count)
+{
+	int i, j;
+
+	int total = 0;
+	for(i = 0; i < nsides; ++i)
+	{
+		if(sides[i].dups_only == dups_only)
+		{
+			total += sides[i].entries.nentries;
+		}
+	}
+
+	*count = 0;
+	unsigned long long *const sizes = malloc(sizeof(*sizes)*MAX(total, 1));
+	if(sizes == NULL)
+	{
+		return NULL;
+	}
+
+	for(i = 0; i < nsides; ++i)
+	{
+		if(sides[i].dups_only == dups_only)
+		{
+			for(j = 0; j < sides[i].entries.nentries; ++j)
+			{
+				sizes[(*count)++] = sides[i].entries.entries[j].size;
+			}
+		}
+	}
+
+	safe_qsort(sizes, *count, sizeof(*sizes), &size_sorter);
+	return sizes;
+}
+
+/* Counts number of occurrences of the size in a sorted list of sizes.  Returns
+ * the number. */
+static int
+count_size(const unsigned long long sizes[], int count,
+		unsigned long long size)
+{
+	/* Lower bound of the range. */
+	int l = 0, u = count;
+	while(l < u)
+	{
+		const int m = l + (u - l)/2;
+		if(sizes[m] < size)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			u = m;
+		}
+	}
+
+	int n = 0;
+	while(l + n < count && sizes[l + n] == size)
+	{
+		++n;
+	}
+	return n;
+}
+
+/* qsort() comparer that sorts sizes in ascending order.  Returns standard -1,
+ * 0, 1 for comparisons. */
+static int
+size_sorter(const void *first, const void *second)
+{
+	const unsigned long long *a = first;
+	const unsigned long long *b = second;
+	return SORT_CMP(*a, *b);
+}
+
+/* Reorders tasks to put those whose sample fingerprints conflict with other
+ * tasks first.  Returns number of such tasks. */
+static int
+pick_sample_collisions(hash_task_t tasks[], int ntasks)
+{
+	safe_qsort(tasks, ntasks, sizeof(*tasks), &task_sorter);
+
+	int i = 0, n = 0;
+	while(i < ntasks)
+	{
+		const char *const fp = *tasks[i].fingerprint;
+
+		int j = i, nprimary = 0, nlookup = 0;
+		while(j < ntasks && task_sorter(&tasks[i], &tasks[j]) == 0)
+		{
+			if(tasks[j].dups_only)
+			{
+				++nlookup;
+			}
+			else
+			{
+				++nprimary;
+			}
+			++j;
+		}
+
+		for(; i < j; ++i)
+		{
+			/* Same logic as for sizes in prefetch_fingerprints(). */
+			const int nsame = tasks[i].dups_only ? nprimary
+			                                     : nprimary + nlookup - 1;
+			if(!is_null_or_empty(fp) && nsame != 0)
+			{
+				const hash_task_t task = tasks[n];
+				tasks[n++] = tasks[i];
+				tasks[i] = task;
+			}
+		}
+	}
+
+	return n;
+}
+
+/* qsort() comparer that groups tasks by their fingerprints.  Returns standard
+ * -1, 0, 1 for comparisons. */
+static int
+task_sorter(const void *first, const void *second)
+{
+	const hash_task_t *a = first;
+	const hash_task_t *b = second;
+	const char *a_fp = (*a->fingerprint == NULL ? "" : *a->fingerprint);
+	const char *b_fp = (*b->fingerprint == NULL ? "" : *b->fingerprint);
+	return strcmp(a_fp, b_fp);
+}
+
+/* parallel_for() body that computes contents fingerprint of a single file. */
+static void
+hash_file(int i, void *arg)
+{
+	hash_args_t *const args = arg;
+	if(cancellation_requested(args->cancellation))
+	{
+		return;
+	}
+
+	hash_task_t *const task = &args->tasks[i];
+	if(args->full)
+	{
+		char *const full_fp = get_full_fingerprint(task->path, task->is_readable,
+				*task->fingerprint, &task->cached);
+		free(*task->fingerprint);
+		*task->fingerprint = full_fp;
+	}
+	else
+	{
+		*task->fingerprint = get_contents_fingerprint(task->path,
+				task->is_readable, task->size, &task->cached);
+	}
+
+	/* Status bar can't be updated from several threads, so progress is reported
+	 * only for background comparison. */
+	if(args->bg_op != NULL && bg_op_lock(args->bg_op))
+	{
+		++args->bg_op->done;
+		bg_op_unlock(args->bg_op);
+	}
+}
+
+/* Looks up entries of the side by their fingerprints, assigning ids to them.
+ * Entries which are skipped are freed. */
+static void
+assign_ids(trie_t *trie, diff_side_t *side, int *next_id, CompareType ct,
+		int flags, const cancellation_t *cancellation, bg_op_t *bg_op)
+{
+	entries_t *const r = &side->entries;
+
+	int i, j = 0;
+	start_stage(bg_op, "Matching...", r->nentries);
+	for(i = 0; i < r->nentries; ++i)
+	{
+		dir_entry_t *const entry = &r->entries[i];
+
+		if(cancellation_requested(cancellation))
+		{
+			entry->id = -1;
+		}
+		else
+		{
+			const char *const path = side->files.items[entry->tag];
+			const char *const contents_fp = (side->fingerprints == NULL)
+			                              ? NULL
+			                              : side->fingerprints[entry->tag];
+			entry->id = add_file_to_diff(trie, path, entry, contents_fp, ct,
+					side->dups_only, flags, next_id);
+		}
 
 		if(entry->id == -1)
 		{
 			fentry_free(entry);
-			--r.nentries;
+			continue;
 		}
 
-		progress = (i*100)/files.nitems;
-		if(progress != last_progress)
+		r->entries[j++] = *entry;
+		report_stage(bg_op, "Matching...", i, r->nentries);
+	}
+	r->nentries = j;
+}
+
+/* Frees resources of a side. */
+static void
+free_side(diff_side_t *side)
+{
+	if(side->fingerprints != NULL)
+	{
+		int i;
+		for(i = 0; i < side->files.nitems; ++i)
 		{
-			char progress_msg[128];
+			free(side->fingerprints[i]);
+		}
+		free(side->fingerprints);
+		side->fingerprints = NULL;
+	}
+
+	free_string_array(side->files.items, side->files.nitems);
+	side->files.items = NULL;
+	side->files.nitems = 0;
+
+	free_dir_entries(&side->entries.entries, &side->entries.nentries);
+}
+
+/* Starts a stage of comparison which consists of the specified number of
+ * steps. */
+static void
+start_stage(bg_op_t *bg_op, const char stage[], int total)
+{
+	if(bg_op == NULL)
+	{
+		report_stage(bg_op, stage, 0, total);
+		return;
+	}
+
+	if(bg_op_lock(bg_op))
+	{
+		bg_op->total = total;
+		bg_op->done = 0;
+		bg_op_unlock(bg_op);
+	}
+	bg_op_set_descr(bg_op, stage);
+}
 
-			last_progress = progress;
-			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (%2d%%)", i,
-					progress);
-			show_progress(progress_msg, -1);
+/* Reports progress of a stage of comparison on the job bar for background
+ * comparison and on the status bar otherwise. */
+static void
+report_stage(bg_op_t *bg_op, const char stage[], int done, int total)
+{
+	static int last_progress;
+
+	if(bg_op != NULL)
+	{
+		if(bg_op_lock(bg_op))
+		{
+			bg_op->done = done;
+			bg_op_unlock(bg_op);
 		}
+		return;
 	}
 
-	free_string_array(files.items, files.nitems);
-	return r;
+	const int progress = (total == 0 ? 0 : (done*100LL)/total);
+	if(done == 0 || progress != last_progress)
+	{
+		char progress_msg[128];
+
+		last_progress = progress;
+		snprintf(progress_msg, sizeof(progress_msg), "%s %d (%2d%%)", stage, done,
+				progress);
+		show_progress(progress_msg, -1);
+	}
 }
 
 /* Fills the list with entries of the view in hierarchical order (pre-order tree
@@ -956,30 +1740,46 @@ get_file_fingerprint(const char path[], const dir_entry_t *entry,
 				return format_str("%" PRINTF_ULL, (unsigned long long)entry->size);
 			}
 			return get_contents_fingerprint(path, filetype_is_readable(entry->type),
-					entry->size);
+					entry->size, /*cached=*/NULL);
 	}
 	assert(0 && "Unexpected diffing type.");
 	return strdup("");
 }
 
-/* Makes fingerprint of file contents (all or of its fixed-size prefix,
- * whichever is smaller).  Returns the fingerprint as a string, which is empty
- * or NULL on error. */
+/* Makes fingerprint of file contents (all of it or of its head, middle and
+ * tail, whichever is smaller).  *cached is incremented if digest is taken from
+ * the cache, cached can be NULL.  Returns the fingerprint as a string, which is
+ * empty or NULL on error. */
 static char *
 get_contents_fingerprint(const char path[], int is_readable,
-		unsigned long long size)
+		unsigned long long size, int *cached)
 {
-	char contents[PREFIX_SIZE];
+	char contents[3*SAMPLE_SIZE];
 	size_t len;
+	hcache_key_t key;
+	int have_key = 0;
 
 	if(is_readable)
 	{
+		hcache_digests_t digests;
+		have_key = (hcache_key_of(path, &key) == 0);
+		if(have_key && hcache_get(&key, &digests) == 0 &&
+				digests.sample_size == SAMPLE_SIZE)
+		{
+			if(cached != NULL)
+			{
+				++*cached;
+			}
+			return format_str("%" PRINTF_ULL "|%" PRINTF_ULL, size,
+					(unsigned long long)digests.sample);
+		}
+
 		FILE *in = os_fopen(path, "rb");
 		if(in == NULL)
 		{
 			return strdup("");
 		}
-		len = fread(&contents, 1, sizeof(contents), in);
+		len = read_samples(in, size, contents);
 		fclose(in);
 	}
 	else
@@ -990,14 +1790,132 @@ get_contents_fingerprint(const char path[], int is_readable,
 	}
 
 	const unsigned long long digest = XXH3_64bits(contents, len);
+	if(have_key)
+	{
+		hcache_put_sample(&key, SAMPLE_SIZE, digest);
+	}
 	return format_str("%" PRINTF_ULL "|%" PRINTF_ULL, size, digest);
 }
 
-/* Looks up file in the trie by its fingerprint.  Returns id for the file or -1
- * if it should be skipped. */
+/* Reads head, middle and tail of a file into the buffer of 3*SAMPLE_SIZE bytes.
+ * Small files are read in full.  Returns number of read bytes. */
+static size_t
+read_samples(FILE *in, unsigned long long size, char buf[])
+{
+	if(size <= 3*SAMPLE_SIZE)
+	{
+		return fread(buf, 1, 3*SAMPLE_SIZE, in);
+	}
+
+	size_t len = fread(buf, 1, SAMPLE_SIZE, in);
+	if(fseeko(in, size/2 - SAMPLE_SIZE/2, SEEK_SET) == 0)
+	{
+		len += fread(buf + len, 1, SAMPLE_SIZE, in);
+	}
+	if(fseeko(in, size - SAMPLE_SIZE, SEEK_SET) == 0)
+	{
+		len += fread(buf + len, 1, SAMPLE_SIZE, in);
+	}
+	return len;
+}
+
+/* Makes fingerprint of whole file contents by extending fingerprint of its
+ * samples.  *cached is incremented if digest is taken from the cache.  Returns
+ * the fingerprint as a string, which is empty or NULL on error. */
+static char *
+get_full_fingerprint(const char path[], int is_readable, const char sample_fp[],
+		int *cached)
+{
+	if(is_null_or_empty(sample_fp))
+	{
+		return strdup("");
+	}
+
+	/* Unreadable files are treated as empty. */
+	const XXH128_hash_t empty = XXH3_128bits("", 0);
+	uint64_t digest[2] = { empty.low64, empty.high64 };
+	if(is_readable && hash_whole_file(path, digest, cached) != 0)
+	{
+		return strdup("");
+	}
+
+	return format_str("%s|%016" PRIx64 "%016" PRIx64, sample_fp, digest[1],
+			digest[0]);
+}
+
+/* Computes XXH3-128 digest of contents of a file.  *cached is incremented if
+ * digest is taken from the cache.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+hash_whole_file(const char path[], uint64_t digest[2], int *cached)
+{
+	hcache_key_t key;
+	hcache_digests_t digests;
+	const int have_key = (hcache_key_of(path, &key) == 0);
+	if(have_key && hcache_get(&key, &digests) == 0 && digests.has_full)
+	{
+		digest[0] = digests.full[0];
+		digest[1] = digests.full[1];
+		++*cached;
+		return 0;
+	}
+
+	FILE *const in = os_fopen(path, "rb");
+	if(in == NULL)
+	{
+		return 1;
+	}
+
+	XXH3_state_t *const state = XXH3_createState();
+	if(state == NULL)
+	{
+		fclose(in);
+		return 1;
+	}
+	(void)XXH3_128bits_reset(state);
+
+	char block[BLOCK_SIZE];
+	size_t len;
+	while((len = fread(block, 1, sizeof(block), in)) != 0U)
+	{
+		(void)XXH3_128bits_update(state, block, len);
+	}
+
+	const int error = ferror(in);
+	fclose(in);
+
+	const XXH128_hash_t hash = XXH3_128bits_digest(state);
+	(void)XXH3_freeState(state);
+	if(error)
+	{
+		return 1;
+	}
+
+	digest[0] = hash.low64;
+	digest[1] = hash.high64;
+	if(have_key)
+	{
+		hcache_put_full(&key, digest);
+	}
+	return 0;
+}
+
+/* Checks whether fingerprint includes digest of the whole file.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_full_fingerprint(const char fingerprint[])
+{
+	const char *const bar = strchr(fingerprint, '|');
+	return (bar != NULL && strchr(bar + 1, '|') != NULL);
+}
+
+/* Looks up file in the trie by its fingerprint.  contents_fp is precomputed
+ * contents fingerprint of the file or NULL.  Returns id for the file or -1 if
+ * it should be skipped. */
 static int
 add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
-		CompareType ct, int dups_only, int flags, int *next_id)
+		const char contents_fp[], CompareType ct, int dups_only, int flags,
+		int *next_id)
 {
 	char *fingerprint = get_file_fingerprint(path, entry, ct, flags, /*lazy=*/1);
 	if(is_null_or_empty(fingerprint))
@@ -1022,7 +1940,9 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 		free(fingerprint);
 		is_partial = 0;
 
-		fingerprint = get_file_fingerprint(path, entry, ct, flags, /*lazy=*/0);
+		fingerprint = (contents_fp != NULL)
+		            ? strdup(contents_fp)
+		            : get_file_fingerprint(path, entry, ct, flags, /*lazy=*/0);
 		if(is_null_or_empty(fingerprint))
 		{
 			/* In case we couldn't obtain fingerprint (e.g., comparing by contents and
@@ -1037,9 +1957,12 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 			 * hasn't been computed yet.  Do it here.  Using `entry->size` is valid
 			 * because partial hash is just the size, so both entries must share
 			 * it. */
-			char *other_fingerprint = get_contents_fingerprint(record->path,
-					record->is_readable, entry->size);
-			if(is_null_or_empty(fingerprint))
+			char *other_fingerprint = (record->fingerprint != NULL)
+			                        ? strdup(record->fingerprint)
+			                        : get_contents_fingerprint(record->path,
+			                              record->is_readable, entry->size,
+			                              /*cached=*/NULL);
+			if(is_null_or_empty(other_fingerprint))
 			{
 				/* That other file has issues, don't update it and skip any other file
 				 * that can conflict with it by size.  The file itself won't be skipped
@@ -1050,28 +1973,28 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 			}
 
 			put_file_id(trie, record->path, other_fingerprint, record->id,
-					record->is_readable, /*is_partial=*/0, ct);
+					record->is_readable, /*is_partial=*/0, /*contents_fp=*/NULL, ct);
 			free(other_fingerprint);
 
 			record->is_partial = 0;
+			update_string(&record->fingerprint, NULL);
 		}
 
 		/* Repeat trie lookup with contents fingerprint. */
+		data = NULL;
 		(void)trie_get(trie, fingerprint, &data);
 		record = data;
 
-		/* Fingerprint does not guarantee a match, go through files and find file
-		 * with identical contents. */
-		do
+		/* Digests of whole files are trusted, other fingerprints don't guarantee a
+		 * match, so go through files and find file with identical contents. */
+		if(!is_full_fingerprint(fingerprint))
 		{
-			if(files_are_identical(path, is_readable, record->path,
-						record->is_readable))
+			while(record != NULL && !files_are_identical(path, is_readable,
+						record->path, record->is_readable))
 			{
-				break;
+				record = record->next;
 			}
-			record = record->next;
 		}
-		while(record != NULL);
 	}
 
 	if(record != NULL)
@@ -1088,7 +2011,8 @@ add_file_to_diff(trie_t *trie, const char path[], dir_entry_t *entry,
 
 	int id = *next_id;
 	++*next_id;
-	put_file_id(trie, path, fingerprint, id, is_readable, is_partial, ct);
+	put_file_id(trie, path, fingerprint, id, is_readable, is_partial,
+			contents_fp, ct);
 
 	free(fingerprint);
 	return id;
@@ -1105,7 +2029,9 @@ filetype_is_readable(FileType type)
 }
 
 /* Checks whether two files specified by their names hold identical content.
- * Returns non-zero if so, otherwise zero is returned. */
+ * Digests of whole files are remembered in hcache, which allows skipping
+ * reading files next time (equal 128-bit digests are trusted to mean equal
+ * contents).  Returns non-zero if so, otherwise zero is returned. */
 static int
 files_are_identical(const char a[], int a_readable, const char b[],
 		int b_readable)
@@ -1124,6 +2050,20 @@ files_are_identical(const char a[], int a_readable, const char b[],
 		return file_is_empty(b);
 	}
 
+	hcache_key_t a_key, b_key;
+	const int have_keys = (hcache_key_of(a, &a_key) == 0)
+	                   && (hcache_key_of(b, &b_key) == 0);
+	if(have_keys)
+	{
+		hcache_digests_t a_digests, b_digests;
+		if(hcache_get(&a_key, &a_digests) == 0 && a_digests.has_full &&
+				hcache_get(&b_key, &b_digests) == 0 && b_digests.has_full)
+		{
+			return a_digests.full[0] == b_digests.full[0]
+			    && a_digests.full[1] == b_digests.full[1];
+		}
+	}
+
 	FILE *const a_file = fopen(a, "rb");
 	FILE *const b_file = fopen(b, "rb");
 
@@ -1140,6 +2080,14 @@ files_are_identical(const char a[], int a_readable, const char b[],
 		return 0;
 	}
 
+	/* Contents is the same until the end, so a single state is enough. */
+	XXH3_state_t *const state = (have_keys ? XXH3_createState() : NULL);
+	if(state != NULL)
+	{
+		(void)XXH3_128bits_reset(state);
+	}
+
+	int identical = 1;
 	while(1)
 	{
 		char a_block[BLOCK_SIZE], b_block[BLOCK_SIZE];
@@ -1154,15 +2102,32 @@ files_are_identical(const char a[], int a_readable, const char b[],
 		if(a_read == 0 || b_read == 0U || a_read != b_read ||
 				memcmp(a_block, b_block, a_read) != 0)
 		{
-			fclose(a_file);
-			fclose(b_file);
-			return 0;
+			identical = 0;
+			break;
+		}
+
+		if(state != NULL)
+		{
+			(void)XXH3_128bits_update(state, a_block, a_read);
 		}
 	}
 
 	fclose(a_file);
 	fclose(b_file);
-	return 1;
+
+	if(state != NULL)
+	{
+		if(identical)
+		{
+			const XXH128_hash_t digest = XXH3_128bits_digest(state);
+			const uint64_t full[2] = { digest.low64, digest.high64 };
+			hcache_put_full(&a_key, full);
+			hcache_put_full(&b_key, full);
+		}
+		(void)XXH3_freeState(state);
+	}
+
+	return identical;
 }
 
 /* Checks that a file is empty.  Returns non-zero if so and there was no
@@ -1175,10 +2140,11 @@ file_is_empty(const char path[])
 	return (os_stat(path, &st) == 0 && st.st_size == 0);
 }
 
-/* Stores id of a file with given fingerprint in the trie. */
+/* Stores id of a file with given fingerprint in the trie.  Precomputed
+ * contents fingerprint (can be NULL) is kept only for partial records. */
 static void
 put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
-		int is_readable, int is_partial, CompareType ct)
+		int is_readable, int is_partial, const char contents_fp[], CompareType ct)
 {
 	compare_record_t *const record = malloc(sizeof(*record));
 	if(record == NULL)
@@ -1194,6 +2160,9 @@ put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
 	/* Comparison by contents is the only one when we need to resolve fingerprint
 	 * conflicts. */
 	record->path = (ct == CT_CONTENTS ? strdup(path) : NULL);
+	record->fingerprint = (is_partial && contents_fp != NULL)
+	                    ? strdup(contents_fp)
+	                    : NULL;
 
 	/* Just add new entry to the list if something is already there. */
 	void *data = NULL;
@@ -1209,6 +2178,7 @@ put_file_id(trie_t *trie, const char path[], const char fingerprint[], int id,
 	/* Otherwise we're the head of the list. */
 	if(trie_set(trie, fingerprint, record) < 0)
 	{
+		free(record->fingerprint);
 		free(record->path);
 		free(record);
 	}
@@ -1224,6 +2194,7 @@ free_compare_records(void *ptr)
 	{
 		compare_record_t *const current = record;
 		record = record->next;
+		free(current->fingerprint);
 		free(current->path);
 		free(current);
 	}
@@ -1357,5 +2328,11 @@ compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx)
 	free(to_fingerprint);
 }
 
+TSTATIC const compare_counters_t *
+compare_get_counters(void)
+{
+	return &last_counters;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
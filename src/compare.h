@@ -20,6 +20,7 @@
 #define VIFM__DIFF_H__
 
 #include "ui/ui.h"
+#include "utils/test_helpers.h"
 
 /* Comparison flags. */
 typedef enum
@@ -47,18 +48,42 @@ typedef enum
 }
 CompareFlags;
 
+/* Counters of stages of comparison by contents. */
+typedef struct
+{
+	int files;   /* Number of files that were matched. */
+	int sampled; /* Number of files of non-unique size, whose head, middle and
+	                tail were hashed. */
+	int hashed;  /* Number of files with non-unique samples, whose whole
+	                contents was hashed. */
+	int cached;  /* Number of digests that were taken from hcache instead of
+	                reading files. */
+}
+compare_counters_t;
+
 /* Composes two panes containing information about files derived from two file
- * system trees.  Returns non-zero if status bar message should be preserved. */
+ * system trees.  Comparison by contents might be finished in background.
+ * Returns non-zero if status bar message should be preserved. */
 int compare_two_panes(CompareType ct, ListType lt, int flags);
 
-/* Replaces single pane with information derived from its files.  Returns
- * non-zero if status bar message should be preserved. */
+/* Replaces single pane with information derived from its files.  Comparison by
+ * contents might be finished in background.  Returns non-zero if status bar
+ * message should be preserved. */
 int compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags);
 
+/* Displays results of comparison that was running in background once it's
+ * done.  Results are dropped if location of any of the views has changed.
+ * Returns non-zero if comparison is still in progress. */
+int compare_update_from_job(void);
+
 /* Moves current file from one view to the other.  Returns non-zero if status
  * bar message should be preserved. */
 int compare_move(view_t *from, view_t *to);
 
+TSTATIC_DEFS(
+	const compare_counters_t * compare_get_counters(void);
+)
+
 #endif /* VIFM__DIFF_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,458 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dcache_file.h"
+
+#ifndef _WIN32
+
+#include <sys/types.h> /* off_t ssize_t */
+#include <unistd.h> /* pread() */
+
+#include <errno.h> /* EINTR errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint32_t uintptr_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() strlen() */
+
+#include "compat/fs_limits.h"
+#include "compat/reallocarray.h"
+#include "utils/alog.h"
+#include "utils/log.h"
+#include "utils/trie.h"
+
+/* Identifier of the file format. */
+#define DCF_MAGIC "VIFMDCF"
+
+/* Version of the file format. */
+#define DCF_VERSION 2U
+
+/* Value at the start of every record. */
+#define DCF_RECORD_MAGIC 0x52434456U
+
+/* Minimal number of records in a file for it to be considered for
+ * compaction. */
+#define DCF_MIN_COMPACT 4096
+
+/* Record of the file, followed by path_len bytes of the path. */
+typedef struct
+{
+	uint32_t magic;    /* DCF_RECORD_MAGIC. */
+	uint32_t path_len; /* Length of the path (without terminating null). */
+	dcf_entry_t entry; /* Payload. */
+}
+dcf_record_t;
+
+/* Latest record for a path loaded from the file. */
+typedef struct
+{
+	size_t offset;     /* Offset of the record in the file. */
+	dcf_entry_t entry; /* Payload of the record. */
+}
+dcf_slot_t;
+
+/* Opened cache file. */
+struct dcf_t
+{
+	alog_t *log; /* The file. */
+
+	char *data;      /* Contents of the file while it's being opened. */
+	size_t data_len; /* Size of the contents. */
+
+	dcf_slot_t *slots; /* Latest records of the file at the moment it was
+	                      opened. */
+	size_t nslots;     /* Number of used elements in slots array. */
+	size_t slots_cap;  /* Capacity of slots array. */
+	trie_t *index;     /* Path -> index into slots plus one (NULL when
+	                      taken). */
+};
+
+/* State of scanning of records. */
+typedef struct
+{
+	int nrecords; /* Number of valid records. */
+	int nunique;  /* Number of distinct paths. */
+}
+scan_stats_t;
+
+/* Destination of records read from the file by dcf_sync(). */
+typedef struct
+{
+	dcf_visitor visitor; /* Callback to invoke. */
+	void *arg;           /* Argument for the callback. */
+}
+sync_ctx_t;
+
+static off_t load_file(int fd, off_t size, int *compact, void *arg);
+static int read_file(int fd, char data[], size_t len);
+static int dump_file(int fd, void *arg);
+static size_t read_records(const char data[], size_t len, void *arg);
+static int scan_records(dcf_t *dcf, size_t *offset, scan_stats_t *stats);
+static dcf_slot_t * add_slot(dcf_t *dcf, const char path[]);
+static int parse_record(const char data[], size_t len, size_t offset,
+		dcf_record_t *record, char path[]);
+static size_t record_len(const dcf_record_t *record);
+static void free_data(dcf_t *dcf);
+static void free_index(dcf_t *dcf);
+
+dcf_t *
+dcf_open(const char path[])
+{
+	dcf_t *const dcf = malloc(sizeof(*dcf));
+	if(dcf == NULL)
+	{
+		return NULL;
+	}
+
+	dcf->data = NULL;
+	dcf->data_len = 0U;
+	dcf->slots = NULL;
+	dcf->nslots = 0U;
+	dcf->slots_cap = 0U;
+	dcf->index = NULL;
+
+	dcf->log = alog_open(path, DCF_MAGIC, DCF_VERSION, &load_file, &dump_file,
+			dcf);
+
+	/* Contents of the file are of no use after records were loaded and it's
+	 * unsafe to access the file without holding a lock on it. */
+	free_data(dcf);
+
+	if(dcf->log == NULL)
+	{
+		dcf_close(dcf);
+		return NULL;
+	}
+
+	return dcf;
+}
+
+/* Reads contents of locked file and loads its latest records.  Returns offset
+ * right past the last valid record or negative value on error. */
+static off_t
+load_file(int fd, off_t size, int *compact, void *arg)
+{
+	dcf_t *const dcf = arg;
+
+	/* This can be a second load after compaction. */
+	free_data(dcf);
+	free_index(dcf);
+
+	if(size > (off_t)sizeof(alog_header_t))
+	{
+		dcf->data = malloc(size);
+		if(dcf->data == NULL)
+		{
+			return -1;
+		}
+		dcf->data_len = size;
+
+		if(read_file(fd, dcf->data, dcf->data_len) != 0)
+		{
+			LOG_SERROR_MSG(errno, "Failed to read dcache file");
+			return -1;
+		}
+	}
+
+	dcf->index = trie_create(/*free_func=*/NULL);
+	if(dcf->index == NULL)
+	{
+		return -1;
+	}
+
+	scan_stats_t stats = { .nrecords = 0, .nunique = 0 };
+	size_t end = sizeof(alog_header_t);
+	if(scan_records(dcf, &end, &stats) != 0)
+	{
+		return -1;
+	}
+
+	*compact = (stats.nrecords >= DCF_MIN_COMPACT &&
+			stats.nrecords > 2*stats.nunique);
+	return end;
+}
+
+/* Reads the specified number of bytes from the beginning of a file.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+read_file(int fd, char data[], size_t len)
+{
+	size_t offset = 0U;
+	while(offset != len)
+	{
+		const ssize_t nread = pread(fd, data + offset, len - offset, offset);
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread <= 0)
+		{
+			return 1;
+		}
+		offset += nread;
+	}
+	return 0;
+}
+
+/* Writes out only the latest records of the loaded file.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+dump_file(int fd, void *arg)
+{
+	dcf_t *const dcf = arg;
+
+	size_t offset = sizeof(alog_header_t);
+	dcf_record_t record;
+	char path[PATH_MAX + 1];
+	while(parse_record(dcf->data, dcf->data_len, offset, &record, path) == 0)
+	{
+		void *data;
+		if(trie_get(dcf->index, path, &data) == 0 && data != NULL &&
+				dcf->slots[(uintptr_t)data - 1U].offset == offset)
+		{
+			if(alog_write(fd, dcf->data + offset, record_len(&record)) != 0)
+			{
+				return 1;
+			}
+		}
+		offset += record_len(&record);
+	}
+	return 0;
+}
+
+/* Loads valid records of the file contents starting at the *offset and
+ * advances it right past the last valid record.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+scan_records(dcf_t *dcf, size_t *offset, scan_stats_t *stats)
+{
+	dcf_record_t record;
+	char path[PATH_MAX + 1];
+	while(parse_record(dcf->data, dcf->data_len, *offset, &record, path) == 0)
+	{
+		dcf_slot_t *slot;
+
+		void *prev;
+		if(trie_get(dcf->index, path, &prev) == 0 && prev != NULL)
+		{
+			slot = &dcf->slots[(uintptr_t)prev - 1U];
+		}
+		else
+		{
+			slot = add_slot(dcf, path);
+			if(slot == NULL)
+			{
+				return 1;
+			}
+			++stats->nunique;
+		}
+
+		slot->offset = *offset;
+		slot->entry = record.entry;
+
+		++stats->nrecords;
+		*offset += record_len(&record);
+	}
+	return 0;
+}
+
+/* Allocates slot for a new path and indexes it.  Returns the slot or NULL on
+ * error. */
+static dcf_slot_t *
+add_slot(dcf_t *dcf, const char path[])
+{
+	if(dcf->nslots == dcf->slots_cap)
+	{
+		const size_t new_cap = (dcf->slots_cap == 0U ? 256U : dcf->slots_cap*2U);
+		dcf_slot_t *const slots = reallocarray(dcf->slots, new_cap,
+				sizeof(*slots));
+		if(slots == NULL)
+		{
+			return NULL;
+		}
+		dcf->slots = slots;
+		dcf->slots_cap = new_cap;
+	}
+
+	if(trie_set(dcf->index, path, (void *)(uintptr_t)(dcf->nslots + 1U)) != 0)
+	{
+		return NULL;
+	}
+
+	return &dcf->slots[dcf->nslots++];
+}
+
+/* Decodes a record at the offset.  Returns zero on success and non-zero if
+ * there is no valid record there. */
+static int
+parse_record(const char data[], size_t len, size_t offset,
+		dcf_record_t *record, char path[])
+{
+	if(offset + sizeof(*record) > len)
+	{
+		return 1;
+	}
+
+	memcpy(record, data + offset, sizeof(*record));
+	if(record->magic != DCF_RECORD_MAGIC || record->path_len == 0U ||
+			record->path_len > PATH_MAX || offset + record_len(record) > len)
+	{
+		return 1;
+	}
+
+	memcpy(path, data + offset + sizeof(*record), record->path_len);
+	path[record->path_len] = '\0';
+	return 0;
+}
+
+/* Computes size of the record on disk.  Returns the size. */
+static size_t
+record_len(const dcf_record_t *record)
+{
+	return sizeof(*record) + record->path_len;
+}
+
+void
+dcf_close(dcf_t *dcf)
+{
+	if(dcf == NULL)
+	{
+		return;
+	}
+
+	alog_close(dcf->log);
+	free_data(dcf);
+	free_index(dcf);
+	free(dcf);
+}
+
+int
+dcf_take(dcf_t *dcf, const char path[], dcf_entry_t *entry)
+{
+	void *data;
+	if(trie_get(dcf->index, path, &data) != 0 || data == NULL)
+	{
+		return 1;
+	}
+
+	/* Don't report the same record twice. */
+	(void)trie_set(dcf->index, path, NULL);
+
+	*entry = dcf->slots[(uintptr_t)data - 1U].entry;
+	return 0;
+}
+
+void
+dcf_put(dcf_t *dcf, const char path[], const dcf_entry_t *entry)
+{
+	const dcf_record_t record = {
+		.magic = DCF_RECORD_MAGIC,
+		.path_len = strlen(path),
+		.entry = *entry,
+	};
+	if(record.path_len == 0U || record.path_len > PATH_MAX)
+	{
+		return;
+	}
+
+	char buf[sizeof(record) + PATH_MAX];
+	memcpy(buf, &record, sizeof(record));
+	memcpy(buf + sizeof(record), path, record.path_len);
+	alog_put(dcf->log, buf, record_len(&record));
+}
+
+int
+dcf_sync(dcf_t *dcf, dcf_visitor visitor, void *arg)
+{
+	sync_ctx_t ctx = { .visitor = visitor, .arg = arg };
+	return alog_sync(dcf->log, &read_records, &ctx);
+}
+
+/* Reports records appended to the file by other instances.  Returns number of
+ * bytes occupied by valid records. */
+static size_t
+read_records(const char data[], size_t len, void *arg)
+{
+	sync_ctx_t *const ctx = arg;
+
+	size_t offset = 0U;
+	dcf_record_t record;
+	char path[PATH_MAX + 1];
+	while(parse_record(data, len, offset, &record, path) == 0)
+	{
+		ctx->visitor(path, &record.entry, ctx->arg);
+		offset += record_len(&record);
+	}
+	return offset;
+}
+
+/* Frees contents of the file. */
+static void
+free_data(dcf_t *dcf)
+{
+	free(dcf->data);
+	dcf->data = NULL;
+	dcf->data_len = 0U;
+}
+
+/* Frees loaded records and their index. */
+static void
+free_index(dcf_t *dcf)
+{
+	free(dcf->slots);
+	dcf->slots = NULL;
+	dcf->nslots = 0U;
+	dcf->slots_cap = 0U;
+
+	trie_free(dcf->index);
+	dcf->index = NULL;
+}
+
+#else
+
+dcf_t *
+dcf_open(const char path[])
+{
+	return NULL;
+}
+
+void
+dcf_close(dcf_t *dcf)
+{
+}
+
+int
+dcf_take(dcf_t *dcf, const char path[], dcf_entry_t *entry)
+{
+	return 1;
+}
+
+void
+dcf_put(dcf_t *dcf, const char path[], const dcf_entry_t *entry)
+{
+}
+
+int
+dcf_sync(dcf_t *dcf, dcf_visitor visitor, void *arg)
+{
+	return 1;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,85 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DCACHE_FILE_H__
+#define VIFM__DCACHE_FILE_H__
+
+#include <stdint.h> /* int64_t uint64_t */
+
+/* File that keeps cache of directory sizes and item counts between sessions.
+ * It's an append-only log of records keyed by paths, the latest record for a
+ * path wins.  The latest records are loaded into memory on opening while the
+ * file is locked, because other instances can truncate it at any moment.
+ * Several instances can share the same file, each of them picks up records
+ * added by others on synchronization.  The file is compacted on opening when it
+ * contains too many outdated records. */
+
+/* Number of values kept for each directory. */
+#define DCF_NVALUES 4
+
+/* Single cached value. */
+typedef struct
+{
+	uint64_t value; /* The value or DCACHE_UNKNOWN. */
+	uint64_t inode; /* Inode of the directory when the value was computed. */
+	int64_t ts;     /* When the value was computed. */
+}
+dcf_value_t;
+
+/* Cached state of a single directory.  Meaning of values is defined by the
+ * user of the file. */
+typedef struct
+{
+	dcf_value_t values[DCF_NVALUES]; /* Values of the directory. */
+}
+dcf_entry_t;
+
+/* Type of callback invoked for records that were added to the file by other
+ * instances. */
+typedef void (*dcf_visitor)(const char path[], const dcf_entry_t *entry,
+		void *arg);
+
+/* Opaque type of the file. */
+typedef struct dcf_t dcf_t;
+
+/* Opens the file creating it if necessary.  Returns the handle or NULL on error
+ * or if persistent cache isn't supported on this platform. */
+dcf_t * dcf_open(const char path[]);
+
+/* Writes out pending records and closes the file.  The dcf can be NULL. */
+void dcf_close(dcf_t *dcf);
+
+/* Retrieves the latest record for the path that was in the file at the moment
+ * it was opened.  Each record is reported only once to not look it up again
+ * after it was loaded.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int dcf_take(dcf_t *dcf, const char path[], dcf_entry_t *entry);
+
+/* Schedules a record to be appended to the file.  Writes pending records out
+ * if there are too many of them. */
+void dcf_put(dcf_t *dcf, const char path[], const dcf_entry_t *entry);
+
+/* Writes out pending records after reporting records appended by other
+ * instances since the last synchronization via the visitor.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int dcf_sync(dcf_t *dcf, dcf_visitor visitor, void *arg);
+
+#endif /* VIFM__DCACHE_FILE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
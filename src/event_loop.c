@@ -27,6 +27,7 @@
 #include <stddef.h> /* NULL size_t wchar_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* memmove() strncpy() */
+#include <time.h> /* time_t time() */
 #include <wchar.h> /* wint_t wcslen() wcscmp() wcsncat() wmemmove() */
 
 #include "cfg/config.h"
@@ -51,7 +52,9 @@
 #include "utils/utils.h"
 #include "background.h"
 #include "bracket_notation.h"
+#include "compare.h"
 #include "filelist.h"
+#include "hcache.h"
 #include "instance.h"
 #include "ipc.h"
 #include "registers.h"
@@ -68,6 +71,7 @@ TSTATIC int process_scheduled_updates_of_view(view_t *view);
 static void update_hardware_cursor(void);
 static int should_check_views_for_changes(void);
 static void check_view_for_changes(view_t *view);
+static void sync_caches(void);
 static void reset_input_buf(wchar_t curr_input_buf[],
 		size_t *curr_input_buf_pos);
 static void display_suggestion_box(const wchar_t input[]);
@@ -435,6 +439,7 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout, int process_callbacks)
 		{
 			check_view_for_changes(curr_view);
 			check_view_for_changes(other_view);
+			sync_caches();
 		}
 
 		process_scheduled_updates();
@@ -550,6 +555,9 @@ process_scheduled_updates(void)
 
 	if(vle_mode_get_primary() != MENU_MODE)
 	{
+		/* Results of comparison schedule redraw of views. */
+		(void)compare_update_from_job();
+
 		need_redraw += (process_scheduled_updates_of_view(curr_view) != 0);
 		need_redraw += (process_scheduled_updates_of_view(other_view) != 0);
 	}
@@ -572,6 +580,9 @@ process_scheduled_updates_of_view(view_t *view)
 		return 0;
 	}
 
+	/* Entries loaded in background schedule a redraw. */
+	(void)flist_update_from_loader(view);
+
 	switch(ui_view_query_scheduled_event(view))
 	{
 		case UUE_NONE:
@@ -644,6 +655,22 @@ check_view_for_changes(view_t *view)
 	}
 }
 
+/* Exchanges updates of persistent caches with other instances from time to
+ * time. */
+static void
+sync_caches(void)
+{
+	static time_t last_sync;
+
+	const time_t now = time(NULL);
+	if(now - last_sync >= 5)
+	{
+		dcache_sync();
+		hcache_sync();
+		last_sync = now;
+	}
+}
+
 void
 update_input_buf(void)
 {
@@ -28,7 +28,8 @@
 
 #include <curses.h>
 
-#include <sys/stat.h> /* stat */
+#include <sys/stat.h> /* stat statx() */
+#include <fcntl.h> /* AT_* */
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
@@ -65,6 +66,7 @@
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/matcher.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/regexp.h"
 #include "utils/str.h"
@@ -73,6 +75,7 @@
 #include "utils/trie.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
+#include "background.h"
 #include "filtering.h"
 #include "flist_hist.h"
 #include "flist_pos.h"
@@ -86,6 +89,7 @@
 #include "sort.h"
 #include "status.h"
 #include "types.h"
+#include "viewcolumns_parser.h"
 
 /* State of a fold. */
 typedef enum
@@ -99,12 +103,97 @@ typedef enum
 }
 FoldState;
 
+/* Number of entries loaded in background that are passed to the view first.
+ * It's small to have the first screenful displayed as soon as possible. */
+#define LOADER_FIRST_BATCH 128
+/* Number of entries loaded in background that are passed to the view at once
+ * after the first batch. */
+#define LOADER_BATCH 4096
+
+/* Minimal number of entries for which querying information about files is
+ * split among several threads.  Starting threads doesn't pay off for fewer
+ * files. */
+#define PARALLEL_STAT_MIN 256
+
+/* State of loading a directory in background.  Shared between the view, which
+ * consumes the entries, and the background job, which produces them. */
+typedef struct dir_loader_t
+{
+	pthread_mutex_t lock; /* Protects fields up to the dir field. */
+	int refs;             /* Number of owners (the view and the job). */
+	int cancelled;        /* Whether results of loading aren't needed anymore. */
+	int finished;         /* Whether the job is done. */
+	int failed;           /* Whether the directory couldn't be read. */
+	int interrupted;      /* Whether the job was cancelled by the user. */
+	dir_entry_t *batch;   /* Loaded entries not yet taken by the view. */
+	int batch_len;        /* Number of elements in the batch array. */
+
+	char *dir;   /* Directory that is being loaded.  Doesn't change. */
+	int skip_md; /* Metadata that isn't loaded (FileMetadata).  Doesn't change. */
+
+	/* The fields below are accessed only by the main thread. */
+	int reload;           /* Whether old list is displayed until the end. */
+	dir_entry_t *entries; /* Entries collected for the reload. */
+	int nentries;         /* Number of elements in the entries array. */
+	int reload_again;     /* Whether a reload was requested while loading. */
+	int last_pos;         /* Cursor position after the last batch. */
+}
+dir_loader_t;
+
+/* State of the background job that loads a directory. */
+typedef struct
+{
+	dir_loader_t *loader; /* Shared state of loading. */
+	bg_op_t *bg_op;       /* Background operation of the job. */
+	dir_entry_t *entries; /* Entries that haven't been passed to the view. */
+	int nentries;         /* Number of elements in the entries array. */
+	int nfilled;          /* Number of leading entries that are filled in. */
+	int total;            /* Number of entries loaded so far. */
+}
+loader_job_t;
+
+/* Arguments of fill_entry_job(). */
+typedef struct
+{
+	dir_entry_t *entries; /* Entries to fill in. */
+	const char *dir;      /* Directory that contains the entries. */
+	int skip_md;          /* Metadata that isn't loaded (FileMetadata). */
+}
+fill_job_t;
+
+/* State of collecting metadata needed by view columns. */
+typedef struct
+{
+	const view_t *view; /* View whose columns are being examined. */
+	int needed;         /* Set of FileMetadata flags. */
+}
+columns_md_t;
+
+/* Listing of a directory of tree-view that's kept between reloads. */
+typedef struct
+{
+	dir_entry_t *entries; /* Files of the directory. */
+	int nentries;         /* Number of elements in the entries array. */
+	int stale;            /* Whether the listing needs to be re-read. */
+}
+tree_listing_t;
+
 static void init_flist(view_t *view);
 static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
 static int navigate_to_file_in_custom_view(view_t *view, const char dir[],
 		const char file[]);
 static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
+static int fill_dir_entry_partial(dir_entry_t *entry, const char path[],
+		int skip_md);
+static void fill_link_target(dir_entry_t *entry, const char path[]);
+static void resolve_link_target(dir_entry_t *entry, const char path[]);
+static int get_skipped_metadata(const view_t *view);
+static void ignore_column(columns_t *columns, column_info_t column_info);
+static int note_column_metadata(const char name[], void *arg);
+static void fill_entries(dir_entry_t entries[], int *count, const char dir[],
+		int skip_md);
+static void fill_entry_job(int i, void *arg);
 static void on_custom_view_leave(view_t *view);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
@@ -126,7 +215,7 @@ static int got_excluded(view_t *view, const dir_entry_t *entry, void *arg);
 static int exclude_temporary_entries(view_t *view);
 static int is_temporary(view_t *view, const dir_entry_t *entry, void *arg);
 static void flist_custom_drop_save(view_t *view);
-static uint64_t recalc_entry_size(const dir_entry_t *entry, uint64_t old_size);
+static uint64_t recalc_entry_size(const dir_entry_t *entry, DirSizeKind kind);
 static uint64_t entry_calc_nitems(const dir_entry_t *entry);
 static void load_dir_list_internal(view_t *view, int reload, int draw_only);
 static int populate_dir_list_internal(view_t *view, int reload);
@@ -151,6 +240,16 @@ static void start_dir_list_change(view_t *view, dir_entry_t **entries, int *len,
 static void finish_dir_list_change(view_t *view, dir_entry_t *entries, int len);
 static int add_file_entry_to_view(const char name[], const void *data,
 		void *param);
+static int should_load_in_bg(const view_t *view);
+static int start_bg_load(view_t *view, int reload);
+static void load_dir_bg(bg_op_t *bg_op, void *arg);
+static int load_entry_bg(const char name[], const void *data, void *param);
+static void pass_loaded_batch(loader_job_t *job);
+static void take_loaded_entries(view_t *view, dir_entry_t *batch,
+		int batch_len, dir_entry_t **entries, int *nentries);
+static void finish_bg_load(view_t *view);
+static void drop_loader(view_t *view);
+static void release_loader(dir_loader_t *loader);
 static void sort_dir_list(int msg, view_t *view);
 static void merge_lists(view_t *view, dir_entry_t *entries, int len);
 TSTATIC void check_file_uniqueness(view_t *view);
@@ -163,8 +262,14 @@ static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static int tree_needs_reload(view_t *view, int root_changed);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
-static FSWatchState poll_watcher(fswatch_t *watch, const char path[]);
+static FSWatchState apply_tree_changes(view_t *view);
+static void invalidate_tree_listing(view_t *view, const char path[]);
+static FSWatchState poll_watcher(fswatch_t *watch, const char path[],
+		fswatch_changes_t *changes);
+static int can_apply_changes(view_t *view);
+static int apply_dir_changes(view_t *view, const fswatch_changes_t *changes);
 static void remove_child_entries(view_t *view, dir_entry_t *entry);
 static void find_dir_in_cdpath(const char base_dir[], const char dst[],
 		char buf[], size_t buf_size);
@@ -187,8 +292,20 @@ static int complete_tree(const char name[], int valid, const void *parent_data,
 static void reset_entry_list(view_t *view, dir_entry_t **entries, int *count);
 static void drop_tops(dir_entry_t *entries, int *nentries, int extra);
 static int add_files_recursively(view_t *view, const char path[],
-		trie_t *excluded_paths, trie_t *folded_paths, int parent_pos,
-		int no_direct_parent, int depth);
+		trie_t *excluded_paths, trie_t *folded_paths, trie_t *prev_listings,
+		int parent_pos, int no_direct_parent, int depth);
+static trie_t * start_tree_listings(view_t *view);
+static void finish_tree_listings(view_t *view, trie_t *prev_listings);
+static void drop_tree_listings(view_t *view);
+static void free_tree_listing(void *ptr);
+static dir_entry_t * get_tree_level(view_t *view, trie_t *prev_listings,
+		const char path[], int *len);
+static dir_entry_t * clone_tree_level(const tree_listing_t *listing,
+		int *len);
+static dir_entry_t * list_tree_level(const char path[], int skip_md,
+		int *len);
+static dir_entry_t * custom_add_filled(view_t *view, const char path[],
+		dir_entry_t *entry);
 static FoldState get_fold_state(trie_t *folded_paths, const char full_path[]);
 static int set_fold_state(trie_t *folded_paths, const char full_path[],
 		FoldState state);
@@ -232,6 +349,7 @@ init_flist(view_t *view)
 	view->history_num = 0;
 	view->history_pos = 0;
 	view->on_slow_fs = 0;
+	view->loader = NULL;
 	view->has_dups = 0;
 
 	view->watched_dir = NULL;
@@ -260,6 +378,7 @@ flist_free_view(view_t *view)
 	/* For the application, we don't need to zero out fields after freeing them,
 	 * but doing so allows reusing this function in tests. */
 
+	drop_loader(view);
 	free_dir_entries(&view->dir_entry, &view->list_rows);
 	free_dir_entries(&view->custom.entries, &view->custom.entry_count);
 
@@ -272,6 +391,7 @@ flist_free_view(view_t *view)
 	view->custom.excluded_paths = NULL;
 	view->custom.folded_paths = NULL;
 	view->custom.paths_cache = NULL;
+	drop_tree_listings(view);
 
 	free_dir_entries(&view->custom.full.entries, &view->custom.full.nentries);
 
@@ -768,6 +888,8 @@ on_custom_view_leave(view_t *view)
 
 	trie_free(view->custom.folded_paths);
 	view->custom.folded_paths = NULL;
+
+	drop_tree_listings(view);
 }
 
 int
@@ -956,6 +1078,7 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 	}
 
 	entry->size = (uintmax_t)s.st_size;
+	entry->asize = (uint64_t)s.st_blocks*512U;
 	entry->uid = s.st_uid;
 	entry->gid = s.st_gid;
 	entry->mode = s.st_mode;
@@ -967,24 +1090,148 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 
 	if(entry->type == FT_LINK)
 	{
-		struct stat s;
+		fill_link_target(entry, path);
+	}
+
+	return 0;
+}
 
-		const SymLinkType symlink_type = get_symlink_type(path);
-		entry->dir_link = (symlink_type != SLT_UNKNOWN);
-		entry->slow_target = (symlink_type == SLT_SLOW);
+#ifdef HAVE_STATX
+
+/* Same as fill_dir_entry_by_path(), but doesn't request metadata specified by
+ * skip_md (FileMetadata) and doesn't force file system to synchronize
+ * attributes.  Returns zero on success, otherwise non-zero is returned. */
+static int
+fill_dir_entry_partial(dir_entry_t *entry, const char path[], int skip_md)
+{
+	unsigned int mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_BLOCKS
+	                  | STATX_MTIME | STATX_INO | STATX_NLINK;
+	if(!(skip_md & FMD_OWNER))
+	{
+		mask |= STATX_UID | STATX_GID;
+	}
+	if(!(skip_md & FMD_ATIME))
+	{
+		mask |= STATX_ATIME;
+	}
+	if(!(skip_md & FMD_CTIME))
+	{
+		mask |= STATX_CTIME;
+	}
 
-		/* Query mode of symbolic link target. */
-		if(!entry->slow_target && os_stat(entry->name, &s) == 0)
+	struct statx s;
+	if(statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask,
+				&s) != 0)
+	{
+		if(errno == ENOSYS)
 		{
-			//add by sim1: show symlink target's real size
-			entry->size = (uintmax_t)s.st_size;
-			entry->mode = s.st_mode;
+			/* Kernel doesn't support the system call. */
+			return fill_dir_entry_by_path(entry, path);
 		}
+
+		LOG_SERROR_MSG(errno, "Can't statx() \"%s\"", path);
+		return 1;
+	}
+
+	entry->type = get_type_from_mode(s.stx_mode);
+	if(entry->type == FT_UNK)
+	{
+		LOG_ERROR_MSG("Can't determine type of \"%s\"", path);
+		return 1;
+	}
+
+	entry->size = (uintmax_t)s.stx_size;
+	entry->asize = (s.stx_mask & STATX_BLOCKS) ? (uint64_t)s.stx_blocks*512U
+	                                           : entry->size;
+	entry->mode = s.stx_mode;
+	entry->inode = s.stx_ino;
+	entry->mtime = s.stx_mtime.tv_sec;
+	entry->nlinks = s.stx_nlink;
+
+	/* File system is free to return more or less than requested. */
+	entry->missing_md = 0;
+	if((s.stx_mask & (STATX_UID | STATX_GID)) == (STATX_UID | STATX_GID))
+	{
+		entry->uid = s.stx_uid;
+		entry->gid = s.stx_gid;
+	}
+	else
+	{
+		entry->missing_md |= FMD_OWNER;
+	}
+	if(s.stx_mask & STATX_ATIME)
+	{
+		entry->atime = s.stx_atime.tv_sec;
+	}
+	else
+	{
+		entry->missing_md |= FMD_ATIME;
+	}
+	if(s.stx_mask & STATX_CTIME)
+	{
+		entry->ctime = s.stx_ctime.tv_sec;
+	}
+	else
+	{
+		entry->missing_md |= FMD_CTIME;
+	}
+
+	if(entry->type == FT_LINK)
+	{
+		fill_link_target(entry, path);
 	}
 
 	return 0;
 }
 
+#else
+
+/* Same as fill_dir_entry_by_path().  There is no way to request only part of
+ * metadata, so skip_md is ignored.  Returns zero on success, otherwise non-zero
+ * is returned. */
+static int
+fill_dir_entry_partial(dir_entry_t *entry, const char path[], int skip_md)
+{
+	return fill_dir_entry_by_path(entry, path);
+}
+
+#endif
+
+/* Fills in information about target of symbolic link or postpones it according
+ * to 'lazylinks'. */
+static void
+fill_link_target(dir_entry_t *entry, const char path[])
+{
+	if(cfg.lazy_links)
+	{
+		/* Target is resolved by fentry_resolve_link() on displaying. */
+		entry->link_pending = 1;
+	}
+	else
+	{
+		resolve_link_target(entry, path);
+	}
+}
+
+/* Fills fields of symbolic link entry that describe its target. */
+static void
+resolve_link_target(dir_entry_t *entry, const char path[])
+{
+	struct stat s;
+
+	const SymLinkType symlink_type = get_symlink_type(path);
+	entry->dir_link = (symlink_type != SLT_UNKNOWN);
+	entry->slow_target = (symlink_type == SLT_SLOW);
+
+	/* Query mode of symbolic link target. */
+	if(!entry->slow_target && os_stat(path, &s) == 0)
+	{
+		//add by sim1: show symlink target's real size
+		entry->size = (uintmax_t)s.st_size;
+		entry->mode = s.st_mode;
+	}
+}
+
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -1036,10 +1283,7 @@ fill_dir_entry(dir_entry_t *entry, const char path[],
 
 	if(is_win_symlink(ffd->dwFileAttributes, ffd->dwReserved0))
 	{
-		const SymLinkType symlink_type = get_symlink_type(path);
-		entry->dir_link = (symlink_type != SLT_UNKNOWN);
-		entry->slow_target = (symlink_type == SLT_SLOW);
-
+		fill_link_target(entry, path);
 		entry->type = FT_LINK;
 	}
 	else if(ffd->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
@@ -1060,6 +1304,40 @@ fill_dir_entry(dir_entry_t *entry, const char path[],
 	return 0;
 }
 
+/* Same as fill_dir_entry_by_path().  Listing provides all the metadata at
+ * once, so skip_md is ignored.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+fill_dir_entry_partial(dir_entry_t *entry, const char path[], int skip_md)
+{
+	return fill_dir_entry_by_path(entry, path);
+}
+
+/* Fills in information about target of symbolic link or postpones it according
+ * to 'lazylinks'. */
+static void
+fill_link_target(dir_entry_t *entry, const char path[])
+{
+	if(cfg.lazy_links)
+	{
+		/* Target is resolved by fentry_resolve_link() on displaying. */
+		entry->link_pending = 1;
+	}
+	else
+	{
+		resolve_link_target(entry, path);
+	}
+}
+
+/* Fills fields of symbolic link entry that describe its target. */
+static void
+resolve_link_target(dir_entry_t *entry, const char path[])
+{
+	const SymLinkType symlink_type = get_symlink_type(path);
+	entry->dir_link = (symlink_type != SLT_UNKNOWN);
+	entry->slow_target = (symlink_type == SLT_SLOW);
+}
+
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -1070,6 +1348,178 @@ data_is_dir_entry(const WIN32_FIND_DATAW *ffd, const char path[])
 
 #endif
 
+void
+fentry_resolve_link(dir_entry_t *entry)
+{
+	if(!entry->link_pending)
+	{
+		return;
+	}
+
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	entry->link_pending = 0;
+	resolve_link_target(entry, full_path);
+}
+
+void
+fentry_load_metadata(const dir_entry_t *entry, int what)
+{
+#ifndef _WIN32
+	if((entry->missing_md & what) == 0)
+	{
+		return;
+	}
+
+	/* Metadata is a cache of file system state, filling it in doesn't change
+	 * the entry logically. */
+	dir_entry_t *const mutable_entry = (dir_entry_t *)entry;
+	mutable_entry->missing_md = 0;
+
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	struct stat s;
+	if(os_lstat(full_path, &s) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Can't lstat() \"%s\"", full_path);
+		return;
+	}
+
+	mutable_entry->uid = s.st_uid;
+	mutable_entry->gid = s.st_gid;
+	mutable_entry->atime = s.st_atime;
+	mutable_entry->ctime = s.st_ctime;
+#endif
+}
+
+int
+flist_metadata_of_key(int key)
+{
+	switch(key)
+	{
+		case SK_BY_GROUP_ID:
+		case SK_BY_GROUP_NAME:
+		case SK_BY_OWNER_ID:
+		case SK_BY_OWNER_NAME:
+			return FMD_OWNER;
+		case SK_BY_TIME_ACCESSED:
+			return FMD_ATIME;
+		case SK_BY_TIME_CHANGED:
+			return FMD_CTIME;
+
+		default:
+			return 0;
+	}
+}
+
+/* Determines metadata that isn't needed for every file of the view, which is
+ * the case when neither sorting nor columns use it.  Returns set of
+ * FileMetadata flags. */
+static int
+get_skipped_metadata(const view_t *view)
+{
+	int i;
+	int needed = 0;
+
+	const signed char *const sort = ui_view_sort_list_get(view, view->sort);
+	for(i = 0; i < SK_COUNT && abs(sort[i]) <= SK_LAST; ++i)
+	{
+		needed |= flist_metadata_of_key(abs(sort[i]));
+	}
+
+	if(!is_null_or_empty(view->view_columns))
+	{
+		columns_md_t md = { .view = view, .needed = 0 };
+		if(parse_columns(/*columns=*/NULL, &ignore_column, &note_column_metadata,
+					view->view_columns, &md) != 0)
+		{
+			return 0;
+		}
+		needed |= md.needed;
+	}
+
+	return FMD_ALL & ~needed;
+}
+
+/* parse_columns() callback that doesn't add columns anywhere. */
+static void
+ignore_column(columns_t *columns, column_info_t column_info)
+{
+}
+
+/* parse_columns() callback that records metadata needed by a column.  Returns
+ * column id or negative number on error. */
+static int
+note_column_metadata(const char name[], void *arg)
+{
+	columns_md_t *const md = arg;
+
+	int id;
+	if(name[0] == '\0')
+	{
+		/* Secondary key of primary sorting key. */
+		const signed char *const sort = ui_view_sort_list_get(md->view,
+				md->view->sort);
+		id = (int)get_secondary_key((SortingKey)abs(sort[0]));
+	}
+	else
+	{
+		id = ui_map_column_name(name);
+	}
+
+	if(id >= 0)
+	{
+		md->needed |= flist_metadata_of_key(id);
+	}
+	return id;
+}
+
+/* Queries information about files of the directory in parallel (see
+ * 'statworkers') skipping metadata specified by skip_md (FileMetadata).
+ * Entries that can't be filled in are removed preserving order of the rest. */
+static void
+fill_entries(dir_entry_t entries[], int *count, const char dir[], int skip_md)
+{
+	fill_job_t job = { .entries = entries, .dir = dir, .skip_md = skip_md };
+	const int nworkers = (*count >= PARALLEL_STAT_MIN ? cfg.stat_workers : 1);
+	parallel_for(*count, nworkers, &fill_entry_job, &job);
+
+	int i, j = 0;
+	for(i = 0; i < *count; ++i)
+	{
+		/* Successfully filled entries always have their type determined. */
+		if(entries[i].type == FT_UNK)
+		{
+			fentry_free(&entries[i]);
+			continue;
+		}
+
+		if(i != j)
+		{
+			entries[j] = entries[i];
+		}
+		++j;
+	}
+	*count = j;
+}
+
+/* parallel_for() body that fills in a single entry. */
+static void
+fill_entry_job(int i, void *arg)
+{
+	fill_job_t *const job = arg;
+	dir_entry_t *const entry = &job->entries[i];
+
+	char full_path[PATH_MAX + 1];
+	build_path(full_path, sizeof(full_path), job->dir, entry->name);
+	if(fill_dir_entry_partial(entry, full_path, job->skip_md) != 0)
+	{
+		entry->type = FT_UNK;
+	}
+}
+
 int
 flist_custom_finish(view_t *view, CVType type, int allow_empty)
 {
@@ -1615,7 +2065,7 @@ fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 		*size = size_res.value;
 		if(size_res.value != DCACHE_UNKNOWN && !size_res.is_valid && !is_slow_fs)
 		{
-			*size = recalc_entry_size(entry, size_res.value);
+			*size = recalc_entry_size(entry, DSK_APPARENT);
 		}
 	}
 
@@ -1630,20 +2080,35 @@ fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 	}
 }
 
-/* Updates cached size of a directory also updating its relevant parents.
- * Returns current size of the directory entry. */
+/* Updates cached sizes of a directory also updating its relevant parents.
+ * Returns current size of the directory entry of the specified kind. */
 static uint64_t
-recalc_entry_size(const dir_entry_t *entry, uint64_t old_size)
+recalc_entry_size(const dir_entry_t *entry, DirSizeKind kind)
 {
-	uint64_t size;
-
 	char full_path[PATH_MAX + 1];
 	get_full_path_of(entry, sizeof(full_path), full_path);
 
-	size = fops_dir_size(full_path, 0, &ui_cancellation_info);
-	dcache_update_parent_sizes(full_path, size - old_size);
+	/* Outdated values are included in sizes of parents. */
+	dcache_result_t old_sizes[DSK_COUNT];
+	int i;
+	for(i = 0; i < DSK_COUNT; ++i)
+	{
+		dcache_get_size_of(entry, i, &old_sizes[i]);
+	}
+
+	uint64_t sizes[DSK_COUNT];
+	fops_dir_sizes(full_path, 0, &ui_cancellation_info, sizes);
+
+	for(i = 0; i < DSK_COUNT; ++i)
+	{
+		if(old_sizes[i].value != DCACHE_UNKNOWN)
+		{
+			dcache_update_parent_sizes_of(full_path, i,
+					sizes[i] - old_sizes[i].value);
+		}
+	}
 
-	return size;
+	return sizes[kind];
 }
 
 /* Calculates number of items at path specified by the entry.  No check for file
@@ -1717,8 +2182,6 @@ populate_dir_list_internal(view_t *view, int reload)
 {
 	char *saved_cwd;
 
-	view->filtered = 0;
-
 	/* List reload usually implies that something related to file list has
 	 * changed, like an option.  Reset cached lists to make sure they are up to
 	 * date with main column. */
@@ -1728,6 +2191,23 @@ populate_dir_list_internal(view_t *view, int reload)
 		flist_free_cache(&view->right_column);
 	}
 
+	if(view->loader != NULL)
+	{
+		if(reload && !flist_custom_active(view) &&
+				stroscmp(view->loader->dir, view->curr_dir) == 0)
+		{
+			/* Don't restart loading, just reload once more after it's done. */
+			view->loader->reload_again = 1;
+			return 0;
+		}
+
+		drop_loader(view);
+	}
+
+	/* Loading starts anew, so entries filtered out by the previous one don't
+	 * count anymore. */
+	view->filtered = 0;
+
 	if(flist_custom_active(view))
 	{
 		return populate_custom_view(view, reload);
@@ -1757,7 +2237,7 @@ populate_dir_list_internal(view_t *view, int reload)
 			stroscmp(view->watched_dir, view->curr_dir) == 0)
 	{
 		/* Drain all events that happened before this point. */
-		(void)poll_watcher(view->watch, view->curr_dir);
+		(void)poll_watcher(view->watch, view->curr_dir, /*changes=*/NULL);
 	}
 
 	if(is_unc_root(view->curr_dir))
@@ -1787,6 +2267,10 @@ populate_dir_list_internal(view_t *view, int reload)
 		}
 #endif
 	}
+	else if(should_load_in_bg(view) && start_bg_load(view, reload) == 0)
+	{
+		/* Entries will be added by flist_update_from_loader(). */
+	}
 	else if(update_dir_list(view, reload) != 0)
 	{
 		/* We don't have read access, only execute, or there were other problems. */
@@ -2307,7 +2791,17 @@ update_dir_list(view_t *view, int reload)
 
 	start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
 
-	if(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0)
+	const int failed =
+		(enum_dir_content(view->curr_dir, &add_file_entry_to_view, view) != 0);
+
+#ifndef _WIN32
+	/* Information about files is queried after listing the directory to be able
+	 * to do it in parallel. */
+	fill_entries(view->dir_entry, &view->list_rows, view->curr_dir,
+			get_skipped_metadata(view));
+#endif
+
+	if(failed)
 	{
 		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", view->curr_dir);
 		free_dir_entries(&prev_dir_entries, &prev_list_rows);
@@ -2397,31 +2891,417 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 
 	init_dir_entry(view, entry, name);
 
-	if(fill_dir_entry(entry, entry->name, data) == 0)
-	{
-		++view->list_rows;
-	}
-	else
+#ifdef _WIN32
+	/* Listing already provides all the information, use it. */
+	if(fill_dir_entry(entry, entry->name, data) != 0)
 	{
 		fentry_free(entry);
+		return 0;
 	}
+#endif
 
+	++view->list_rows;
 	return 0;
 }
 
-void
-resort_dir_list(int msg, view_t *view)
+/* Checks whether current directory of the view should be loaded in
+ * background.  Returns non-zero if so. */
+static int
+should_load_in_bg(const view_t *view)
 {
-	char full_path[PATH_MAX + 1];
-	const int top_delta = view->list_pos - view->top_line;
-	if(view->list_pos < view->list_rows)
+	/* Startup commands expect file lists to be loaded. */
+	return view->on_slow_fs && curr_stats.load_stage >= 3;
+}
+
+/* Starts loading current directory of the view in background.  On reload
+ * current list is kept until loading is finished, otherwise the list is filled
+ * in progressively.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+start_bg_load(view_t *view, int reload)
+{
+	dir_loader_t *const loader = calloc(1, sizeof(*loader));
+	if(loader == NULL)
 	{
-		get_current_full_path(view, sizeof(full_path), full_path);
+		return 1;
 	}
 
-	sort_dir_list(msg, view);
-
-	if(view->list_pos < view->list_rows)
+	loader->dir = strdup(view->curr_dir);
+	if(loader->dir == NULL || pthread_mutex_init(&loader->lock, NULL) != 0)
+	{
+		free(loader->dir);
+		free(loader);
+		return 1;
+	}
+
+	loader->refs = 2;
+	loader->reload = reload;
+	loader->skip_md = get_skipped_metadata(view);
+
+	if(bg_execute("Loading directory", loader->dir, BG_UNDEFINED_TOTAL,
+				/*important=*/0, &load_dir_bg, loader) != 0)
+	{
+		loader->refs = 1;
+		release_loader(loader);
+		return 1;
+	}
+
+	view->loader = loader;
+
+	if(!reload)
+	{
+		dir_entry_t *prev_dir_entries;
+		int prev_list_rows;
+		start_dir_list_change(view, &prev_dir_entries, &prev_list_rows, reload);
+
+		/* Parent directory keeps the list valid while it's being loaded.  It's
+		 * removed at the end if it's not supposed to be visible. */
+		add_parent_dir(view);
+	}
+
+	return 0;
+}
+
+/* Entry point of the background job that loads directory. */
+static void
+load_dir_bg(bg_op_t *bg_op, void *arg)
+{
+	loader_job_t job = { .loader = arg, .bg_op = bg_op };
+	dir_loader_t *const loader = job.loader;
+
+	const int failed = (enum_dir_content(loader->dir, &load_entry_bg, &job) != 0);
+	if(failed)
+	{
+		LOG_SERROR_MSG(errno, "Can't opendir() \"%s\"", loader->dir);
+	}
+
+	pass_loaded_batch(&job);
+	free_dir_entries(&job.entries, &job.nentries);
+
+	pthread_mutex_lock(&loader->lock);
+	loader->finished = 1;
+	loader->failed = failed;
+	loader->interrupted = bg_op_cancelled(bg_op);
+	pthread_mutex_unlock(&loader->lock);
+
+	release_loader(loader);
+}
+
+/* enum_dir_content() callback that collects entries in background.  Returns
+ * zero on success or non-zero to stop enumeration. */
+static int
+load_entry_bg(const char name[], const void *data, void *param)
+{
+	loader_job_t *const job = param;
+	dir_loader_t *const loader = job->loader;
+
+	if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	const int cancelled = loader->cancelled;
+	pthread_mutex_unlock(&loader->lock);
+	if(cancelled || bg_op_cancelled(job->bg_op))
+	{
+		return 1;
+	}
+
+	dir_entry_t *const entry = alloc_dir_entry(&job->entries, job->nentries);
+	if(entry == NULL)
+	{
+		return 1;
+	}
+
+	init_dir_entry(/*view=*/NULL, entry, name);
+	if(entry->name == NULL)
+	{
+		return 0;
+	}
+
+	++job->nentries;
+	++job->total;
+
+	const int first = (job->total == job->nentries);
+	if(job->nentries >= (first ? LOADER_FIRST_BATCH : LOADER_BATCH))
+	{
+		pass_loaded_batch(job);
+	}
+	return 0;
+}
+
+/* Hands entries collected by the job over to the view. */
+static void
+pass_loaded_batch(loader_job_t *job)
+{
+	dir_loader_t *const loader = job->loader;
+
+	/* Information about files is queried for the whole batch to be able to do
+	 * it in parallel. */
+	int nnew = job->nentries - job->nfilled;
+	fill_entries(job->entries + job->nfilled, &nnew, loader->dir,
+			loader->skip_md);
+	job->nentries = job->nfilled + nnew;
+	job->nfilled = job->nentries;
+
+	if(job->nentries == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	dir_entry_t *const batch = dynarray_extend(loader->batch,
+			job->nentries*sizeof(*loader->batch));
+	if(batch != NULL)
+	{
+		memcpy(&batch[loader->batch_len], job->entries,
+				job->nentries*sizeof(*job->entries));
+		loader->batch = batch;
+		loader->batch_len += job->nentries;
+	}
+	pthread_mutex_unlock(&loader->lock);
+
+	if(batch == NULL)
+	{
+		/* Retry next time. */
+		return;
+	}
+
+	dynarray_free(job->entries);
+	job->entries = NULL;
+	job->nentries = 0;
+	job->nfilled = 0;
+
+	if(bg_op_lock(job->bg_op))
+	{
+		job->bg_op->done = job->total;
+		bg_op_unlock(job->bg_op);
+	}
+}
+
+int
+flist_update_from_loader(view_t *view)
+{
+	dir_loader_t *const loader = view->loader;
+	if(loader == NULL)
+	{
+		return 0;
+	}
+
+	if(flist_custom_active(view) || stroscmp(loader->dir, view->curr_dir) != 0)
+	{
+		/* The results are of no use anymore. */
+		drop_loader(view);
+		return 0;
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	dir_entry_t *const batch = loader->batch;
+	const int batch_len = loader->batch_len;
+	const int finished = loader->finished;
+	loader->batch = NULL;
+	loader->batch_len = 0;
+	pthread_mutex_unlock(&loader->lock);
+
+	if(batch_len == 0 && !finished)
+	{
+		return 1;
+	}
+
+	if(loader->reload)
+	{
+		take_loaded_entries(view, batch, batch_len, &loader->entries,
+				&loader->nentries);
+	}
+	else if(batch_len != 0)
+	{
+		/* Keep cursor at the position from history until user moves it. */
+		const int keep_hist_pos = (view->list_pos == loader->last_pos);
+
+		take_loaded_entries(view, batch, batch_len, &view->dir_entry,
+				&view->list_rows);
+		resort_dir_list(/*msg=*/0, view);
+		if(keep_hist_pos)
+		{
+			flist_hist_lookup(view, view);
+		}
+		loader->last_pos = view->list_pos;
+
+		fview_list_updated(view);
+		ui_view_schedule_redraw(view);
+	}
+
+	if(finished)
+	{
+		finish_bg_load(view);
+		return 0;
+	}
+	return 1;
+}
+
+/* Appends visible entries loaded in background to a list, frees the rest along
+ * with the batch. */
+static void
+take_loaded_entries(view_t *view, dir_entry_t *batch, int batch_len,
+		dir_entry_t **entries, int *nentries)
+{
+	int i;
+	for(i = 0; i < batch_len; ++i)
+	{
+		dir_entry_t *const entry = &batch[i];
+
+		const int visible = (!view->hide_dot || entry->name[0] != '.')
+		                 && filters_file_is_visible(view, view->curr_dir,
+		                        entry->name, fentry_is_dir(entry),
+		                        /*apply_local_filter=*/1);
+		if(!visible)
+		{
+			++view->filtered;
+			fentry_free(entry);
+			continue;
+		}
+
+		dir_entry_t *const dst = alloc_dir_entry(entries, *nentries);
+		if(dst == NULL)
+		{
+			fentry_free(entry);
+			continue;
+		}
+
+		*dst = *entry;
+		dst->origin = &view->curr_dir[0];
+		++*nentries;
+	}
+
+	dynarray_free(batch);
+}
+
+/* Completes loading of a directory in background. */
+static void
+finish_bg_load(view_t *view)
+{
+	dir_loader_t *const loader = view->loader;
+
+	pthread_mutex_lock(&loader->lock);
+	const int failed = loader->failed;
+	const int interrupted = loader->interrupted;
+	pthread_mutex_unlock(&loader->lock);
+
+	const int parent_visible = cfg_parent_dir_is_visible(
+			is_root_dir(view->curr_dir));
+
+	if(loader->reload)
+	{
+		/* Incomplete list would drop entries from the view, keep the old one
+		 * instead. */
+		if(!failed && !interrupted)
+		{
+			dir_entry_t *const prev_dir_entries = view->dir_entry;
+			const int prev_list_rows = view->list_rows;
+
+			view->dir_entry = loader->entries;
+			view->list_rows = loader->nentries;
+			loader->entries = NULL;
+			loader->nentries = 0;
+			view->matches = 0;
+			view->selected_files = 0;
+
+			if(parent_visible || view->list_rows == 0)
+			{
+				add_parent_dir(view);
+			}
+
+			sort_dir_list(/*msg=*/0, view);
+			finish_dir_list_change(view, prev_dir_entries, prev_list_rows);
+		}
+	}
+	else
+	{
+		if(!parent_visible && view->list_rows > 1)
+		{
+			int i;
+			for(i = 0; i < view->list_rows; ++i)
+			{
+				if(is_parent_dir(view->dir_entry[i].name))
+				{
+					view->dir_entry[i].temporary = 1;
+				}
+			}
+		}
+
+		/* This also drops parent directory entry if it was marked above. */
+		check_file_uniqueness(view);
+		(void)exclude_temporary_entries(view);
+	}
+
+	if(interrupted)
+	{
+		ui_sb_msgf("Loading of %s was cancelled", view->curr_dir);
+	}
+
+	const int reload_again = loader->reload_again;
+	drop_loader(view);
+
+	fview_list_updated(view);
+	ui_view_schedule_redraw(view);
+
+	if(reload_again)
+	{
+		ui_view_schedule_reload(view);
+	}
+}
+
+/* Stops loading directory of the view in background, if any. */
+static void
+drop_loader(view_t *view)
+{
+	dir_loader_t *const loader = view->loader;
+	if(loader == NULL)
+	{
+		return;
+	}
+
+	view->loader = NULL;
+	free_dir_entries(&loader->entries, &loader->nentries);
+
+	pthread_mutex_lock(&loader->lock);
+	loader->cancelled = 1;
+	pthread_mutex_unlock(&loader->lock);
+
+	release_loader(loader);
+}
+
+/* Drops a reference to the loader freeing it after the last one. */
+static void
+release_loader(dir_loader_t *loader)
+{
+	pthread_mutex_lock(&loader->lock);
+	const int last = (--loader->refs == 0);
+	pthread_mutex_unlock(&loader->lock);
+
+	if(last)
+	{
+		free_dir_entries(&loader->batch, &loader->batch_len);
+		pthread_mutex_destroy(&loader->lock);
+		free(loader->dir);
+		free(loader);
+	}
+}
+
+void
+resort_dir_list(int msg, view_t *view)
+{
+	char full_path[PATH_MAX + 1];
+	const int top_delta = view->list_pos - view->top_line;
+	if(view->list_pos < view->list_rows)
+	{
+		get_current_full_path(view, sizeof(full_path), full_path);
+	}
+
+	sort_dir_list(msg, view);
+
+	if(view->list_pos < view->list_rows)
 	{
 		flist_goto_by_path(view, full_path);
 		view->top_line = view->list_pos - top_delta;
@@ -2656,15 +3536,16 @@ add_parent_entry(view_t *view, dir_entry_t **entries, int *count)
 }
 
 /* Initializes dir_entry_t with name and all other fields with default
- * values. */
+ * values.  The view can be NULL, in which case origin is left unset. */
 static void
 init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 {
 	entry->name = strdup(name);
-	entry->origin = &view->curr_dir[0];
+	entry->origin = (view == NULL ? NULL : &view->curr_dir[0]);
 
 	entry->size = 0ULL;
 #ifndef _WIN32
+	entry->asize = 0ULL;
 	entry->uid = (uid_t)-1;
 	entry->gid = (gid_t)-1;
 	entry->mode = (mode_t)0;
@@ -2681,6 +3562,8 @@ init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 	entry->nlinks = 0;
 	entry->dir_link = 0;
 	entry->slow_target = 0;
+	entry->link_pending = 0;
+	entry->missing_md = 0;
 	entry->hi_num = -1;
 	entry->name_dec_num = -1;
 
@@ -2824,6 +3707,8 @@ check_if_filelist_has_changed(view_t *view)
 {
 	int failed, changed;
 	const char *const curr_dir = flist_get_dir(view);
+	fswatch_changes_t changes = {};
+	int have_changes = 0;
 
 	if(view->on_slow_fs ||
 			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
@@ -2842,9 +3727,13 @@ check_if_filelist_has_changed(view_t *view)
 	}
 	else
 	{
-		FSWatchState state = poll_watcher(view->watch, curr_dir);
+		const int collect = can_apply_changes(view);
+		FSWatchState state = poll_watcher(view->watch, curr_dir,
+				collect ? &changes : NULL);
 		changed = (state != FSWS_UNCHANGED);
 		failed = (state == FSWS_ERRORED);
+		have_changes = (collect && state == FSWS_UPDATED && !changes.lost &&
+				changes.nitems != 0);
 	}
 
 	/* Check if we still have permission to visit this directory. */
@@ -2857,6 +3746,8 @@ check_if_filelist_has_changed(view_t *view)
 
 	if(failed)
 	{
+		fswatch_changes_free(&changes);
+
 		show_error_msgf("Directory Check", "Cannot open %s", curr_dir);
 
 		leave_invalid_dir(view);
@@ -2866,18 +3757,23 @@ check_if_filelist_has_changed(view_t *view)
 		return;
 	}
 
-	if(changed)
-	{
-		ui_view_schedule_reload(view);
-	}
-	else if(flist_custom_active(view) && cv_tree(view->custom.type))
+	if(flist_custom_active(view) && cv_tree(view->custom.type))
 	{
-		if(flist_is_fs_backed(view) &&
-				tree_has_changed(view->dir_entry, view->list_rows))
+		/* Watcher of the tree has to be polled even if root has changed to not
+		 * reuse outdated listings on reload. */
+		if(flist_is_fs_backed(view) ? tree_needs_reload(view, changed) : changed)
 		{
 			ui_view_schedule_reload(view);
 		}
 	}
+	else if(have_changes && apply_dir_changes(view, &changes) == 0)
+	{
+		ui_view_schedule_redraw(view);
+	}
+	else if(changed)
+	{
+		ui_view_schedule_reload(view);
+	}
 	else
 	{
 		if(flist_update_cache(view, &view->left_column, view->left_column.dir) ||
@@ -2886,6 +3782,221 @@ check_if_filelist_has_changed(view_t *view)
 			ui_view_schedule_redraw(view);
 		}
 	}
+
+	fswatch_changes_free(&changes);
+}
+
+/* Checks whether changes reported by watcher of current directory can be
+ * applied to file list of the view directly instead of reloading it.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_apply_changes(view_t *view)
+{
+	return curr_stats.load_stage >= 2
+	    && !flist_custom_active(view)
+	    && view->loader == NULL
+	    && !view->has_dups
+	    && !view->local_filter.in_progress
+	    && !vle_mode_is(VISUAL_MODE)
+	    && window_shows_dirlist(view)
+	    && is_dir_list_loaded(view)
+	    && view->watched_dir != NULL
+	    && stroscmp(view->watched_dir, view->curr_dir) == 0;
+}
+
+/* Updates file list of the view according to changes of its files instead of
+ * reading the whole directory again.  Cursor stays on the same file if it's
+ * still there.  Returns zero on success and non-zero if the list should be
+ * reloaded. */
+static int
+apply_dir_changes(view_t *view, const fswatch_changes_t *changes)
+{
+	const char *const dir = flist_get_dir(view);
+
+	/* Placeholder entry of an empty directory is better handled by reloading. */
+	if(!cfg_parent_dir_is_visible(is_root_dir(dir)) && view->list_rows == 1 &&
+			is_parent_dir(view->dir_entry[0].name))
+	{
+		return 1;
+	}
+
+	/* Entries of changed files that are currently in the list (ones with NULL
+	 * name aren't). */
+	dir_entry_t *const prev = reallocarray(NULL, changes->nitems, sizeof(*prev));
+	char *const curr_name = strdup(get_current_file_name(view));
+	trie_t *const names = trie_create(/*free_func=*/NULL);
+	if(prev == NULL || curr_name == NULL || names == NULL)
+	{
+		free(prev);
+		free(curr_name);
+		trie_free(names);
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < changes->nitems; ++i)
+	{
+		prev[i].name = NULL;
+		(void)trie_set(names, changes->items[i].name, &prev[i]);
+	}
+
+	/* Take out entries of changed files in a single pass. */
+	int nkept = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+
+		void *data;
+		if(trie_get(names, entry->name, &data) == 0 && data != NULL)
+		{
+			*(dir_entry_t *)data = *entry;
+			view->selected_files -= (entry->selected != 0);
+			view->matches -= (entry->search_match != 0);
+			continue;
+		}
+
+		view->dir_entry[nkept++] = *entry;
+	}
+	view->list_rows = nkept;
+	trie_free(names);
+
+	/* And put them back at their new positions if they are still visible. */
+	int error = 0;
+	const int skip_md = get_skipped_metadata(view);
+	for(i = 0; i < changes->nitems; ++i)
+	{
+		const fswatch_change_t *const change = &changes->items[i];
+		dir_entry_t *const old = (prev[i].name == NULL ? NULL : &prev[i]);
+
+		char full_path[PATH_MAX + 1 + NAME_MAX + 1];
+		snprintf(full_path, sizeof(full_path), "%s/%s", dir, change->name);
+
+		dir_entry_t entry;
+		init_dir_entry(view, &entry, change->name);
+
+		/* The latest event being deletion means that there is no such file. */
+		const int exists = entry.name != NULL && change->kind != FSWC_DELETED
+		                && fill_dir_entry_partial(&entry, full_path, skip_md) == 0;
+		const int visible = exists && tree_candidate_is_visible(view, dir,
+				change->name, is_dir(full_path), /*apply_local_filter=*/1);
+
+		/* A file that isn't new and isn't in the list must have been filtered
+		 * out. */
+		const int was_filtered = (old == NULL && change->kind != FSWC_CREATED);
+		const int is_filtered = (exists && !visible);
+		view->filtered += is_filtered - was_filtered;
+		if(view->filtered < 0)
+		{
+			view->filtered = 0;
+		}
+
+		if(old != NULL)
+		{
+			merge_entries(&entry, old);
+			/* Highlighting might depend on properties that have changed. */
+			entry.hi_num = -1;
+			fentry_free(old);
+		}
+
+		if(!visible)
+		{
+			fentry_free(&entry);
+			continue;
+		}
+
+		const int pos = sort_find_pos(view, &entry);
+		if(alloc_dir_entry(&view->dir_entry, view->list_rows) == NULL)
+		{
+			fentry_free(&entry);
+			error = 1;
+			continue;
+		}
+
+		memmove(&view->dir_entry[pos + 1], &view->dir_entry[pos],
+				sizeof(*view->dir_entry)*(view->list_rows - pos));
+		view->dir_entry[pos] = entry;
+		++view->list_rows;
+
+		view->selected_files += (entry.selected != 0);
+	}
+	free(prev);
+
+	if(view->list_rows == 0)
+	{
+		add_parent_dir(view);
+	}
+
+	const int pos = fpos_find_by_name(view, curr_name);
+	if(pos >= 0)
+	{
+		view->list_pos = pos;
+	}
+	else if(view->list_pos >= view->list_rows)
+	{
+		view->list_pos = view->list_rows - 1;
+	}
+	free(curr_name);
+
+	fview_list_updated(view);
+	return error;
+}
+
+/* Checks whether tree-view needs a reload and marks listings of changed
+ * directories as outdated.  root_changed signals about a change detected by
+ * watcher of the root.  Returns non-zero if so, otherwise zero is returned. */
+static int
+tree_needs_reload(view_t *view, int root_changed)
+{
+	fswatch_t *const watch = view->custom.tree_watch;
+	if(watch == NULL)
+	{
+		return root_changed || tree_has_changed(view->dir_entry, view->list_rows);
+	}
+
+	if(root_changed)
+	{
+		invalidate_tree_listing(view, flist_get_dir(view));
+	}
+
+	const FSWatchState state = apply_tree_changes(view);
+	return root_changed || state != FSWS_UNCHANGED;
+}
+
+/* Marks listings of tree-view that were changed on file system as outdated.
+ * Returns state of the watcher. */
+static FSWatchState
+apply_tree_changes(view_t *view)
+{
+	strlist_t changed = {};
+	const FSWatchState state = fswatch_poll_set(view->custom.tree_watch,
+			&changed);
+
+	int i;
+	for(i = 0; i < changed.nitems; ++i)
+	{
+		invalidate_tree_listing(view, changed.items[i]);
+	}
+	free_string_array(changed.items, changed.nitems);
+
+	if(state == FSWS_ERRORED)
+	{
+		/* Some changes were lost, so nothing can be trusted. */
+		drop_tree_listings(view);
+	}
+
+	return state;
+}
+
+/* Marks listing of a directory of tree-view as outdated, if it exists. */
+static void
+invalidate_tree_listing(view_t *view, const char path[])
+{
+	void *data;
+	if(trie_get(view->custom.tree_listings, path, &data) == 0 && data != NULL)
+	{
+		tree_listing_t *const listing = data;
+		listing->stale = 1;
+	}
 }
 
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
@@ -2947,7 +4058,8 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 		update = 1;
 	}
 
-	if(poll_watcher(cache->watch, path) != FSWS_UNCHANGED || update)
+	if(poll_watcher(cache->watch, path, /*changes=*/NULL) != FSWS_UNCHANGED ||
+			update)
 	{
 		free_dir_entries(&cache->entries.entries, &cache->entries.nentries);
 		cache->entries = flist_list_in(view, path, 0, 1);
@@ -2958,11 +4070,11 @@ flist_update_cache(view_t *view, cached_entries_t *cache, const char path[])
 }
 
 /* Polls file-system watcher and re-enters current working directory of the
- * process if necessary.  Returns watcher's state. */
+ * process if necessary.  changes can be NULL.  Returns watcher's state. */
 static FSWatchState
-poll_watcher(fswatch_t *watch, const char path[])
+poll_watcher(fswatch_t *watch, const char path[], fswatch_changes_t *changes)
 {
-	FSWatchState state = fswatch_poll(watch);
+	FSWatchState state = fswatch_poll_changes(watch, changes);
 
 	if(state == FSWS_ERRORED || state == FSWS_REPLACED)
 	{
@@ -3515,6 +4627,40 @@ fentry_get_size(const view_t *view, const dir_entry_t *entry)
 	return (size == DCACHE_UNKNOWN ? entry->size : size);
 }
 
+uint64_t
+fentry_get_size_of(const view_t *view, const dir_entry_t *entry,
+		DirSizeKind kind)
+{
+	if(kind == DSK_APPARENT)
+	{
+		return fentry_get_size(view, entry);
+	}
+
+	if(fentry_is_dir(entry))
+	{
+		dcache_result_t size_res;
+		dcache_get_size_of(entry, kind, &size_res);
+
+		const int is_slow_fs = view->on_slow_fs || entry->slow_target;
+		if(size_res.value != DCACHE_UNKNOWN && !size_res.is_valid && !is_slow_fs)
+		{
+			return recalc_entry_size(entry, kind);
+		}
+
+		if(size_res.value != DCACHE_UNKNOWN)
+		{
+			return size_res.value;
+		}
+	}
+
+#ifndef _WIN32
+	/* Hard links of a single file can't be deduplicated. */
+	return (kind == DSK_ALLOCATED ? entry->asize : entry->size);
+#else
+	return entry->size;
+#endif
+}
+
 //add by sim1 ++++++++++++++++++++++++++++++++++++++++++++++
 extern int has_rating_stars(const char path[]);
 int
@@ -3753,7 +4899,7 @@ get_short_path_of(const view_t *view, const dir_entry_t *entry, NameFormat fmt,
 	}
 	else
 	{
-		snprintf(buf, buf_len, "%s/%s", path, name);
+		build_path(buf, buf_len, path, name);
 	}
 }
 
@@ -4165,14 +5311,18 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths,
 	ui_cancellation_push_on();
 	if(from_custom)
 	{
+		drop_tree_listings(view);
+
 		nfiltered = 0;
 		tree_from_cv(view);
 		type = CV_CUSTOM_TREE;
 	}
 	else
 	{
+		trie_t *const prev_listings = start_tree_listings(view);
 		nfiltered = add_files_recursively(view, path, excluded_paths, folded_paths,
-				-1, 0, depth);
+				prev_listings, -1, 0, depth);
+		finish_tree_listings(view, prev_listings);
 		type = CV_TREE;
 	}
 	ui_cancellation_pop();
@@ -4366,21 +5516,23 @@ drop_tops(dir_entry_t *entries, int *nentries, int extra)
 	}
 }
 
-/* Adds custom view entries corresponding to file system tree.  parent_pos is
+/* Adds custom view entries corresponding to file system tree.  Listings from
+ * prev_listings are reused if they are still up to date.  parent_pos is
  * expected to be negative for the outermost invocation.  The depth parameter
  * is used to limit nesting level, when it's negative, parent node is just
  * marked as folded.  Returns number of filtered out files on success or partial
  * success and negative value on serious error. */
 static int
 add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
-		trie_t *folded_paths, int parent_pos, int no_direct_parent, int depth)
+		trie_t *folded_paths, trie_t *prev_listings, int parent_pos,
+		int no_direct_parent, int depth)
 {
 	int i;
 	const int prev_count = view->custom.entry_count;
 	int nfiltered = 0;
 
 	int len;
-	char **lst = list_all_files(path, &len);
+	dir_entry_t *lst = get_tree_level(view, prev_listings, path, &len);
 	if(len < 0)
 	{
 		return -1;
@@ -4393,7 +5545,8 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 		int dir;
 		void *dummy;
 		dir_entry_t *entry;
-		char *const full_path = format_str("%s/%s", path, lst[i]);
+		const char *const name = lst[i].name;
+		char *const full_path = format_str("%s/%s", path, name);
 
 		if(trie_get(excluded_paths, full_path, &dummy) == 0)
 		{
@@ -4401,10 +5554,10 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			continue;
 		}
 
-		dir = is_dir(full_path);
-		if(!tree_candidate_is_visible(view, path, lst[i], dir, 1))
+		dir = lst[i].link_pending ? is_dir(full_path) : fentry_is_dir(&lst[i]);
+		if(!tree_candidate_is_visible(view, path, name, dir, 1))
 		{
-			const int real_dir = (dir && !is_symlink(full_path));
+			const int real_dir = (lst[i].type == FT_DIR);
 
 			FoldState state;
 			if(real_dir)
@@ -4425,12 +5578,12 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			/* Traverse directory (but not symlink to it) even if we're skipping it,
 			 * because we might need files that are inside of it. */
 			if(real_dir && depth > 0 &&
-					tree_candidate_is_visible(view, path, lst[i], dir, 0))
+					tree_candidate_is_visible(view, path, name, dir, 0))
 			{
 				if(state != FOLD_AUTO_CLOSED && state != FOLD_USER_CLOSED)
 				{
 					nfiltered += add_files_recursively(view, full_path, excluded_paths,
-							folded_paths, parent_pos, 1, depth - 1);
+							folded_paths, prev_listings, parent_pos, 1, depth - 1);
 				}
 			}
 
@@ -4439,11 +5592,11 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			continue;
 		}
 
-		entry = flist_custom_add(view, full_path);
+		entry = custom_add_filled(view, full_path, &lst[i]);
 		if(entry == NULL)
 		{
 			free(full_path);
-			free_string_array(lst, len);
+			free_dir_entries(&lst, &len);
 			return -1;
 		}
 
@@ -4472,7 +5625,7 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 			{
 				const int idx = view->custom.entry_count - 1;
 				const int filtered = add_files_recursively(view, full_path,
-						excluded_paths, folded_paths, idx, 0, depth - 1);
+						excluded_paths, folded_paths, prev_listings, idx, 0, depth - 1);
 				/* Keep going in case of error and load partial list. */
 				if(filtered >= 0)
 				{
@@ -4490,7 +5643,7 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 		show_progress("Building tree...", 1000);
 	}
 
-	free_string_array(lst, len);
+	free_dir_entries(&lst, &len);
 
 	/* The prev_count != 0 check is to make sure that we won't create leaf instead
 	 * of the whole tree (this is handled in flist_custom_finish()). */
@@ -4509,6 +5662,238 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 	return nfiltered;
 }
 
+/* Prepares for building tree-view by making a new set of listings.  Returns
+ * previous set of listings, which can be NULL. */
+static trie_t *
+start_tree_listings(view_t *view)
+{
+	if(view->custom.tree_watch == NULL)
+	{
+		trie_free(view->custom.tree_listings);
+		view->custom.tree_listings = NULL;
+
+		view->custom.tree_watch = fswatch_create_set();
+		if(view->custom.tree_watch == NULL)
+		{
+			return NULL;
+		}
+	}
+	else if(apply_tree_changes(view) == FSWS_ERRORED)
+	{
+		return start_tree_listings(view);
+	}
+
+	trie_t *const prev_listings = view->custom.tree_listings;
+	view->custom.tree_listings = trie_create(&free_tree_listing);
+	if(view->custom.tree_listings == NULL)
+	{
+		view->custom.tree_listings = prev_listings;
+		drop_tree_listings(view);
+		return NULL;
+	}
+
+	fswatch_begin_update(view->custom.tree_watch);
+	return prev_listings;
+}
+
+/* Finishes building tree-view by stopping to watch directories that are no
+ * longer part of it. */
+static void
+finish_tree_listings(view_t *view, trie_t *prev_listings)
+{
+	trie_free(prev_listings);
+
+	if(view->custom.tree_watch != NULL)
+	{
+		fswatch_end_update(view->custom.tree_watch);
+	}
+}
+
+/* Frees listings of tree-view along with their watcher. */
+static void
+drop_tree_listings(view_t *view)
+{
+	trie_free(view->custom.tree_listings);
+	view->custom.tree_listings = NULL;
+	fswatch_free(view->custom.tree_watch);
+	view->custom.tree_watch = NULL;
+}
+
+/* Frees tree_listing_t.  ptr can be NULL. */
+static void
+free_tree_listing(void *ptr)
+{
+	tree_listing_t *const listing = ptr;
+	if(listing != NULL)
+	{
+		free_dir_entries(&listing->entries, &listing->nentries);
+		free(listing);
+	}
+}
+
+/* Retrieves files of a single level of tree-view either from an up to date
+ * listing or from file system remembering the listing for future reloads.
+ * Sets *len to negative value on error.  Returns the list. */
+static dir_entry_t *
+get_tree_level(view_t *view, trie_t *prev_listings, const char path[],
+		int *len)
+{
+	if(view->custom.tree_listings == NULL)
+	{
+		return list_tree_level(path, get_skipped_metadata(view), len);
+	}
+
+	tree_listing_t *listing = NULL;
+	void *data;
+	if(trie_get(prev_listings, path, &data) == 0 && data != NULL)
+	{
+		/* The listing is either moved to the new set or freed below. */
+		(void)trie_set(prev_listings, path, NULL);
+		listing = data;
+	}
+
+	/* Watch is established before reading a directory to not miss changes that
+	 * happen in between.  A listing can't be kept without a watch. */
+	if(fswatch_add(view->custom.tree_watch, path) != 0)
+	{
+		free_tree_listing(listing);
+		return list_tree_level(path, get_skipped_metadata(view), len);
+	}
+
+	if(listing != NULL && listing->stale)
+	{
+		free_tree_listing(listing);
+		listing = NULL;
+	}
+
+	if(listing == NULL)
+	{
+		dir_entry_t *const lst = list_tree_level(path, get_skipped_metadata(view),
+				len);
+		if(*len < 0)
+		{
+			return lst;
+		}
+
+		listing = malloc(sizeof(*listing));
+		if(listing == NULL)
+		{
+			return lst;
+		}
+
+		listing->entries = lst;
+		listing->nentries = *len;
+		listing->stale = 0;
+	}
+
+	if(trie_set(view->custom.tree_listings, path, listing) < 0)
+	{
+		dir_entry_t *const lst = listing->entries;
+		*len = listing->nentries;
+		free(listing);
+		return lst;
+	}
+
+	return clone_tree_level(listing, len);
+}
+
+/* Makes a copy of entries of a listing.  Sets *len to negative value on error.
+ * Returns the copy. */
+static dir_entry_t *
+clone_tree_level(const tree_listing_t *listing, int *len)
+{
+	dir_entry_t *entries = dynarray_extend(NULL,
+			sizeof(*entries)*listing->nentries);
+	if(entries == NULL && listing->nentries != 0)
+	{
+		*len = -1;
+		return NULL;
+	}
+
+	int i;
+	for(i = 0; i < listing->nentries; ++i)
+	{
+		entries[i] = listing->entries[i];
+		entries[i].name = strdup(entries[i].name);
+		if(entries[i].name == NULL)
+		{
+			free_dir_entries(&entries, &i);
+			*len = -1;
+			return NULL;
+		}
+	}
+
+	*len = listing->nentries;
+	return entries;
+}
+
+/* Lists files of a single level of a tree along with information about them
+ * except for metadata specified by skip_md (FileMetadata).  Sets *len to
+ * negative value on error.  Returns the list. */
+static dir_entry_t *
+list_tree_level(const char path[], int skip_md, int *len)
+{
+	int i;
+	int count;
+	char **names = list_all_files(path, &count);
+	if(count < 0)
+	{
+		*len = -1;
+		return NULL;
+	}
+
+	dir_entry_t *entries = NULL;
+	*len = 0;
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *const entry = alloc_dir_entry(&entries, *len);
+		if(entry == NULL)
+		{
+			break;
+		}
+
+		init_dir_entry(/*view=*/NULL, entry, names[i]);
+		++*len;
+	}
+	free_string_array(names, count);
+
+	fill_entries(entries, len, path, skip_md);
+	return entries;
+}
+
+/* Moves already filled in entry for the path to the list of custom view.
+ * Returns pointer to the new entry or NULL on error or for a duplicate. */
+static dir_entry_t *
+custom_add_filled(view_t *view, const char path[], dir_entry_t *entry)
+{
+	char canonic_path[PATH_MAX + 1];
+	to_canonic_path(path, flist_get_dir(view), canonic_path,
+			sizeof(canonic_path));
+
+	/* Don't add duplicates. */
+	if(trie_put(view->custom.paths_cache, canonic_path) != 0)
+	{
+		return NULL;
+	}
+
+	dir_entry_t *const dir_entry = alloc_dir_entry(&view->custom.entries,
+			view->custom.entry_count);
+	if(dir_entry == NULL)
+	{
+		return NULL;
+	}
+
+	*dir_entry = *entry;
+	entry->name = NULL;
+
+	dir_entry->origin = strdup(canonic_path);
+	dir_entry->owns_origin = 1;
+	remove_last_path_component(dir_entry->origin);
+
+	++view->custom.entry_count;
+	return dir_entry;
+}
+
 /* Retrieves state of the fold if present.  Returns the state or
  * FOLD_UNDEFINED. */
 static FoldState
@@ -4626,6 +6011,7 @@ init_parent_entry(view_t *view, dir_entry_t *entry, const char path[])
 
 #ifndef _WIN32
 	entry->size = (uintmax_t)s.st_size;
+	entry->asize = (uint64_t)s.st_blocks*512U;
 	entry->uid = s.st_uid;
 	entry->gid = s.st_gid;
 	entry->mode = s.st_mode;
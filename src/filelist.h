@@ -28,6 +28,19 @@
 #include "ui/ui.h"
 #include "utils/test_helpers.h"
 
+/* Optional pieces of file metadata, which aren't loaded with directories unless
+ * sorting or columns need them.  They are loaded on demand by
+ * fentry_load_metadata(). */
+typedef enum
+{
+	FMD_OWNER = 1 << 0, /* uid and gid fields. */
+	FMD_ATIME = 1 << 1, /* atime field. */
+	FMD_CTIME = 1 << 2, /* ctime field. */
+
+	FMD_ALL = FMD_OWNER | FMD_ATIME | FMD_CTIME, /* All of the above. */
+}
+FileMetadata;
+
 /* Type of filter function for zapping list of entries.  Should return non-zero
  * if entry is to be kept and zero otherwise. */
 typedef int (*zap_filter)(view_t *view, const dir_entry_t *entry, void *arg);
@@ -167,6 +180,10 @@ int populate_dir_list(view_t *view, int reload);
 /* Loads file list for the view and redraws the view.  The reload parameter
  * should be set in case of view refresh operation. */
 void load_dir_list(view_t *view, int reload);
+/* Moves entries loaded in background (see 'slowfs') into the view.  Schedules
+ * redraw of the view if it was updated.  Returns non-zero if loading is still
+ * in progress. */
+int flist_update_from_loader(view_t *view);
 /* Resorts view without reloading it and preserving current file under cursor
  * along with its relative position in the list.  msg parameter controls whether
  * to show "Sorting..." status bar message. */
@@ -191,6 +208,10 @@ int view_needs_cd(const view_t *view, const char path[]);
 /* Retrieves size of the entry, possibly using cached or calculated value.
  * Returns the size. */
 uint64_t fentry_get_size(const view_t *view, const dir_entry_t *entry);
+/* Same as fentry_get_size(), but retrieves size of the specified kind.  Returns
+ * the size. */
+uint64_t fentry_get_size_of(const view_t *view, const dir_entry_t *entry,
+		DirSizeKind kind);
 /* Loads pointer to the next selected entry in file list of the view.  *entry
  * should be NULL for the first call and result of previous call otherwise.
  * Returns zero when there is no more entries to supply, otherwise non-zero is
@@ -305,6 +326,15 @@ int fentry_is_valid(const dir_entry_t *entry);
 /* Checks whether entry corresponds to a directory (including symbolic links to
  * directories).  Returns non-zero if so, otherwise zero is returned. */
 int fentry_is_dir(const dir_entry_t *entry);
+/* Fills in information about target of symbolic link if it was postponed
+ * because of 'lazylinks'.  Does nothing for other entries. */
+void fentry_resolve_link(dir_entry_t *entry);
+/* Loads metadata specified by the what parameter (set of FileMetadata flags)
+ * if it wasn't loaded together with the list of files. */
+void fentry_load_metadata(const dir_entry_t *entry, int what);
+/* Determines which optional metadata (see FileMetadata) is used by a sorting
+ * key or a column with the same id.  Returns set of FileMetadata flags. */
+int flist_metadata_of_key(int key);
 /* Checks whether entry points to a path resolving symbolic links if necessary.
  * Returns non-zero if so, otherwise zero is returned. */
 int fentry_points_to(const dir_entry_t *entry, const char path[]);
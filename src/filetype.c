@@ -29,6 +29,7 @@
 #include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "utils/darray.h"
+#include "utils/matcher_set.h"
 #include "utils/matchers.h"
 #include "utils/mem.h"
 #include "utils/str.h"
@@ -74,6 +75,9 @@ static assoc_records_t parse_command_list(const char cmds[]);
 static assoc_records_t clone_all_matching_records(const char file[],
 		const assoc_list_t *record_list);
 static int add_assoc(assoc_list_t *assoc_list, assoc_t assoc);
+static void index_list(assoc_list_t *assoc_list);
+static int find_matches(const assoc_list_t *assoc_list, const char file[],
+		const int **matches);
 static int is_assoc_equal(const assoc_t *a, const assoc_t *b);
 static void reset_all_lists(void);
 static void add_defaults(int in_x);
@@ -146,15 +150,13 @@ ft_get_viewers(const char file[])
 {
 	strlist_t viewers = {};
 
+	const int *matches;
+	const int nmatches = find_matches(&fileviewers, file, &matches);
+
 	int i;
-	for(i = 0; i < fileviewers.count; ++i)
+	for(i = 0; i < nmatches; ++i)
 	{
-		assoc_t *const assoc = &fileviewers.list[i];
-
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
+		assoc_t *const assoc = &fileviewers.list[matches[i]];
 
 		int j;
 		for(j = 0; j < assoc->records.count; ++j)
@@ -177,17 +179,14 @@ ft_get_viewers(const char file[])
 static const char *
 find_existing_cmd(const assoc_list_t *record_list, const char file[])
 {
-	int i;
+	const int *matches;
+	const int nmatches = find_matches(record_list, file, &matches);
 
-	for(i = 0; i < record_list->count; ++i)
+	int i;
+	for(i = 0; i < nmatches; ++i)
 	{
 		assoc_record_t prog;
-		assoc_t *const assoc = &record_list->list[i];
-
-		if(!mg_match(&assoc->mg, file))
-		{
-			continue;
-		}
+		assoc_t *const assoc = &record_list->list[matches[i]];
 
 		prog = find_existing_cmd_record(&assoc->records);
 		if(!is_assoc_record_empty(&prog))
@@ -367,6 +366,8 @@ make_pivot_first(reordering_data_t *d)
 	{
 		fileviewers.list[fileviewers.count++] = split_prefix;
 	}
+
+	index_list(&fileviewers);
 }
 
 void
@@ -435,6 +436,8 @@ make_pivot_last(reordering_data_t *d)
 		assert(d->j == fileviewers.count - 1);
 		fileviewers.list[d->j] = last_item;
 	}
+
+	index_list(&fileviewers);
 }
 
 /* Finds a matching entry in the list of viewers either by checking for its
@@ -632,16 +635,15 @@ ft_get_all_viewers(const char file[])
 static assoc_records_t
 clone_all_matching_records(const char file[], const assoc_list_t *record_list)
 {
-	int i;
 	assoc_records_t result = {};
 
-	for(i = 0; i < record_list->count; ++i)
+	const int *matches;
+	const int nmatches = find_matches(record_list, file, &matches);
+
+	int i;
+	for(i = 0; i < nmatches; ++i)
 	{
-		assoc_t *const assoc = &record_list->list[i];
-		if(mg_match(&assoc->mg, file))
-		{
-			ft_assoc_record_add_all(&result, &assoc->records);
-		}
+		ft_assoc_record_add_all(&result, &record_list->list[matches[i]].records);
 	}
 
 	return result;
@@ -687,9 +689,82 @@ add_assoc(assoc_list_t *assoc_list, assoc_t assoc)
 	assoc_list->list = p;
 	assoc_list->list[assoc_list->count] = assoc;
 	assoc_list->count++;
+
+	/* New association goes last, so it can be appended to existing set. */
+	if(assoc_list->set == NULL ||
+			matcher_set_add(assoc_list->set, assoc.mg.list, assoc.mg.count) != 0)
+	{
+		index_list(assoc_list);
+	}
 	return 1;
 }
 
+/* (Re)builds compiled form of matchers of the list. */
+static void
+index_list(assoc_list_t *assoc_list)
+{
+	matcher_set_free(assoc_list->set);
+	assoc_list->set = NULL;
+
+	if(assoc_list->count == 0)
+	{
+		return;
+	}
+
+	assoc_list->set = matcher_set_alloc();
+	if(assoc_list->set == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < assoc_list->count; ++i)
+	{
+		const matchers_group_t *const mg = &assoc_list->list[i].mg;
+		if(matcher_set_add(assoc_list->set, mg->list, mg->count) != 0)
+		{
+			matcher_set_free(assoc_list->set);
+			assoc_list->set = NULL;
+			break;
+		}
+	}
+}
+
+/* Finds associations of the list whose patterns match the file.  Sets
+ * *matches to their indexes in ascending order, the list is valid until the
+ * next call.  Returns number of matches. */
+static int
+find_matches(const assoc_list_t *assoc_list, const char file[],
+		const int **matches)
+{
+	if(assoc_list->set != NULL)
+	{
+		return matcher_set_match_all(assoc_list->set, file, matches);
+	}
+
+	/* Matching without compiled set, which could fail to be created. */
+	static int *fallback;
+	int count = 0;
+
+	int i;
+	for(i = 0; i < assoc_list->count; ++i)
+	{
+		if(mg_match(&assoc_list->list[i].mg, file))
+		{
+			int *const p = reallocarray(fallback, count + 1, sizeof(*fallback));
+			if(p == NULL)
+			{
+				break;
+			}
+			fallback = p;
+			fallback[count++] = i;
+		}
+	}
+
+	*matches = fallback;
+	return count;
+}
+
 /* Compares two associations for equality.  Returns non-zero if they are equal,
  * otherwise zero is returned. */
 static int
@@ -807,6 +882,9 @@ reset_list_head(assoc_list_t *assoc_list)
 	free(assoc_list->list);
 	assoc_list->list = NULL;
 	assoc_list->count = 0;
+
+	matcher_set_free(assoc_list->set);
+	assoc_list->set = NULL;
 }
 
 static void
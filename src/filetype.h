@@ -22,6 +22,7 @@
 
 #define VIFM_PSEUDO_CMD "vifm"
 
+struct matcher_set_t;
 struct matchers_t;
 
 /* Type of file association by its source. */
@@ -78,6 +79,8 @@ typedef struct
 {
 	assoc_t *list;
 	int count;
+	/* Compiled matchers of the list or NULL if there are none or on error. */
+	struct matcher_set_t *set;
 }
 assoc_list_t;
 
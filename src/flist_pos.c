@@ -546,6 +546,16 @@ fpos_find_group(const view_t *view, int next)
 				if(fentry_get_nitems(view, nentry) != fentry_get_nitems(view, pentry))
 					return pos;
 				break;
+			case SK_BY_USIZE:
+				if(fentry_get_size_of(view, nentry, DSK_UNIQUE) !=
+						fentry_get_size_of(view, pentry, DSK_UNIQUE))
+					return pos;
+				break;
+			case SK_BY_ASIZE:
+				if(fentry_get_size_of(view, nentry, DSK_ALLOCATED) !=
+						fentry_get_size_of(view, pentry, DSK_ALLOCATED))
+					return pos;
+				break;
 			case SK_BY_TIME_ACCESSED:
 				if(nentry->atime != pentry->atime)
 					return pos;
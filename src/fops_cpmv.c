@@ -20,6 +20,7 @@
 #include "fops_cpmv.h"
 
 #include <assert.h> /* assert() */
+#include <stdlib.h> /* free() */
 #include <string.h> /* strcmp() strdup() */
 
 #include "compat/reallocarray.h"
@@ -62,10 +63,10 @@ static int check_for_clashes(verify_args_t *args, char *list[], char *marked[],
 		int nlines, char **error);
 static const char * cmlo_to_str(CopyMoveLikeOp op);
 static void cpmv_files_in_bg(bg_op_t *bg_op, void *arg);
+static void cpmv_item_started(const ops_item_t *item, void *arg);
 static void set_cpmv_bg_descr(bg_op_t *bg_op, bg_args_t *args, size_t i);
-static void cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[],
-		int move, int force, int skip, int deep, int from_trash,
-		const char dst_dir[]);
+static int cpmv_file_in_bg_prepare(const char src[], const char dst[],
+		int force, int skip, int from_trash);
 static int cp_file_f(const char src[], const char dst[], CopyMoveLikeOp op,
 		int bg, int cancellable, ops_t *ops, int force, int deep);
 
@@ -611,21 +612,60 @@ cpmv_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 	}
 
+	ops_item_t *const items = reallocarray(NULL, args->sel_list_len,
+			sizeof(*items));
+	char **const dsts = reallocarray(NULL, args->sel_list_len, sizeof(*dsts));
+	if(items == NULL || dsts == NULL)
+	{
+		free(items);
+		free(dsts);
+		fops_free_bg_args(args);
+		return;
+	}
+
+	/* Conflicts are resolved in order and before processing any of the files,
+	 * because files might be processed in parallel. */
+	int nitems = 0;
 	for(i = 0U; i < args->sel_list_len; ++i)
 	{
 		const char *const src = args->sel_list[i];
-		const char *const dst = args->list[i];
+		char *const dst = format_str("%s/%s", args->path, args->list[i]);
 
-		set_cpmv_bg_descr(bg_op, args, i);
+		if(dst == NULL ||
+				!cpmv_file_in_bg_prepare(src, dst, args->force, args->skip,
+					args->is_in_trash[i]))
+		{
+			free(dst);
+			++bg_op->done;
+			continue;
+		}
 
-		cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->skip,
-				args->deep, args->is_in_trash[i], args->path);
-		++bg_op->done;
+		ops_item_t *const item = &items[nitems];
+		item->op = (args->move ? OP_MOVE : OP_COPY);
+		item->data = ops_flags((!args->move && args->deep) ? DF_DEEP_COPY
+		                                                    : DF_NONE);
+		item->src = src;
+		item->dst = dst;
+		item->index = i;
+		dsts[nitems++] = dst;
 	}
 
+	ops_perform_batch(ops, items, nitems, &cpmv_item_started, args);
+
+	free_string_array(dsts, nitems);
+	free(items);
 	fops_free_bg_args(args);
 }
 
+/* Implementation of ops_item_started_func that updates description of the
+ * job. */
+static void
+cpmv_item_started(const ops_item_t *item, void *arg)
+{
+	bg_args_t *const args = arg;
+	set_cpmv_bg_descr(args->ops->bg_op, args, item->index);
+}
+
 /* Sets nice title for the background job. */
 static void
 set_cpmv_bg_descr(bg_op_t *bg_op, bg_args_t *args, size_t i)
@@ -661,35 +701,33 @@ set_cpmv_bg_descr(bg_op_t *bg_op, bg_args_t *args, size_t i)
 	free(stats);
 }
 
-/* Actual implementation of background file copying/moving. */
-static void
-cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
-		int force, int skip, int deep, int from_trash, const char dst_dir[])
+/* Resolves conflict of background file copying/moving with existing
+ * destination.  Returns non-zero if the file should be copied/moved, otherwise
+ * zero is returned. */
+static int
+cpmv_file_in_bg_prepare(const char src[], const char dst[], int force,
+		int skip, int from_trash)
 {
-	char dst_full[PATH_MAX + 1];
-	snprintf(dst_full, sizeof(dst_full), "%s/%s", dst_dir, dst);
-	if(path_exists(dst_full, NODEREF))
+	if(strcmp(src, dst) == 0)
+	{
+		return 0;
+	}
+
+	if(path_exists(dst, NODEREF))
 	{
 		if(skip)
 		{
-			return;
+			return 0;
 		}
 
 		if(force && !from_trash)
 		{
 			void *flags = ops_flags(DF_NO_CANCEL);
-			(void)perform_operation(OP_REMOVESL, NULL, flags, dst_full, NULL);
+			(void)perform_operation(OP_REMOVESL, NULL, flags, dst, NULL);
 		}
 	}
 
-	if(move)
-	{
-		(void)fops_mv_file_f(src, dst_full, OP_MOVE, 1, 1, ops);
-	}
-	else
-	{
-		(void)cp_file_f(src, dst_full, CMLO_COPY, 1, 1, ops, 0, deep);
-	}
+	return 1;
 }
 
 /* Copies file from one location to another.  Returns zero on success, otherwise
@@ -22,10 +22,13 @@
 #include <sys/stat.h> /* stat */
 #include <sys/types.h> /* gid_t uid_t */
 
-#include <string.h> /* strdup() strlen() */
+#include <pthread.h> /* pthread_mutex_* */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() memset() strdup() strlen() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
+#include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/fileview.h"
@@ -33,6 +36,7 @@
 #include "ui/ui.h"
 #include "utils/cancellation.h"
 #include "utils/fs.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
@@ -50,11 +54,56 @@
 /* Arguments pack for dir_size_bg() background function. */
 typedef struct
 {
-	char *path; /* Full path to directory to process, will be freed. */
-	int force;  /* Whether cached values should be ignored. */
+	char **paths; /* Full paths to directories to process, will be freed. */
+	int npaths;   /* Number of elements in paths array. */
+	int force;    /* Whether cached values should be ignored. */
 }
 dir_size_args_t;
 
+struct du_state_t;
+
+/* Directory whose size is being calculated by fops_dir_size(). */
+typedef struct du_node_t
+{
+	struct du_state_t *state;  /* State of calculation for the root. */
+	struct du_node_t *parent;  /* Parent directory or NULL for the root. */
+	char *path;                /* Full path to the directory. */
+	int depth;                 /* Nesting level relative to the root. */
+	uint64_t inode;            /* Inode of the directory. */
+	uint64_t sizes[DSK_COUNT]; /* Sizes of each kind accumulated so far. */
+	int pending;               /* Number of unprocessed subdirectories plus one
+	                              for listing of the directory itself. */
+	int incomplete;            /* Whether calculation was cancelled. */
+	int partial;               /* Whether sizes other than apparent are missing
+	                              contribution of reused cached values. */
+	int store;                 /* Whether sizes should be cached. */
+}
+du_node_t;
+
+/* Identifier of a file with multiple hard links. */
+typedef struct
+{
+	uint64_t dev; /* Device of the file. */
+	uint64_t ino; /* Inode of the file, zero marks an empty slot. */
+}
+du_link_t;
+
+/* State of calculation for a single root directory shared among workers. */
+typedef struct du_state_t
+{
+	pthread_mutex_t lock;               /* Protects fields of nodes and links. */
+	int force;                          /* Whether to ignore cached values. */
+	int apparent_only;                  /* Whether only apparent size is of
+	                                       interest. */
+	const cancellation_t *cancellation; /* Cancellation state. */
+	uint64_t sizes[DSK_COUNT];          /* Result of the calculation. */
+	du_link_t *links;                   /* Open addressing hash set of files with
+	                                       multiple hard links seen so far. */
+	size_t links_cap;                   /* Capacity of the set (power of two). */
+	size_t links_count;                 /* Number of elements in the set. */
+}
+du_state_t;
+
 /* Arguments pack for fops_query_list() verification function. */
 typedef struct
 {
@@ -85,11 +134,24 @@ static int clone_file(const dir_entry_t *entry, const char path[],
 		const char clone[], ops_t *ops);
 static void get_group_file_list(char *list[], int count, char buf[]);
 static void go_to_first_file(view_t *view, char *names[], int count);
-static void update_dir_entry_size(dir_entry_t *entry, int force);
-static void start_dir_size_calc(const char path[], int force);
+static int get_dir_entry_path(const dir_entry_t *entry, char **paths[],
+		int *npaths);
+static void start_dir_size_calc(char *paths[], int npaths, int force);
 static void dir_size_bg(bg_op_t *bg_op, void *arg);
-static void dir_size(bg_op_t *bg_op, const char path[], int force);
+static void dir_size(bg_op_t *bg_op, char *paths[], int npaths, int force);
 static int bg_cancellation_hook(void *arg);
+static void du_run(char *paths[], int npaths, int force, int apparent_only,
+		const cancellation_t *cancellation, uint64_t sizes[][DSK_COUNT]);
+static du_node_t * du_node_alloc(du_state_t *state, du_node_t *parent,
+		const char path[]);
+static void du_task(parallel_ctx_t *ctx, void *task, void *arg);
+static void du_list(parallel_ctx_t *ctx, du_node_t *node, du_state_t *state);
+static void du_add_file(du_state_t *state, const char path[],
+		uint64_t sizes[DSK_COUNT]);
+static int du_is_new_link(du_state_t *state, uint64_t dev, uint64_t ino);
+static int du_grow_links(du_state_t *state);
+static void du_finish(du_node_t *node, const uint64_t sizes[DSK_COUNT],
+		int incomplete, int partial, du_state_t *state);
 #ifndef _WIN32
 static void change_owner_cb(const char new_owner[], void *arg);
 static int complete_owner(const char str[], void *arg);
@@ -1223,27 +1285,47 @@ fops_size_bg(view_t *view, int force)
 	int user_selection = !view->pending_marking;
 	flist_set_marking(view, 0);
 
+	char **paths = NULL;
+	int npaths = 0;
+
 	dir_entry_t *curr = get_current_entry(view);
 	if(!curr->marked && user_selection)
 	{
-		update_dir_entry_size(curr, force);
-		return;
+		if(get_dir_entry_path(curr, &paths, &npaths) != 0)
+		{
+			show_error_msg("Can't calculate size", "Out of memory");
+			return;
+		}
+	}
+	else
+	{
+		dir_entry_t *entry = NULL;
+		while(iter_marked_entries(view, &entry))
+		{
+			if(get_dir_entry_path(entry, &paths, &npaths) != 0)
+			{
+				free_string_array(paths, npaths);
+				show_error_msg("Can't calculate size", "Out of memory");
+				return;
+			}
+		}
 	}
 
-	dir_entry_t *entry = NULL;
-	while(iter_marked_entries(view, &entry))
+	if(npaths != 0)
 	{
-		update_dir_entry_size(entry, force);
+		/* Single task for all directories makes them share worker threads. */
+		start_dir_size_calc(paths, npaths, force);
 	}
 }
 
-/* Initiates background size calculation for view entry. */
-static void
-update_dir_entry_size(dir_entry_t *entry, int force)
+/* Appends path of view entry to the list if it's a directory.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+get_dir_entry_path(const dir_entry_t *entry, char **paths[], int *npaths)
 {
 	if(fentry_is_fake(entry) || !fentry_is_dir(entry))
 	{
-		return;
+		return 0;
 	}
 
 	char full_path[PATH_MAX + 1];
@@ -1255,12 +1337,20 @@ update_dir_entry_size(dir_entry_t *entry, int force)
 	{
 		get_full_path_of(entry, sizeof(full_path), full_path);
 	}
-	start_dir_size_calc(full_path, force);
+
+	const int n = add_to_string_array(paths, *npaths, full_path);
+	if(n == *npaths)
+	{
+		return 1;
+	}
+	*npaths = n;
+	return 0;
 }
 
-/* Initiates background directory size calculation. */
+/* Initiates background size calculation of directories.  Takes ownership of
+ * the paths array. */
 static void
-start_dir_size_calc(const char path[], int force)
+start_dir_size_calc(char *paths[], int npaths, int force)
 {
 	char task_desc[PATH_MAX + 32];
 	dir_size_args_t *args;
@@ -1268,19 +1358,31 @@ start_dir_size_calc(const char path[], int force)
 	args = malloc(sizeof(*args));
 	if(args == NULL)
 	{
+		free_string_array(paths, npaths);
 		show_error_msg("Can't calculate size", "Out of memory");
 		return;
 	}
 
-	args->path = strdup(path);
+	args->paths = paths;
+	args->npaths = npaths;
 	args->force = force;
 
-	snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", path);
+	const char *op_descr = paths[0];
+	if(npaths == 1)
+	{
+		snprintf(task_desc, sizeof(task_desc), "Calculating size: %s", paths[0]);
+	}
+	else
+	{
+		snprintf(task_desc, sizeof(task_desc),
+				"Calculating size of %d directories", npaths);
+		op_descr = task_desc;
+	}
 
-	if(bg_execute(task_desc, path, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
+	if(bg_execute(task_desc, op_descr, BG_UNDEFINED_TOTAL, 0, &dir_size_bg,
 				args) != 0)
 	{
-		free(args->path);
+		free_string_array(args->paths, args->npaths);
 		free(args);
 
 		show_error_msg("Can't calculate size",
@@ -1288,29 +1390,29 @@ start_dir_size_calc(const char path[], int force)
 	}
 }
 
-/* Entry point for a background task that calculates size of a directory. */
+/* Entry point for a background task that calculates size of directories. */
 static void
 dir_size_bg(bg_op_t *bg_op, void *arg)
 {
 	dir_size_args_t *const args = arg;
 
-	dir_size(bg_op, args->path, args->force);
+	dir_size(bg_op, args->paths, args->npaths, args->force);
 
-	free(args->path);
+	free_string_array(args->paths, args->npaths);
 	free(args);
 }
 
-/* Calculates directory size and triggers view updates if necessary.  Changes
- * path. */
+/* Calculates sizes of directories and triggers view updates if necessary. */
 static void
-dir_size(bg_op_t *bg_op, const char path[], int force)
+dir_size(bg_op_t *bg_op, char *paths[], int npaths, int force)
 {
 	const cancellation_t bg_cancellation_info = {
 		.arg = bg_op,
 		.hook = &bg_cancellation_hook,
 	};
 
-	(void)fops_dir_size(path, force, &bg_cancellation_info);
+	du_run(paths, npaths, force, /*apparent_only=*/1, &bg_cancellation_info,
+			/*sizes=*/NULL);
 
 	/* Redraw the views unconditionally, because checking their location from a
 	 * background thread will cause a data race. */
@@ -1329,37 +1431,198 @@ uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
 {
-	struct dirent *dentry;
-	uint64_t size;
+	char *paths[] = { (char *)path };
+	uint64_t sizes[1][DSK_COUNT];
+	du_run(paths, 1, force_update, /*apparent_only=*/1, cancellation, sizes);
+	return sizes[0][DSK_APPARENT];
+}
+
+void
+fops_dir_sizes(const char path[], int force_update,
+		const cancellation_t *cancellation, uint64_t sizes[DSK_COUNT])
+{
+	char *paths[] = { (char *)path };
+	uint64_t all_sizes[1][DSK_COUNT];
+	du_run(paths, 1, force_update, /*apparent_only=*/0, cancellation,
+			all_sizes);
+	memcpy(sizes, all_sizes[0], sizeof(all_sizes[0]));
+}
+
+/* Calculates sizes of several directories using one set of worker threads for
+ * all of them.  Sizes are stored in the sizes array, if it's not NULL.  Non-zero
+ * apparent_only allows reusing cached sizes of subdirectories at the cost of
+ * not computing sizes of other kinds. */
+static void
+du_run(char *paths[], int npaths, int force, int apparent_only,
+		const cancellation_t *cancellation, uint64_t sizes[][DSK_COUNT])
+{
+	du_state_t *const states = calloc(npaths, sizeof(*states));
+	void **const roots = reallocarray(NULL, npaths, sizeof(*roots));
+	if(states == NULL || roots == NULL)
+	{
+		free(states);
+		free(roots);
+		if(sizes != NULL)
+		{
+			memset(sizes, 0, sizeof(*sizes)*npaths);
+		}
+		return;
+	}
+
+	int i;
+	int nroots = 0;
+	for(i = 0; i < npaths; ++i)
+	{
+		du_state_t *const state = &states[i];
+		pthread_mutex_init(&state->lock, NULL);
+		state->force = force;
+		state->apparent_only = apparent_only;
+		state->cancellation = cancellation;
+
+		du_node_t *const root = du_node_alloc(state, NULL, paths[i]);
+		if(root != NULL)
+		{
+			roots[nroots++] = root;
+		}
+	}
+
+	parallel_run_many(roots, nroots, cfg.stat_workers, &du_task, NULL);
+
+	for(i = 0; i < npaths; ++i)
+	{
+		du_state_t *const state = &states[i];
+		pthread_mutex_destroy(&state->lock);
+		free(state->links);
+
+		if(sizes != NULL)
+		{
+			memcpy(sizes[i], state->sizes, sizeof(state->sizes));
+		}
+	}
+
+	free(states);
+	free(roots);
+}
+
+/* Allocates node for a directory.  Returns the node or NULL on error. */
+static du_node_t *
+du_node_alloc(du_state_t *state, du_node_t *parent, const char path[])
+{
+	du_node_t *const node = malloc(sizeof(*node));
+	if(node == NULL)
+	{
+		return NULL;
+	}
+
+	node->path = strdup(path);
+	if(node->path == NULL)
+	{
+		free(node);
+		return NULL;
+	}
+
+	node->state = state;
+	node->parent = parent;
+	node->depth = (parent == NULL ? 0 : parent->depth + 1);
+	node->inode = DCACHE_UNKNOWN;
+	memset(node->sizes, 0, sizeof(node->sizes));
+	node->pending = 1;
+	node->incomplete = 0;
+	node->partial = 0;
+	node->store = 1;
+	return node;
+}
+
+/* Processes single directory of fops_dir_size() spawning tasks for its
+ * subdirectories. */
+static void
+du_task(parallel_ctx_t *ctx, void *task, void *arg)
+{
+	du_node_t *const node = task;
+	du_state_t *const state = node->state;
+
+	static const uint64_t no_sizes[DSK_COUNT];
+
+	if(cancellation_requested(state->cancellation))
+	{
+		du_finish(node, no_sizes, /*incomplete=*/1, /*partial=*/0, state);
+		return;
+	}
 
 	time_t mtime = 0;
-	uint64_t inode = DCACHE_UNKNOWN;
 	struct stat s;
-	if(os_stat(path, &s) == 0)
+	if(os_stat(node->path, &s) == 0)
 	{
 		mtime = s.st_mtime;
-		inode = s.st_ino;
+		node->inode = s.st_ino;
+#ifndef _WIN32
+		/* Like du, count space occupied by directories themselves. */
+		node->sizes[DSK_ALLOCATED] = (uint64_t)s.st_blocks*512U;
+#endif
+	}
+
+	/* The check is here and not in du_list() to do only one stat() for each
+	 * path.  Sizes of all kinds are reused only for the directory being
+	 * measured, because cached sizes of a subdirectory don't tell which hard
+	 * links they account for and reusing them would count links shared with
+	 * other subdirectories more than once.  Apparent size doesn't depend on hard
+	 * links and can be reused at any depth. */
+	if(!state->force && node->depth == 0)
+	{
+		uint64_t dir_sizes[DSK_COUNT];
+		int all_known = 1;
+
+		int i;
+		for(i = 0; i < DSK_COUNT && all_known; ++i)
+		{
+			dcache_get_size_at(node->path, i, mtime, node->inode, &dir_sizes[i]);
+			all_known = (dir_sizes[i] != DCACHE_UNKNOWN);
+		}
+
+		if(all_known)
+		{
+			node->store = 0;
+			memset(node->sizes, 0, sizeof(node->sizes));
+			du_finish(node, dir_sizes, /*incomplete=*/0, /*partial=*/0, state);
+			return;
+		}
 	}
 
-	/* The check is at the top and not in the loop to do only one stat() for each
-	 * path. */
-	if(!force_update)
+	if(!state->force && state->apparent_only)
 	{
-		uint64_t dir_size;
-		dcache_get_at(path, mtime, inode, &dir_size, NULL);
-		if(dir_size != DCACHE_UNKNOWN)
+		uint64_t dir_sizes[DSK_COUNT] = { };
+		dcache_get_size_at(node->path, DSK_APPARENT, mtime, node->inode,
+				&dir_sizes[DSK_APPARENT]);
+
+		if(dir_sizes[DSK_APPARENT] != DCACHE_UNKNOWN)
 		{
-			return dir_size;
+			node->store = 0;
+			memset(node->sizes, 0, sizeof(node->sizes));
+			du_finish(node, dir_sizes, /*incomplete=*/0, /*partial=*/1, state);
+			return;
 		}
 	}
 
-	DIR *dir = os_opendir(path);
+	du_list(ctx, node, state);
+}
+
+/* Sums up sizes of files of a directory and spawns tasks for its
+ * subdirectories. */
+static void
+du_list(parallel_ctx_t *ctx, du_node_t *node, du_state_t *state)
+{
+	uint64_t sizes[DSK_COUNT] = { };
+
+	DIR *dir = os_opendir(node->path);
 	if(dir == NULL)
 	{
-		return 0U;
+		node->store = 0;
+		du_finish(node, sizes, /*incomplete=*/0, /*partial=*/0, state);
+		return;
 	}
 
-	size = 0U;
+	int incomplete = 0;
+	struct dirent *dentry;
 	while((dentry = os_readdir(dir)) != NULL)
 	{
 		if(is_builtin_dir(dentry->d_name))
@@ -1368,29 +1631,208 @@ fops_dir_size(const char path[], int force_update,
 		}
 
 		char full_path[PATH_MAX + 1];
-		build_path(full_path, sizeof(full_path), path, dentry->d_name);
+		build_path(full_path, sizeof(full_path), node->path, dentry->d_name);
 		if(fops_is_dir_entry(full_path, dentry))
 		{
-			size += fops_dir_size(full_path, force_update, cancellation);
+			du_node_t *const child = du_node_alloc(state, node, full_path);
+			if(child == NULL)
+			{
+				incomplete = 1;
+				break;
+			}
+
+			pthread_mutex_lock(&state->lock);
+			++node->pending;
+			pthread_mutex_unlock(&state->lock);
+
+			parallel_spawn(ctx, child);
 		}
 		else
 		{
-			size += get_file_size(full_path);
+			du_add_file(state, full_path, sizes);
 		}
 
-		if(cancellation_requested(cancellation))
+		if(cancellation_requested(state->cancellation))
 		{
-			os_closedir(dir);
-			return 0U;
+			incomplete = 1;
+			break;
 		}
 	}
 
 	os_closedir(dir);
 
-	/* Could calculate nitems here, but they aren't recursive and might only take
-	 * up memory, because interest in size sort of excludes interest in nitems. */
-	(void)dcache_set_at(path, inode, size, DCACHE_UNKNOWN);
-	return size;
+	du_finish(node, sizes, incomplete, /*partial=*/0, state);
+}
+
+/* Accounts file specified by the path in sizes of all kinds. */
+static void
+du_add_file(du_state_t *state, const char path[], uint64_t sizes[DSK_COUNT])
+{
+#ifndef _WIN32
+	struct stat st;
+	if(os_lstat(path, &st) != 0)
+	{
+		return;
+	}
+
+	sizes[DSK_APPARENT] += (uint64_t)st.st_size;
+
+	if(st.st_nlink > 1)
+	{
+		pthread_mutex_lock(&state->lock);
+		const int is_new = du_is_new_link(state, st.st_dev, st.st_ino);
+		pthread_mutex_unlock(&state->lock);
+
+		if(!is_new)
+		{
+			return;
+		}
+	}
+
+	sizes[DSK_UNIQUE] += (uint64_t)st.st_size;
+	sizes[DSK_ALLOCATED] += (uint64_t)st.st_blocks*512U;
+#else
+	/* Hard links are rare on Windows and allocation size isn't readily
+	 * available, so all kinds are the same. */
+	const uint64_t size = get_file_size(path);
+	sizes[DSK_APPARENT] += size;
+	sizes[DSK_UNIQUE] += size;
+	sizes[DSK_ALLOCATED] += size;
+#endif
+}
+
+/* Records file with multiple hard links as seen.  Must be called with
+ * state->lock held.  Returns non-zero if the file wasn't seen before, which is
+ * also the case on failure to grow the set. */
+static int
+du_is_new_link(du_state_t *state, uint64_t dev, uint64_t ino)
+{
+	if(state->links_count*2U >= state->links_cap && du_grow_links(state) != 0)
+	{
+		return 1;
+	}
+
+	const size_t mask = state->links_cap - 1U;
+	size_t i = (size_t)((ino ^ (dev*0x9e3779b97f4a7c15ULL))*0x9e3779b97f4a7c15ULL
+			>> 17) & mask;
+	while(state->links[i].ino != 0U)
+	{
+		if(state->links[i].ino == ino && state->links[i].dev == dev)
+		{
+			return 0;
+		}
+		i = (i + 1U) & mask;
+	}
+
+	state->links[i].dev = dev;
+	state->links[i].ino = ino;
+	++state->links_count;
+	return 1;
+}
+
+/* Doubles capacity of the set of hard links.  Must be called with state->lock
+ * held.  Returns zero on success, otherwise non-zero is returned. */
+static int
+du_grow_links(du_state_t *state)
+{
+	const size_t old_cap = state->links_cap;
+	du_link_t *const old_links = state->links;
+
+	const size_t new_cap = (old_cap == 0U ? 64U : old_cap*2U);
+	du_link_t *const new_links = calloc(new_cap, sizeof(*new_links));
+	if(new_links == NULL)
+	{
+		return 1;
+	}
+
+	state->links = new_links;
+	state->links_cap = new_cap;
+	state->links_count = 0U;
+
+	size_t i;
+	for(i = 0U; i < old_cap; ++i)
+	{
+		if(old_links[i].ino != 0U)
+		{
+			(void)du_is_new_link(state, old_links[i].dev, old_links[i].ino);
+		}
+	}
+
+	free(old_links);
+	return 0;
+}
+
+/* Adds sizes to the node and completes processing of the node and its parents
+ * if it was the last thing they were waiting for.  Non-zero incomplete means
+ * that the sizes are partial, non-zero partial means that only apparent size is
+ * complete. */
+static void
+du_finish(du_node_t *node, const uint64_t sizes[DSK_COUNT], int incomplete,
+		int partial, du_state_t *state)
+{
+	/* Sizes of a finished node which are propagated to its parent. */
+	uint64_t carried[DSK_COUNT];
+
+	while(node != NULL)
+	{
+		pthread_mutex_lock(&state->lock);
+		int i;
+		for(i = 0; i < DSK_COUNT; ++i)
+		{
+			node->sizes[i] += sizes[i];
+		}
+		node->incomplete |= incomplete;
+		node->partial |= partial;
+		const int done = (--node->pending == 0);
+		pthread_mutex_unlock(&state->lock);
+
+		if(!done)
+		{
+			break;
+		}
+
+		/* Nothing else can access the node at this point. */
+
+		if(!node->incomplete && node->store)
+		{
+			uint64_t stored[DSK_COUNT];
+			memcpy(stored, node->sizes, sizeof(stored));
+			if(node->depth != 0 || node->partial)
+			{
+				/* Which subdirectory accounts for a hard link depends on the order of
+				 * traversal, so only apparent size is well defined for them.  The same
+				 * holds for sizes that include reused apparent sizes. */
+				stored[DSK_UNIQUE] = DCACHE_UNKNOWN;
+				stored[DSK_ALLOCATED] = DCACHE_UNKNOWN;
+			}
+
+			/* Could calculate nitems here, but they aren't recursive and might only
+			 * take up memory, because interest in size sort of excludes interest in
+			 * nitems. */
+			(void)dcache_set_sizes_at(node->path, node->inode, stored);
+
+			if(node->depth == 1)
+			{
+				/* Let sizes of subdirectories appear as they become known. */
+				ui_view_schedule_redraw(&lwin);
+				ui_view_schedule_redraw(&rwin);
+			}
+		}
+
+		du_node_t *const parent = node->parent;
+		if(parent == NULL && !node->incomplete)
+		{
+			memcpy(state->sizes, node->sizes, sizeof(state->sizes));
+		}
+
+		memcpy(carried, node->sizes, sizeof(carried));
+		sizes = carried;
+		incomplete = node->incomplete;
+		partial = node->partial;
+		free(node->path);
+		free(node);
+		node = parent;
+	}
 }
 
 #ifndef _WIN32
@@ -1423,6 +1865,9 @@ fops_chown(int u, int g, uid_t uid, gid_t gid)
 		char full_path[PATH_MAX + 1];
 		get_full_path_of(entry, sizeof(full_path), full_path);
 
+		/* Old owner and group are needed for undo. */
+		fentry_load_metadata(entry, FMD_OWNER);
+
 		if(u && perform_operation(OP_CHOWN, ops, V(uid), full_path, NULL) ==
 				OPS_SUCCEEDED)
 		{
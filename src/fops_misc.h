@@ -25,6 +25,7 @@
 #include <stdint.h> /* uint64_t */
 
 #include "utils/test_helpers.h"
+#include "status.h"
 
 struct dir_entry_t;
 struct ops_t;
@@ -83,6 +84,13 @@ struct cancellation_t;
 uint64_t fops_dir_size(const char path[], int force,
 		const struct cancellation_t *cancellation);
 
+/* Same as fops_dir_size(), but provides sizes of all kinds at once (see
+ * DirSizeKind).  Cached sizes of subdirectories aren't reused, because they
+ * can't account for hard links shared between them.  On error or cancellation
+ * all sizes are zero. */
+void fops_dir_sizes(const char path[], int force,
+		const struct cancellation_t *cancellation, uint64_t sizes[DSK_COUNT]);
+
 #ifndef _WIN32
 
 /* Sets uid and or gid for marked files.  Non-zero u enables setting of uid,
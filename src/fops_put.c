@@ -22,6 +22,7 @@
 #include <assert.h> /* assert() */
 #include <ctype.h> /* tolower() */
 #include <limits.h> /* INT_MAX */
+#include <stdlib.h> /* free() */
 #include <string.h> /* memmove() memset() strdup() */
 
 #include "cfg/config.h"
@@ -60,6 +61,7 @@ typedef struct
 conflict_prompt_data_t;
 
 static void put_files_in_bg(bg_op_t *bg_op, void *arg);
+static void put_item_started(const ops_item_t *item, void *arg);
 static int initiate_put_files(view_t *view, int at, CopyMoveLikeOp op,
 		const char descr[], int reg_name, int deep);
 static void reset_put_confirm(CopyMoveLikeOp main_op, const char descr[],
@@ -99,6 +101,7 @@ static struct
 	int skip_all;        /* Skip all conflicting files/directories. */
 	int overwrite_all;   /* Overwrite all future conflicting files/directories. */
 	int append;          /* Whether we're appending ending of a file or not. */
+	int resume;          /* Whether we're resuming terminated copying or not. */
 	int allow_merge;     /* Allow merging of files in directories. */
 	int allow_merge_all; /* Allow merging of files in directories by default. */
 	int merge;           /* Merge conflicting directory once. */
@@ -192,7 +195,8 @@ fops_put_bg(view_t *view, int at, int reg_name, int move, int deep)
 		dst = join_paths(args->path, dst_name);
 		args->nlines = put_into_string_array(&args->list, args->nlines, dst);
 
-		if(!paths_are_equal(src, dst) && path_exists(dst, NODEREF))
+		if(!paths_are_equal(src, dst) && path_exists(dst, NODEREF) &&
+				!ops_can_resume(NULL, src, dst))
 		{
 			char *escaped_dst = escape_unreadable(dst);
 			ui_sb_errf("File \"%s\" already exists", escaped_dst);
@@ -241,7 +245,18 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 	}
 
-	for(i = 0U; i < args->sel_list_len; ++i, ++bg_op->done)
+	ops_item_t *const items = reallocarray(NULL, args->sel_list_len,
+			sizeof(*items));
+	if(items == NULL)
+	{
+		fops_free_bg_args(args);
+		return;
+	}
+
+	/* Files are checked in order and before processing any of them, because
+	 * files might be processed in parallel. */
+	int nitems = 0;
+	for(i = 0U; i < args->sel_list_len; ++i)
 	{
 		struct stat src_st;
 		const char *const src = args->sel_list[i];
@@ -250,6 +265,7 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		if(paths_are_equal(src, dst))
 		{
 			/* Just ignore this file. */
+			++bg_op->done;
 			continue;
 		}
 
@@ -257,25 +273,47 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		{
 			/* File isn't there, assume that it's fine and don't error in this
 			 * case. */
+			++bg_op->done;
 			continue;
 		}
 
+		OPS op = ops->main_op;
 		if(path_exists(dst, NODEREF))
 		{
-			/* This file wasn't here before (when checking in fops_put_bg()), won't
-			 * overwrite. */
-			continue;
-		}
+			if(!ops_can_resume(ops, src, dst))
+			{
+				/* This file wasn't here before (when checking in fops_put_bg()),
+				 * won't overwrite. */
+				++bg_op->done;
+				continue;
+			}
 
-		bg_op_set_descr(bg_op, src);
+			/* Continue copying that was terminated by a previous operation. */
+			op = (args->move ? OP_MOVER : OP_COPYR);
+		}
 
-		void *flags = ops_flags(args->deep ? DF_DEEP_COPY : DF_NONE);
-		(void)perform_operation(ops->main_op, ops, flags, src, dst);
+		ops_item_t *const item = &items[nitems++];
+		item->op = op;
+		item->data = ops_flags(args->deep ? DF_DEEP_COPY : DF_NONE);
+		item->src = src;
+		item->dst = dst;
+		item->index = i;
 	}
 
+	ops_perform_batch(ops, items, nitems, &put_item_started, bg_op);
+
+	free(items);
 	fops_free_bg_args(args);
 }
 
+/* Implementation of ops_item_started_func that updates description of the
+ * job. */
+static void
+put_item_started(const ops_item_t *item, void *arg)
+{
+	bg_op_set_descr(arg, item->src);
+}
+
 int
 fops_put_links(view_t *view, int reg_name, int relative)
 {
@@ -622,7 +660,8 @@ put_next(int force)
 	build_path(dst_buf, sizeof(dst_buf), dst_dir, dst_name);
 	chosp(dst_buf);
 
-	if(!put_confirm.append && path_exists(dst_buf, NODEREF))
+	if(!put_confirm.append && !put_confirm.resume &&
+			path_exists(dst_buf, NODEREF))
 	{
 		if(force)
 		{
@@ -709,6 +748,11 @@ put_next(int force)
 		op = move ? OP_MOVEA : OP_COPYA;
 		put_confirm.append = 0;
 	}
+	else if(put_confirm.resume)
+	{
+		op = move ? OP_MOVER : OP_COPYR;
+		put_confirm.resume = 0;
+	}
 	else if(move)
 	{
 		op = merge ? OP_MOVEF : OP_MOVE;
@@ -1056,6 +1100,8 @@ prompt_what_to_do(const char fname[], const char caused_by[])
 		skip           = { .key = 's', .descr = "[s]kip /" },
 		skip_all       = { .key = 'S', .descr = " [S]kip all\n" },
 		append         = { .key = 'a', .descr = "[a]ppend the tail\n" },
+		append_only    = { .key = 'a', .descr = "[a]ppend the tail /" },
+		resume         = { .key = 'u', .descr = " res[u]me copying\n" },
 		overwrite      = { .key = 'o', .descr = "[o]verwrite /" },
 		overwrite_all  = { .key = 'O', .descr = " [O]verwrite all\n" },
 		merge          = { .key = 'm', .descr = "[m]erge /" },
@@ -1064,7 +1110,7 @@ prompt_what_to_do(const char fname[], const char caused_by[])
 		escape         = { .key = NC_C_c, .descr = "\n   Esc or Ctrl-C to abort" };
 
 	/* Last element is a terminator. */
-	response_variant responses[12] = {};
+	response_variant responses[13] = {};
 	size_t i = 0;
 
 	char dst_buf[PATH_MAX + 1];
@@ -1082,7 +1128,15 @@ prompt_what_to_do(const char fname[], const char caused_by[])
 		if(cfg.use_system_calls && ONE_OF(put_confirm.op, CMLO_COPY, CMLO_MOVE) &&
 				is_regular_file_noderef(dst_buf) && is_regular_file_noderef(caused_by))
 		{
-			responses[i++] = append;
+			if(ops_can_resume(put_confirm.ops, caused_by, dst_buf))
+			{
+				responses[i++] = append_only;
+				responses[i++] = resume;
+			}
+			else
+			{
+				responses[i++] = append;
+			}
 		}
 		responses[i++] = overwrite;
 		responses[i++] = overwrite_all;
@@ -1175,6 +1229,11 @@ handle_prompt_response(const char fname[], const char caused_by[],
 		put_confirm.append = 1;
 		put_continue(0);
 	}
+	else if(response == 'u' && cfg.use_system_calls && !is_dir(fname))
+	{
+		put_confirm.resume = 1;
+		put_continue(0);
+	}
 	else if(response == 'O')
 	{
 		put_confirm.overwrite_all = 1;
@@ -0,0 +1,487 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "hcache.h"
+
+#include <sys/stat.h> /* stat */
+#include <sys/types.h> /* off_t */
+#ifndef _WIN32
+#include <unistd.h> /* pread() */
+#endif
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcpy() strcmp() */
+
+#include "cfg/config.h"
+#include "compat/fs_limits.h"
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "utils/alog.h"
+#include "utils/str.h"
+
+/*
+ * The file is an append-only log of fixed-size records, the latest record for
+ * a file wins.  Unlike with dcache file, all records are loaded into memory on
+ * attaching because they are looked up by metadata rather than by path.  The
+ * file is compacted on attaching when it contains too many outdated records.
+ */
+
+/* Identifier of the file format. */
+#define HCF_MAGIC "VIFMHCF"
+
+/* Version of the file format. */
+#define HCF_VERSION 2U
+
+/* Value at the start of every record. */
+#define HCF_RECORD_MAGIC 0x52434648U
+
+/* Minimal number of records in a file for it to be considered for
+ * compaction. */
+#define HCF_MIN_COMPACT 4096
+
+/* Number of records read from the file at once. */
+#define HCF_READ_BATCH 4096
+
+/* Initial number of slots in the table, must be a power of two. */
+#define INITIAL_CAPACITY 1024U
+
+/* Record of the cache, the same structure is used in memory and in the
+ * file. */
+typedef struct
+{
+	uint32_t magic;           /* HCF_RECORD_MAGIC, zero for free slots. */
+	uint32_t reserved;        /* Padding, zero. */
+	hcache_key_t key;         /* State of the file. */
+	hcache_digests_t digests; /* Digests of the file. */
+}
+hcache_record_t;
+
+static void put_record(const hcache_record_t *record);
+static hcache_record_t * find_slot(const hcache_key_t *key);
+static int grow_table(void);
+static int keys_match(const hcache_key_t *a, const hcache_key_t *b);
+#ifndef _WIN32
+static off_t load_file(int fd, off_t size, int *compact, void *arg);
+static int dump_file(int fd, void *arg);
+static size_t read_records(const char data[], size_t len, void *arg);
+static void store_record(const hcache_record_t *record);
+static void close_file(void);
+#endif
+
+/* Protects all state of the unit. */
+static pthread_mutex_t hcache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Open addressing hash table of records. */
+static hcache_record_t *table;
+/* Number of slots in the table. */
+static size_t table_cap;
+/* Number of occupied slots in the table. */
+static size_t table_len;
+
+/* Path to attached file or NULL. */
+static char *file_path;
+/* Attached file or NULL. */
+static alog_t *file_log;
+
+int
+hcache_key_of(const char path[], hcache_key_t *key)
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		return 1;
+	}
+
+	key->dev = st.st_dev;
+	key->inode = st.st_ino;
+	key->size = st.st_size;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	key->mtime_ns = st.st_mtim.tv_sec*1000000000LL + st.st_mtim.tv_nsec;
+	key->ctime_ns = st.st_ctim.tv_sec*1000000000LL + st.st_ctim.tv_nsec;
+#else
+	key->mtime_ns = st.st_mtime*1000000000LL;
+	key->ctime_ns = st.st_ctime*1000000000LL;
+#endif
+	return 0;
+}
+
+int
+hcache_get(const hcache_key_t *key, hcache_digests_t *digests)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&hcache_mutex);
+	const hcache_record_t *const record = find_slot(key);
+	if(record != NULL && record->magic != 0U && keys_match(&record->key, key))
+	{
+		*digests = record->digests;
+		found = 1;
+	}
+	pthread_mutex_unlock(&hcache_mutex);
+
+	return !found;
+}
+
+void
+hcache_put_sample(const hcache_key_t *key, uint32_t sample_size,
+		uint64_t sample)
+{
+	pthread_mutex_lock(&hcache_mutex);
+
+	hcache_record_t record = { .magic = HCF_RECORD_MAGIC, .key = *key };
+
+	const hcache_record_t *const old = find_slot(key);
+	if(old != NULL && old->magic != 0U && keys_match(&old->key, key))
+	{
+		record.digests = old->digests;
+	}
+
+	record.digests.sample_size = sample_size;
+	record.digests.sample = sample;
+	put_record(&record);
+
+	pthread_mutex_unlock(&hcache_mutex);
+}
+
+void
+hcache_put_full(const hcache_key_t *key, const uint64_t full[2])
+{
+	pthread_mutex_lock(&hcache_mutex);
+
+	hcache_record_t record = { .magic = HCF_RECORD_MAGIC, .key = *key };
+
+	const hcache_record_t *const old = find_slot(key);
+	if(old != NULL && old->magic != 0U && keys_match(&old->key, key))
+	{
+		record.digests = old->digests;
+	}
+
+	record.digests.has_full = 1;
+	record.digests.full[0] = full[0];
+	record.digests.full[1] = full[1];
+	put_record(&record);
+
+	pthread_mutex_unlock(&hcache_mutex);
+}
+
+/* Stores the record in the table and schedules writing it to the file.  Must
+ * be called with the mutex held. */
+static void
+put_record(const hcache_record_t *record)
+{
+	hcache_record_t *const slot = find_slot(&record->key);
+	if(slot == NULL)
+	{
+		return;
+	}
+
+	if(slot->magic == 0U)
+	{
+		++table_len;
+	}
+	*slot = *record;
+
+	if(file_log != NULL)
+	{
+		alog_put(file_log, record, sizeof(*record));
+	}
+}
+
+/* Looks up a slot of the table that holds record for the same file or a free
+ * slot where such a record should be put.  Must be called with the mutex
+ * held.  Returns the slot or NULL on error. */
+static hcache_record_t *
+find_slot(const hcache_key_t *key)
+{
+	/* Keep load factor under one half. */
+	if((table_len + 1U)*2U > table_cap && grow_table() != 0 && table_cap == 0U)
+	{
+		return NULL;
+	}
+
+	uint64_t hash = (key->inode ^ (key->dev << 32 | key->dev >> 32))
+	              * 0x9e3779b97f4a7c15ULL;
+	size_t i = (hash >> 32) & (table_cap - 1U);
+	while(table[i].magic != 0U &&
+			(table[i].key.dev != key->dev || table[i].key.inode != key->inode))
+	{
+		i = (i + 1U) & (table_cap - 1U);
+	}
+	return &table[i];
+}
+
+/* Doubles capacity of the table.  Must be called with the mutex held.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+grow_table(void)
+{
+	const size_t new_cap = (table_cap == 0U ? INITIAL_CAPACITY : table_cap*2U);
+	hcache_record_t *const new_table = calloc(new_cap, sizeof(*new_table));
+	if(new_table == NULL)
+	{
+		return 1;
+	}
+
+	hcache_record_t *const old_table = table;
+	const size_t old_cap = table_cap;
+
+	table = new_table;
+	table_cap = new_cap;
+
+	size_t i;
+	for(i = 0U; i < old_cap; ++i)
+	{
+		if(old_table[i].magic != 0U)
+		{
+			/* Capacity is enough for all records, so this doesn't recurse. */
+			*find_slot(&old_table[i].key) = old_table[i];
+		}
+	}
+
+	free(old_table);
+	return 0;
+}
+
+/* Checks whether two keys describe the same state of the same file.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+keys_match(const hcache_key_t *a, const hcache_key_t *b)
+{
+	return a->dev == b->dev
+	    && a->inode == b->inode
+	    && a->size == b->size
+	    && a->mtime_ns == b->mtime_ns
+	    && a->ctime_ns == b->ctime_ns;
+}
+
+void
+hcache_clear(void)
+{
+	pthread_mutex_lock(&hcache_mutex);
+	free(table);
+	table = NULL;
+	table_cap = 0U;
+	table_len = 0U;
+	pthread_mutex_unlock(&hcache_mutex);
+}
+
+void
+hcache_setup_file(const config_t *config)
+{
+	if(!(config->vifm_info & VINFO_HCACHE))
+	{
+		hcache_detach();
+		return;
+	}
+
+	char path[PATH_MAX + 16];
+	snprintf(path, sizeof(path), "%s/hcache", config->config_dir);
+
+	pthread_mutex_lock(&hcache_mutex);
+	const int attached = (file_path != NULL && strcmp(file_path, path) == 0);
+	pthread_mutex_unlock(&hcache_mutex);
+
+	if(!attached)
+	{
+		(void)hcache_attach(path);
+	}
+}
+
+#ifndef _WIN32
+
+int
+hcache_attach(const char path[])
+{
+	hcache_detach();
+
+	pthread_mutex_lock(&hcache_mutex);
+	file_path = strdup(path);
+	if(file_path != NULL)
+	{
+		file_log = alog_open(path, HCF_MAGIC, HCF_VERSION, &load_file, &dump_file,
+				NULL);
+	}
+	const int failed = (file_log == NULL);
+	if(failed)
+	{
+		close_file();
+	}
+	pthread_mutex_unlock(&hcache_mutex);
+
+	return failed;
+}
+
+/* Puts valid records of locked file into the table and requests compaction if
+ * the file has too many outdated records.  Must be called with the mutex held.
+ * Returns offset right past the last valid record. */
+static off_t
+load_file(int fd, off_t size, int *compact, void *arg)
+{
+	off_t offset = sizeof(alog_header_t);
+
+	hcache_record_t *const batch = malloc(sizeof(*batch)*HCF_READ_BATCH);
+	if(batch == NULL)
+	{
+		return -1;
+	}
+
+	size_t nrecords = 0U;
+	while(size - offset >= (off_t)sizeof(*batch))
+	{
+		size_t n = (size - offset)/sizeof(*batch);
+		if(n > HCF_READ_BATCH)
+		{
+			n = HCF_READ_BATCH;
+		}
+
+		const ssize_t nread = pread(fd, batch, n*sizeof(*batch), offset);
+		if(nread < (ssize_t)sizeof(*batch))
+		{
+			break;
+		}
+		n = nread/sizeof(*batch);
+
+		size_t i;
+		for(i = 0U; i < n && batch[i].magic == HCF_RECORD_MAGIC; ++i)
+		{
+			store_record(&batch[i]);
+		}
+
+		nrecords += i;
+		offset += i*sizeof(*batch);
+		if(i != n)
+		{
+			/* Garbage after valid records. */
+			break;
+		}
+	}
+
+	free(batch);
+
+	*compact = (nrecords >= HCF_MIN_COMPACT && nrecords > 2U*table_len);
+	return offset;
+}
+
+/* Writes out records of the table.  Must be called with the mutex held.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+dump_file(int fd, void *arg)
+{
+	size_t i;
+	for(i = 0U; i < table_cap; ++i)
+	{
+		if(table[i].magic != 0U &&
+				alog_write(fd, &table[i], sizeof(table[i])) != 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void
+hcache_detach(void)
+{
+	pthread_mutex_lock(&hcache_mutex);
+	close_file();
+	pthread_mutex_unlock(&hcache_mutex);
+}
+
+void
+hcache_sync(void)
+{
+	pthread_mutex_lock(&hcache_mutex);
+	if(file_log != NULL)
+	{
+		(void)alog_sync(file_log, &read_records, NULL);
+	}
+	pthread_mutex_unlock(&hcache_mutex);
+}
+
+/* Puts records appended to the file by other instances into the table.  Must be
+ * called with the mutex held.  Returns number of bytes occupied by valid
+ * records. */
+static size_t
+read_records(const char data[], size_t len, void *arg)
+{
+	size_t offset = 0U;
+	while(len - offset >= sizeof(hcache_record_t))
+	{
+		/* The data isn't necessarily aligned. */
+		hcache_record_t record;
+		memcpy(&record, data + offset, sizeof(record));
+		if(record.magic != HCF_RECORD_MAGIC)
+		{
+			break;
+		}
+
+		store_record(&record);
+		offset += sizeof(record);
+	}
+	return offset;
+}
+
+/* Puts record read from the file into the table.  Must be called with the mutex
+ * held. */
+static void
+store_record(const hcache_record_t *record)
+{
+	hcache_record_t *const slot = find_slot(&record->key);
+	if(slot != NULL)
+	{
+		table_len += (slot->magic == 0U);
+		*slot = *record;
+	}
+}
+
+/* Writes out pending records and frees state of attached file.  Must be called
+ * with the mutex held. */
+static void
+close_file(void)
+{
+	alog_close(file_log);
+	file_log = NULL;
+
+	update_string(&file_path, NULL);
+}
+
+#else
+
+int
+hcache_attach(const char path[])
+{
+	return 1;
+}
+
+void
+hcache_detach(void)
+{
+}
+
+void
+hcache_sync(void)
+{
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,93 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__HCACHE_H__
+#define VIFM__HCACHE_H__
+
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+
+/* Cache of digests of contents of files.  Records are looked up by device and
+ * inode of a file and are valid only while size, modification and change times
+ * of the file stay the same.  The cache can be kept in a file between sessions,
+ * in which case it's shared by running instances.  All functions can be called
+ * from multiple threads. */
+
+struct config_t;
+
+/* State of a file that determines whether its digests are up to date. */
+typedef struct
+{
+	uint64_t dev;     /* Device of the file. */
+	uint64_t inode;   /* Inode of the file. */
+	uint64_t size;    /* Size of the file in bytes. */
+	int64_t mtime_ns; /* Modification time in nanoseconds. */
+	int64_t ctime_ns; /* Change time in nanoseconds. */
+}
+hcache_key_t;
+
+/* Digests of contents of a file. */
+typedef struct
+{
+	uint32_t sample_size; /* Size of each of samples of contents covered by the
+	                         sample digest or zero if the digest is unknown. */
+	uint32_t has_full;    /* Whether digest of the whole file is known. */
+	uint64_t sample;      /* Digest of samples taken from the file. */
+	uint64_t full[2];     /* 128-bit digest of the whole file. */
+}
+hcache_digests_t;
+
+/* Fills in the key for a file at the path (symbolic links are resolved).
+ * Returns zero on success, otherwise non-zero is returned. */
+int hcache_key_of(const char path[], hcache_key_t *key);
+
+/* Retrieves digests of a file.  Returns zero if there is a record which is up
+ * to date, otherwise non-zero is returned. */
+int hcache_get(const hcache_key_t *key, hcache_digests_t *digests);
+
+/* Remembers digest of samples of contents of a file.  Digest of the whole file
+ * is kept if the file hasn't changed. */
+void hcache_put_sample(const hcache_key_t *key, uint32_t sample_size,
+		uint64_t sample);
+
+/* Remembers digest of the whole file.  Digest of samples is kept if the file
+ * hasn't changed. */
+void hcache_put_full(const hcache_key_t *key, const uint64_t full[2]);
+
+/* Empties in-memory cache.  Doesn't affect attached file. */
+void hcache_clear(void);
+
+/* Starts or stops keeping the cache in $VIFM/hcache between sessions depending
+ * on whether 'vifminfo' contains "hcache". */
+void hcache_setup_file(const struct config_t *config);
+
+/* Makes the cache persistent by loading it from the file and appending its
+ * updates there.  Returns zero on success, otherwise non-zero is returned. */
+int hcache_attach(const char path[]);
+
+/* Writes out pending updates and stops using file attached by
+ * hcache_attach(). */
+void hcache_detach(void);
+
+/* Exchanges updates with the file attached by hcache_attach(), which might
+ * have been updated by other instances. */
+void hcache_sync(void);
+
+#endif /* VIFM__HCACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
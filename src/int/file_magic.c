@@ -27,10 +27,12 @@
 #include <magic.h>
 #endif
 
-#include <stddef.h> /* size_t */
+#include <pthread.h> /* PTHREAD_* pthread_* */
+
+#include <stddef.h> /* NULL size_t */
 #include <stdlib.h> /* free() malloc() */
 #include <stdio.h> /* popen() */
-#include <string.h> /* strdup() */
+#include <string.h> /* memmove() strdup() */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
@@ -39,24 +41,36 @@
 #include "../utils/fsddata.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/trie.h"
 #include "../utils/utils.h"
 #include "../filetype.h"
 #include "../status.h"
 #include "desktop.h"
 
+/* Maximum number of files waiting for deferred detection.  Older requests are
+ * dropped to make room for new ones, which are more likely to be visible. */
+#define MAX_DEFERRED 1024
+
+/* Number of detected mime-types after which callback is invoked even if more
+ * files are waiting for detection. */
+#define NOTIFY_BATCH 32
+
 /* Cache entry. */
 typedef struct
 {
-	char *mime;        /* Mime-type. */
+	char *mime;        /* Mime-type or empty string if it couldn't be detected. */
 	filemon_t filemon; /* Timestamp. */
 }
 cache_data_t;
 
+static int lookup_in_cache(const char path[], filemon_t *filemon, char buf[],
+		size_t buf_sz);
 static fsddata_t * get_cache(void);
-static int lookup_in_cache(fsddata_t *cache, const char path[],
-		filemon_t *filemon, cache_data_t **data);
-static void update_cache(fsddata_t *cache, const char path[],
-		const char mimetype[], filemon_t *filemon, cache_data_t *data);
+static void update_cache(const char path[], const char mimetype[],
+		const filemon_t *filemon);
+static int defer_detection(const char path[], mime_detected_cb cb);
+static void * detection_thread(void *arg);
+static int detect_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_glib_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_magic_mimetype(const char filename[], char buf[], size_t buf_sz);
 static int get_file_mimetype(const char filename[], char buf[], size_t buf_sz);
@@ -66,6 +80,31 @@ static void parse_app_dir(const char directory[], const char mime_type[],
 		assoc_records_t *result);
 #endif
 
+/* Protects the cache, which is also updated by detection thread. */
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Serializes detection, because libmagic handle can't be shared by threads. */
+static pthread_mutex_t detect_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Callback to use for deferring detection or NULL to detect synchronously. */
+static mime_detected_cb defer_cb;
+/* Whether detection was deferred since the last check. */
+static int deferred;
+
+/* Files waiting for detection, the last one is processed first. */
+static char *queue[MAX_DEFERRED];
+/* Number of elements in the queue. */
+static int queue_len;
+/* Set of files that were queued since the queue was empty last time. */
+static trie_t *queued;
+/* Callback to invoke after detection. */
+static mime_detected_cb detected_cb;
+/* Whether detection thread is running. */
+static int worker_started;
+/* Protects all of the state related to the queue. */
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Signaled when a new file is added to the queue. */
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+
 assoc_records_t
 get_magic_handlers(const char file[])
 {
@@ -86,33 +125,71 @@ get_mimetype(const char file[], int resolve_symlinks)
 		}
 	}
 
-	fsddata_t *mime_cache = get_cache();
-
 	filemon_t filemon;
-	cache_data_t *cache_data = NULL;
-	if(lookup_in_cache(mime_cache, file, &filemon, &cache_data))
+	if(!lookup_in_cache(file, &filemon, mimetype, sizeof(mimetype)))
 	{
-		copy_str(mimetype, sizeof(mimetype), cache_data->mime);
-		return mimetype;
+		/* Files that can't be cached (e.g., broken symbolic links) are handled
+		 * synchronously to not queue them again and again. */
+		if(defer_cb != NULL && filemon_is_set(&filemon) &&
+				defer_detection(file, defer_cb) == 0)
+		{
+			deferred = 1;
+			return NULL;
+		}
+
+		if(detect_mimetype(file, mimetype, sizeof(mimetype)) != 0)
+		{
+			mimetype[0] = '\0';
+		}
+		update_cache(file, mimetype, &filemon);
 	}
 
-	if(get_glib_mimetype(file, mimetype, sizeof(mimetype)) == -1)
+	return (mimetype[0] == '\0' ? NULL : mimetype);
+}
+
+void
+get_mimetype_defer(mime_detected_cb cb)
+{
+	defer_cb = cb;
+}
+
+int
+get_mimetype_deferred(void)
+{
+	const int result = deferred;
+	deferred = 0;
+	return result;
+}
+
+/* Looks up cache entry for the specified path and copies mime-type from it into
+ * the buffer.  *filemon is always initialized from the file.  Returns non-zero
+ * if up-to-date entry is found, otherwise zero is returned. */
+static int
+lookup_in_cache(const char path[], filemon_t *filemon, char buf[],
+		size_t buf_sz)
+{
+	(void)filemon_from_file(path, FMT_MODIFIED, filemon);
+
+	int found = 0;
+
+	pthread_mutex_lock(&cache_lock);
+	void *value = NULL;
+	if(fsddata_get(get_cache(), path, &value) == 0)
 	{
-		if(get_magic_mimetype(file, mimetype, sizeof(mimetype)) == -1)
+		cache_data_t *const data = value;
+		if(filemon_equal(filemon, &data->filemon))
 		{
-			if(get_file_mimetype(file, mimetype, sizeof(mimetype)) == -1)
-			{
-				return NULL;
-			}
+			copy_str(buf, buf_sz, data->mime);
+			found = 1;
 		}
 	}
+	pthread_mutex_unlock(&cache_lock);
 
-	update_cache(mime_cache, file, mimetype, &filemon, cache_data);
-
-	return mimetype;
+	return found;
 }
 
-/* Retrieves mime-type cache, creating it on first call.  Returns the cache. */
+/* Retrieves mime-type cache, creating it on first call.  Must be called with
+ * cache_lock held.  Returns the cache. */
 static fsddata_t *
 get_cache(void)
 {
@@ -124,54 +201,166 @@ get_cache(void)
 	return mime_cache;
 }
 
-/* Looks up cache entry for the specified path.  On success, *filemon is
- * initialized from the file.  Returns non-zero if entry is found, otherwise
- * zero is returned. */
-static int
-lookup_in_cache(fsddata_t *cache, const char path[], filemon_t *filemon,
-		cache_data_t **data)
+/* Updates cache for the path.  Empty mimetype means that detection failed. */
+static void
+update_cache(const char path[], const char mimetype[],
+		const filemon_t *filemon)
 {
+	pthread_mutex_lock(&cache_lock);
+
+	fsddata_t *const cache = get_cache();
+
 	void *value = NULL;
 	if(fsddata_get(cache, path, &value) == 0)
 	{
-		*data = value;
+		/* Simply update cache entry in place. */
+		cache_data_t *const data = value;
+		replace_string(&data->mime, mimetype);
+		data->filemon = *filemon;
+		pthread_mutex_unlock(&cache_lock);
+		return;
+	}
 
-		(void)filemon_from_file(path, FMT_MODIFIED, filemon);
-		return filemon_equal(filemon, &(*data)->filemon);
+	cache_data_t *const data = malloc(sizeof(*data));
+	if(data != NULL)
+	{
+		data->filemon = *filemon;
+		data->mime = strdup(mimetype);
+		if(data->mime == NULL)
+		{
+			free(data);
+		}
+		else
+		{
+			fsddata_set(cache, path, data);
+		}
 	}
-	return 0;
+
+	pthread_mutex_unlock(&cache_lock);
 }
 
-/* Updates cache for the path. */
-static void
-update_cache(fsddata_t *cache, const char path[], const char mimetype[],
-		filemon_t *filemon, cache_data_t *data)
+/* Queues the file for detection in background.  Returns zero on success or if
+ * the file is already queued, otherwise non-zero is returned. */
+static int
+defer_detection(const char path[], mime_detected_cb cb)
 {
-	if(data != NULL)
+	pthread_mutex_lock(&queue_lock);
+
+	if(!worker_started)
 	{
-		/* Simply update cache entry in place. */
-		replace_string(&data->mime, mimetype);
-		data->filemon = *filemon;
-		return;
+		pthread_t id;
+		if(pthread_create(&id, NULL, &detection_thread, NULL) != 0)
+		{
+			pthread_mutex_unlock(&queue_lock);
+			return 1;
+		}
+		worker_started = 1;
 	}
 
-	(void)filemon_from_file(path, FMT_MODIFIED, filemon);
+	if(queued == NULL)
+	{
+		queued = trie_create(/*free_func=*/NULL);
+	}
+	if(queued != NULL && trie_put(queued, path) != 0)
+	{
+		/* Already queued or there is no memory to track it. */
+		pthread_mutex_unlock(&queue_lock);
+		return 0;
+	}
 
-	data = malloc(sizeof(*data));
-	if(data == NULL)
+	char *const copy = strdup(path);
+	if(copy == NULL)
 	{
-		return;
+		pthread_mutex_unlock(&queue_lock);
+		return 1;
 	}
 
-	data->filemon = *filemon;
-	data->mime = strdup(mimetype);
-	if(data->mime == NULL)
+	if(queue_len == MAX_DEFERRED)
 	{
-		free(data);
-		return;
+		free(queue[0]);
+		memmove(&queue[0], &queue[1], sizeof(*queue)*(queue_len - 1));
+		--queue_len;
+	}
+
+	queue[queue_len++] = copy;
+	detected_cb = cb;
+	pthread_cond_signal(&queue_cond);
+
+	pthread_mutex_unlock(&queue_lock);
+	return 0;
+}
+
+/* Entry point of a thread that detects mime-types of queued files and fills
+ * the cache.  Never returns. */
+static void *
+detection_thread(void *arg)
+{
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	int ndetected = 0;
+	while(1)
+	{
+		pthread_mutex_lock(&queue_lock);
+		while(queue_len == 0)
+		{
+			pthread_cond_wait(&queue_cond, &queue_lock);
+		}
+		char *const path = queue[--queue_len];
+		pthread_mutex_unlock(&queue_lock);
+
+		filemon_t filemon;
+		(void)filemon_from_file(path, FMT_MODIFIED, &filemon);
+
+		char mimetype[128];
+		if(detect_mimetype(path, mimetype, sizeof(mimetype)) != 0)
+		{
+			mimetype[0] = '\0';
+		}
+		update_cache(path, mimetype, &filemon);
+		free(path);
+
+		pthread_mutex_lock(&queue_lock);
+		const int drained = (queue_len == 0);
+		if(drained)
+		{
+			trie_free(queued);
+			queued = NULL;
+		}
+		const mime_detected_cb cb = detected_cb;
+		pthread_mutex_unlock(&queue_lock);
+
+		if(++ndetected == NOTIFY_BATCH || drained)
+		{
+			ndetected = 0;
+			cb();
+		}
+	}
+
+	return NULL;
+}
+
+/* Detects mime-type of the file by trying all available methods.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+detect_mimetype(const char filename[], char buf[], size_t buf_sz)
+{
+	int result = 0;
+
+	pthread_mutex_lock(&detect_lock);
+	if(get_glib_mimetype(filename, buf, buf_sz) == -1)
+	{
+		if(get_magic_mimetype(filename, buf, buf_sz) == -1)
+		{
+			if(get_file_mimetype(filename, buf, buf_sz) == -1)
+			{
+				result = 1;
+			}
+		}
 	}
+	pthread_mutex_unlock(&detect_lock);
 
-	fsddata_set(cache, path, data);
+	return result;
 }
 
 static int
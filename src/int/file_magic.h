@@ -21,11 +21,26 @@
 
 #include "../filetype.h"
 
+/* Type of callback invoked after detection of some of deferred mime-types
+ * finishes.  It's called from a background thread. */
+typedef void (*mime_detected_cb)(void);
+
 /* Retrieves mime type of the file specified by its path.  The resolve_symlinks
  * argument controls whether mime-type of the link should be that of its target.
- * Returns pointer to a statically allocated buffer. */
+ * Returns pointer to a statically allocated buffer or NULL if mime-type is
+ * unknown. */
 const char * get_mimetype(const char file[], int resolve_symlinks);
 
+/* Makes get_mimetype() return NULL for files whose mime-type isn't cached and
+ * queue their detection in background instead of performing it right away.
+ * Most recently queued files are processed first.  The callback is invoked
+ * once results are in the cache.  NULL cb restores synchronous detection. */
+void get_mimetype_defer(mime_detected_cb cb);
+
+/* Checks whether get_mimetype() deferred detection since the last call and
+ * resets the state.  Returns non-zero if so. */
+int get_mimetype_deferred(void);
+
 /* Retrieves system-wide desktop file associations.  Caller shouldn't free
  * anything. */
 assoc_records_t get_magic_handlers(const char file[]);
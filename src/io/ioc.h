@@ -41,6 +41,11 @@ typedef enum
 	/* Appends the reset of data to files at destination (assumes previously
 	 * terminated operation). */
 	IO_CRS_APPEND_TO_FILES,
+
+	/* Continues copying to files at destination after the part that matches
+	 * journal of previously terminated operation, copies whole files if there is
+	 * nothing to resume. */
+	IO_CRS_RESUME_FILES,
 }
 IoCrs;
 
@@ -127,6 +132,9 @@ struct io_args_t
 			unsigned int data_sync : 1;
 			/* Deep link copying (copy the target instead of linking to it). */
 			unsigned int deep_copying : 1;
+			/* Whether to skip holes of all files instead of only of files whose
+			 * allocated size is much smaller than their size. */
+			unsigned int sparse_copying : 1;
 		};
 	}
 	arg4;
@@ -19,6 +19,7 @@
 #include "ioeta.h"
 
 #include <assert.h> /* assert() */
+#include <pthread.h> /* pthread_mutex_t */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* calloc() free() */
@@ -44,6 +45,18 @@ ioeta_alloc(void *param, io_cancellation_t cancellation)
 	return estim;
 }
 
+ioeta_estim_t *
+ioeta_alloc_lane(ioeta_estim_t *parent, pthread_mutex_t *lock)
+{
+	ioeta_estim_t *const lane = ioeta_alloc(parent->param, parent->cancellation);
+	if(lane != NULL)
+	{
+		lane->parent = parent;
+		lane->parent_lock = lock;
+	}
+	return lane;
+}
+
 void
 ioeta_free(ioeta_estim_t *estim)
 {
@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__IOETA_H__
 #define VIFM__IO__IOETA_H__
 
+#include <pthread.h> /* pthread_mutex_t */
+
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 
@@ -68,12 +70,25 @@ typedef struct ioeta_estim_t
 
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
+
+	/* Estimation to which progress of this one is added or NULL.  See
+	 * ioeta_alloc_lane(). */
+	struct ioeta_estim_t *parent;
+
+	/* Serializes updates of the parent and notifications about them. */
+	pthread_mutex_t *parent_lock;
 }
 ioeta_estim_t;
 
 /* Allocates and initializes new ioeta_estim_t.  Returns NULL on error. */
 ioeta_estim_t * ioeta_alloc(void *param, io_cancellation_t cancellation);
 
+/* Allocates estimation for one of several parts of an operation that are
+ * processed at the same time.  Progress of the lane is added to the parent
+ * while holding the lock, listeners are notified about progress of the parent.
+ * Returns NULL on error. */
+ioeta_estim_t * ioeta_alloc_lane(ioeta_estim_t *parent, pthread_mutex_t *lock);
+
 /* Frees ioeta_estim_t.  The estim can be NULL. */
 void ioeta_free(ioeta_estim_t *estim);
 
@@ -25,12 +25,17 @@
 #ifndef _WIN32
 #include <sys/ioctl.h> /* ioctl() */
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h> /* sendfile() */
+#endif
 #include <sys/stat.h> /* stat */
-#include <sys/types.h> /* mode_t */
-#include <unistd.h> /* symlink() unlink() */
+#include <sys/types.h> /* mode_t ssize_t */
+#include <unistd.h> /* copy_file_range() ftruncate() lseek() pread() pwrite()
+                       symlink() unlink() */
 
 #include <assert.h> /* assert() */
-#include <errno.h> /* EEXIST ENOENT EISDIR errno */
+#include <errno.h> /* EBADF EEXIST EINTR EINVAL ENOENT ENOSYS ENXIO EISDIR
+                       EOPNOTSUPP EXDEV errno */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
                       fsetpos() fwrite() snprintf() */
@@ -49,23 +54,61 @@
 #include "private/ioc.h"
 #include "private/ioe.h"
 #include "private/ioeta.h"
+#include "private/iojournal.h"
 #include "ioc.h"
 
 /* Amount of data to transfer at once. */
 #define BLOCK_SIZE 32*1024
 
+/* Amount of data to transfer at once when copying is done by the kernel. */
+#define KERNEL_BLOCK_SIZE 4*1024*1024
+
 /* Amount of data after which data flush should be performed. */
 #define FLUSH_SIZE 256*1024*1024
 
+#if defined(HAVE_COPY_FILE_RANGE) || \
+    (defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE))
+#define HAVE_KERNEL_COPY
+#endif
+
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+#define HAVE_SPARSE_COPY
+#endif
+
 /* Type of io function used by retry_wrapper(). */
 typedef IoRes (*iop_func)(io_args_t *args);
 
+#if defined(HAVE_KERNEL_COPY) || defined(HAVE_SPARSE_COPY)
+
+/* Result of kernel_copy() and sparse_copy(). */
+typedef enum
+{
+	KCR_DONE,        /* All data was copied. */
+	KCR_FAILED,      /* Copying failed or was cancelled. */
+	KCR_UNSUPPORTED, /* Method isn't applicable to these files, the rest of data
+	                    should be copied in some other way. */
+}
+KernelCopyRes;
+
+#endif
+
 static IoRes iop_mkfile_internal(io_args_t *args);
 static IoRes iop_mkdir_internal(io_args_t *args);
 static IoRes iop_rmfile_internal(io_args_t *args);
 static IoRes iop_rmdir_internal(io_args_t *args);
 static IoRes iop_cp_internal(io_args_t *args);
 static int clone_file(int dst_fd, int src_fd);
+#ifdef HAVE_KERNEL_COPY
+static KernelCopyRes kernel_copy(io_args_t *args, int dst_fd, int src_fd,
+		size_t *ncopied, iojournal_t *journal);
+static int is_kernel_copy_unsupported(int error);
+#endif
+#ifdef HAVE_SPARSE_COPY
+static KernelCopyRes sparse_copy(io_args_t *args, int dst_fd, int src_fd,
+		off_t size, size_t *ncopied);
+static int copy_range(io_args_t *args, int dst_fd, int src_fd, off_t offset,
+		off_t len, size_t *ncopied);
+#endif
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER transferred, LARGE_INTEGER stream_size,
@@ -291,6 +334,15 @@ iop_cp(io_args_t *args)
 	return retry_wrapper(&iop_cp_internal, args);
 }
 
+int
+iop_can_resume_cp(const char src[], const char dst[])
+{
+	struct stat st;
+	return os_stat(src, &st) == 0
+	    && is_regular_file_noderef(dst)
+	    && iojournal_exists(dst, &st);
+}
+
 /* Implementation of iop_cp(). */
 static IoRes
 iop_cp_internal(io_args_t *args)
@@ -304,7 +356,7 @@ iop_cp_internal(io_args_t *args)
 
 	FILE *in, *out;
 	int error;
-	int cloned;
+	int copied;
 	struct stat src_st;
 	const char *open_mode = "wb";
 
@@ -434,6 +486,11 @@ iop_cp_internal(io_args_t *args)
 	{
 		open_mode = "ab";
 	}
+	else if(crs == IO_CRS_RESUME_FILES && is_regular_file_noderef(dst))
+	{
+		/* Contents of destination is checked and truncated later. */
+		open_mode = "r+b";
+	}
 	else if(crs != IO_CRS_FAIL)
 	{
 		if(path_exists(dst, NODEREF))
@@ -520,7 +577,11 @@ iop_cp_internal(io_args_t *args)
 	}
 
 	error = 0;
-	cloned = 0;
+	copied = 0;
+
+	/* Size of part of destination which is already in place. */
+	uint64_t resume_offset = 0U;
+	iojournal_t *journal = NULL;
 
 	if(crs == IO_CRS_APPEND_TO_FILES)
 	{
@@ -539,23 +600,96 @@ iop_cp_internal(io_args_t *args)
 			ioeta_update(args->estim, NULL, NULL, 0, orig_out_size);
 		}
 	}
-	else if(args->arg4.fast_file_cloning)
+#ifndef _WIN32
+	else if(crs == IO_CRS_RESUME_FILES)
+	{
+		journal = iojournal_resume(dst, fileno(out), fileno(in), &st,
+				&args->cancellation, &resume_offset);
+
+		/* Drop unverified tail and continue from where verified part ends. */
+		if(ftruncate(fileno(out), (off_t)resume_offset) != 0 ||
+				fseeko(in, (off_t)resume_offset, SEEK_SET) != 0 ||
+				fseeko(out, (off_t)resume_offset, SEEK_SET) != 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Failed to resume copying");
+			error = 1;
+		}
+		else
+		{
+			ioeta_update(args->estim, NULL, NULL, 0, resume_offset);
+		}
+	}
+#endif
+
+	if(!error && crs != IO_CRS_APPEND_TO_FILES && resume_offset == 0U &&
+			args->arg4.fast_file_cloning)
 	{
 		if(clone_file(fileno(out), fileno(in)) == 0)
 		{
-			cloned = 1;
+			copied = 1;
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
+#ifndef _WIN32
+	/* Amount of data written since last flush. */
+	size_t ncopied = 0U;
+#endif
 
-	if(!error && !cloned)
+#ifdef HAVE_SPARSE_COPY
+	if(!error && !copied && crs != IO_CRS_APPEND_TO_FILES &&
+			resume_offset == 0U &&
+			(args->arg4.sparse_copying || io_is_sparse(&st)))
+	{
+		/* Copy only data and leave holes in place of holes of the source. */
+		switch(sparse_copy(args, fileno(out), fileno(in), st.st_size, &ncopied))
+		{
+			case KCR_DONE:
+				copied = 1;
+				break;
+			case KCR_FAILED:
+				error = 1;
+				break;
+			case KCR_UNSUPPORTED:
+				break;
+		}
+	}
+#endif
+
+#ifndef _WIN32
+	if(!error && !copied && journal == NULL && crs != IO_CRS_APPEND_TO_FILES)
+	{
+		/* Record progress of copying large files to be able to resume it. */
+		journal = iojournal_start(dst, &st);
+	}
+#endif
+
+#ifdef HAVE_KERNEL_COPY
+	if(!error && !copied)
+	{
+		/* Nothing was read or written via FILE streams yet, so their buffers are
+		 * empty and data can be transferred by the kernel directly between file
+		 * descriptors. */
+		switch(kernel_copy(args, fileno(out), fileno(in), &ncopied, journal))
+		{
+			case KCR_DONE:
+				copied = 1;
+				break;
+			case KCR_FAILED:
+				error = 1;
+				break;
+			case KCR_UNSUPPORTED:
+				break;
+		}
+	}
+#endif
+
+	if(!error && !copied)
 	{
 		char block[BLOCK_SIZE];
 		/* Suppress possible false-positive compiler warning. */
 		size_t nread = (size_t)-1;
 #ifndef _WIN32
-		size_t ncopied = 0U;
 		const int data_sync = args->arg4.data_sync;
 #endif
 		while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
@@ -575,6 +709,7 @@ iop_cp_internal(io_args_t *args)
 			}
 
 			ioeta_update(args->estim, NULL, NULL, 0, nread);
+			iojournal_advance(journal, nread);
 
 #ifndef _WIN32
 			/* Force flushing data to disk to not pollute RAM with this data too
@@ -633,6 +768,9 @@ iop_cp_internal(io_args_t *args)
 		error = 1;
 	}
 
+	/* Journal is kept if copying was cancelled or failed. */
+	iojournal_finish(journal, error == 0);
+
 	if(error == 0 && (deep_copying ? os_stat : os_lstat)(src, &src_st) == 0)
 	{
 		error = os_chmod(dst, src_st.st_mode & 07777);
@@ -671,6 +809,272 @@ clone_file(int dst_fd, int src_fd)
 #endif
 }
 
+#ifdef HAVE_KERNEL_COPY
+
+/* Copies data from current position of the source to the destination without
+ * passing it through user space.  Data is transferred in bounded chunks to
+ * report progress, check for cancellation and flush data periodically.
+ * *ncopied is updated as data is written.  Progress is recorded in the journal
+ * if it's not NULL.  Returns status of the copying. */
+static KernelCopyRes
+kernel_copy(io_args_t *args, int dst_fd, int src_fd, size_t *ncopied,
+		iojournal_t *journal)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+	int use_copy_file_range = 1;
+#else
+	int use_copy_file_range = 0;
+#endif
+	/* Whether current method has transferred anything. */
+	int transferred = 0;
+
+	while(1)
+	{
+		if(io_cancelled(args))
+		{
+			return KCR_FAILED;
+		}
+
+		ssize_t n;
+		if(use_copy_file_range)
+		{
+#ifdef HAVE_COPY_FILE_RANGE
+			n = copy_file_range(src_fd, NULL, dst_fd, NULL, KERNEL_BLOCK_SIZE, 0);
+#endif
+		}
+		else
+		{
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+			n = sendfile(dst_fd, src_fd, NULL, KERNEL_BLOCK_SIZE);
+#else
+			return KCR_UNSUPPORTED;
+#endif
+		}
+
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			/* Nothing was transferred, so it's safe to try something else. */
+			if(!transferred && is_kernel_copy_unsupported(errno))
+			{
+				if(!use_copy_file_range)
+				{
+					return KCR_UNSUPPORTED;
+				}
+				use_copy_file_range = 0;
+				continue;
+			}
+
+			(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+					"Failed to copy data");
+			return KCR_FAILED;
+		}
+
+		if(n == 0)
+		{
+			/* Some file systems (e.g., procfs) report end of file immediately
+			 * instead of failing, let copying via buffer double-check that there is
+			 * really no data. */
+			return (transferred ? KCR_DONE : KCR_UNSUPPORTED);
+		}
+
+		transferred = 1;
+		ioeta_update(args->estim, NULL, NULL, 0, n);
+
+		iojournal_advance(journal, n);
+
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		*ncopied += n;
+		if(args->arg4.data_sync && *ncopied >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			*ncopied -= FLUSH_SIZE;
+		}
+	}
+}
+
+/* Checks whether error code of copy_file_range() or sendfile() means that the
+ * call isn't applicable to the files.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_kernel_copy_unsupported(int error)
+{
+	/* EXDEV is returned for files on different file systems, EBADF for
+	 * destination opened for appending. */
+	return error == ENOSYS || error == EXDEV || error == EINVAL
+	    || error == EOPNOTSUPP || error == EBADF;
+}
+
+#endif
+
+#ifdef HAVE_SPARSE_COPY
+
+/* Copies data ranges of the source found via SEEK_DATA/SEEK_HOLE to the same
+ * offsets of an empty destination, which leaves holes unallocated, and then
+ * extends the destination to the size.  *ncopied is updated as data is
+ * written.  Returns status of the copying. */
+static KernelCopyRes
+sparse_copy(io_args_t *args, int dst_fd, int src_fd, off_t size,
+		size_t *ncopied)
+{
+	off_t pos = 0;
+	while(pos < size)
+	{
+		const off_t data = lseek(src_fd, pos, SEEK_DATA);
+		if(data < 0)
+		{
+			if(errno == ENXIO)
+			{
+				/* The rest of the file is a hole. */
+				break;
+			}
+
+			/* Nothing was written yet, so it's safe to try something else. */
+			if(pos == 0 && (errno == EINVAL || errno == EOPNOTSUPP))
+			{
+				return KCR_UNSUPPORTED;
+			}
+
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to find data in source file");
+			return KCR_FAILED;
+		}
+
+		if(data >= size)
+		{
+			break;
+		}
+
+		off_t hole = lseek(src_fd, data, SEEK_HOLE);
+		if(hole < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to find hole in source file");
+			return KCR_FAILED;
+		}
+		hole = MIN(hole, size);
+
+		if(copy_range(args, dst_fd, src_fd, data, hole - data, ncopied) != 0)
+		{
+			return KCR_FAILED;
+		}
+
+		pos = hole;
+	}
+
+	/* This creates trailing hole if there is one. */
+	if(ftruncate(dst_fd, size) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Failed to set size of destination file");
+		return KCR_FAILED;
+	}
+
+	return KCR_DONE;
+}
+
+/* Copies range of data at the same offset of the destination reporting
+ * progress, checking for cancellation and flushing data periodically.
+ * *ncopied is updated as data is written.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+copy_range(io_args_t *args, int dst_fd, int src_fd, off_t offset, off_t len,
+		size_t *ncopied)
+{
+	char block[BLOCK_SIZE];
+#ifdef HAVE_COPY_FILE_RANGE
+	int use_copy_file_range = 1;
+#endif
+
+	while(len > 0)
+	{
+		if(io_cancelled(args))
+		{
+			return 1;
+		}
+
+		ssize_t n;
+#ifdef HAVE_COPY_FILE_RANGE
+		if(use_copy_file_range)
+		{
+			off_t in_off = offset, out_off = offset;
+			n = copy_file_range(src_fd, &in_off, dst_fd, &out_off,
+					MIN(len, KERNEL_BLOCK_SIZE), 0);
+			if(n < 0 && errno != EINTR && is_kernel_copy_unsupported(errno))
+			{
+				/* Offsets are explicit, so switching methods is always safe. */
+				use_copy_file_range = 0;
+				continue;
+			}
+		}
+		else
+#endif
+		{
+			n = pread(src_fd, block, MIN(len, (off_t)sizeof(block)), offset);
+			if(n > 0)
+			{
+				ssize_t written = 0;
+				while(written < n)
+				{
+					const ssize_t w = pwrite(dst_fd, block + written, n - written,
+							offset + written);
+					if(w < 0 && errno == EINTR)
+					{
+						continue;
+					}
+					if(w <= 0)
+					{
+						(void)ioe_errlst_append(&args->result.errors, args->arg2.dst,
+								errno, "Write to destination file failed");
+						return 1;
+					}
+					written += w;
+				}
+			}
+		}
+
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to copy data");
+			return 1;
+		}
+
+		if(n == 0)
+		{
+			/* The file got shorter, the rest becomes a hole. */
+			break;
+		}
+
+		offset += n;
+		len -= n;
+		ioeta_update(args->estim, NULL, NULL, 0, n);
+
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		*ncopied += n;
+		if(args->arg4.data_sync && *ncopied >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			*ncopied -= FLUSH_SIZE;
+		}
+	}
+
+	return 0;
+}
+
+#endif
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -43,6 +43,11 @@ IoRes iop_rmdir(io_args_t *args);
 /* Copies file.  Expects source in arg1, destination in arg2 and crs in arg3. */
 IoRes iop_cp(io_args_t *args);
 
+/* Checks whether copying of src to dst was terminated earlier and left a
+ * journal, so that IO_CRS_RESUME_FILES can continue it.  Returns non-zero if
+ * so, otherwise zero is returned. */
+int iop_can_resume_cp(const char src[], const char dst[]);
+
 /* Change owner of file/directory.  Expects path in arg1 and uid in arg3. */
 IoRes iop_chown(io_args_t *args);
 
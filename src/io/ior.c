@@ -183,18 +183,18 @@ ior_mv(io_args_t *args)
 		return IO_RES_FAILED;
 	}
 
-	if(crs == IO_CRS_APPEND_TO_FILES)
+	if(crs == IO_CRS_APPEND_TO_FILES || crs == IO_CRS_RESUME_FILES)
 	{
 		if(!is_file(src))
 		{
 			(void)ioe_errlst_append(&args->result.errors, src, EISDIR,
-					"Can't append when source is not a file");
+					"Can't append or resume when source is not a file");
 			return IO_RES_FAILED;
 		}
 		if(!is_file(dst))
 		{
 			(void)ioe_errlst_append(&args->result.errors, dst, EISDIR,
-					"Can't append when destination is not a file");
+					"Can't append or resume when destination is not a file");
 			return IO_RES_FAILED;
 		}
 	}
@@ -241,7 +241,8 @@ ior_mv(io_args_t *args)
 		}
 
 		if(crs == IO_CRS_REPLACE_FILES ||
-				(!has_atomic_file_replace() && crs == IO_CRS_APPEND_TO_FILES))
+				(!has_atomic_file_replace() &&
+				 (crs == IO_CRS_APPEND_TO_FILES || crs == IO_CRS_RESUME_FILES)))
 		{
 			return mv_replacing_files(args);
 		}
@@ -434,6 +435,7 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp,
 					/* It's safe to always use fast file cloning on moving files. */
 					.arg4.fast_file_cloning = cp ? cp_args->arg4.fast_file_cloning : 1,
 					.arg4.data_sync = cp_args->arg4.data_sync,
+					.arg4.sparse_copying = cp_args->arg4.sparse_copying,
 					/* Deep copying may be suppressed for links that can't be copied. */
 					.arg4.deep_copying = cp ? deep && cp_args->arg4.deep_copying : 0,
 
@@ -18,6 +18,18 @@
 
 #include "ioc.h"
 
+#include <sys/stat.h> /* S_ISLNK() S_ISREG() stat */
+
+#include <stdint.h> /* uint64_t */
+
+#include "../../compat/os.h"
+#include "../../utils/fs.h"
+
+/* Minimal size of a file to be considered sparse.  Smaller files can be stored
+ * without separate data blocks or compressed, which doesn't mean that they have
+ * holes. */
+#define SPARSE_MIN_SIZE (64*1024)
+
 int
 io_cancelled(const io_args_t *args)
 {
@@ -30,5 +42,38 @@ cancelled(const io_cancellation_t *info)
 	return info->hook != NULL && info->hook(info->arg);
 }
 
+int
+io_is_sparse(const struct stat *st)
+{
+#ifndef _WIN32
+	return S_ISREG(st->st_mode)
+	    && st->st_size >= SPARSE_MIN_SIZE
+	    && (uint64_t)st->st_blocks*512U < (uint64_t)st->st_size/2U;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+uint64_t
+io_data_size(const char path[], int deep)
+{
+#ifndef _WIN32
+	struct stat st;
+	if((deep ? os_stat : os_lstat)(path, &st) != 0 || S_ISLNK(st.st_mode))
+	{
+		return 0U;
+	}
+	return io_is_sparse(&st) ? (uint64_t)st.st_blocks*512U
+	                         : (uint64_t)st.st_size;
+#else
+	if(deep)
+	{
+		return get_target_file_size(path);
+	}
+	return is_symlink(path) ? 0U : get_file_size(path);
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -19,6 +19,10 @@
 #ifndef VIFM__IO__PRIVATE__IOC_H__
 #define VIFM__IO__PRIVATE__IOC_H__
 
+#include <sys/stat.h> /* stat */
+
+#include <stdint.h> /* uint64_t */
+
 #include "../ioc.h"
 
 /* Convenience function that checks whether given I/O operation was cancelled
@@ -30,6 +34,16 @@ int io_cancelled(const io_args_t *args);
  * non-zero if so, otherwise zero is returned.  */
 int cancelled(const io_cancellation_t *info);
 
+/* Checks whether allocated size of a file is much smaller than its size, in
+ * which case copying should skip holes of the file.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int io_is_sparse(const struct stat *st);
+
+/* Computes number of bytes that copying a file transfers, which is less than
+ * size for sparse files.  Symbolic links are resolved if deep is non-zero,
+ * otherwise they count as empty.  Returns the number. */
+uint64_t io_data_size(const char path[], int deep);
+
 #endif /* VIFM__IO__PRIVATE__IOC_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
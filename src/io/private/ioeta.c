@@ -18,16 +18,19 @@
 
 #include "ioeta.h"
 
-#include <stddef.h> /* NULL */
+#include <pthread.h> /* pthread_mutex_lock() pthread_mutex_unlock() */
+#include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strdup() */
 
-#include "../../utils/fs.h"
 #include "../../utils/str.h"
 #include "../ioeta.h"
+#include "ioc.h"
 #include "ionotif.h"
 
+static void add_progress(ioeta_estim_t *estim, int finished, uint64_t bytes);
+
 void
 ioeta_release(ioeta_estim_t *estim)
 {
@@ -48,15 +51,8 @@ ioeta_add_item(ioeta_estim_t *estim, const char path[])
 void
 ioeta_add_file(ioeta_estim_t *estim, const char path[], int deep)
 {
-	if(deep)
-	{
-		estim->total_bytes += get_target_file_size(path);
-	}
-	else if(!is_symlink(path))
-	{
-		estim->total_bytes += get_file_size(path);
-	}
-
+	/* Holes of sparse files aren't copied and aren't counted. */
+	estim->total_bytes += io_data_size(path, deep);
 	ioeta_add_item(estim, path);
 }
 
@@ -76,29 +72,17 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		return;
 	}
 
-	estim->current_byte += bytes;
-	estim->current_file_byte += bytes;
-	if(estim->current_byte > estim->total_bytes)
-	{
-		/* Estimations are out of date, update them. */
-		estim->total_bytes = estim->current_byte;
-	}
+	add_progress(estim, finished, bytes);
 
 	if(finished)
 	{
-		++estim->current_item;
-		if(estim->current_item > estim->total_items)
-		{
-			/* Estimations are out of date, update them. */
-			estim->total_items = estim->current_item;
-		}
 		estim->current_file_byte = 0U;
 		estim->total_file_bytes = 0U;
 	}
 	else if(estim->inspected_items != estim->current_item + 1)
 	{
 		estim->inspected_items = estim->current_item + 1;
-		estim->total_file_bytes = get_file_size(path);
+		estim->total_file_bytes = io_data_size(path, /*deep=*/0);
 	}
 
 	if(path != NULL)
@@ -111,7 +95,46 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		replace_string(&estim->target, target);
 	}
 
-	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+	if(estim->parent == NULL)
+	{
+		ionotif_notify(IO_PS_IN_PROGRESS, estim);
+		return;
+	}
+
+	/* Parent displays state of the file of the lane that reported last. */
+	ioeta_estim_t *const parent = estim->parent;
+	pthread_mutex_lock(estim->parent_lock);
+	add_progress(parent, finished, bytes);
+	parent->current_file_byte = estim->current_file_byte;
+	parent->total_file_bytes = estim->total_file_bytes;
+	update_string(&parent->item, estim->item);
+	update_string(&parent->target, estim->target);
+	ionotif_notify(IO_PS_IN_PROGRESS, parent);
+	pthread_mutex_unlock(estim->parent_lock);
+}
+
+/* Accounts for processed bytes and finished item adjusting estimations if they
+ * turn out to be out of date. */
+static void
+add_progress(ioeta_estim_t *estim, int finished, uint64_t bytes)
+{
+	estim->current_byte += bytes;
+	estim->current_file_byte += bytes;
+	if(estim->current_byte > estim->total_bytes)
+	{
+		/* Estimations are out of date, update them. */
+		estim->total_bytes = estim->current_byte;
+	}
+
+	if(finished)
+	{
+		++estim->current_item;
+		if(estim->current_item > estim->total_items)
+		{
+			/* Estimations are out of date, update them. */
+			estim->total_items = estim->current_item;
+		}
+	}
 }
 
 int
@@ -162,9 +185,21 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 	update_string(&item, save->item);
 	update_string(&target, save->target);
 
+	const uint64_t bytes = estim->current_byte;
+	const size_t items = estim->current_item;
+
 	*estim = *save;
 	estim->item = item;
 	estim->target = target;
+
+	if(estim->parent != NULL)
+	{
+		/* Take back progress of the lane since the restoration point. */
+		pthread_mutex_lock(estim->parent_lock);
+		estim->parent->current_byte -= bytes - estim->current_byte;
+		estim->parent->current_item -= items - estim->current_item;
+		pthread_mutex_unlock(estim->parent_lock);
+	}
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -0,0 +1,439 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "iojournal.h"
+
+#include <sys/stat.h> /* S_ISREG() fstat() stat */
+#include <sys/types.h> /* off_t ssize_t */
+#ifndef _WIN32
+#include <fcntl.h> /* O_* open() */
+#include <unistd.h> /* close() ftruncate() lseek() pread() unlink() write() */
+#endif
+
+#include <errno.h> /* EINTR errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcmp() */
+
+#include "../../compat/reallocarray.h"
+#include "../../utils/str.h"
+#include "ioc.h"
+
+/*
+ * The file consists of a header which describes the source file followed by
+ * 64-bit indexes of consecutive chunks of the destination file.  An index is
+ * appended once a chunk is complete, so a partially written index at the end
+ * of the file is possible and is ignored.  Records aren't synchronized with
+ * data, because data is compared with the source before being trusted.
+ */
+
+/* Suffix of path to the destination that forms path to its journal. */
+#define JOURNAL_SUFFIX ".vifm-journal"
+
+/* Version of the file format. */
+#define IOJ_VERSION 2U
+
+/* Value of byte_order field, which lets detect files from other machines. */
+#define IOJ_BYTE_ORDER 0x01020304U
+
+/* Size of a chunk of data described by a single digest. */
+#define CHUNK_SIZE (16*1024*1024)
+
+/* Files smaller than this aren't journaled as they are quick to copy again. */
+#define MIN_FILE_SIZE (4*CHUNK_SIZE)
+
+/* Size of a block in which data is read to be compared. */
+#define READ_SIZE (32*1024)
+
+/* Header at the start of the file. */
+typedef struct
+{
+	char magic[8];       /* "VIFMCPJ" terminated with a null character. */
+	uint32_t version;    /* IOJ_VERSION. */
+	uint32_t byte_order; /* IOJ_BYTE_ORDER in native byte order. */
+	uint32_t chunk_size; /* CHUNK_SIZE. */
+	uint32_t reserved;   /* Padding, zero. */
+	uint64_t size;       /* Size of the source. */
+	int64_t mtime;       /* Modification time of the source. */
+	uint64_t inode;      /* Inode of the source. */
+	uint64_t dev;        /* Device of the source. */
+}
+ioj_header_t;
+
+/* State of a journal. */
+struct iojournal_t
+{
+	char *path;     /* Path to the file of the journal. */
+	int fd;         /* File descriptor or -1 after a failure. */
+	uint64_t chunk; /* Index of current chunk. */
+	uint64_t fill;  /* Number of bytes in current chunk. */
+};
+
+#ifndef _WIN32
+
+static iojournal_t * alloc_journal(const char path[], int fd, uint64_t chunk);
+static ioj_header_t make_header(const struct stat *src_st);
+static int is_journaled(const struct stat *src_st);
+static int header_matches(int fd, const struct stat *src_st);
+static int chunk_matches(int dst_fd, int src_fd, uint64_t index);
+static int read_block(int fd, char block[], size_t len, off_t offset);
+static int write_all(int fd, const void *data, size_t len);
+
+iojournal_t *
+iojournal_start(const char dst[], const struct stat *src_st)
+{
+	if(!is_journaled(src_st))
+	{
+		return NULL;
+	}
+
+	char *const path = format_str("%s%s", dst, JOURNAL_SUFFIX);
+	if(path == NULL)
+	{
+		return NULL;
+	}
+
+	const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+	const ioj_header_t header = make_header(src_st);
+	if(fd == -1 || write_all(fd, &header, sizeof(header)) != 0)
+	{
+		if(fd != -1)
+		{
+			close(fd);
+			(void)unlink(path);
+		}
+		free(path);
+		return NULL;
+	}
+
+	return alloc_journal(path, fd, /*chunk=*/0U);
+}
+
+iojournal_t *
+iojournal_resume(const char dst[], int dst_fd, int src_fd,
+		const struct stat *src_st, const io_cancellation_t *cancellation,
+		uint64_t *offset)
+{
+	*offset = 0U;
+
+	char *const path = format_str("%s%s", dst, JOURNAL_SUFFIX);
+	if(path == NULL)
+	{
+		return NULL;
+	}
+
+	const int fd = open(path, O_RDWR);
+	if(fd == -1)
+	{
+		free(path);
+		return iojournal_start(dst, src_st);
+	}
+
+	struct stat st;
+	if(!is_journaled(src_st) || !header_matches(fd, src_st) ||
+			fstat(fd, &st) != 0)
+	{
+		close(fd);
+		(void)unlink(path);
+		free(path);
+		return iojournal_start(dst, src_st);
+	}
+
+	const uint64_t nrecords = (st.st_size - sizeof(ioj_header_t))/8U;
+	uint64_t *const chunks = reallocarray(NULL, nrecords, sizeof(*chunks));
+	if(nrecords != 0U && (chunks == NULL ||
+			pread(fd, chunks, nrecords*8U, sizeof(ioj_header_t)) !=
+				(ssize_t)(nrecords*8U)))
+	{
+		free(chunks);
+		close(fd);
+		free(path);
+		return iojournal_start(dst, src_st);
+	}
+
+	/* The prefix of the destination is only as good as the first chunk which
+	 * doesn't match. */
+	uint64_t nmatched = 0U;
+	while(nmatched < nrecords && chunks[nmatched] == nmatched &&
+			!cancelled(cancellation) && chunk_matches(dst_fd, src_fd, nmatched))
+	{
+		++nmatched;
+	}
+	free(chunks);
+
+	const off_t size = sizeof(ioj_header_t) + nmatched*8U;
+	if(ftruncate(fd, size) != 0 || lseek(fd, size, SEEK_SET) != size)
+	{
+		close(fd);
+		(void)unlink(path);
+		free(path);
+		return iojournal_start(dst, src_st);
+	}
+
+	iojournal_t *const journal = alloc_journal(path, fd, nmatched);
+	if(journal != NULL)
+	{
+		*offset = nmatched*(uint64_t)CHUNK_SIZE;
+	}
+	return journal;
+}
+
+int
+iojournal_exists(const char dst[], const struct stat *src_st)
+{
+	if(!is_journaled(src_st))
+	{
+		return 0;
+	}
+
+	char *const path = format_str("%s%s", dst, JOURNAL_SUFFIX);
+	if(path == NULL)
+	{
+		return 0;
+	}
+
+	const int fd = open(path, O_RDONLY);
+	free(path);
+	if(fd == -1)
+	{
+		return 0;
+	}
+
+	struct stat st;
+	const int exists = header_matches(fd, src_st)
+	                && fstat(fd, &st) == 0
+	                && (uint64_t)st.st_size >= sizeof(ioj_header_t) + 8U;
+	close(fd);
+	return exists;
+}
+
+void
+iojournal_advance(iojournal_t *journal, size_t len)
+{
+	if(journal == NULL || journal->fd == -1)
+	{
+		return;
+	}
+
+	journal->fill += len;
+	while(journal->fill >= CHUNK_SIZE)
+	{
+		if(write_all(journal->fd, &journal->chunk, sizeof(journal->chunk)) != 0)
+		{
+			/* Stop journaling, what was recorded is still correct. */
+			close(journal->fd);
+			journal->fd = -1;
+			return;
+		}
+
+		++journal->chunk;
+		journal->fill -= CHUNK_SIZE;
+	}
+}
+
+void
+iojournal_finish(iojournal_t *journal, int succeeded)
+{
+	if(journal == NULL)
+	{
+		return;
+	}
+
+	if(journal->fd != -1)
+	{
+		close(journal->fd);
+	}
+	if(succeeded)
+	{
+		(void)unlink(journal->path);
+	}
+
+	free(journal->path);
+	free(journal);
+}
+
+/* Allocates journal structure taking ownership of path and the file
+ * descriptor.  The chunk is index of the first chunk to be recorded.  Returns
+ * the journal or NULL on error. */
+static iojournal_t *
+alloc_journal(const char path[], int fd, uint64_t chunk)
+{
+	iojournal_t *const journal = malloc(sizeof(*journal));
+	if(journal == NULL)
+	{
+		close(fd);
+		free((char *)path);
+		return NULL;
+	}
+
+	journal->path = (char *)path;
+	journal->fd = fd;
+	journal->chunk = chunk;
+	journal->fill = 0U;
+	return journal;
+}
+
+/* Makes header of a journal for the source file.  Returns the header. */
+static ioj_header_t
+make_header(const struct stat *src_st)
+{
+	ioj_header_t header = {
+		.magic = "VIFMCPJ",
+		.version = IOJ_VERSION,
+		.byte_order = IOJ_BYTE_ORDER,
+		.chunk_size = CHUNK_SIZE,
+		.size = src_st->st_size,
+		.mtime = src_st->st_mtime,
+		.inode = src_st->st_ino,
+		.dev = src_st->st_dev,
+	};
+	return header;
+}
+
+/* Checks whether copying of the file is worth journaling.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+is_journaled(const struct stat *src_st)
+{
+	return S_ISREG(src_st->st_mode) && src_st->st_size >= MIN_FILE_SIZE;
+}
+
+/* Checks whether journal was written for the same state of the source.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+header_matches(int fd, const struct stat *src_st)
+{
+	ioj_header_t header;
+	if(pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+	{
+		return 0;
+	}
+
+	const ioj_header_t expected = make_header(src_st);
+	return memcmp(&header, &expected, sizeof(header)) == 0;
+}
+
+/* Checks whether chunk of the destination at the index has the same contents
+ * as in the source.  Returns non-zero if so, otherwise zero is returned. */
+static int
+chunk_matches(int dst_fd, int src_fd, uint64_t index)
+{
+	char dst_block[READ_SIZE];
+	char src_block[READ_SIZE];
+	off_t offset = index*(uint64_t)CHUNK_SIZE;
+	size_t left = CHUNK_SIZE;
+	while(left != 0U)
+	{
+		const size_t len = (left < sizeof(dst_block) ? left : sizeof(dst_block));
+		if(read_block(dst_fd, dst_block, len, offset) != 0 ||
+				read_block(src_fd, src_block, len, offset) != 0 ||
+				memcmp(dst_block, src_block, len) != 0)
+		{
+			return 0;
+		}
+
+		offset += len;
+		left -= len;
+	}
+	return 1;
+}
+
+/* Reads exactly len bytes of a file at the offset.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+read_block(int fd, char block[], size_t len, off_t offset)
+{
+	while(len != 0U)
+	{
+		const ssize_t n = pread(fd, block, len, offset);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			return 1;
+		}
+		block += n;
+		offset += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* Writes data to a file descriptor retrying on interrupts and partial writes.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+write_all(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+	while(len != 0U)
+	{
+		const ssize_t n = write(fd, p, len);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			return 1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+#else
+
+iojournal_t *
+iojournal_start(const char dst[], const struct stat *src_st)
+{
+	return NULL;
+}
+
+iojournal_t *
+iojournal_resume(const char dst[], int dst_fd, int src_fd,
+		const struct stat *src_st, const io_cancellation_t *cancellation,
+		uint64_t *offset)
+{
+	*offset = 0U;
+	return NULL;
+}
+
+int
+iojournal_exists(const char dst[], const struct stat *src_st)
+{
+	return 0;
+}
+
+void
+iojournal_advance(iojournal_t *journal, size_t len)
+{
+}
+
+void
+iojournal_finish(iojournal_t *journal, int succeeded)
+{
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -0,0 +1,67 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__IOJOURNAL_H__
+#define VIFM__IO__PRIVATE__IOJOURNAL_H__
+
+#include <sys/stat.h> /* stat */
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "../ioc.h"
+
+/* Journal of copying a large file.  It's kept next to the destination while
+ * copying is in progress and lists chunks of data written to the destination,
+ * which allows reusing what was copied by an interrupted operation.  Nothing
+ * is read to maintain the journal, chunks are verified against the source only
+ * on resuming.  Journal is removed once copying succeeds. */
+
+/* Opaque declaration of the journal type. */
+typedef struct iojournal_t iojournal_t;
+
+/* Starts a new journal for copying a file of the specified state to dst,
+ * replacing any existing one.  Returns NULL for files that are too small to be
+ * journaled or on error. */
+iojournal_t * iojournal_start(const char dst[], const struct stat *src_st);
+
+/* Compares chunks of dst listed in its journal that was written for a file of
+ * the specified state with the source and continues the journal after the
+ * last matching chunk (starts a new one if nothing matches).  *offset is set to
+ * the size of the verified prefix of the destination.  Returns NULL for files
+ * that are too small to be journaled or on error. */
+iojournal_t * iojournal_resume(const char dst[], int dst_fd, int src_fd,
+		const struct stat *src_st, const io_cancellation_t *cancellation,
+		uint64_t *offset);
+
+/* Checks whether there is a journal for dst that was written for a file of the
+ * specified state.  Returns non-zero if so, otherwise zero is returned. */
+int iojournal_exists(const char dst[], const struct stat *src_st);
+
+/* Accounts len bytes that were appended to the destination.  Journal can be
+ * NULL. */
+void iojournal_advance(iojournal_t *journal, size_t len);
+
+/* Closes the journal and removes its file if copying has succeeded, otherwise
+ * the file is kept for resuming the copying.  Journal can be NULL. */
+void iojournal_finish(iojournal_t *journal, int succeeded);
+
+#endif /* VIFM__IO__PRIVATE__IOJOURNAL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
@@ -51,9 +51,11 @@ static const char *const fsop_names[] = {
 	[OP_COPY]     = "copy",
 	[OP_COPYF]    = "copy",
 	[OP_COPYA]    = "copy",
+	[OP_COPYR]    = "copy",
 	[OP_MOVE]     = "move",
 	[OP_MOVEF]    = "move",
 	[OP_MOVEA]    = "move",
+	[OP_MOVER]    = "move",
 	[OP_MOVETMP1] = "move",
 	[OP_MOVETMP2] = "move",
 	[OP_MOVETMP3] = "move",
@@ -64,6 +64,8 @@ vifmentry_init(lua_State *lua)
 void
 vifmentry_new(lua_State *lua, const dir_entry_t *entry)
 {
+	fentry_load_metadata(entry, FMD_ALL);
+
 	lua_createtable(lua, /*narr=*/0, /*nrec=*/16); /* entry */
 
 	lua_pushstring(lua, entry->name);
@@ -75,13 +75,15 @@ static int indexes[] = {
 	[SK_BY_INODE]         = 13,
 #endif
 	[SK_BY_SIZE]          = 14 + CORRECTION,
-	[SK_BY_NITEMS]        = 15 + CORRECTION,
-	[SK_BY_GROUPS]        = 16 + CORRECTION,
-	[SK_BY_TARGET]        = 17 + CORRECTION,
-	[SK_BY_TIME_ACCESSED] = 18 + CORRECTION,
-	[SK_BY_TIME_CHANGED]  = 19 + CORRECTION,
-	[SK_BY_TIME_MODIFIED] = 20 + CORRECTION,
-	[SK_BY_RATING]        = 21 + CORRECTION,  //add by sim1
+	[SK_BY_USIZE]         = 15 + CORRECTION,
+	[SK_BY_ASIZE]         = 16 + CORRECTION,
+	[SK_BY_NITEMS]        = 17 + CORRECTION,
+	[SK_BY_GROUPS]        = 18 + CORRECTION,
+	[SK_BY_TARGET]        = 19 + CORRECTION,
+	[SK_BY_TIME_ACCESSED] = 20 + CORRECTION,
+	[SK_BY_TIME_CHANGED]  = 21 + CORRECTION,
+	[SK_BY_TIME_MODIFIED] = 22 + CORRECTION,
+	[SK_BY_RATING]        = 23 + CORRECTION,  //add by sim1
 };
 ARRAY_GUARD(indexes, 1 + SK_COUNT);
 
@@ -111,6 +113,8 @@ static void cmd_L(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_I(key_info_t key_info, keys_info_t *keys_info);
 #endif
 static void cmd_s(key_info_t key_info, keys_info_t *keys_info);
+static void cmd_U(key_info_t key_info, keys_info_t *keys_info);
+static void cmd_A(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_i(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_u(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_T(key_info_t key_info, keys_info_t *keys_info);
@@ -155,6 +159,8 @@ static keys_add_info_t builtin_cmds[] = {
 	{WK_I,      {{&cmd_I},      .descr = "sort by inode number"}},
 #endif
 	{WK_s,      {{&cmd_s},      .descr = "sort by size"}},
+	{WK_U,      {{&cmd_U},      .descr = "sort by size with unique hard-links"}},
+	{WK_A,      {{&cmd_A},      .descr = "sort by allocated size"}},
 	{WK_i,      {{&cmd_i},      .descr = "sort by number of files in directory"}},
 	{WK_u,      {{&cmd_u},      .descr = "sort by 'sortgroups' match"}},
 	{WK_T,      {{&cmd_T},      .descr = "sort by symbolic link target"}},
@@ -251,6 +257,8 @@ redraw_sort_dialog(void)
 	mvwaddstr(sort_win, cy++, 2, " [   ] I Inode");
 #endif
 	mvwaddstr(sort_win, cy++, 2, " [   ] s Size");
+	mvwaddstr(sort_win, cy++, 2, " [   ] U Unique Size");
+	mvwaddstr(sort_win, cy++, 2, " [   ] A Allocated Size");
 	mvwaddstr(sort_win, cy++, 2, " [   ] i Item Count");
 	mvwaddstr(sort_win, cy++, 2, " [   ] u Groups");
 	mvwaddstr(sort_win, cy++, 2, " [   ] T Link Target");
@@ -468,6 +476,20 @@ cmd_s(key_info_t key_info, keys_info_t *keys_info)
 	cmd_return(key_info, keys_info);
 }
 
+static void
+cmd_U(key_info_t key_info, keys_info_t *keys_info)
+{
+	goto_line(top + indexes[SK_BY_USIZE]);
+	cmd_return(key_info, keys_info);
+}
+
+static void
+cmd_A(key_info_t key_info, keys_info_t *keys_info)
+{
+	goto_line(top + indexes[SK_BY_ASIZE]);
+	cmd_return(key_info, keys_info);
+}
+
 static void
 cmd_i(key_info_t key_info, keys_info_t *keys_info)
 {
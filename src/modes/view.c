@@ -25,7 +25,7 @@
 
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MAX */
-#include <stddef.h> /* ptrdiff_t size_t */
+#include <stddef.h> /* size_t */
 #include <string.h> /* memset() strdup() */
 #include <stdio.h>  /* snprintf() */
 #include <stdlib.h> /* free() */
@@ -47,6 +47,7 @@
 #include "../ui/ui.h"
 #include "../utils/filemon.h"
 #include "../utils/fs.h"
+#include "../utils/fswatch.h"
 #include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/regexp.h"
@@ -57,15 +58,21 @@
 #include "../utils/utils.h"
 #include "../filelist.h"
 #include "../filetype.h"
+#include "../pager.h"
 #include "../running.h"
 #include "../status.h"
 #include "../types.h"
 #include "../vcache.h"
+#include "../vsearch.h"
 #include "cmdline.h"
 #include "modes.h"
 #include "normal.h"
 #include "wk.h"
 
+/* Files of at least this size are viewed via pager instead of being read in
+ * full. */
+#define PAGER_MIN_SIZE (4*1024*1024)
+
 /* Named boolean values of "silent" parameter for better readability. */
 enum
 {
@@ -78,6 +85,8 @@ struct modview_info_t
 {
 	/* Data of the view. */
 	char **lines;     /* List of real lines (owned by vcache unit). */
+	pager_t *pager;   /* Source of real lines of a large file instead of lines. */
+	int partial;      /* Whether pager is still indexing the file. */
 	int (*widths)[2]; /* (virtual line, screen width) pair per real line. */
 	int nlines;       /* Number of real lines. */
 	int nlinesv;      /* Number of virtual (possibly wrapped) lines. */
@@ -91,12 +100,19 @@ struct modview_info_t
 
 	/* Monitoring of changes for automatic forwarding. */
 	int auto_forward;   /* Whether auto forwarding (tail -F) is enabled. */
-	filemon_t file_mon; /* File monitor for auto forwarding mode. */
+	fswatch_t *watch;   /* Watcher of the file for auto forwarding mode. */
+	filemon_t file_mon; /* File monitor for when the file can't be watched. */
 
 	/* Related to search. */
 	regex_t re;               /* Search regular expression. */
+	char *pattern;            /* Source of the regular expression. */
+	int cflags;               /* Flags used to compile the expression. */
+	vsearch_t *search;        /* Index of matching lines or NULL. */
 	int last_search_backward; /* Value -1 means no search was performed. */
 	int search_repeat;        /* Saved count prefix of search commands. */
+	int search_pending;       /* Number of search steps waiting for scanning. */
+	int pending_backward;     /* Direction of pending search steps. */
+	int pending_linev;        /* Position at which search steps were delayed. */
 
 	/* Viewers. */
 	strlist_t viewers;       /* List of viewers of current file. */
@@ -130,10 +146,11 @@ static void init_view_info(modview_info_t *vi);
 static void free_view_info(modview_info_t *vi);
 static void redraw(void);
 static void calc_vlines(void);
-static void calc_vlines_wrapped(modview_info_t *vi);
-static void calc_vlines_non_wrapped(modview_info_t *vi);
+static void calc_vlines_wrapped(modview_info_t *vi, int from);
+static void fetch_pager_widths(modview_info_t *vi, int from);
+static void calc_vlines_non_wrapped(modview_info_t *vi, int from);
 static void draw(void);
-static int get_part(const char line[], int offset, size_t max_len, char part[]);
+static const char * get_line(modview_info_t *vi, int line);
 static void display_error(const char error_msg[]);
 static void cmd_ctrl_l(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_ctrl_wH(key_info_t key_info, keys_info_t *keys_info);
@@ -188,7 +205,8 @@ static void cmd_j(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_k(key_info_t key_info, keys_info_t *keys_info);
 static void cmd_n(key_info_t key_info, keys_info_t *keys_info);
 static void goto_search_result(int repeat_count, int inverse_direction);
-static void search(int repeat_count, int backward);
+static int search(int repeat_count, int backward);
+static int start_scanning(int backward);
 static int find_previous(void);
 static int find_next(void);
 static void cmd_q(key_info_t key_info, keys_info_t *keys_info);
@@ -201,7 +219,11 @@ static void cmd_z(key_info_t key_info, keys_info_t *keys_info);
 static void update_with_win(key_info_t *key_info);
 static int is_trying_the_same_file(void);
 static int get_file_to_explore(const view_t *view, char buf[], size_t buf_len);
+static int sync_with_pager(modview_info_t *vi);
+static int resume_search(void);
 static int forward_if_changed(modview_info_t *vi);
+static FSWatchState poll_file(modview_info_t *vi);
+static int append_from_pager(modview_info_t *vi);
 static int scroll_to_bottom(modview_info_t *vi);
 static void reload_view(modview_info_t *vi, int silent);
 static void cleanup(modview_info_t *vi);
@@ -593,11 +615,15 @@ static void
 free_view_info(modview_info_t *vi)
 {
 	free_string_array(vi->viewers.items, vi->viewers.nitems);
+	pager_close(vi->pager);
 	free(vi->widths);
 	if(vi->last_search_backward != -1)
 	{
 		regfree(&vi->re);
 	}
+	vsearch_free(vi->search);
+	free(vi->pattern);
+	fswatch_free(vi->watch);
 	free(vi->filename);
 	free(vi->ext_viewer);
 }
@@ -624,38 +650,76 @@ calc_vlines(void)
 	vi->width = ui_qv_width(vi->view);
 	vi->wrap = cfg.wrap_quick_view;
 
+	/* Index of matches depends on how lines are broken. */
+	vsearch_free(vi->search);
+	vi->search = NULL;
+
 	if(vi->wrap)
 	{
-		calc_vlines_wrapped(vi);
+		calc_vlines_wrapped(vi, 0);
 	}
 	else
 	{
-		calc_vlines_non_wrapped(vi);
+		calc_vlines_non_wrapped(vi, 0);
 	}
 }
 
-/* Recalculates virtual lines of a view with line wrapping. */
+/* Recalculates virtual lines of a view with line wrapping starting at the
+ * specified real line.  Lines before it must be already processed. */
 static void
-calc_vlines_wrapped(modview_info_t *vi)
+calc_vlines_wrapped(modview_info_t *vi, int from)
 {
+	if(from == 0)
+	{
+		vi->nlinesv = 0;
+	}
+
+	if(vi->pager != NULL)
+	{
+		fetch_pager_widths(vi, from);
+	}
+
 	int i;
-	vi->nlinesv = 0;
-	for(i = 0; i < vi->nlines; i++)
+	for(i = from; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = vi->nlinesv++;
-		vi->widths[i][1] = utf8_strsw_with_tabs(vi->lines[i], cfg.tab_stop) -
-			esc_str_overhead(vi->lines[i]);
+		if(vi->pager == NULL)
+		{
+			vi->widths[i][1] = utf8_strsw_with_tabs(vi->lines[i], cfg.tab_stop) -
+				esc_str_overhead(vi->lines[i]);
+		}
 		vi->nlinesv += vi->widths[i][1]/vi->width;
 	}
 }
 
-/* Recalculates virtual lines of a view without line wrapping. */
+/* Copies widths of lines starting at the specified one, which were computed by
+ * the pager. */
+static void
+fetch_pager_widths(modview_info_t *vi, int from)
+{
+	int widths[1024];
+	while(from < vi->nlines)
+	{
+		const int count = MIN(vi->nlines - from, (int)ARRAY_LEN(widths));
+		pager_get_widths(vi->pager, from, count, widths);
+
+		int i;
+		for(i = 0; i < count; ++i)
+		{
+			vi->widths[from + i][1] = widths[i];
+		}
+		from += count;
+	}
+}
+
+/* Recalculates virtual lines of a view without line wrapping starting at the
+ * specified real line. */
 static void
-calc_vlines_non_wrapped(modview_info_t *vi)
+calc_vlines_non_wrapped(modview_info_t *vi, int from)
 {
 	int i;
 	vi->nlinesv = vi->nlines;
-	for(i = 0; i < vi->nlines; i++)
+	for(i = from; i < vi->nlines; i++)
 	{
 		vi->widths[i][0] = i;
 		vi->widths[i][1] = vi->width;
@@ -700,8 +764,11 @@ draw(void)
 	{
 		int offset = 0;
 		int processed = 0;
-		char *const line = vi->lines[l];
-		char *p = searched ? esc_highlight_pattern(line, &vi->re) : line;
+		const char *const line = get_line(vi, l);
+		char *const highlighted = searched
+		                        ? esc_highlight_pattern(line, &vi->re)
+		                        : NULL;
+		const char *const p = (searched ? highlighted : line);
 		do
 		{
 			int printed;
@@ -713,16 +780,27 @@ draw(void)
 			++processed;
 		}
 		while(vi->wrap && p[offset] != '\0' && vl < height);
-		if(searched)
-		{
-			free(p);
-		}
+		free(highlighted);
 	}
 	refresh_view_win(vi->view);
 
 	checked_wmove(vi->view->win, ui_qv_top(vi->view), ui_qv_left(vi->view));
 }
 
+/* Retrieves real line of the view.  Returns pointer to the line, which is valid
+ * until the next call. */
+static const char *
+get_line(modview_info_t *vi, int line)
+{
+	if(vi->pager == NULL)
+	{
+		return vi->lines[line];
+	}
+
+	const char *const text = pager_get_line(vi->pager, line);
+	return (text == NULL ? "" : text);
+}
+
 int
 modview_find(const char pattern[], int backward)
 {
@@ -734,7 +812,13 @@ modview_find(const char pattern[], int backward)
 	if(vi->last_search_backward != -1)
 		regfree(&vi->re);
 	vi->last_search_backward = -1;
-	if((err = regexp_compile(&vi->re, pattern, get_regexp_cflags(pattern))) != 0)
+
+	vsearch_free(vi->search);
+	vi->search = NULL;
+	(void)replace_string(&vi->pattern, pattern);
+	vi->cflags = get_regexp_cflags(pattern);
+
+	if((err = regexp_compile(&vi->re, pattern, vi->cflags)) != 0)
 	{
 		ui_sb_errf("Invalid pattern: %s", get_regexp_error(err, &vi->re));
 		regfree(&vi->re);
@@ -1032,12 +1116,22 @@ static void
 cmd_F(key_info_t key_info, keys_info_t *keys_info)
 {
 	vi->auto_forward = !vi->auto_forward;
+
+	fswatch_free(vi->watch);
+	vi->watch = NULL;
+
 	if(vi->auto_forward)
 	{
-		if(forward_if_changed(vi) || scroll_to_bottom(vi))
+		/* Start following the file from its current state. */
+		vi->watch = fswatch_create(vi->filename);
+		if(filemon_from_file(vi->filename, FMT_MODIFIED, &vi->file_mon) != 0)
 		{
-			draw();
+			filemon_reset(&vi->file_mon);
 		}
+
+		reload_view(vi, SILENT);
+		(void)scroll_to_bottom(vi);
+		draw();
 	}
 }
 
@@ -1119,6 +1213,8 @@ load_view_data(modview_info_t *vi, const char action[],
 		vi->widths = reallocarray(NULL, vi->nlines, sizeof(*vi->widths));
 		if(vi->widths == NULL)
 		{
+			pager_close(vi->pager);
+			vi->pager = NULL;
 			vi->lines = NULL;
 			vi->nlines = 0;
 			show_error_msg(action, "Not enough memory");
@@ -1150,11 +1246,29 @@ get_view_data(modview_info_t *vi, const char file_to_view[])
 	};
 	curr_stats.preview_hint = &parea;
 
-	const char *error;
+	const char *error = NULL;
 	const char *viewer = (vi->raw ? NULL : vi->curr_viewer);
 
-	strlist_t lines;
-	if(vi->curr_viewer == vi->ext_viewer)
+	pager_close(vi->pager);
+	vi->pager = NULL;
+	vi->partial = 0;
+
+	/* Reading large files in full takes a lot of time and memory, while
+	 * following a file is cheaper if appended lines are just indexed. */
+	if(viewer == NULL && kind == VK_TEXTUAL && (vi->auto_forward ||
+			get_target_file_size(file_to_view) >= PAGER_MIN_SIZE))
+	{
+		vi->pager = pager_open(file_to_view, cfg.tab_stop);
+	}
+
+	strlist_t lines = {};
+	if(vi->pager != NULL)
+	{
+		int complete;
+		lines.nitems = pager_get_count(vi->pager, &complete);
+		vi->partial = !complete;
+	}
+	else if(vi->curr_viewer == vi->ext_viewer)
 	{
 		/* No macros in this viewer. */
 		lines = vcache_lookup(file_to_view, vi->ext_viewer, vi->flags, kind,
@@ -1222,15 +1336,23 @@ replace_vi(modview_info_t *orig, modview_info_t *new)
 	{
 		new->last_search_backward = orig->last_search_backward;
 		new->re = orig->re;
+		new->pattern = orig->pattern;
+		new->cflags = orig->cflags;
 		orig->last_search_backward = -1;
+		orig->pattern = NULL;
 	}
 
 	new->win_size = orig->win_size;
 	new->half_win = orig->half_win;
-	new->line = orig->line;
-	new->linev = orig->linev;
+	if(orig->line < new->nlines)
+	{
+		new->line = orig->line;
+		new->linev = orig->linev;
+	}
 	new->view = orig->view;
 	new->auto_forward = orig->auto_forward;
+	new->watch = orig->watch;
+	orig->watch = NULL;
 	new->file_mon = orig->file_mon;
 
 	free_view_info(orig);
@@ -1422,13 +1544,15 @@ goto_search_result(int repeat_count, int inverse_direction)
 	search(repeat_count, backward);
 }
 
-/* Performs search and navigation to the first match. */
-static void
+/* Performs search and navigation to the first match.  Returns zero on success,
+ * positive number if pattern wasn't found and negative number if search will
+ * continue after more lines are scanned. */
+static int
 search(int repeat_count, int backward)
 {
 	if(vi->last_search_backward == -1)
 	{
-		return;
+		return 1;
 	}
 
 	if(repeat_count == NO_COUNT_GIVEN)
@@ -1436,17 +1560,55 @@ search(int repeat_count, int backward)
 		repeat_count = 1;
 	}
 
-	while(repeat_count-- > 0)
+	vi->search_pending = 0;
+
+	if(start_scanning(backward) != 0)
+	{
+		draw();
+		display_error("Failed to start search");
+		return 1;
+	}
+
+	while(repeat_count > 0)
 	{
-		if(backward ? find_previous() : find_next())
+		const int result = (backward ? find_previous() : find_next());
+		if(result < 0)
 		{
-			break;
+			vi->search_pending = repeat_count;
+			vi->pending_backward = backward;
+			vi->pending_linev = vi->linev;
+
+			draw();
+			ui_sb_msg("Searching...");
+			curr_stats.save_msg = 1;
+		}
+		if(result != 0)
+		{
+			return result;
 		}
+		--repeat_count;
 	}
+	return 0;
+}
+
+/* Makes sure that index of matches is available and corresponds to current
+ * layout of lines.  Returns zero on success, otherwise non-zero is returned. */
+static int
+start_scanning(int backward)
+{
+	calc_vlines();
+
+	if(vi->search == NULL && vi->pattern != NULL)
+	{
+		vi->search = vsearch_start(vi->pattern, vi->cflags, vi->pager, vi->lines,
+				vi->nlines, vi->width, vi->wrap, cfg.tab_stop, vi->line, backward);
+	}
+	return (vi->search == NULL);
 }
 
-/* Scrolls to the previous search match.  Returns zero on success and non-zero
- * if pattern wasn't found.  Prints a message on search failure. */
+/* Scrolls to the previous search match.  Returns zero on success, positive
+ * number if pattern wasn't found and negative number if lines that might
+ * contain the match aren't scanned yet.  Prints a message on search failure. */
 static int
 find_previous(void)
 {
@@ -1457,124 +1619,76 @@ find_previous(void)
 		return 1;
 	}
 
-	char buf[ui_qv_width(vi->view)*4];
-
-	int vl = vi->linev - 1;
 	int l = vi->line;
-
-	if(l > 0 && vl < vi->widths[l][0])
-	{
-		--l;
-	}
-
-	int i;
-	int offset = 0;
-	for(i = 0; l < vi->nlines && i <= vl - vi->widths[l][0]; ++i)
+	const int from = vi->linev - vi->widths[l][0] - 1;
+	int part = -1;
+	if(from >= 0)
 	{
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+		part = vsearch_match_part(vi->search, get_line(vi, l), from, 1);
 	}
 
-	/* Don't stop until we go above first virtual line of the first line. */
-	while(l >= 0 && vl >= 0)
+	while(part == -1)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
+		const VSearchResult result = vsearch_find(vi->search, l, 1, vi->nlines,
+				&l);
+		if(result == VSR_PENDING)
 		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
+			return -1;
 		}
-		if(l > 0 && vl - 1 < vi->widths[l][0])
+		if(result == VSR_NOT_FOUND)
 		{
-			--l;
-			offset = 0;
-			for(i = 0; i <= vl - 1 - vi->widths[l][0]; i++)
-				offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+			draw();
+			display_error("Pattern not found");
+			return 1;
 		}
-		else
-			offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
-		--vl;
+
+		part = vsearch_match_part(vi->search, get_line(vi, l), INT_MAX, 1);
 	}
 
+	vi->line = l;
+	vi->linev = vi->widths[l][0] + part;
 	draw();
-
-	if(vi->linev != vl || vi->nlines == 0)
-	{
-		display_error("Pattern not found");
-		return 1;
-	}
 	return 0;
 }
 
-/* Scrolls to the next search match.  Returns zero on success and non-zero if
- * pattern wasn't found.  Prints a message on search failure. */
+/* Scrolls to the next search match.  Returns zero on success, positive number
+ * if pattern wasn't found and negative number if lines that might contain the
+ * match aren't scanned yet.  Prints a message on search failure. */
 static int
 find_next(void)
 {
-	char buf[ui_qv_width(vi->view)*4];
-
-	int vl = vi->linev + 1;
 	int l = vi->line;
-
-	if(l < vi->nlines - 1 && vl == vi->widths[l + 1][0])
-	{
-		++l;
-	}
-
-	int i;
-	int offset = 0;
-	for(i = 0; l < vi->nlines && i <= vl - vi->widths[l][0]; ++i)
+	int part = -1;
+	if(vi->nlines != 0)
 	{
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
+		part = vsearch_match_part(vi->search, get_line(vi, l),
+				vi->linev - vi->widths[l][0] + 1, 0);
 	}
 
-	while(l < vi->nlines)
+	while(part == -1)
 	{
-		if(regexec(&vi->re, buf, 0, NULL, 0) == 0)
+		const VSearchResult result = vsearch_find(vi->search, l, 0, vi->nlines,
+				&l);
+		if(result == VSR_PENDING)
 		{
-			vi->linev = vl;
-			vi->line = l;
-			break;
+			return -1;
 		}
-		if(l == vi->nlines - 1)
+		if(result == VSR_NOT_FOUND)
 		{
-			break;
+			draw();
+			display_error("Pattern not found");
+			return 1;
 		}
 
-		if(vl + 1 >= vi->widths[l + 1][0])
-		{
-			++l;
-			offset = 0;
-		}
-		offset = get_part(vi->lines[l], offset, ui_qv_width(vi->view), buf);
-		++vl;
+		part = vsearch_match_part(vi->search, get_line(vi, l), 0, 0);
 	}
 
+	vi->line = l;
+	vi->linev = vi->widths[l][0] + part;
 	draw();
-
-	if(vi->linev != vl || vi->nlines == 0)
-	{
-		display_error("Pattern not found");
-		return 1;
-	}
 	return 0;
 }
 
-/* Extracts part of the line replacing all occurrences of horizontal tabulation
- * character with appropriate number of spaces.  The offset specifies beginning
- * of the part in the line.  The max_len parameter designates the maximum number
- * of screen characters to put into the part.  Returns number of processed items
- * of the line. */
-static int
-get_part(const char line[], int offset, size_t max_len, char part[])
-{
-	char *const no_esc = esc_remove(line);
-	const char *const begin = no_esc + offset;
-	const char *const end = expand_tabulation(begin, max_len, cfg.tab_stop, part);
-	const ptrdiff_t processed_chars = end - no_esc;
-	free(no_esc);
-	return processed_chars;
-}
-
 /* Displays the error message in the status bar. */
 static void
 display_error(const char error_msg[])
@@ -1799,43 +1913,188 @@ modview_check_for_updates(void)
 {
 	int need_redraw = 0;
 
+	need_redraw += sync_with_pager(curr_stats.preview.explore);
+	need_redraw += sync_with_pager(lwin.vi);
+	need_redraw += sync_with_pager(rwin.vi);
+
 	need_redraw += forward_if_changed(curr_stats.preview.explore);
 	need_redraw += forward_if_changed(lwin.vi);
 	need_redraw += forward_if_changed(rwin.vi);
 
+	need_redraw += resume_search();
+
 	if(need_redraw)
 	{
 		stats_redraw_later();
 	}
 }
 
-/* Forwards the view if underlying file changed.  Returns non-zero if reload
- * occurred, otherwise zero is returned. */
+/* Picks up lines that were indexed by the pager since the last call.  Returns
+ * non-zero if the view has changed, otherwise zero is returned. */
 static int
-forward_if_changed(modview_info_t *vi)
+sync_with_pager(modview_info_t *vi)
 {
-	filemon_t mon;
+	if(vi == NULL || vi->pager == NULL || !vi->partial)
+	{
+		return 0;
+	}
 
-	if(vi == NULL || !vi->auto_forward)
+	int complete;
+	const int nlines = pager_get_count(vi->pager, &complete);
+	if(nlines != vi->nlines)
+	{
+		int (*widths)[2] = reallocarray(vi->widths, nlines, sizeof(*widths));
+		if(widths == NULL)
+		{
+			return 0;
+		}
+
+		const int from = vi->nlines;
+		vi->widths = widths;
+		vi->nlines = nlines;
+
+		/* Otherwise virtual lines will be computed on the next redraw. */
+		if(vi->width > 0)
+		{
+			if(vi->wrap)
+			{
+				calc_vlines_wrapped(vi, from);
+			}
+			else
+			{
+				calc_vlines_non_wrapped(vi, from);
+			}
+
+			if(vi->auto_forward)
+			{
+				(void)scroll_to_bottom(vi);
+			}
+		}
+	}
+
+	vi->partial = !complete;
+	return 1;
+}
+
+/* Continues search that waits for more lines to be scanned unless position in
+ * the view has changed since then.  Returns non-zero if the search is over,
+ * otherwise zero is returned. */
+static int
+resume_search(void)
+{
+	if(!vle_mode_is(VIEW_MODE) || vi->search_pending == 0)
 	{
 		return 0;
 	}
 
-	if(filemon_from_file(vi->filename, FMT_MODIFIED, &mon) != 0)
+	if(vi->linev != vi->pending_linev)
 	{
+		vi->search_pending = 0;
 		return 0;
 	}
 
-	if(filemon_equal(&mon, &vi->file_mon))
+	const int result = search(vi->search_pending, vi->pending_backward);
+	if(result < 0)
 	{
 		return 0;
 	}
 
-	vi->file_mon = mon;
+	if(result == 0)
+	{
+		curr_stats.save_msg = 0;
+		modview_pre();
+	}
+	return 1;
+}
+
+/* Forwards the view if underlying file changed.  Returns non-zero if the view
+ * has changed, otherwise zero is returned. */
+static int
+forward_if_changed(modview_info_t *vi)
+{
+	if(vi == NULL || !vi->auto_forward)
+	{
+		return 0;
+	}
+
+	switch(poll_file(vi))
+	{
+		case FSWS_UNCHANGED:
+		case FSWS_ERRORED:
+			return 0;
+
+		case FSWS_UPDATED:
+			if(vi->pager != NULL && append_from_pager(vi) == 0)
+			{
+				(void)scroll_to_bottom(vi);
+				return 1;
+			}
+			break;
+
+		case FSWS_REPLACED:
+			break;
+	}
+
 	reload_view(vi, SILENT);
 	return scroll_to_bottom(vi);
 }
 
+/* Checks whether the file has changed using timestamps if the file can't be
+ * watched.  Returns state of the file. */
+static FSWatchState
+poll_file(modview_info_t *vi)
+{
+	if(vi->watch != NULL)
+	{
+		return fswatch_poll(vi->watch);
+	}
+
+	filemon_t mon;
+	if(filemon_from_file(vi->filename, FMT_MODIFIED, &mon) != 0)
+	{
+		return FSWS_ERRORED;
+	}
+
+	if(filemon_equal(&mon, &vi->file_mon))
+	{
+		return FSWS_UNCHANGED;
+	}
+
+	vi->file_mon = mon;
+	return FSWS_UPDATED;
+}
+
+/* Picks up lines appended to the file that's viewed via pager instead of
+ * reloading it.  Returns zero on success and non-zero if the file needs to be
+ * reloaded (e.g., because it was truncated). */
+static int
+append_from_pager(modview_info_t *vi)
+{
+	/* Scanning for matches reads lines from the pager. */
+	vsearch_free(vi->search);
+	vi->search = NULL;
+
+	int first;
+	if(pager_refresh(vi->pager, &first) != 0)
+	{
+		return 1;
+	}
+
+	if(first < vi->nlines)
+	{
+		/* Forget lines that have changed, they will be picked up again. */
+		if(vi->width > 0)
+		{
+			vi->nlinesv = (vi->wrap ? vi->widths[first][0] : first);
+		}
+		vi->nlines = first;
+	}
+
+	vi->partial = 1;
+	(void)sync_with_pager(vi);
+	return 0;
+}
+
 /* Scrolls view to the bottom if there is any room for that.  Returns non-zero
  * if position was changed, otherwise zero is returned. */
 static int
@@ -1872,6 +2131,7 @@ reload_view(modview_info_t *vi, int silent)
 	new_vi.ext_viewer = vi->ext_viewer;
 	new_vi.viewers = vi->viewers;
 	new_vi.raw = vi->raw;
+	new_vi.auto_forward = vi->auto_forward;
 
 	if(load_view_data(&new_vi, "File exploring reload", vi->filename, silent)
 			== 0)
@@ -1998,8 +2258,10 @@ format_ruler(const modview_info_t *vi, char buf[], size_t buf_len)
 	format_position(rel_pos, sizeof(rel_pos), vi->line, vi->nlines,
 			vi->view->window_rows);
 
+	/* Number of lines is going to grow while pager indexes the file. */
 	int curr_line = vi->line + (vi->nlines > 0 ? 1 : 0);
-	snprintf(buf, buf_len, "%d-%d %s", curr_line, vi->nlines, rel_pos);
+	snprintf(buf, buf_len, "%d-%d%s %s", curr_line, vi->nlines,
+			vi->partial ? "+" : "", rel_pos);
 }
 
 TSTATIC int
@@ -25,7 +25,8 @@
 #include "utils/utf8.h"
 #endif
 
-#include <sys/stat.h> /* gid_t uid_t */
+#include <sys/stat.h> /* dev_t gid_t stat uid_t */
+#include <pthread.h> /* PTHREAD_* pthread_* */
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
@@ -47,6 +48,7 @@
 #include "utils/fs.h"
 #include "utils/log.h"
 #include "utils/macros.h"
+#include "utils/parallel.h"
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/utils.h"
@@ -77,6 +79,7 @@ typedef enum
 	CA_FAIL,      /* Fail with an error. */
 	CA_OVERWRITE, /* Overwrite existing files. */
 	CA_APPEND,    /* Append the rest of source file to destination file. */
+	CA_RESUME,    /* Continue terminated copying after its verified part. */
 }
 ConflictAction;
 
@@ -84,6 +87,35 @@ ConflictAction;
 typedef OpsResult (*op_func)(ops_t *ops, void *data, const char src[],
 		const char dst[]);
 
+/* Number of items being processed that involve a device. */
+typedef struct
+{
+	dev_t dev; /* Identifier of the device. */
+	int busy;  /* Number of items. */
+}
+dev_load_t;
+
+/* State of processing a batch of items shared among workers. */
+typedef struct
+{
+	ops_t *ops;                    /* Operation the batch is part of. */
+	ops_t lane_template;           /* Copy of the ops made before workers start
+	                                  to initialize private copies from it. */
+	ops_item_t *items;             /* Items of the batch. */
+	ops_item_started_func started; /* Invoked before processing an item. */
+	void *arg;                     /* Argument for the callback. */
+	int concurrent;                /* Whether items are processed in parallel. */
+
+	pthread_mutex_t lock;  /* Protects fields below and merging into ops. */
+	pthread_cond_t freed;  /* Signaled when load of a device goes down. */
+	int dev_limit;         /* Maximum number of items per device. */
+	dev_load_t *devs;      /* Load of devices seen so far. */
+	int ndevs;             /* Number of elements in devs. */
+
+	pthread_mutex_t progress_lock; /* Serializes updates of ops->estim. */
+}
+batch_t;
+
 static OpsResult op_none(ops_t *ops, void *data, const char src[],
 		const char dst[]);
 static OpsResult op_remove(ops_t *ops, void *data, const char src[],
@@ -96,6 +128,8 @@ static OpsResult op_copyf(ops_t *ops, void *data, const char src[],
 		const char dst[]);
 static OpsResult op_copya(ops_t *ops, void *data, const char src[],
 		const char dst[]);
+static OpsResult op_copyr(ops_t *ops, void *data, const char src[],
+		const char dst[]);
 static OpsResult op_cp(ops_t *ops, void *data, const char src[],
 		const char dst[], ConflictAction conflict_action);
 static OpsResult op_move(ops_t *ops, void *data, const char src[],
@@ -104,6 +138,8 @@ static OpsResult op_movef(ops_t *ops, void *data, const char src[],
 		const char dst[]);
 static OpsResult op_movea(ops_t *ops, void *data, const char src[],
 		const char dst[]);
+static OpsResult op_mover(ops_t *ops, void *data, const char src[],
+		const char dst[]);
 static OpsResult op_mv(ops_t *ops, void *data, const char src[],
 		const char dst[], ConflictAction conflict_action);
 static IoCrs ca_to_crs(ConflictAction conflict_action);
@@ -148,6 +184,15 @@ static OpsResult run_operation_command(ops_t *ops, char cmd[], int cancellable);
 static int ops_runs_in_bg(const ops_t *ops);
 static int bg_cancellation_hook(void *arg);
 static OpsResult result_from_code(int exit_code);
+static int has_nested_items(const ops_item_t items[], int count);
+static int path_sorter(const void *first, const void *second);
+static void process_batch_item(int i, void *arg);
+static int get_item_devs(const ops_item_t *item, dev_t devs[2]);
+static void acquire_devs(batch_t *batch, const dev_t devs[], int ndevs);
+static void release_devs(batch_t *batch, const dev_t devs[], int ndevs);
+static dev_load_t * get_dev_load(batch_t *batch, dev_t dev);
+static void merge_lane(ops_t *ops, ops_t *lane);
+static void copy_rating(const char src[], const char dst[], int op);
 
 //add by sim1
 extern void copy_rating_info(const char src[], const char dst[], int op);
@@ -161,9 +206,11 @@ static op_func op_funcs[] = {
 	[OP_COPY]     = &op_copy,
 	[OP_COPYF]    = &op_copyf,
 	[OP_COPYA]    = &op_copya,
+	[OP_COPYR]    = &op_copyr,
 	[OP_MOVE]     = &op_move,
 	[OP_MOVEF]    = &op_movef,
 	[OP_MOVEA]    = &op_movea,
+	[OP_MOVER]    = &op_mover,
 	[OP_MOVETMP1] = &op_move,
 	[OP_MOVETMP2] = &op_move,
 	[OP_MOVETMP3] = &op_move,
@@ -185,9 +232,12 @@ static op_func op_funcs[] = {
 };
 ARRAY_GUARD(op_funcs, OP_COUNT);
 
-/* Operation that is processed at the moment. */
+/* Foreground operation that is processed at the moment. */
 static ops_t *curr_ops;
 
+/* Serializes accesses to rating information from several threads. */
+static pthread_mutex_t rating_lock = PTHREAD_MUTEX_INITIALIZER;
+
 ops_t *
 ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 		const char target_dir[], ops_choice_func choose, ops_confirm_func confirm)
@@ -203,6 +253,8 @@ ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 	ops->use_system_calls = cfg.use_system_calls;
 	ops->fast_file_cloning = cfg.fast_file_cloning;
 	ops->data_sync = cfg.data_sync;
+	ops->sparse_copying = cfg.sparse_copying;
+	ops->io_workers = cfg.io_workers;
 	ops->shell_type = curr_stats.shell_type;
 
 	ops->choose = choose;
@@ -309,6 +361,13 @@ ops_flags(DataFlags flags)
 	return (void *)(uintptr_t)flags;
 }
 
+int
+ops_can_resume(const ops_t *ops, const char src[], const char dst[])
+{
+	/* Journal of copying is maintained only by builtin implementation. */
+	return ops_uses_syscalls(ops) && iop_can_resume_cp(src, dst);
+}
+
 OpsResult
 perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 		const char dst[])
@@ -337,6 +396,51 @@ perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 	return status;
 }
 
+void
+ops_perform_batch(ops_t *ops, ops_item_t items[], int count,
+		ops_item_started_func started, void *arg)
+{
+	batch_t batch = {
+		.ops = ops,
+		.items = items,
+		.started = started,
+		.arg = arg,
+		.concurrent = ops_runs_in_bg(ops) && ops->use_system_calls
+		           && ops->io_workers > 1 && count > 1
+		           && !has_nested_items(items, count),
+
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.freed = PTHREAD_COND_INITIALIZER,
+		.dev_limit = MAX(1, ops->io_workers/2),
+
+		.progress_lock = PTHREAD_MUTEX_INITIALIZER,
+	};
+
+	if(batch.concurrent)
+	{
+		/* Each item involves at most two devices. */
+		batch.devs = reallocarray(NULL, count*2, sizeof(*batch.devs));
+		batch.concurrent = (batch.devs != NULL);
+	}
+
+	if(batch.concurrent)
+	{
+		/* Workers modify the ops while merging their results, so it can't be
+		 * copied by them without synchronization. */
+		batch.lane_template = *ops;
+		batch.lane_template.errors = NULL;
+		batch.lane_template.aborted = 0;
+	}
+
+	const int nworkers = (batch.concurrent ? ops->io_workers : 1);
+	parallel_for(count, nworkers, &process_batch_item, &batch);
+
+	free(batch.devs);
+	pthread_mutex_destroy(&batch.progress_lock);
+	pthread_cond_destroy(&batch.freed);
+	pthread_mutex_destroy(&batch.lock);
+}
+
 static OpsResult
 op_none(ops_t *ops, void *data, const char src[], const char dst[])
 {
@@ -421,7 +525,7 @@ op_removesl(ops_t *ops, void *data, const char src[], const char dst[])
 		//add by sim1
 		if (OPS_SUCCEEDED == result)
 		{
-			copy_rating_info(src, dst, 0);
+			copy_rating(src, dst, 0);
 		}
 
 		free(escaped);
@@ -462,7 +566,7 @@ op_removesl(ops_t *ops, void *data, const char src[], const char dst[])
 			//add by sim1
 			if (0 == err)
 			{
-				copy_rating_info(src, dst, 0);
+				copy_rating(src, dst, 0);
 			}
 
 			log_msg("Error: %d", err);
@@ -488,7 +592,7 @@ op_removesl(ops_t *ops, void *data, const char src[], const char dst[])
 			//add by sim1
 			if (success)
 			{
-				copy_rating_info(src, dst, 0);
+				copy_rating(src, dst, 0);
 			}
 
 			free(utf16_path);
@@ -505,7 +609,7 @@ op_removesl(ops_t *ops, void *data, const char src[], const char dst[])
   int retval = exec_io_op(ops, &ior_rm, &args, cancellable);
 	if (0 == retval)
 	{
-		copy_rating_info(src, dst, 0);
+		copy_rating(src, dst, 0);
 	}
 
 	return retval;
@@ -535,6 +639,14 @@ op_copya(ops_t *ops, void *data, const char src[], const char dst[])
 	return op_cp(ops, data, src, dst, CA_APPEND);
 }
 
+/* OP_COPYR operation handler.  Copies file continuing terminated copying to the
+ * destination.  Returns status. */
+static OpsResult
+op_copyr(ops_t *ops, void *data, const char src[], const char dst[])
+{
+	return op_cp(ops, data, src, dst, CA_RESUME);
+}
+
 /* Copies file/directory overwriting/appending destination files if requested.
  * Returns status. */
 static OpsResult
@@ -547,6 +659,9 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 	                             ? cfg.fast_file_cloning
 	                             : ops->fast_file_cloning;
 	const int data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync);
+	const int sparse_copying = (ops == NULL)
+	                         ? cfg.sparse_copying
+	                         : ops->sparse_copying;
 
 	if(!ops_uses_syscalls(ops))
 	{
@@ -575,7 +690,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		//add by sim1
 		if (OPS_SUCCEEDED == result)
 		{
-			copy_rating_info(src, dst, 2);
+			copy_rating(src, dst, 2);
 		}
 
 		free(escaped_dst);
@@ -626,7 +741,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		//add by sim1
 		if (0 == ret)
 		{
-			copy_rating_info(src, dst, 2);
+			copy_rating(src, dst, 2);
 		}
 
 		return result_from_code(ret);
@@ -640,6 +755,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg4 = {
 			.fast_file_cloning = fast_file_cloning,
 			.data_sync = data_sync,
+			.sparse_copying = sparse_copying,
 			.deep_copying = deep_copy,
 		},
 	};
@@ -648,7 +764,7 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
   OpsResult retval = exec_io_op(ops, &ior_cp, &args, cancellable);
 	if (OPS_SUCCEEDED == retval)
 	{
-		copy_rating_info(src, dst, 2);
+		copy_rating(src, dst, 2);
 	}
 
 	return retval;
@@ -678,6 +794,14 @@ op_movea(ops_t *ops, void *data, const char src[], const char dst[])
 	return op_mv(ops, data, src, dst, CA_APPEND);
 }
 
+/* OP_MOVER operation handler.  Moves file continuing terminated copying to the
+ * destination.  Returns status. */
+static OpsResult
+op_mover(ops_t *ops, void *data, const char src[], const char dst[])
+{
+	return op_mv(ops, data, src, dst, CA_RESUME);
+}
+
 /* Moves file/directory overwriting/appending destination files if requested.
  * Returns status. */
 static OpsResult
@@ -749,6 +873,9 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 				/* It's safe to always use fast file cloning on moving files. */
 				.fast_file_cloning = 1,
 				.data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync),
+				.sparse_copying = (ops == NULL)
+				                ? cfg.sparse_copying
+				                : ops->sparse_copying,
 			},
 		};
 
@@ -762,7 +889,7 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 		trash_file_moved(src, dst);
 		bmarks_file_moved(src, dst);
     
-		copy_rating_info(src, dst, 1);  //add by sim1
+		copy_rating(src, dst, 1);  //add by sim1
 	}
 
 	return result;
@@ -778,6 +905,7 @@ ca_to_crs(ConflictAction conflict_action)
 		case CA_FAIL:      return IO_CRS_FAIL;
 		case CA_OVERWRITE: return IO_CRS_REPLACE_FILES;
 		case CA_APPEND:    return IO_CRS_APPEND_TO_FILES;
+		case CA_RESUME:    return IO_CRS_RESUME_FILES;
 	}
 	assert(0 && "Unhandled conflict action.");
 	return IO_CRS_FAIL;
@@ -1058,7 +1186,7 @@ op_rmdir(ops_t *ops, void *data, const char src[], const char dst[])
 		OpsResult ret = run_operation_command(ops, cmd, 1);
 		if (OPS_SUCCEEDED == ret)
 		{
-			copy_rating_info(src, dst, 0);
+			copy_rating(src, dst, 0);
 		}
 
 		return ret;
@@ -1069,7 +1197,7 @@ op_rmdir(ops_t *ops, void *data, const char src[], const char dst[])
 		//mod by sim1
 		if (success)
 		{
-			copy_rating_info(src, dst, 0);
+			copy_rating(src, dst, 0);
 		}
 
 		free(utf16_path);
@@ -1085,7 +1213,7 @@ op_rmdir(ops_t *ops, void *data, const char src[], const char dst[])
   OpsResult retval = exec_io_op(ops, &iop_rmdir, &args, 0);
 	if (OPS_SUCCEEDED == retval)
 	{
-		copy_rating_info(src, dst, 0);
+		copy_rating(src, dst, 0);
 	}
 
 	return retval;
@@ -1178,7 +1306,13 @@ exec_io_op(ops_t *ops, IoRes (*func)(io_args_t *), io_args_t *args,
 		}
 	}
 
-	curr_ops = ops;
+	/* Several background operations can run at the same time, but they don't
+	 * need curr_ops because they don't interact with the user. */
+	if(!ops_runs_in_bg(ops))
+	{
+		curr_ops = ops;
+	}
+
 	OpsResult result = OPS_FAILED;
 	IoRes io_res = func(args);
 	switch(io_res)
@@ -1188,7 +1322,11 @@ exec_io_op(ops_t *ops, IoRes (*func)(io_args_t *), io_args_t *args,
 		case IO_RES_FAILED:    result = OPS_FAILED; break;
 		case IO_RES_ABORTED:   result = OPS_FAILED; break;
 	}
-	curr_ops = NULL;
+
+	if(!ops_runs_in_bg(ops))
+	{
+		curr_ops = NULL;
+	}
 
 	if(cancellable && (ops == NULL || !ops->bg))
 	{
@@ -1422,5 +1560,231 @@ result_from_code(int exit_code)
 	return (exit_code == 0 ? OPS_SUCCEEDED : OPS_FAILED);
 }
 
+/* Checks whether source of an item is located inside source of another item,
+ * in which case processing of one of them affects the other one.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+has_nested_items(const ops_item_t items[], int count)
+{
+	const char **const srcs = reallocarray(NULL, count, sizeof(*srcs));
+	if(srcs == NULL)
+	{
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		srcs[i] = items[i].src;
+	}
+
+	safe_qsort(srcs, count, sizeof(*srcs), &path_sorter);
+
+	for(i = 1; i < count; ++i)
+	{
+		if(path_starts_with(srcs[i], srcs[i - 1]))
+		{
+			break;
+		}
+	}
+
+	free(srcs);
+	return (i < count);
+}
+
+/* Sorts paths so that each path is immediately followed by paths inside of it.
+ * Returns negative number, zero or positive number like strcmp() does. */
+static int
+path_sorter(const void *first, const void *second)
+{
+	const unsigned char *a = *(const unsigned char **)first;
+	const unsigned char *b = *(const unsigned char **)second;
+
+	while(*a != '\0' && *a == *b)
+	{
+		++a;
+		++b;
+	}
+
+	/* Slash goes right after the end of a string. */
+	const int a_char = (*a == '/' ? 1 : *a);
+	const int b_char = (*b == '/' ? 1 : *b);
+	return a_char - b_char;
+}
+
+/* Implementation of parallel_for() body that processes a single item of a
+ * batch. */
+static void
+process_batch_item(int i, void *arg)
+{
+	batch_t *const batch = arg;
+	ops_item_t *const item = &batch->items[i];
+	ops_t *const ops = batch->ops;
+
+	if(batch->started != NULL)
+	{
+		batch->started(item, batch->arg);
+	}
+
+	if(!batch->concurrent)
+	{
+		item->result = perform_operation(item->op, ops, item->data, item->src,
+				item->dst);
+	}
+	else
+	{
+		dev_t devs[2];
+		const int ndevs = get_item_devs(item, devs);
+		acquire_devs(batch, devs, ndevs);
+
+		/* Private copy of the ops collects errors of this item and reports its
+		 * progress to the shared estimation. */
+		ops_t lane = batch->lane_template;
+		if(ops->estim != NULL)
+		{
+			lane.estim = ioeta_alloc_lane(ops->estim, &batch->progress_lock);
+		}
+
+		item->result = perform_operation(item->op, &lane, item->data, item->src,
+				item->dst);
+
+		ioeta_free(lane.estim);
+		release_devs(batch, devs, ndevs);
+
+		pthread_mutex_lock(&batch->lock);
+		merge_lane(ops, &lane);
+		pthread_mutex_unlock(&batch->lock);
+	}
+
+	if(ops->bg_op != NULL && bg_op_lock(ops->bg_op))
+	{
+		++ops->bg_op->done;
+		bg_op_unlock(ops->bg_op);
+	}
+}
+
+/* Determines devices that hold source and parent directory of destination of
+ * the item.  Returns number of distinct devices that were found. */
+static int
+get_item_devs(const ops_item_t *item, dev_t devs[2])
+{
+	int ndevs = 0;
+	struct stat st;
+
+	if(os_lstat(item->src, &st) == 0)
+	{
+		devs[ndevs++] = st.st_dev;
+	}
+
+	if(item->dst != NULL)
+	{
+		char dst_dir[PATH_MAX + 1];
+		copy_str(dst_dir, sizeof(dst_dir), item->dst);
+		remove_last_path_component(dst_dir);
+
+		if(os_stat(dst_dir, &st) == 0 && (ndevs == 0 || st.st_dev != devs[0]))
+		{
+			devs[ndevs++] = st.st_dev;
+		}
+	}
+
+	return ndevs;
+}
+
+/* Waits until all devices can take one more item and then accounts for it. */
+static void
+acquire_devs(batch_t *batch, const dev_t devs[], int ndevs)
+{
+	int i;
+
+	pthread_mutex_lock(&batch->lock);
+
+	for(i = 0; i < ndevs; ++i)
+	{
+		if(get_dev_load(batch, devs[i])->busy >= batch->dev_limit)
+		{
+			/* Wait and check all devices from the start. */
+			pthread_cond_wait(&batch->freed, &batch->lock);
+			i = -1;
+		}
+	}
+
+	for(i = 0; i < ndevs; ++i)
+	{
+		++get_dev_load(batch, devs[i])->busy;
+	}
+
+	pthread_mutex_unlock(&batch->lock);
+}
+
+/* Accounts for end of processing of an item that involved the devices. */
+static void
+release_devs(batch_t *batch, const dev_t devs[], int ndevs)
+{
+	int i;
+
+	pthread_mutex_lock(&batch->lock);
+	for(i = 0; i < ndevs; ++i)
+	{
+		--get_dev_load(batch, devs[i])->busy;
+	}
+	pthread_cond_broadcast(&batch->freed);
+	pthread_mutex_unlock(&batch->lock);
+}
+
+/* Looks up load of a device adding an entry for it if it's not there yet.  Must
+ * be called with batch->lock held.  Returns pointer to the entry. */
+static dev_load_t *
+get_dev_load(batch_t *batch, dev_t dev)
+{
+	int i;
+	for(i = 0; i < batch->ndevs; ++i)
+	{
+		if(batch->devs[i].dev == dev)
+		{
+			return &batch->devs[i];
+		}
+	}
+
+	/* There is enough space for all devices of all items. */
+	dev_load_t *const load = &batch->devs[batch->ndevs++];
+	load->dev = dev;
+	load->busy = 0;
+	return load;
+}
+
+/* Moves errors and abortion state of a private copy of the ops into the
+ * ops. */
+static void
+merge_lane(ops_t *ops, ops_t *lane)
+{
+	if(lane->aborted)
+	{
+		ops->aborted = 1;
+	}
+
+	if(lane->errors != NULL && lane->errors[0] != '\0')
+	{
+		size_t len = (ops->errors == NULL) ? 0U : strlen(ops->errors);
+		if(len != 0U)
+		{
+			(void)strappend(&ops->errors, &len, "\n");
+		}
+		(void)strappend(&ops->errors, &len, lane->errors);
+	}
+
+	free(lane->errors);
+	lane->errors = NULL;
+}
+
+/* Thread-safe version of copy_rating_info(). */
+static void
+copy_rating(const char src[], const char dst[], int op)
+{
+	pthread_mutex_lock(&rating_lock);
+	copy_rating_info(src, dst, op);
+	pthread_mutex_unlock(&rating_lock);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -31,9 +31,11 @@ typedef enum
 	OP_COPY,     /* copy and clone */
 	OP_COPYF,    /* copy with file overwrite */
 	OP_COPYA,    /* copy with appending to existing contents of destination */
+	OP_COPYR,    /* copy resuming terminated copying to destination */
 	OP_MOVE,     /* move, rename and substitute */
 	OP_MOVEF,    /* move with file overwrite */
 	OP_MOVEA,    /* move file appending to existing contents of destination */
+	OP_MOVER,    /* move file resuming terminated copying to destination */
 	OP_MOVETMP1, /* multiple files rename */
 	OP_MOVETMP2, /* multiple files rename */
 	OP_MOVETMP3, /* multiple files rename */
@@ -126,6 +128,8 @@ typedef struct ops_t
 	int use_system_calls;  /* Copy of 'syscalls' option value. */
 	int fast_file_cloning; /* Copy of part of 'iooptions' option value. */
 	int data_sync;         /* Copy of part of 'iooptions' option value. */
+	int sparse_copying;    /* Copy of part of 'iooptions' option value. */
+	int io_workers;        /* Copy of 'ioworkers' option value. */
 	int shell_type;        /* Copy of curr_stats.shell_type */
 
 	/* Pointers to user-interaction functions. */
@@ -143,6 +147,22 @@ typedef struct ops_t
 }
 ops_t;
 
+/* Single item of a batch processed by ops_perform_batch(). */
+typedef struct
+{
+	OPS op;           /* Operation to perform. */
+	void *data;       /* Data for the operation as for perform_operation(). */
+	const char *src;  /* Source path. */
+	const char *dst;  /* Destination path. */
+	int index;        /* Position of the item in caller's list. */
+	OpsResult result; /* Status of the operation after processing. */
+}
+ops_item_t;
+
+/* Function that is invoked right before processing an item of a batch.  Might
+ * be called from several threads at the same time. */
+typedef void (*ops_item_started_func)(const ops_item_t *item, void *arg);
+
 /* Allocates and initializes new ops_t.  Returns just allocated structure. */
 ops_t * ops_alloc(OPS main_op, int bg, const char descr[],
 		const char base_dir[], const char target_dir[], ops_choice_func choose,
@@ -164,11 +184,24 @@ void ops_free(ops_t *ops);
 /* Produces a pointer value that describes the flags.  Returns the value. */
 void * ops_flags(DataFlags flags);
 
+/* Checks whether copying of src to dst was terminated and can be resumed by
+ * OP_COPYR or OP_MOVER.  Returns non-zero if so, otherwise zero is returned. */
+int ops_can_resume(const ops_t *ops, const char src[], const char dst[]);
+
 /* Performs single operations, possibly part of the ops (which can be NULL).
  * Returns status. */
 OpsResult perform_operation(OPS op, ops_t *ops, void *data, const char src[],
 		const char dst[]);
 
+/* Performs operations on items of a batch, which is part of the ops, and
+ * counts them as done for background operation.  Items of background
+ * operations that use system calls are processed by 'ioworkers' threads with a
+ * limit on number of items that involve the same device at once, otherwise
+ * items are processed one after another.  Conflicts should be resolved before
+ * calling this function.  The started callback can be NULL. */
+void ops_perform_batch(ops_t *ops, ops_item_t items[], int count,
+		ops_item_started_func started, void *arg);
+
 #endif /* VIFM__OPS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
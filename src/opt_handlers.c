@@ -50,6 +50,7 @@
 #include "utils/utils.h"
 #include "filelist.h"
 #include "flist_hist.h"
+#include "hcache.h"
 #include "registers.h"
 #include "search.h"
 #include "sort.h"
@@ -150,8 +151,10 @@ static void iec_handler(OPT_OP op, optval_t val);
 static void ignorecase_handler(OPT_OP op, optval_t val);
 static void incsearch_handler(OPT_OP op, optval_t val);
 static void iooptions_handler(OPT_OP op, optval_t val);
+static void ioworkers_handler(OPT_OP op, optval_t val);
 static void keepsel_handler(OPT_OP op, optval_t val);
 static void laststatus_handler(OPT_OP op, optval_t val);
+static void lazylinks_handler(OPT_OP op, optval_t val);
 static void lines_handler(OPT_OP op, optval_t val);
 static void locateprg_handler(OPT_OP op, optval_t val);
 #ifndef _WIN32
@@ -226,6 +229,7 @@ static int map_name(const char name[], void *arg);
 static void resort_view(view_t * view);
 static void sessionoptions_handler(OPT_OP op, optval_t val);
 static void statusline_handler(OPT_OP op, optval_t val);
+static void statworkers_handler(OPT_OP op, optval_t val);
 static void suggestoptions_handler(OPT_OP op, optval_t val);
 static void reset_suggestoptions(void);
 static void syncregs_handler(OPT_OP op, optval_t val);
@@ -393,6 +397,7 @@ ARRAY_GUARD(suggestoptions_vals, NUM_SUGGESTION_FLAGS);
 static const char *iooptions_vals[][2] = {
 	{ "fastfilecloning", "use COW if FS supports it" },
 	{ "datasync",        "synchronize writes to storage" },
+	{ "sparse",          "skip holes of all files on copying" },
 };
 
 /* Possible flags of 'shortmess' and their count. */
@@ -561,6 +566,14 @@ static const char *sort_types[][2] = {
 	{ "rating", "by star rating" },  //add by sim1
 	{"+rating", "by star rating" },  //add by sim1
 	{"-rating", "by star rating" },  //add by sim1
+
+	{ "usize",  "by size with hard-links counted once" },
+	{ "+usize", "by size with hard-links counted once" },
+	{ "-usize", "by size with hard-links counted once" },
+
+	{ "asize",  "by allocated size" },
+	{ "+asize", "by allocated size" },
+	{ "-asize", "by allocated size" },
 };
 ARRAY_GUARD(sort_types, SK_COUNT*3);
 
@@ -592,6 +605,8 @@ static const char *vifminfo_set[][2] = {
 	[BIT(VINFO_MCHISTORY)] = { "mchistory", "menu cmdline history" },
 	[BIT(VINFO_TABS)]      = { "tabs",      "global or pane tabs" },
 	[BIT(VINFO_RATINGS)]   = { "ratings",   "star ratings" },  //add by sim1
+	[BIT(VINFO_DCACHE)]    = { "dcache",    "directory sizes cache" },
+	[BIT(VINFO_HCACHE)]    = { "hcache",    "file contents digests cache" },
 };
 ARRAY_GUARD(vifminfo_set, NUM_VINFO);
 
@@ -750,6 +765,10 @@ options[] = {
 	  NULL,
 	  { .init = &init_iooptions },
 	},
+	{ "ioworkers", "", "number of threads copying or moving files",
+	  OPT_INT, 0, NULL, &ioworkers_handler, NULL,
+	  { .ref.int_val = &cfg.io_workers },
+	},
 	{ "keepsel", "", "don't reset selection on some switches to normal mode",
 	  OPT_BOOL, 0, NULL, &keepsel_handler, NULL,
 	  { .ref.bool_val = &cfg.keep_sel }
@@ -758,6 +777,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &laststatus_handler, NULL,
 	  { .ref.bool_val = &cfg.display_statusline },
 	},
+	{ "lazylinks", "", "resolve symbolic links on displaying them",
+	  OPT_BOOL, 0, NULL, &lazylinks_handler, NULL,
+	  { .ref.bool_val = &cfg.lazy_links },
+	},
 	{ "lines", "", "height of TUI in chars",
 	  OPT_INT, 0, NULL, &lines_handler, NULL,
 	  { .ref.int_val = &cfg.lines },
@@ -925,6 +948,10 @@ options[] = {
 	  OPT_STR, 0, NULL, &statusline_handler, NULL,
 	  { .ref.str_val = &cfg.status_line },
 	},
+	{ "statworkers", "", "number of threads querying file information",
+	  OPT_INT, 0, NULL, &statworkers_handler, NULL,
+	  { .ref.int_val = &cfg.stat_workers },
+	},
 	{ "suggestoptions", "", "when and how to display key suggestions",
 	  OPT_STRLIST, ARRAY_LEN(suggestoptions_vals), suggestoptions_vals,
 	  &suggestoptions_handler, NULL,
@@ -1449,7 +1476,8 @@ static void
 init_iooptions(optval_t *val)
 {
 	val->set_items = (cfg.fast_file_cloning != 0) << 0
-	               | (cfg.data_sync         != 0) << 1;
+	               | (cfg.data_sync         != 0) << 1
+	               | (cfg.sparse_copying    != 0) << 2;
 }
 
 /* Default-initializes whether to display file numbers. */
@@ -2513,6 +2541,22 @@ iooptions_handler(OPT_OP op, optval_t val)
 {
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
 	cfg.data_sync = ((val.set_items & 2) != 0);
+	cfg.sparse_copying = ((val.set_items & 4) != 0);
+}
+
+/* Sets number of threads used to copy or move files. */
+static void
+ioworkers_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		vle_opts_assign("ioworkers", val, OPT_GLOBAL);
+	}
+
+	cfg.io_workers = val.int_val;
 }
 
 /* Handles changes of 'keepsel'. */
@@ -2538,6 +2582,13 @@ laststatus_handler(OPT_OP op, optval_t val)
 	stats_redraw_later();
 }
 
+/* Makes targets of symbolic links be resolved only when they are displayed. */
+static void
+lazylinks_handler(OPT_OP op, optval_t val)
+{
+	cfg.lazy_links = val.bool_val;
+}
+
 /* Handles updates of the global 'lines' option, which reflects height of
  * terminal. */
 static void
@@ -3722,6 +3773,21 @@ statusline_handler(OPT_OP op, optval_t val)
 	stats_redraw_later();
 }
 
+/* Sets number of threads used to query information about files. */
+static void
+statworkers_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be > 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 1;
+		vle_opts_assign("statworkers", val, OPT_GLOBAL);
+	}
+
+	cfg.stat_workers = val.int_val;
+}
+
 /* Sets when to display key suggestions. */
 static void
 suggestoptions_handler(OPT_OP op, optval_t val)
@@ -4090,6 +4156,11 @@ static void
 vifminfo_handler(OPT_OP op, optval_t val)
 {
 	cfg.vifm_info = val.set_items;
+	if(curr_stats.load_stage >= 2)
+	{
+		dcache_setup_file(&cfg);
+		hcache_setup_file(&cfg);
+	}
 }
 
 static void
@@ -0,0 +1,797 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "pager.h"
+
+#ifndef _WIN32
+
+#include <sys/stat.h> /* S_ISREG fstat() stat stat() */
+#include <sys/types.h> /* ssize_t */
+#include <fcntl.h> /* O_RDONLY open() */
+#include <unistd.h> /* close() pread() */
+
+#include <pthread.h> /* pthread_* */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* SIZE_MAX uintmax_t */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* memcmp() memcpy() memmove() strdup() */
+
+#include "compat/reallocarray.h"
+#include "ui/escape.h"
+#include "utils/macros.h"
+#include "utils/utf8.h"
+#include "utils/utils.h"
+
+/* Number of bytes indexed synchronously on opening. */
+#define SYNC_BYTES (1024*1024)
+
+/* Number of bytes indexed by background thread before publishing results. */
+#define BATCH_BYTES (1024*1024)
+
+/* Number of bytes read from the file at once while indexing. */
+#define READ_BYTES (64*1024)
+
+/* Number of bytes at the start and at the end of the file that are remembered
+ * to detect that the file was overwritten. */
+#define SAMPLE_BYTES 256
+
+/* Piece of the file read into memory. */
+typedef struct
+{
+	char *data;      /* Contents of the piece. */
+	size_t len;      /* Number of bytes in the piece. */
+	size_t capacity; /* Number of bytes allocated for data. */
+	size_t offset;   /* Position of the piece in the file. */
+}
+chunk_t;
+
+/* Storage used while indexing a batch of lines. */
+typedef struct
+{
+	size_t *offsets; /* Offsets of lines of the batch. */
+	int *widths;     /* Widths of lines of the batch. */
+	int count;       /* Number of lines in the batch. */
+	int capacity;    /* Number of elements allocated for offsets and widths. */
+	char *line;      /* Buffer for null-terminated copy of a line. */
+	size_t line_len; /* Size of the line buffer. */
+	chunk_t chunk;   /* Data of the file at the current position. */
+}
+batch_t;
+
+struct pager_t
+{
+	int fd;       /* Descriptor of the file. */
+	char *path;   /* Path to the file for detecting its replacement. */
+	size_t size;  /* Size of the file at the moment of the last refresh. */
+	int tab_stop; /* Tabulation width for computing widths of lines. */
+
+	char head[SAMPLE_BYTES]; /* Bytes at the start of the file. */
+	char tail[SAMPLE_BYTES]; /* Bytes at the end of the file. */
+	size_t sample_len;       /* Number of bytes in head and tail. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	size_t *offsets;      /* Offsets of indexed lines. */
+	int *widths;          /* Screen widths of indexed lines. */
+	int nlines;           /* Number of indexed lines. */
+	int capacity;         /* Number of elements allocated for the index. */
+	size_t indexed;       /* Offset of the first line that's not indexed. */
+	int complete;         /* Whether indexing is over. */
+	int stop;             /* Request for indexing thread to stop. */
+
+	pthread_t thread; /* Thread that indexes the file. */
+	int has_thread;   /* Whether the thread was started. */
+
+	char *line;      /* Buffer for the last line returned to the user. */
+	size_t line_len; /* Size of the line buffer. */
+};
+
+static void take_samples(pager_t *pager);
+static int samples_match(const pager_t *pager);
+static void start_indexing(pager_t *pager);
+static void stop_indexing(pager_t *pager);
+static void * index_thread(void *arg);
+static int index_batch(pager_t *pager, size_t limit, batch_t *batch);
+static int add_to_batch(batch_t *batch, size_t offset, int width);
+static int publish_batch(pager_t *pager, const batch_t *batch, size_t indexed);
+static void free_batch(batch_t *batch);
+static const char * find_line_end(const pager_t *pager, chunk_t *chunk,
+		size_t pos, size_t *len, size_t *next);
+static int read_more(const pager_t *pager, chunk_t *chunk, size_t pos);
+static int read_range(const pager_t *pager, size_t begin, size_t end,
+		char **buf, size_t *buf_len, size_t *nread);
+static size_t get_line_len(const char line[], size_t max_len);
+static int copy_line(const char line[], size_t len, char **buf,
+		size_t *buf_len);
+
+pager_t *
+pager_open(const char path[], int tab_stop)
+{
+	const int fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+			(uintmax_t)st.st_size > SIZE_MAX)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	pager_t *const pager = calloc(1, sizeof(*pager));
+	if(pager == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	pager->path = strdup(path);
+	if(pager->path == NULL)
+	{
+		close(fd);
+		free(pager);
+		return NULL;
+	}
+
+	pager->fd = fd;
+	pager->size = st.st_size;
+	pager->tab_stop = tab_stop;
+
+	if(pthread_mutex_init(&pager->lock, NULL) != 0)
+	{
+		close(fd);
+		free(pager->path);
+		free(pager);
+		return NULL;
+	}
+
+	/* Skip byte order mark. */
+	char bom[3];
+	if(pread(fd, bom, sizeof(bom), 0) == (ssize_t)sizeof(bom) &&
+			memcmp(bom, "\xef\xbb\xbf", sizeof(bom)) == 0)
+	{
+		pager->indexed = sizeof(bom);
+	}
+
+	take_samples(pager);
+	start_indexing(pager);
+	return pager;
+}
+
+int
+pager_refresh(pager_t *pager, int *first)
+{
+	struct stat st, path_st;
+	if(fstat(pager->fd, &st) != 0 || (uintmax_t)st.st_size > SIZE_MAX ||
+			(uintmax_t)st.st_size < pager->size)
+	{
+		return 1;
+	}
+
+	if(stat(pager->path, &path_st) != 0 || path_st.st_dev != st.st_dev ||
+			path_st.st_ino != st.st_ino)
+	{
+		return 1;
+	}
+
+	/* File could have been truncated and then written past its old size, which
+	 * looks like an append if only size is checked. */
+	if(!samples_match(pager))
+	{
+		return 1;
+	}
+
+	if((uintmax_t)st.st_size == pager->size)
+	{
+		pthread_mutex_lock(&pager->lock);
+		*first = pager->nlines;
+		pthread_mutex_unlock(&pager->lock);
+		return 0;
+	}
+
+	/* Indexer reads size of the file without locking. */
+	stop_indexing(pager);
+
+	const size_t old_size = pager->size;
+	const char last = (pager->sample_len == 0U)
+	                ? '\n'
+	                : pager->tail[pager->sample_len - 1U];
+
+	pthread_mutex_lock(&pager->lock);
+
+	pager->size = st.st_size;
+	pager->complete = 0;
+
+	/* Last line might continue in the appended data. */
+	if(pager->nlines > 0 && pager->indexed == old_size && last != '\n')
+	{
+		--pager->nlines;
+		pager->indexed = pager->offsets[pager->nlines];
+	}
+	*first = pager->nlines;
+
+	pthread_mutex_unlock(&pager->lock);
+
+	take_samples(pager);
+	start_indexing(pager);
+	return 0;
+}
+
+/* Remembers bytes at the start and at the end of the file. */
+static void
+take_samples(pager_t *pager)
+{
+	const size_t len = MIN(pager->size, (size_t)SAMPLE_BYTES);
+	if(pread(pager->fd, pager->head, len, 0) != (ssize_t)len ||
+			pread(pager->fd, pager->tail, len, pager->size - len) != (ssize_t)len)
+	{
+		/* Force reopening on the next refresh. */
+		pager->sample_len = (size_t)-1;
+		return;
+	}
+	pager->sample_len = len;
+}
+
+/* Checks whether the file still has the same bytes at the start and at the
+ * old end.  Returns non-zero if so. */
+static int
+samples_match(const pager_t *pager)
+{
+	const size_t len = pager->sample_len;
+	if(len > SAMPLE_BYTES)
+	{
+		return 0;
+	}
+
+	char head[SAMPLE_BYTES], tail[SAMPLE_BYTES];
+	return pread(pager->fd, head, len, 0) == (ssize_t)len
+	    && pread(pager->fd, tail, len, pager->size - len) == (ssize_t)len
+	    && memcmp(head, pager->head, len) == 0
+	    && memcmp(tail, pager->tail, len) == 0;
+}
+
+void
+pager_close(pager_t *pager)
+{
+	if(pager == NULL)
+	{
+		return;
+	}
+
+	stop_indexing(pager);
+	close(pager->fd);
+
+	pthread_mutex_destroy(&pager->lock);
+	free(pager->offsets);
+	free(pager->widths);
+	free(pager->line);
+	free(pager->path);
+	free(pager);
+}
+
+/* Indexes beginning of not yet indexed part of the file right away to have
+ * something to display and starts a thread to index the rest. */
+static void
+start_indexing(pager_t *pager)
+{
+	batch_t batch = {};
+	const int done = index_batch(pager, SYNC_BYTES, &batch);
+	free_batch(&batch);
+
+	if(!done)
+	{
+		if(pthread_create(&pager->thread, NULL, &index_thread, pager) == 0)
+		{
+			pager->has_thread = 1;
+		}
+		else
+		{
+			pthread_mutex_lock(&pager->lock);
+			pager->complete = 1;
+			pthread_mutex_unlock(&pager->lock);
+		}
+	}
+}
+
+/* Stops indexing thread if it's running. */
+static void
+stop_indexing(pager_t *pager)
+{
+	if(!pager->has_thread)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&pager->lock);
+	pager->stop = 1;
+	pthread_mutex_unlock(&pager->lock);
+
+	(void)pthread_join(pager->thread, NULL);
+
+	pager->has_thread = 0;
+	pager->stop = 0;
+}
+
+/* Entry point of a thread that indexes the rest of the file.  Returns NULL. */
+static void *
+index_thread(void *arg)
+{
+	pager_t *const pager = arg;
+
+	block_all_thread_signals();
+
+	batch_t batch = {};
+	while(1)
+	{
+		pthread_mutex_lock(&pager->lock);
+		const int stop = pager->stop;
+		pthread_mutex_unlock(&pager->lock);
+
+		if(stop || index_batch(pager, BATCH_BYTES, &batch))
+		{
+			break;
+		}
+	}
+	free_batch(&batch);
+
+	return NULL;
+}
+
+/* Indexes lines that start within limit bytes after already indexed part of
+ * the file and publishes the result.  Must be called by a single thread at a
+ * time.  Returns non-zero when indexing is over. */
+static int
+index_batch(pager_t *pager, size_t limit, batch_t *batch)
+{
+	/* Only the indexer changes this field, so it can be read without a lock. */
+	size_t pos = pager->indexed;
+
+	batch->count = 0;
+
+	const size_t stop_at = (pager->size - pos > limit ? pos + limit : pager->size);
+	while(pos < stop_at)
+	{
+		size_t len, next;
+		const char *const line = find_line_end(pager, &batch->chunk, pos, &len,
+				&next);
+		if(line == NULL)
+		{
+			/* The file got shorter or can't be read, stop at what's there. */
+			return publish_batch(pager, batch, pager->size);
+		}
+
+		int width = 0;
+		if(copy_line(line, len, &batch->line, &batch->line_len) == 0)
+		{
+			width = utf8_strsw_with_tabs(batch->line, pager->tab_stop)
+			      - esc_str_overhead(batch->line);
+		}
+
+		if(add_to_batch(batch, pos, width) != 0)
+		{
+			return publish_batch(pager, batch, pager->size);
+		}
+
+		pos = next;
+	}
+
+	return publish_batch(pager, batch, pos);
+}
+
+/* Appends a line to the batch.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+add_to_batch(batch_t *batch, size_t offset, int width)
+{
+	if(batch->count == batch->capacity)
+	{
+		const int capacity = (batch->capacity == 0 ? 1024 : batch->capacity*2);
+
+		size_t *const offsets = reallocarray(batch->offsets, capacity,
+				sizeof(*offsets));
+		if(offsets == NULL)
+		{
+			return 1;
+		}
+		batch->offsets = offsets;
+
+		int *const widths = reallocarray(batch->widths, capacity, sizeof(*widths));
+		if(widths == NULL)
+		{
+			return 1;
+		}
+		batch->widths = widths;
+
+		batch->capacity = capacity;
+	}
+
+	batch->offsets[batch->count] = offset;
+	batch->widths[batch->count] = width;
+	++batch->count;
+	return 0;
+}
+
+/* Appends lines of the batch to the index and marks everything before the
+ * indexed offset as processed.  Returns non-zero when indexing is over. */
+static int
+publish_batch(pager_t *pager, const batch_t *batch, size_t indexed)
+{
+	pthread_mutex_lock(&pager->lock);
+
+	int complete = (indexed >= pager->size);
+
+	const int needed = pager->nlines + batch->count;
+	if(needed > pager->capacity)
+	{
+		const int capacity = MAX(needed, pager->capacity*2);
+
+		size_t *const offsets = reallocarray(pager->offsets, capacity,
+				sizeof(*offsets));
+		int *const widths = (offsets == NULL)
+		                  ? NULL
+		                  : reallocarray(pager->widths, capacity, sizeof(*widths));
+		if(offsets != NULL)
+		{
+			pager->offsets = offsets;
+		}
+		if(widths != NULL)
+		{
+			pager->widths = widths;
+			pager->capacity = capacity;
+		}
+	}
+
+	if(needed <= pager->capacity)
+	{
+		memcpy(pager->offsets + pager->nlines, batch->offsets,
+				sizeof(*batch->offsets)*batch->count);
+		memcpy(pager->widths + pager->nlines, batch->widths,
+				sizeof(*batch->widths)*batch->count);
+		pager->nlines = needed;
+		pager->indexed = indexed;
+	}
+	else
+	{
+		/* Out of memory, stop at what's already there. */
+		complete = 1;
+	}
+
+	pager->complete = complete;
+
+	pthread_mutex_unlock(&pager->lock);
+	return complete;
+}
+
+/* Frees resources of the batch. */
+static void
+free_batch(batch_t *batch)
+{
+	free(batch->offsets);
+	free(batch->widths);
+	free(batch->line);
+	free(batch->chunk.data);
+}
+
+int
+pager_get_count(pager_t *pager, int *complete)
+{
+	pthread_mutex_lock(&pager->lock);
+	const int count = pager->nlines;
+	*complete = pager->complete;
+	pthread_mutex_unlock(&pager->lock);
+	return count;
+}
+
+void
+pager_get_widths(pager_t *pager, int from, int count, int widths[])
+{
+	pthread_mutex_lock(&pager->lock);
+	memcpy(widths, pager->widths + from, sizeof(*widths)*count);
+	pthread_mutex_unlock(&pager->lock);
+}
+
+const char *
+pager_get_line(pager_t *pager, int line)
+{
+	pthread_mutex_lock(&pager->lock);
+	const int valid = (line >= 0 && line < pager->nlines);
+	size_t begin = 0U, end = 0U;
+	if(valid)
+	{
+		begin = pager->offsets[line];
+		end = (line + 1 < pager->nlines ? pager->offsets[line + 1]
+		                                : pager->indexed);
+	}
+	pthread_mutex_unlock(&pager->lock);
+
+	if(!valid)
+	{
+		return NULL;
+	}
+
+	size_t nread;
+	if(read_range(pager, begin, end, &pager->line, &pager->line_len,
+			&nread) != 0)
+	{
+		return NULL;
+	}
+
+	pager->line[get_line_len(pager->line, nread)] = '\0';
+	return pager->line;
+}
+
+int
+pager_get_lines(pager_t *pager, int from, int count, char **buf,
+		size_t *buf_len)
+{
+	/* The lock is held while reading, because pager_refresh() can change the
+	 * index. */
+	pthread_mutex_lock(&pager->lock);
+
+	if(from < 0 || count < 0 || from + count > pager->nlines)
+	{
+		pthread_mutex_unlock(&pager->lock);
+		return 1;
+	}
+
+	size_t begin = 0U, end = 0U;
+	if(count > 0)
+	{
+		begin = pager->offsets[from];
+		end = (from + count < pager->nlines ? pager->offsets[from + count]
+		                                    : pager->indexed);
+	}
+
+	size_t nread;
+	if(read_range(pager, begin, end, buf, buf_len, &nread) != 0)
+	{
+		pthread_mutex_unlock(&pager->lock);
+		return 1;
+	}
+
+	/* Lines are converted in place, which is possible because each line loses
+	 * at least one character of its line break (except for the last line of the
+	 * file, for which read_range() reserves an extra byte). */
+	char *p = *buf;
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		const size_t pos = pager->offsets[from + i] - begin;
+		const size_t len = (pos < nread)
+		                 ? get_line_len(*buf + pos, nread - pos)
+		                 : 0U;
+		memmove(p, *buf + pos, len);
+		p[len] = '\0';
+		p += len + 1;
+	}
+
+	pthread_mutex_unlock(&pager->lock);
+	return 0;
+}
+
+/* Finds end of a line that starts at the specified position reading the file
+ * into the chunk as needed.  Line break can be "\n", "\r\n" or "\r".  Sets
+ * *len to length of the line without line break and *next to position of the
+ * next line.  Returns pointer to the line inside the chunk or NULL if the file
+ * got shorter or on error. */
+static const char *
+find_line_end(const pager_t *pager, chunk_t *chunk, size_t pos, size_t *len,
+		size_t *next)
+{
+	if(pos < chunk->offset || pos >= chunk->offset + chunk->len)
+	{
+		chunk->offset = pos;
+		chunk->len = 0U;
+	}
+
+	size_t i = pos - chunk->offset;
+	while(1)
+	{
+		while(i < chunk->len && chunk->data[i] != '\n' && chunk->data[i] != '\r')
+		{
+			++i;
+		}
+
+		/* "\r" at the end of the chunk might be followed by "\n". */
+		const int need_more = (i == chunk->len)
+		                   || (chunk->data[i] == '\r' && i + 1 == chunk->len);
+		if(!need_more || chunk->offset + chunk->len >= pager->size)
+		{
+			break;
+		}
+
+		i -= pos - chunk->offset;
+		if(read_more(pager, chunk, pos) != 0)
+		{
+			return NULL;
+		}
+	}
+
+	const char *const line = chunk->data + (pos - chunk->offset);
+	*len = (chunk->offset + i) - pos;
+
+	if(i == chunk->len)
+	{
+		*next = chunk->offset + i;
+	}
+	else if(chunk->data[i] == '\r' && i + 1 < chunk->len &&
+			chunk->data[i + 1] == '\n')
+	{
+		*next = chunk->offset + i + 2;
+	}
+	else
+	{
+		*next = chunk->offset + i + 1;
+	}
+	return line;
+}
+
+/* Drops data of the chunk before the position and appends next piece of the
+ * file to it.  Returns zero on success and non-zero if nothing was read. */
+static int
+read_more(const pager_t *pager, chunk_t *chunk, size_t pos)
+{
+	const size_t skip = pos - chunk->offset;
+	if(skip != 0U)
+	{
+		memmove(chunk->data, chunk->data + skip, chunk->len - skip);
+		chunk->len -= skip;
+		chunk->offset = pos;
+	}
+
+	const size_t from = chunk->offset + chunk->len;
+	const size_t count = MIN((size_t)READ_BYTES, pager->size - from);
+	if(chunk->len + count > chunk->capacity)
+	{
+		char *const data = realloc(chunk->data, chunk->len + count);
+		if(data == NULL)
+		{
+			return 1;
+		}
+		chunk->data = data;
+		chunk->capacity = chunk->len + count;
+	}
+
+	const ssize_t nread = pread(pager->fd, chunk->data + chunk->len, count, from);
+	if(nread <= 0)
+	{
+		return 1;
+	}
+
+	chunk->len += nread;
+	return 0;
+}
+
+/* Reads part of the file into a buffer, which is enlarged if necessary to hold
+ * one more byte than the range.  Sets *nread to number of read bytes, which is
+ * smaller than the range if the file got shorter.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+read_range(const pager_t *pager, size_t begin, size_t end, char **buf,
+		size_t *buf_len, size_t *nread)
+{
+	const size_t size = (end - begin) + 1U;
+	if(size > *buf_len)
+	{
+		char *const new_buf = realloc(*buf, size);
+		if(new_buf == NULL)
+		{
+			return 1;
+		}
+		*buf = new_buf;
+		*buf_len = size;
+	}
+
+	*nread = 0U;
+	while(*nread < end - begin)
+	{
+		const ssize_t n = pread(pager->fd, *buf + *nread, (end - begin) - *nread,
+				begin + *nread);
+		if(n <= 0)
+		{
+			break;
+		}
+		*nread += n;
+	}
+	return 0;
+}
+
+/* Computes length of a line that starts at the beginning of the buffer and
+ * can't be longer than max_len.  Returns the length. */
+static size_t
+get_line_len(const char line[], size_t max_len)
+{
+	size_t len = 0U;
+	while(len < max_len && line[len] != '\n' && line[len] != '\r')
+	{
+		++len;
+	}
+	return len;
+}
+
+/* Makes null-terminated copy of a line in a buffer, which is enlarged if
+ * necessary.  Returns zero on success, otherwise non-zero is returned. */
+static int
+copy_line(const char line[], size_t len, char **buf, size_t *buf_len)
+{
+	if(len + 1 > *buf_len)
+	{
+		char *const new_buf = realloc(*buf, len + 1);
+		if(new_buf == NULL)
+		{
+			return 1;
+		}
+		*buf = new_buf;
+		*buf_len = len + 1;
+	}
+
+	memcpy(*buf, line, len);
+	(*buf)[len] = '\0';
+	return 0;
+}
+
+#else
+
+pager_t *
+pager_open(const char path[], int tab_stop)
+{
+	return NULL;
+}
+
+int
+pager_refresh(pager_t *pager, int *first)
+{
+	return 1;
+}
+
+void
+pager_close(pager_t *pager)
+{
+}
+
+int
+pager_get_count(pager_t *pager, int *complete)
+{
+	*complete = 1;
+	return 0;
+}
+
+void
+pager_get_widths(pager_t *pager, int from, int count, int widths[])
+{
+}
+
+const char *
+pager_get_line(pager_t *pager, int line)
+{
+	return NULL;
+}
+
+int
+pager_get_lines(pager_t *pager, int from, int count, char **buf,
+		size_t *buf_len)
+{
+	return 1;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
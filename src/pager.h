@@ -0,0 +1,75 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__PAGER_H__
+#define VIFM__PAGER_H__
+
+#include <stddef.h> /* size_t */
+
+/* Backend of builtin viewing of large plain files.  Lines of the file are
+ * indexed by a background thread, so viewing can start before the whole file
+ * is processed, and are read on demand, so contents of the file isn't kept in
+ * memory.  The file is read rather than memory-mapped to not crash if it gets
+ * truncated while being viewed.  Beginning of the file is indexed
+ * synchronously on opening.  Lines are split the same way read_line() does it
+ * and leading BOM is skipped.  Along with offsets of lines the index contains
+ * their screen widths. */
+
+/* Opaque pager type. */
+typedef struct pager_t pager_t;
+
+/* Opens the file and starts indexing it.  The tab_stop parameter is used for
+ * computing widths of lines.  Returns the pager or NULL on error or if paging
+ * isn't supported on this platform. */
+pager_t * pager_open(const char path[], int tab_stop);
+
+/* Picks up data appended to the file since it was opened or refreshed last
+ * time and starts indexing it.  *first is set to number of the first line that
+ * has changed (last line can get longer) or was added.  Returns zero on success
+ * and non-zero if the file got shorter, was overwritten (detected by comparing
+ * bytes at its start and old end), was replaced or on error, in which case the
+ * file should be reopened. */
+int pager_refresh(pager_t *pager, int *first);
+
+/* Stops indexing and frees all resources.  The pager can be NULL. */
+void pager_close(pager_t *pager);
+
+/* Retrieves number of lines indexed so far.  *complete is set to non-zero if
+ * the whole file has been indexed (or indexing was stopped because the file was
+ * truncated).  Returns the number. */
+int pager_get_count(pager_t *pager, int *complete);
+
+/* Retrieves screen widths of count lines starting at from (escape sequences
+ * aren't counted), all of the lines must be indexed. */
+void pager_get_widths(pager_t *pager, int from, int count, int widths[]);
+
+/* Retrieves an indexed line.  Returns pointer to a buffer which is valid until
+ * the next call or NULL on error. */
+const char * pager_get_line(pager_t *pager, int line);
+
+/* Retrieves count indexed lines starting at from as null-terminated strings
+ * that follow each other in *buf, which is enlarged if necessary.  Unlike
+ * pager_get_line() can be called from any thread.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int pager_get_lines(pager_t *pager, int from, int count, char **buf,
+		size_t *buf_len);
+
+#endif /* VIFM__PAGER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -23,8 +23,9 @@
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stdint.h> /* int64_t uint64_t */
+#include <stdlib.h> /* abs() free() malloc() */
+#include <string.h> /* memcpy() memmove() strcmp() strdup() strlen() strrchr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
@@ -76,43 +77,105 @@ const char *sort_enum[] = {
 	[SK_BY_INODE]         = "inode",
 #endif
 	[SK_BY_RATING]        = "rating",  //add by sim1
+	[SK_BY_USIZE]         = "usize",
+	[SK_BY_ASIZE]         = "asize",
 
 	[SK_NONE]             = "",
 	[SK_BY_ID]            = "",
 };
 ARRAY_GUARD(sort_enum, SK_TOTAL);
 
+/* Key of an entry extracted once per sorting round, so that comparisons don't
+ * need to compute anything. */
+typedef struct
+{
+	/* Numeric key or class of an entry for string keys. */
+	uint64_t num;
+	/* String key or NULL.  Strings of the same class are compared. */
+	const char *str;
+	/* Version of the str that can be compared by strcmp() in a way that respects
+	 * 'sortnumbers' or NULL. */
+	const char *enc;
+	/* Index of the entry in the sequence being sorted. */
+	unsigned int idx;
+	/* Position of the entry before current round of sorting. */
+	unsigned int pos;
+}
+sort_key_t;
+
+/* Type of comparator of keys for a particular sorting key.  Returns standard
+ * < 0, == 0, > 0 comparison result. */
+typedef int (*key_cmp_func)(const sort_key_t *f, const sort_key_t *s);
+
+/* Block of memory for strings of keys. */
+typedef struct strs_block_t
+{
+	struct strs_block_t *next; /* Next block in the list or NULL. */
+	size_t size;               /* Size of data. */
+	size_t used;               /* Number of used bytes of data. */
+	char data[];               /* Storage for strings. */
+}
+strs_block_t;
+
+/* Regular expressions of sorting groups prepared for repeated matching. */
+typedef struct
+{
+	regex_t **groups;  /* Regexps of groups in order of their priority. */
+	regex_t *compiled; /* Storage of regexps that were compiled here. */
+	int ngroups;       /* Number of elements in groups array. */
+	int ncompiled;     /* Number of elements in compiled array. */
+}
+sort_groups_t;
+
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		size_t nchildren, int root);
 static int prepare_for_sorting(view_t *v, int local);
-static int setup_linking(dir_entry_t *entries, int nentries);
-static void cleanup_linking(void);
+static int setup_sorting(size_t nentries);
+static void cleanup_sorting(void);
 static void sort_sequence(dir_entry_t *entries, size_t nentries);
-static void sort_by_groups(dir_entry_t *entries, signed char key,
-		size_t nentries);
-static void sort_by_key(dir_entry_t *entries, size_t nentries, signed char key,
-		void *data);
+static void sort_by_groups(dir_entry_t *entries, size_t nentries,
+		signed char key);
+static void compile_sort_groups(sort_groups_t *groups);
+static void free_sort_groups(sort_groups_t *groups);
+static char ** split_sort_groups(int *ngroups);
+static void sort_by_key(dir_entry_t *entries, size_t nentries,
+		signed char key, void *data);
+static int prepare_key(dir_entry_t *entries, const unsigned int order[],
+		size_t nentries, signed char key, void *data, sort_key_t keys[]);
+static void extract_key(const dir_entry_t *entry, sort_key_t *key);
+static void extract_name_key(const dir_entry_t *entry, sort_key_t *key);
+static void extract_ext_key(const dir_entry_t *entry, int is_dir,
+		sort_key_t *key);
+static uint64_t signed_key(int64_t num);
+static void encode_key(sort_key_t *key);
+static int encode_numbers(const char str[], char buf[], size_t buf_len);
+static void radix_sort_nums(sort_key_t keys[], sort_key_t buf[], size_t nkeys);
+static int can_radix_sort_strs(const sort_key_t keys[], size_t nkeys);
+static void radix_sort_strs(sort_key_t keys[], sort_key_t buf[], size_t nkeys);
+static void sort_str_chunks(sort_key_t keys[], sort_key_t buf[], size_t nkeys,
+		size_t depth);
+static int compare_entries(const dir_entry_t *a, const dir_entry_t *b,
+		const sort_groups_t *groups);
+static int compare_by_groups(dir_entry_t pair[2], signed char key,
+		const sort_groups_t *groups);
+static int compare_by_key(dir_entry_t pair[2], signed char key, void *data);
 static char * map_ascii_clone(const char str[], int ignore_case);
 static char * map_ascii(const char str[], int ignore_case);
-static char * lowerdup(const char str[]);
-static int sort_dir_list(const void *one, const void *two);
+static char * lower_key_str(const char str[]);
+static char * save_key_str(const char str[]);
+static char * alloc_key_str(size_t size);
+static void reset_key_strs(void);
+static void free_key_strs(void);
+static int compare_keys(const void *one, const void *two);
+static int compare_nums(const sort_key_t *f, const sort_key_t *s);
+static int compare_names(const sort_key_t *f, const sort_key_t *s);
+static int compare_inames(const sort_key_t *f, const sort_key_t *s);
+static int compare_targets(const sort_key_t *f, const sort_key_t *s);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if HAVE_STRVERSCMP_FUNC
 static char * skip_leading_zeros(const char str[]);
 #endif
-static int compare_file_names(const dir_entry_t *f, const dir_entry_t *s,
-		SortingKey sort_type);
-static int compare_file_exts(const dir_entry_t *f, int f_dir,
-		const dir_entry_t *s, int s_dir, SortingKey sort_type);
 static int compare_name_part(const char s[], const char t[]);
-static int compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s);
-static int compare_item_count(const dir_entry_t *f, int fdir,
-		const dir_entry_t *s, int sdir);
-static int compare_group(const char f[], const char s[], regex_t *regex);
-static int compare_targets(const dir_entry_t *f, const dir_entry_t *s);
-static int compare_rating(const dir_entry_t *f, const dir_entry_t *s);  //add by sim1
-
-/* The following variables are set by prepare_for_sorting(). */
 
 /* The following variables are set by prepare_for_sorting(). */
 
@@ -125,21 +188,28 @@ static const char *view_sort_groups;
 /* Whether the view displays custom file list. */
 static int custom_view;
 
-/* The following variables are set up by setup_linking() and managed by
- * sort_by_key(). */
-
-/* A key per entry in a currently processed sequence of entries.  The value in
- * principle can be anything, but it's either name or short path at the moment.
- *
- * An entry can be NULL in which case original entry's value should be used.
- * The check for NULL seems to work measurably faster (not using NULLs doubles
- * Unicode decomposition overhead from around 3% to 6%), otherwise NULLs could
- * be replaced by those values.  This probably happens because CPU doesn't need
- * to actually store that NULL anywhere on a check and data to use instead of
- * NULL is already available in CPU's cache. */
-static char **cached_keys;
-
-/* The following variables are set by sort_by_key(). */
+/* The following variables are set up by setup_sorting().  They are large
+ * enough for the whole list and are reused by every round of sorting, which
+ * avoids paying for fresh memory on each round. */
+
+/* Order of entries of a sequence, which is applied to them once all keys are
+ * processed. */
+static unsigned int *sort_order;
+/* Storage for reordering entries. */
+static dir_entry_t *sort_entries_buf;
+/* Keys of entries. */
+static sort_key_t *sort_keys;
+/* Storage for reordering keys. */
+static sort_key_t *sort_keys_buf;
+
+/* Strings of keys (normalized names, short paths, link targets, etc.) are
+ * allocated from a list of blocks, which is much cheaper than allocating and
+ * freeing them one by one.  Blocks are reused by every round of sorting. */
+static strs_block_t *key_strs;
+/* Block which is used for allocations. */
+static strs_block_t *key_strs_cur;
+
+/* The following variables are set by prepare_key(). */
 
 /* Whether it's descending sort. */
 static int sort_descending;
@@ -147,6 +217,10 @@ static int sort_descending;
 static SortingKey sort_type;
 /* Sorting key specific data. */
 static void *sort_data;
+/* Comparator of keys extracted for current sorting round. */
+static key_cmp_func key_cmp;
+/* Entries whose keys are being compared. */
+static const dir_entry_t *sorted_entries;
 
 void
 sort_view(view_t *v)
@@ -162,10 +236,10 @@ sort_view(view_t *v)
 	 * resources, so skip it if we can. */
 	if(!custom_view || !cv_tree(v->custom.type))
 	{
-		if(setup_linking(v->dir_entry, v->list_rows) == 0)
+		if(setup_sorting(v->list_rows) == 0)
 		{
 			sort_sequence(v->dir_entry, v->list_rows);
-			cleanup_linking();
+			cleanup_sorting();
 		}
 		return;
 	}
@@ -179,7 +253,7 @@ sort_view(view_t *v)
 	}
 
 	/* This must be done after uncompressing custom tree. */
-	if(setup_linking(v->dir_entry, v->list_rows) != 0)
+	if(setup_sorting(v->list_rows) != 0)
 	{
 		/* Compress custom tree back. */
 		filters_drop_temporaries(v, /*entries=*/NULL);
@@ -199,8 +273,8 @@ sort_view(view_t *v)
 		unsorted_list = NULL;
 	}
 
-	/* Done with linking data by now. */
-	cleanup_linking();
+	/* Done with sorting data by now. */
+	cleanup_sorting();
 
 	if(local_filter_is_empty(v))
 	{
@@ -258,10 +332,10 @@ sort_entries(view_t *v, entries_t entries)
 		return;
 	}
 
-	if(setup_linking(entries.entries, entries.nentries) == 0)
+	if(setup_sorting(entries.nentries) == 0)
 	{
 		sort_sequence(entries.entries, entries.nentries);
-		cleanup_linking();
+		cleanup_sorting();
 	}
 }
 
@@ -284,33 +358,39 @@ prepare_for_sorting(view_t *v, int local)
 	return 0;
 }
 
-/* Initializes cached keys storage and numbers entries to make future access to
- * cache possible.  Use cleanup_linking() to cleanup.  Returns zero on
- * success. */
+/* Allocates storage for sorting a list of specified size.  Use
+ * cleanup_sorting() to cleanup.  Returns zero on success. */
 static int
-setup_linking(dir_entry_t *entries, int nentries)
+setup_sorting(size_t nentries)
 {
-	cached_keys = reallocarray(NULL, nentries, sizeof(*cached_keys));
-	if(cached_keys == NULL)
-	{
-		return 1;
-	}
+	sort_order = reallocarray(NULL, nentries, sizeof(*sort_order));
+	sort_entries_buf = reallocarray(NULL, nentries, sizeof(*sort_entries_buf));
+	sort_keys = reallocarray(NULL, nentries, sizeof(*sort_keys));
+	sort_keys_buf = reallocarray(NULL, nentries, sizeof(*sort_keys_buf));
 
-	int i;
-	for(i = 0; i < nentries; ++i)
+	if(nentries != 0U && (sort_order == NULL || sort_entries_buf == NULL ||
+				sort_keys == NULL || sort_keys_buf == NULL))
 	{
-		entries[i].link = i;
+		cleanup_sorting();
+		return 1;
 	}
 	return 0;
 }
 
-/* Frees resources allocated by setup_linking(). */
+/* Frees resources allocated by setup_sorting() and during sorting. */
 static void
-cleanup_linking(void)
+cleanup_sorting(void)
 {
-	/* Individual array elements are allocated and freed in sort_by_key(). */
-	free(cached_keys);
-	cached_keys = NULL;
+	free(sort_order);
+	sort_order = NULL;
+	free(sort_entries_buf);
+	sort_entries_buf = NULL;
+	free(sort_keys);
+	sort_keys = NULL;
+	free(sort_keys_buf);
+	sort_keys_buf = NULL;
+
+	free_key_strs();
 }
 
 /* Sorts sequence of file entries (plain list, not tree, although it can be some
@@ -318,6 +398,14 @@ cleanup_linking(void)
 static void
 sort_sequence(dir_entry_t *entries, size_t nentries)
 {
+	/* Rounds of sorting only reorder indexes of entries, which is cheaper than
+	 * moving entries around. */
+	size_t j;
+	for(j = 0U; j < nentries; ++j)
+	{
+		sort_order[j] = j;
+	}
+
 	int i = SK_COUNT;
 	while(--i >= 0)
 	{
@@ -331,7 +419,7 @@ sort_sequence(dir_entry_t *entries, size_t nentries)
 
 		if(sorting_type == SK_BY_GROUPS)
 		{
-			sort_by_groups(entries, sorting_key, nentries);
+			sort_by_groups(entries, nentries, sorting_key);
 			continue;
 		}
 
@@ -342,542 +430,1093 @@ sort_sequence(dir_entry_t *entries, size_t nentries)
 	{
 		sort_by_key(entries, nentries, SK_BY_DIR, NULL);
 	}
+
+	for(j = 0U; j < nentries; ++j)
+	{
+		sort_entries_buf[j] = entries[sort_order[j]];
+	}
+	memcpy(entries, sort_entries_buf, nentries*sizeof(*entries));
 }
 
-/* Sorts specified range of entries according to sorting groups option. */
+/* Sorts order of specified range of entries according to sorting groups
+ * option. */
 static void
-sort_by_groups(dir_entry_t *entries, signed char key, size_t nentries)
+sort_by_groups(dir_entry_t *entries, size_t nentries, signed char key)
 {
-	char **groups = NULL;
-	int ngroups = 0;
+	sort_groups_t groups;
+	compile_sort_groups(&groups);
 
-	char *const copy = strdup(view_sort_groups);
-	char *group = copy, *state = NULL;
-	while((group = split_and_get(group, ',', &state)) != NULL)
+	int i;
+	for(i = groups.ngroups - 1; i >= 0; --i)
 	{
-		ngroups = add_to_string_array(&groups, ngroups, group);
+		sort_by_key(entries, nentries, key, groups.groups[i]);
 	}
-	free(copy);
+
+	free_sort_groups(&groups);
+}
+
+/* Compiles regular expressions of all sorting groups of the view. */
+static void
+compile_sort_groups(sort_groups_t *groups)
+{
+	int ngroups;
+	char **patterns = split_sort_groups(&ngroups);
 
 	/* Whether view->primary_group can be used to skip compiling regexp of the
 	 * first group. */
 	const int optimized = (view_sort_groups == view->sort_groups);
 
+	groups->groups = reallocarray(NULL, ngroups, sizeof(*groups->groups));
+	groups->compiled = reallocarray(NULL, ngroups, sizeof(*groups->compiled));
+	groups->ngroups = 0;
+	groups->ncompiled = 0;
+
+	int i;
+	for(i = 0; i < ngroups; ++i)
+	{
+		if(groups->groups == NULL || groups->compiled == NULL)
+		{
+			break;
+		}
+
+		if(i == 0 && optimized)
+		{
+			groups->groups[groups->ngroups++] = &view->primary_group;
+			continue;
+		}
+
+		regex_t *const regex = &groups->compiled[groups->ncompiled++];
+		(void)regexp_compile(regex, patterns[i], REG_EXTENDED | REG_ICASE);
+		groups->groups[groups->ngroups++] = regex;
+	}
+
+	free_string_array(patterns, ngroups);
+}
+
+/* Frees resources allocated by compile_sort_groups(). */
+static void
+free_sort_groups(sort_groups_t *groups)
+{
 	int i;
-	for(i = ngroups - 1; i >= (optimized ? 1 : 0); --i)
+	for(i = 0; i < groups->ncompiled; ++i)
 	{
-		regex_t regex;
-		(void)regexp_compile(&regex, groups[i], REG_EXTENDED | REG_ICASE);
-		sort_by_key(entries, nentries, key, &regex);
-		regfree(&regex);
+		regfree(&groups->compiled[i]);
 	}
-	if(optimized && ngroups != 0)
+	free(groups->compiled);
+	free(groups->groups);
+}
+
+/* Splits value of sorting groups option into separate groups.  Returns the
+ * groups and sets *ngroups. */
+static char **
+split_sort_groups(int *ngroups)
+{
+	char **groups = NULL;
+	*ngroups = 0;
+
+	char *const copy = strdup(view_sort_groups);
+	char *group = copy, *state = NULL;
+	while((group = split_and_get(group, ',', &state)) != NULL)
 	{
-		sort_by_key(entries, nentries, key, &view->primary_group);
+		*ngroups = add_to_string_array(&groups, *ngroups, group);
 	}
+	free(copy);
 
-	free_string_array(groups, ngroups);
+	return groups;
 }
 
-/* Sorts specified range of entries by the key in a stable way. */
+/* Sorts order of specified range of entries by the key in a stable way. */
 static void
 sort_by_key(dir_entry_t *entries, size_t nentries, signed char key, void *data)
 {
-	sort_descending = (key < 0);
-	sort_type = (SortingKey)abs(key);
-	sort_data = data;
+	sort_key_t *keys = sort_keys;
+	sort_key_t *buf = sort_keys_buf;
 
-	int using_cache = 0;
+	const int nparents = prepare_key(entries, sort_order, nentries, key, data,
+			keys);
 
-	if(sort_type == SK_BY_NAME || sort_type == SK_BY_INAME)
+	size_t i;
+	if(key_cmp == &compare_nums || can_radix_sort_strs(keys, nentries))
 	{
-		using_cache = 1;
-
-		const int ignore_case = (sort_type == SK_BY_INAME);
-
-		unsigned int i;
-		if(custom_view)
+		/* Radix sort is stable, so put keys in current order first. */
+		for(i = 0U; i < nentries; ++i)
 		{
-			for(i = 0; i < nentries; ++i)
-			{
-				char short_path[PATH_MAX + 1];
-				get_short_path_of(view, &entries[i], NF_NONE, 0, sizeof(short_path),
-						short_path);
-				cached_keys[entries[i].link] = map_ascii_clone(short_path, ignore_case);
-			}
+			buf[keys[i].pos] = keys[i];
 		}
-		else
+		sort_key_t *const tmp = keys;
+		keys = buf;
+		buf = tmp;
+
+		if(key_cmp == &compare_nums)
 		{
-			for(i = 0; i < nentries; ++i)
+			if(sort_descending)
 			{
-				cached_keys[entries[i].link] = map_ascii(entries[i].name, ignore_case);
+				/* Inverting keys reverses their order, while stability keeps ties in
+				 * the original order. */
+				for(i = 0U; i < nentries; ++i)
+				{
+					keys[i].num = ~keys[i].num;
+				}
 			}
+			radix_sort_nums(keys, buf, nentries);
 		}
-	}
-	else if(sort_type == SK_BY_FILEEXT || sort_type == SK_BY_EXTENSION)
-	{
-		using_cache = 1;
-
-		unsigned int i;
-		for(i = 0; i < nentries; ++i)
+		else
 		{
-			cached_keys[entries[i].link] =
-				map_ascii(entries[i].name, /*ignore_case=*/0);
+			radix_sort_strs(keys, buf, nentries);
 		}
 	}
-
-	unsigned int i;
-	for(i = 0U; i < nentries; ++i)
+	else
 	{
-		entries[i].tag = i;
+		safe_qsort(keys, nentries, sizeof(*keys), &compare_keys);
 	}
 
-	safe_qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
-
-	if(using_cache)
+	/* Parent directory always goes first, so just move it there. */
+	size_t nmoved = 0U;
+	for(i = 0U; i < nentries && nmoved < (size_t)nparents; ++i)
 	{
-		for(i = 0; i < nentries; ++i)
+		const dir_entry_t *const entry = &entries[keys[i].idx];
+		if(fentry_is_dir(entry) && is_parent_dir(entry->name))
 		{
-			free(cached_keys[entries[i].link]);
+			const sort_key_t parent = keys[i];
+			memmove(&keys[nmoved + 1U], &keys[nmoved], (i - nmoved)*sizeof(*keys));
+			keys[nmoved++] = parent;
 		}
 	}
-}
-
-/* Turns non-ASCII strings into normalized UTF-8 strings or just clones it.
- * Returns a newly allocated string. */
-static char *
-map_ascii_clone(const char str[], int ignore_case)
-{
-	char *mapped = map_ascii(str, ignore_case);
-	if(mapped == NULL)
-	{
-		mapped = strdup(str);
-	}
-	return mapped;
-}
 
-/* Checks whether input string is ASCII and allocates its normalized UTF-8
- * version if not.  Returns NULL on error or if string is good as is. */
-static char *
-map_ascii(const char str[], int ignore_case)
-{
-	if(str_is_ascii(str))
+	for(i = 0U; i < nentries; ++i)
 	{
-		if(ignore_case)
-		{
-			return lowerdup(str);
-		}
-		return NULL;
+		sort_order[i] = keys[i].idx;
 	}
 
-	return utf8_normalize(str, ignore_case);
+	reset_key_strs();
 }
 
-/* strdup()-like function which changes string to lower case.  Returns newly
- * allocated string or NULL on out of memory. */
-static char *
-lowerdup(const char str[])
+/* Sets up globals for comparing entries by the key and extracts the key of
+ * every entry into keys array.  Keys are stored in the order of entries, their
+ * positions are taken from order array.  Strings of the keys are valid until
+ * reset_key_strs() or free_key_strs().  Returns number of parent directory
+ * entries. */
+static int
+prepare_key(dir_entry_t *entries, const unsigned int order[], size_t nentries,
+		signed char key, void *data, sort_key_t keys[])
 {
-	/* Could save memory by returning NULL when string is already in lower case,
-	 * but that might reduce performance. */
-	size_t len = strlen(str);
-	char *copy = malloc(len + 1);
-	if(copy != NULL)
+	sort_descending = (key < 0);
+	sort_type = (SortingKey)abs(key);
+	sort_data = data;
+	sorted_entries = entries;
+
+	/* Directory could have been loaded without metadata needed for this key. */
+	const int metadata = flist_metadata_of_key(sort_type);
+	if(metadata != 0)
 	{
-		size_t i;
-		for(i = 0; i < len; ++i)
+		unsigned int i;
+		for(i = 0U; i < nentries; ++i)
 		{
-			copy[i] = tolower(str[i]);
+			fentry_load_metadata(&entries[i], metadata);
 		}
-		copy[len] = '\0';
 	}
-	return copy;
-}
 
-/* Compares file names containing numbers correctly. */
-TSTATIC int
-strnumcmp(const char s[], const char t[])
-{
-#if HAVE_STRVERSCMP_FUNC
-	static int buggy_musl = -1;
-	if(buggy_musl < 0)
+	switch(sort_type)
 	{
-		/* "A" has an empty sequence of digits, so byte sorting should be used. */
-		buggy_musl = (strverscmp("A", "10") < 0);
-	}
+		case SK_BY_INAME:
+			key_cmp = &compare_inames;
+			break;
+		case SK_BY_NAME:
+		case SK_BY_FILEEXT:
+		case SK_BY_EXTENSION:
+		case SK_BY_TYPE:
+		case SK_BY_GROUPS:
+#ifndef _WIN32
+		case SK_BY_PERMISSIONS:
+#endif
+			key_cmp = &compare_names;
+			break;
+		case SK_BY_TARGET:
+			key_cmp = &compare_targets;
+			break;
 
-	if(!buggy_musl)
-	{
-		const char *new_s = skip_leading_zeros(s);
-		const char *new_t = skip_leading_zeros(t);
-		return strverscmp(new_s, new_t);
+		default:
+			key_cmp = &compare_nums;
+			break;
 	}
 
-	/* Fall through to the custom implementation which is aligned with the correct
-	 * version. */
-#endif
-
-	while(*s != '\0' && *t != '\0')
+	/* Going through entries sequentially is much more cache-friendly than doing
+	 * it in current order. */
+	int nparents = 0;
+	unsigned int i;
+	for(i = 0U; i < nentries; ++i)
 	{
-		if(isdigit(*s) && isdigit(*t))
-		{
-			int num_a, num_b;
-			const char *os = s, *ot = t;
-			char *p;
+		const dir_entry_t *const entry = &entries[i];
 
-			num_a = strtol(s, &p, 10);
-			s = p;
+		keys[i].num = 0U;
+		keys[i].str = NULL;
+		keys[i].enc = NULL;
+		keys[i].idx = i;
 
-			num_b = strtol(t, &p, 10);
-			t = p;
+		extract_key(entry, &keys[i]);
 
-			if(num_a != num_b)
-				return SORT_CMP(num_a, num_b);
-			else if(*os != *ot)
-				return SORT_CMP((unsigned char)*os, (unsigned char)*ot);
-		}
-		else if(*s == *t)
+		if(fentry_is_dir(entry) && is_parent_dir(entry->name))
 		{
-			s++;
-			t++;
+			++nparents;
 		}
-		else
-			break;
 	}
 
-	return SORT_CMP((unsigned char)*s, (unsigned char)*t);
-}
-
-#if HAVE_STRVERSCMP_FUNC
-/* Skips all zeros in front of numbers (correctly handles zero).  Returns str, a
- * pointer to '0' or a pointer to non-zero digit. */
-static char *
-skip_leading_zeros(const char str[])
-{
-	while(str[0] == '0' && isdigit(str[1]))
+	for(i = 0U; i < nentries; ++i)
 	{
-		str++;
+		keys[order[i]].pos = i;
 	}
-	return (char *)str;
+
+	return nparents;
 }
-#endif
 
-static int
-sort_dir_list(const void *one, const void *two)
+/* Computes key of the entry for current sorting round. */
+static void
+extract_key(const dir_entry_t *entry, sort_key_t *key)
 {
-	/* TODO: refactor this function sort_dir_list(). */
+	const int is_dir = fentry_is_dir(entry);
 
-	int retval;
-	const dir_entry_t *const first = one;
-	const dir_entry_t *const second = two;
-
-	const int first_is_dir = fentry_is_dir(first);
-	const int second_is_dir = fentry_is_dir(second);
-
-	if(first_is_dir && is_parent_dir(first->name))
-	{
-		return -1;
-	}
-	if(second_is_dir && is_parent_dir(second->name))
-	{
-		return 1;
-	}
-
-	retval = 0;
 	switch(sort_type)
 	{
 		case SK_BY_NAME:
 		case SK_BY_INAME:
-			retval = compare_file_names(first, second, sort_type);
+			extract_name_key(entry, key);
+			break;
+		case SK_BY_FILEEXT:
+		case SK_BY_EXTENSION:
+			extract_ext_key(entry, is_dir, key);
 			break;
 
 		case SK_BY_DIR:
-			if(first_is_dir != second_is_dir)
-			{
-				retval = first_is_dir ? -1 : 1;
-			}
+			key->num = !is_dir;
 			break;
-
 		case SK_BY_TYPE:
-			retval = strcmp(get_type_str(first->type), get_type_str(second->type));
-			break;
-
-		case SK_BY_FILEEXT:
-		case SK_BY_EXTENSION:
-			retval = compare_file_exts(first, first_is_dir, second, second_is_dir,
-					sort_type);
+			key->str = get_type_str(entry->type);
+			key->enc = key->str;
 			break;
 
 		case SK_BY_SIZE:
-			retval = compare_file_sizes(first, second);
+			key->num = fentry_get_size_of(view, entry, DSK_APPARENT);
+			break;
+		case SK_BY_USIZE:
+			key->num = fentry_get_size_of(view, entry, DSK_UNIQUE);
+			break;
+		case SK_BY_ASIZE:
+			key->num = fentry_get_size_of(view, entry, DSK_ALLOCATED);
 			break;
 
 		case SK_BY_NITEMS:
-			retval = compare_item_count(first, first_is_dir, second, second_is_dir);
+			/* We don't want to call fentry_get_nitems() for files as sorting huge
+			 * lists of files can call this function a lot of times, thus even small
+			 * extra performance overhead is not desirable. */
+			key->num = (is_dir ? fentry_get_nitems(view, entry) : 0U);
 			break;
 
 		case SK_BY_GROUPS:
-			retval = compare_group(first->name, second->name, sort_data);
+			{
+				char group[NAME_MAX + 1];
+				regmatch_t match = get_group_match(sort_data, entry->name);
+				copy_str(group,
+						MIN(sizeof(group), (size_t)match.rm_eo - match.rm_so + 1U),
+						entry->name + match.rm_so);
+				const char *const copy = save_key_str(group);
+				key->str = (copy == NULL ? "" : copy);
+				key->enc = key->str;
+			}
 			break;
 
 		case SK_BY_TARGET:
-			retval = compare_targets(first, second);
+			key->num = (entry->type == FT_LINK);
+			if(entry->type == FT_LINK)
+			{
+				char full_path[PATH_MAX + 1];
+				char target[PATH_MAX + 1];
+				get_full_path_of(entry, sizeof(full_path), full_path);
+				if(get_link_target(full_path, target, sizeof(target)) == 0)
+				{
+					key->str = save_key_str(target);
+				}
+			}
 			break;
 
 		case SK_BY_TIME_MODIFIED:
-			retval = SORT_CMP(first->mtime, second->mtime);
+			key->num = signed_key(entry->mtime);
 			break;
-
 		case SK_BY_TIME_ACCESSED:
-			retval = SORT_CMP(first->atime, second->atime);
+			key->num = signed_key(entry->atime);
 			break;
-
 		case SK_BY_TIME_CHANGED:
-			retval = SORT_CMP(first->ctime, second->ctime);
+			key->num = signed_key(entry->ctime);
 			break;
 
 #ifndef _WIN32
 		case SK_BY_MODE:
-			retval = SORT_CMP(first->mode, second->mode);
+			key->num = entry->mode;
 			break;
-
 		case SK_BY_INODE:
-			retval = SORT_CMP(first->inode, second->inode);
+			key->num = entry->inode;
 			break;
-
 		case SK_BY_OWNER_NAME: /* FIXME */
 		case SK_BY_OWNER_ID:
-			retval = SORT_CMP(first->uid, second->uid);
+			key->num = entry->uid;
 			break;
-
 		case SK_BY_GROUP_NAME: /* FIXME */
 		case SK_BY_GROUP_ID:
-			retval = SORT_CMP(first->gid, second->gid);
+			key->num = entry->gid;
 			break;
-
 		case SK_BY_PERMISSIONS:
 			{
-				char first_perm[11], second_perm[11];
-				get_perm_string(first_perm, sizeof(first_perm), first->mode);
-				get_perm_string(second_perm, sizeof(second_perm), second->mode);
-				retval = strcmp(first_perm, second_perm);
+				char perms[11];
+				get_perm_string(perms, sizeof(perms), entry->mode);
+				const char *const copy = save_key_str(perms);
+				key->str = (copy == NULL ? "" : copy);
+				key->enc = key->str;
 			}
 			break;
-
 		case SK_BY_NLINKS:
-			retval = SORT_CMP(first->nlinks, second->nlinks);
+			key->num = entry->nlinks;
 			break;
 #endif
 		//add by sim1  *******************************************************
 		case SK_BY_RATING:
-			retval = compare_rating(first, second);
+			{
+				char path[PATH_MAX + 1];
+				get_full_path_of(entry, sizeof(path), path);
+				key->num = get_rating_stars(path);
+			}
 			break;
 		//add by sim1  *******************************************************
-	}
 
-	if(retval == 0)
-	{
-		retval = SORT_CMP(first->tag, second->tag);
-	}
-	else if(sort_descending)
-	{
-		retval = -retval;
+		default:
+			break;
 	}
-
-	return retval;
-}
-
-/* Compares two file sizes.  Returns standard -1, 0, 1 for comparisons. */
-static int
-compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s)
-{
-	const uint64_t fsize = fentry_get_size(view, f);
-	const uint64_t ssize = fentry_get_size(view, s);
-	return SORT_CMP(fsize, ssize);
 }
 
-/* Compares number of items in two directories (taken as zero for files).
- * Returns standard -1, 0, 1 for comparisons. */
-static int
-compare_item_count(const dir_entry_t *f, int fdir, const dir_entry_t *s,
-		int sdir)
+/* Computes key for sorting by name or by short path in custom views. */
+static void
+extract_name_key(const dir_entry_t *entry, sort_key_t *key)
 {
-	/* We don't want to call fentry_get_nitems() for files as sorting huge lists
-	 * of files can call this function a lot of times, thus even small extra
-	 * performance overhead is not desirable. */
-	const uint64_t fsize = fdir ? fentry_get_nitems(view, f) : 0U;
-	const uint64_t ssize = sdir ? fentry_get_nitems(view, s) : 0U;
-	return SORT_CMP(fsize, ssize);
-}
+	const int ignore_case = (sort_type == SK_BY_INAME);
 
-/* Compares two file names according to grouping regular expression.  Returns
- * standard -1, 0, 1 for comparisons. */
-static int
-compare_group(const char f[], const char s[], regex_t *regex)
-{
-	char fname[NAME_MAX + 1], sname[NAME_MAX + 1];
-	regmatch_t fmatch = get_group_match(regex, f);
-	regmatch_t smatch = get_group_match(regex, s);
+	char *mapped;
+	if(custom_view)
+	{
+		char short_path[PATH_MAX + 1];
+		get_short_path_of(view, entry, NF_NONE, 0, sizeof(short_path),
+				short_path);
+		mapped = map_ascii_clone(short_path, ignore_case);
+	}
+	else
+	{
+		mapped = map_ascii(entry->name, ignore_case);
+	}
 
-	copy_str(fname, MIN(sizeof(fname), (size_t)fmatch.rm_eo - fmatch.rm_so + 1U),
-			f + fmatch.rm_so);
-	copy_str(sname, MIN(sizeof(sname), (size_t)smatch.rm_eo - smatch.rm_so + 1U),
-			s + smatch.rm_so);
+	key->str = (mapped == NULL ? entry->name : mapped);
+	/* The leading dot character is smaller than any other character. */
+	key->num = (key->str[0] != '.');
 
-	return strcmp(fname, sname);
+	encode_key(key);
 }
 
-/* Compares two file names according to symbolic link target.  Returns standard
- * -1, 0, 1 for comparisons. */
-static int
-compare_targets(const dir_entry_t *f, const dir_entry_t *s)
+/* Computes key for sorting by extension.  Classes of entries go in this order:
+ * directories (for fileext only), files with only leading dot, files with
+ * extension and files without one. */
+static void
+extract_ext_key(const dir_entry_t *entry, int is_dir, sort_key_t *key)
 {
-	char full_path[PATH_MAX + 1];
-	char nlink[PATH_MAX + 1], plink[PATH_MAX + 1];
-
-	if((f->type == FT_LINK) != (s->type == FT_LINK))
+	const char *name = map_ascii(entry->name, /*ignore_case=*/0);
+	if(name == NULL)
 	{
-		/* One of the entries is not a link. */
-		return (f->type == FT_LINK) ? 1 : -1;
+		name = entry->name;
 	}
-	if(f->type != FT_LINK)
+
+	const char *const ext = strrchr(name, '.');
+	if(sort_type == SK_BY_FILEEXT && is_dir)
 	{
-		/* Both entries are not symbolic links. */
-		return 0;
+		key->num = 0U;
+		key->str = name;
 	}
-
-	/* Both entries are symbolic links. */
-
-	get_full_path_of(f, sizeof(full_path), full_path);
-	if(get_link_target(full_path, nlink, sizeof(nlink)) != 0)
+	else if(ext == NULL)
 	{
-		return 0;
+		key->num = 3U;
+		key->str = name;
 	}
-	get_full_path_of(s, sizeof(full_path), full_path);
-	if(get_link_target(full_path, plink, sizeof(plink)) != 0)
+	else
 	{
-		return 0;
+		key->num = (ext == name ? 1U : 2U);
+		key->str = ext + 1;
 	}
 
-	return stroscmp(nlink, plink);
+	encode_key(key);
 }
 
-/* Compares two file names (could include one or several components) assuming
- * that the leading dot character is smaller than any other character.  Returns
- * positive value if s is greater than t, zero if they are equal, otherwise
- * negative value is returned. */
-static int
-compare_file_names(const dir_entry_t *f, const dir_entry_t *s,
-		SortingKey sort_type)
+/* Sets key->enc for a string key making comparisons of most strings as cheap as
+ * strcmp().  Leaves it NULL for strings that need to be compared by
+ * strnumcmp(). */
+static void
+encode_key(sort_key_t *key)
 {
-	/* NULL check and conditional load is actually faster than just reading a
-	 * value and not by a trivial amount. */
-	const char *f_name = cached_keys[f->link];
-	if(f_name == NULL)
+	if(!cfg.sort_numbers)
 	{
-		f_name = f->name;
+		key->enc = key->str;
+		return;
 	}
-	const char *s_name = cached_keys[s->link];
-	if(s_name == NULL)
+
+	char enc[2*(PATH_MAX + 1)];
+	const int result = encode_numbers(key->str, enc, sizeof(enc));
+	if(result == 0)
 	{
-		s_name = s->name;
+		key->enc = key->str;
 	}
+	else if(result > 0)
+	{
+		char *const copy = alloc_key_str(result);
+		if(copy != NULL)
+		{
+			memcpy(copy, enc, result);
+			key->enc = copy;
+		}
+	}
+}
 
-	if(f_name[0] == '.' && s_name[0] != '.')
+/* Encodes numbers in the string so that strcmp() of encoded strings orders
+ * them in the same way strnumcmp() orders original ones: every number gets
+ * prefixed with '0' and its length.  Numbers with leading zeros and very long
+ * ones are compared in a special way and can't be encoded.  Returns zero if
+ * there are no numbers in the string, size of encoded string in the buffer on
+ * success and negative number if encoding isn't possible. */
+static int
+encode_numbers(const char str[], char buf[], size_t buf_len)
+{
+	int has_numbers = 0;
+	size_t i = 0U;
+	while(*str != '\0')
 	{
-		return -1;
+		if(!isdigit((unsigned char)*str))
+		{
+			if(i + 1U >= buf_len)
+			{
+				return -1;
+			}
+			buf[i++] = *str++;
+			continue;
+		}
+
+		size_t len = 1U;
+		while(isdigit((unsigned char)str[len]))
+		{
+			++len;
+		}
+
+		/* Limit on length also protects against integer overflows in
+		 * strnumcmp(). */
+		if((str[0] == '0' && len > 1U) || len > 9U || i + 2U + len >= buf_len)
+		{
+			return -1;
+		}
+
+		buf[i++] = '0';
+		buf[i++] = (char)len;
+		memcpy(&buf[i], str, len);
+		i += len;
+		str += len;
+		has_numbers = 1;
 	}
-	if(f_name[0] != '.' && s_name[0] == '.')
+	buf[i++] = '\0';
+	return (has_numbers ? (int)i : 0);
+}
+
+/* Maps signed number onto unsigned one preserving the order.  Returns the
+ * mapped number. */
+static uint64_t
+signed_key(int64_t num)
+{
+	return (uint64_t)num ^ ((uint64_t)1 << 63);
+}
+
+/* Sorts keys in a stable way by their numeric part with LSD radix sort.  buf
+ * should be at least as large as keys. */
+static void
+radix_sort_nums(sort_key_t keys[], sort_key_t buf[], size_t nkeys)
+{
+	if(nkeys < 2U)
 	{
-		return 1;
+		return;
 	}
 
-	int result = compare_name_part(f_name, s_name);
+	/* Count digits of all passes at once. */
+	size_t counts[8][256] = { { 0 } };
 
-	/* Resort to comparing original names when their normalized versions match
-	 * to always solve ties in a deterministic way. */
-	if(result == 0 && sort_type == SK_BY_INAME)
+	size_t i;
+	for(i = 0U; i < nkeys; ++i)
 	{
-		f_name = f->name;
-		s_name = s->name;
+		const uint64_t num = keys[i].num;
+		unsigned int pass;
+		for(pass = 0U; pass < 8U; ++pass)
+		{
+			++counts[pass][(num >> pass*8U) & 0xff];
+		}
+	}
+
+	sort_key_t *from = keys, *to = buf;
+	unsigned int pass;
+	for(pass = 0U; pass < 8U; ++pass)
+	{
+		const unsigned int shift = pass*8U;
+		size_t *const pass_counts = counts[pass];
+
+		/* Skip passes which don't change anything, usually there are quite a lot
+		 * of them as high bytes of keys tend to be the same. */
+		if(pass_counts[(from[0].num >> shift) & 0xff] == nkeys)
+		{
+			continue;
+		}
+
+		size_t pos = 0U;
+		for(i = 0U; i < 256U; ++i)
+		{
+			const size_t count = pass_counts[i];
+			pass_counts[i] = pos;
+			pos += count;
+		}
 
-		char f_short[PATH_MAX + 1];
-		char s_short[PATH_MAX + 1];
-		if(custom_view)
+		for(i = 0U; i < nkeys; ++i)
 		{
-			/* Computing these short paths here isn't a big deal as such ties should
-			 * be a rare occasion. */
-			get_short_path_of(view, f, NF_NONE, /*drop_prefix=*/0, sizeof(f_short),
-					f_short);
-			get_short_path_of(view, s, NF_NONE, /*drop_prefix=*/0, sizeof(s_short),
-					s_short);
+			to[pass_counts[(from[i].num >> shift) & 0xff]++] = from[i];
+		}
 
-			f_name = f_short;
-			s_name = s_short;
+		sort_key_t *const tmp = from;
+		from = to;
+		to = tmp;
+	}
+
+	if(from != keys)
+	{
+		memcpy(keys, from, nkeys*sizeof(*keys));
+	}
+}
+
+/* Checks whether string keys can be sorted by radix_sort_strs().  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_radix_sort_strs(const sort_key_t keys[], size_t nkeys)
+{
+	if(key_cmp != &compare_names && key_cmp != &compare_inames)
+	{
+		return 0;
+	}
+
+	size_t i;
+	for(i = 0U; i < nkeys; ++i)
+	{
+		if(keys[i].enc == NULL)
+		{
+			return 0;
 		}
+	}
+	return 1;
+}
 
-		result = strcmp(f_name, s_name);
+/* Sorts string keys in current order in a stable way taking descending order
+ * into account.  Keys are grouped by their class and then by encoded strings
+ * using radix sort on 8-byte chunks starting with the most significant one. */
+static void
+radix_sort_strs(sort_key_t keys[], sort_key_t buf[], size_t nkeys)
+{
+	size_t i;
+	if(sort_descending)
+	{
+		for(i = 0U; i < nkeys; ++i)
+		{
+			keys[i].num = ~keys[i].num;
+		}
 	}
+	radix_sort_nums(keys, buf, nkeys);
 
-	return result;
+	size_t start = 0U;
+	for(i = 1U; i <= nkeys; ++i)
+	{
+		if(i == nkeys || keys[i].num != keys[start].num)
+		{
+			sort_str_chunks(keys + start, buf + start, i - start, 0U);
+			start = i;
+		}
+	}
 }
 
-/* Compares files/directories by extensions.  Returns standard < 0, == 0, > 0
+/* Sorts keys with equal prefix of specified length of encoded strings by next
+ * 8 bytes of those strings and continues recursively for keys that are equal
+ * after that.  Keys are in current order and are reordered in a stable way. */
+static void
+sort_str_chunks(sort_key_t keys[], sort_key_t buf[], size_t nkeys,
+		size_t depth)
+{
+	/* Comparison-based sorting is faster on small arrays.  All keys here have
+	 * the same class and compare_keys() compares whole strings. */
+	if(nkeys < 256U)
+	{
+		safe_qsort(keys, nkeys, sizeof(*keys), &compare_keys);
+		return;
+	}
+
+	size_t i;
+	for(i = 0U; i < nkeys; ++i)
+	{
+		/* Previous chunks didn't end, so the string is at least depth long. */
+		const unsigned char *const str = (const unsigned char *)keys[i].enc + depth;
+
+		uint64_t chunk = 0U;
+		int j;
+		for(j = 0; j < 8 && str[j] != '\0'; ++j)
+		{
+			chunk |= (uint64_t)str[j] << (56 - 8*j);
+		}
+		keys[i].num = (sort_descending ? ~chunk : chunk);
+	}
+
+	radix_sort_nums(keys, buf, nkeys);
+
+	size_t start = 0U;
+	for(i = 1U; i <= nkeys; ++i)
+	{
+		if(i != nkeys && keys[i].num == keys[start].num)
+		{
+			continue;
+		}
+
+		const size_t n = i - start;
+		const uint64_t chunk = (sort_descending ? ~keys[start].num
+		                                        : keys[start].num);
+		if(n > 1U)
+		{
+			if((chunk & 0xff) != 0U)
+			{
+				/* Strings continue past this chunk. */
+				sort_str_chunks(keys + start, buf + start, n, depth + 8U);
+			}
+			else if(key_cmp == &compare_inames)
+			{
+				/* Strings are equal, but ties of case-insensitive sorting are
+				 * resolved by original names. */
+				safe_qsort(keys + start, n, sizeof(*keys), &compare_keys);
+			}
+		}
+		start = i;
+	}
+}
+
+int
+sort_find_pos(view_t *v, const dir_entry_t *entry)
+{
+	if(prepare_for_sorting(v, /*local=*/1) != 0)
+	{
+		return v->list_rows;
+	}
+
+	/* Groups are compiled once here rather than on every comparison. */
+	sort_groups_t groups = {};
+	if(ui_view_sort_list_contains(view_sort, SK_BY_GROUPS))
+	{
+		compile_sort_groups(&groups);
+	}
+
+	/* Look for the first entry that goes after the new one, thus inserting the
+	 * entry after all of its equals. */
+	int l = 0, u = v->list_rows;
+	while(l < u)
+	{
+		const int i = l + (u - l)/2;
+		if(compare_entries(&v->dir_entry[i], entry, &groups) <= 0)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i;
+		}
+	}
+
+	free_sort_groups(&groups);
+	return l;
+}
+
+/* Compares two entries according to all sorting keys in the same way as
+ * sort_sequence() would order them.  Returns standard < 0, == 0, > 0
  * comparison result. */
 static int
-compare_file_exts(const dir_entry_t *f, int f_dir, const dir_entry_t *s,
-		int s_dir, SortingKey sort_type)
+compare_entries(const dir_entry_t *a, const dir_entry_t *b,
+		const sort_groups_t *groups)
 {
-	/* NULL check and conditional load is actually faster than just reading a
-	 * value and not by a trivial amount. */
-	const char *f_name = cached_keys[f->link];
-	if(f_name == NULL)
+	dir_entry_t pair[2] = { *a, *b };
+	int result = 0;
+
+	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
 	{
-		f_name = f->name;
+		result = compare_by_key(pair, SK_BY_DIR, NULL);
 	}
-	const char *s_name = cached_keys[s->link];
-	if(s_name == NULL)
+
+	int i;
+	for(i = 0; i < SK_COUNT && result == 0; ++i)
 	{
-		s_name = s->name;
+		const signed char sorting_key = view_sort[i];
+		const int sorting_type = abs(sorting_key);
+
+		if(sorting_type > SK_LAST)
+		{
+			continue;
+		}
+
+		if(sorting_type == SK_BY_GROUPS)
+		{
+			result = compare_by_groups(pair, sorting_key, groups);
+			continue;
+		}
+
+		result = compare_by_key(pair, sorting_key, NULL);
 	}
 
-	if(sort_type == SK_BY_FILEEXT)
+	free_key_strs();
+	return result;
+}
+
+/* Compares pair of entries according to compiled sorting groups.  Returns
+ * standard < 0, == 0, > 0 comparison result. */
+static int
+compare_by_groups(dir_entry_t pair[2], signed char key,
+		const sort_groups_t *groups)
+{
+	int result = 0;
+	int i;
+	for(i = 0; i < groups->ngroups && result == 0; ++i)
 	{
-		if(f_dir && s_dir)
+		result = compare_by_key(pair, key, groups->groups[i]);
+	}
+	return result;
+}
+
+/* Compares pair of entries by a single key.  Returns standard < 0,
+ * == 0, > 0 comparison result. */
+static int
+compare_by_key(dir_entry_t pair[2], signed char key, void *data)
+{
+	static const unsigned int order[] = { 0, 1 };
+
+	sort_key_t keys[2];
+	prepare_key(pair, order, 2, key, data, keys);
+
+	int result;
+	if(fentry_is_dir(&pair[0]) && is_parent_dir(pair[0].name))
+	{
+		result = -1;
+	}
+	else if(fentry_is_dir(&pair[1]) && is_parent_dir(pair[1].name))
+	{
+		result = 1;
+	}
+	else
+	{
+		/* Ties compare as equal. */
+		result = key_cmp(&keys[0], &keys[1]);
+		if(sort_descending)
 		{
-			return compare_name_part(f_name, s_name);
+			result = -result;
 		}
+	}
+
+	reset_key_strs();
+	return result;
+}
 
-		if(f_dir || s_dir)
+/* Turns non-ASCII strings into normalized UTF-8 strings or just clones it.
+ * Returns string allocated for keys or NULL on out of memory. */
+static char *
+map_ascii_clone(const char str[], int ignore_case)
+{
+	char *mapped = map_ascii(str, ignore_case);
+	if(mapped == NULL)
+	{
+		mapped = save_key_str(str);
+	}
+	return mapped;
+}
+
+/* Checks whether input string is ASCII and makes its normalized UTF-8 version
+ * if not.  Returns string allocated for keys or NULL on error or if string is
+ * good as is. */
+static char *
+map_ascii(const char str[], int ignore_case)
+{
+	if(str_is_ascii(str))
+	{
+		if(ignore_case)
 		{
-			return (f_dir ? -1 : 1);
+			return lower_key_str(str);
 		}
+		return NULL;
 	}
 
-	const char *f_ext = strrchr(f_name, '.');
-	const char *s_ext = strrchr(s_name, '.');
+	char *const normalized = utf8_normalize(str, ignore_case);
+	if(normalized == NULL)
+	{
+		return NULL;
+	}
 
-	if(f_ext != NULL && s_ext != NULL)
+	char *const mapped = save_key_str(normalized);
+	free(normalized);
+	return mapped;
+}
+
+/* Makes a copy of a string for keys changing it to lower case.  Returns the
+ * copy or NULL on out of memory. */
+static char *
+lower_key_str(const char str[])
+{
+	/* Could save memory by returning NULL when string is already in lower case,
+	 * but that might reduce performance. */
+	const size_t len = strlen(str);
+	char *const copy = alloc_key_str(len + 1U);
+	if(copy != NULL)
 	{
-		if(f_ext == f_name && s_ext != s_name)
+		size_t i;
+		for(i = 0U; i < len; ++i)
 		{
-			return -1;
+			copy[i] = tolower(str[i]);
 		}
+		copy[len] = '\0';
+	}
+	return copy;
+}
+
+/* Makes a copy of a string for keys.  Returns the copy or NULL on out of
+ * memory. */
+static char *
+save_key_str(const char str[])
+{
+	const size_t size = strlen(str) + 1U;
+	char *const copy = alloc_key_str(size);
+	if(copy != NULL)
+	{
+		memcpy(copy, str, size);
+	}
+	return copy;
+}
+
+/* Allocates memory for a string of a key, which is valid until next call of
+ * reset_key_strs() or free_key_strs().  Returns pointer to the memory or NULL
+ * on out of memory. */
+static char *
+alloc_key_str(size_t size)
+{
+	enum { MIN_BLOCK_SIZE = 64*1024 };
+
+	strs_block_t *block = key_strs_cur;
+	while(block != NULL && block->size - block->used < size)
+	{
+		block = block->next;
+	}
+
+	if(block == NULL)
+	{
+		const size_t block_size = MAX(size, (size_t)MIN_BLOCK_SIZE);
+		block = malloc(sizeof(*block) + block_size);
+		if(block == NULL)
+		{
+			return NULL;
+		}
+
+		block->next = key_strs;
+		block->size = block_size;
+		block->used = 0U;
+		key_strs = block;
+	}
+
+	key_strs_cur = block;
+
+	char *const str = &block->data[block->used];
+	block->used += size;
+	return str;
+}
+
+/* Makes memory of all strings of keys available for reuse. */
+static void
+reset_key_strs(void)
+{
+	strs_block_t *block;
+	for(block = key_strs; block != NULL; block = block->next)
+	{
+		block->used = 0U;
+	}
+	key_strs_cur = key_strs;
+}
+
+/* Frees memory of all strings of keys. */
+static void
+free_key_strs(void)
+{
+	while(key_strs != NULL)
+	{
+		strs_block_t *const next = key_strs->next;
+		free(key_strs);
+		key_strs = next;
+	}
+	key_strs_cur = NULL;
+}
+
+/* Compares file names containing numbers correctly. */
+TSTATIC int
+strnumcmp(const char s[], const char t[])
+{
+#if HAVE_STRVERSCMP_FUNC
+	static int buggy_musl = -1;
+	if(buggy_musl < 0)
+	{
+		/* "A" has an empty sequence of digits, so byte sorting should be used. */
+		buggy_musl = (strverscmp("A", "10") < 0);
+	}
+
+	if(!buggy_musl)
+	{
+		const char *new_s = skip_leading_zeros(s);
+		const char *new_t = skip_leading_zeros(t);
+		return strverscmp(new_s, new_t);
+	}
+
+	/* Fall through to the custom implementation which is aligned with the correct
+	 * version. */
+#endif
 
-		if(f_ext != f_name && s_ext == s_name)
+	while(*s != '\0' && *t != '\0')
+	{
+		if(isdigit(*s) && isdigit(*t))
+		{
+			int num_a, num_b;
+			const char *os = s, *ot = t;
+			char *p;
+
+			num_a = strtol(s, &p, 10);
+			s = p;
+
+			num_b = strtol(t, &p, 10);
+			t = p;
+
+			if(num_a != num_b)
+				return SORT_CMP(num_a, num_b);
+			else if(*os != *ot)
+				return SORT_CMP((unsigned char)*os, (unsigned char)*ot);
+		}
+		else if(*s == *t)
 		{
-			return 1;
+			s++;
+			t++;
 		}
+		else
+			break;
+	}
 
-		return compare_name_part(f_ext + 1, s_ext + 1);
+	return SORT_CMP((unsigned char)*s, (unsigned char)*t);
+}
+
+#if HAVE_STRVERSCMP_FUNC
+/* Skips all zeros in front of numbers (correctly handles zero).  Returns str, a
+ * pointer to '0' or a pointer to non-zero digit. */
+static char *
+skip_leading_zeros(const char str[])
+{
+	while(str[0] == '0' && isdigit(str[1]))
+	{
+		str++;
 	}
+	return (char *)str;
+}
+#endif
 
-	if(f_ext != NULL || s_ext != NULL)
+/* qsort() comparator of keys of the current sorting round.  Returns standard
+ * < 0, == 0, > 0 comparison result. */
+static int
+compare_keys(const void *one, const void *two)
+{
+	const sort_key_t *const first = one;
+	const sort_key_t *const second = two;
+
+	const int result = key_cmp(first, second);
+	if(result == 0)
 	{
-		return (f_ext != NULL ? -1 : 1);
+		return SORT_CMP(first->pos, second->pos);
 	}
+	return (sort_descending ? -result : result);
+}
 
-	return compare_name_part(f_name, s_name);
+/* Compares numeric keys.  Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_nums(const sort_key_t *f, const sort_key_t *s)
+{
+	return SORT_CMP(f->num, s->num);
+}
+
+/* Compares file names or their parts (e.g. extensions) of the same class
+ * respecting 'sortnumbers'.  Returns standard < 0, == 0, > 0 comparison
+ * result. */
+static int
+compare_names(const sort_key_t *f, const sort_key_t *s)
+{
+	if(f->num != s->num)
+	{
+		return SORT_CMP(f->num, s->num);
+	}
+	if(f->enc != NULL && s->enc != NULL)
+	{
+		return strcmp(f->enc, s->enc);
+	}
+	return compare_name_part(f->str, s->str);
+}
+
+/* Same as compare_names(), but resorts to comparing original names when their
+ * normalized versions match to always solve ties in a deterministic way.
+ * Returns standard < 0, == 0, > 0 comparison result. */
+static int
+compare_inames(const sort_key_t *f, const sort_key_t *s)
+{
+	const int result = compare_names(f, s);
+	if(result != 0)
+	{
+		return result;
+	}
+
+	const dir_entry_t *const f_entry = &sorted_entries[f->idx];
+	const dir_entry_t *const s_entry = &sorted_entries[s->idx];
+	if(!custom_view)
+	{
+		return strcmp(f_entry->name, s_entry->name);
+	}
+
+	/* Computing these short paths here isn't a big deal as such ties should be
+	 * a rare occasion. */
+	char f_short[PATH_MAX + 1];
+	char s_short[PATH_MAX + 1];
+	get_short_path_of(view, f_entry, NF_NONE, /*drop_prefix=*/0, sizeof(f_short),
+			f_short);
+	get_short_path_of(view, s_entry, NF_NONE, /*drop_prefix=*/0, sizeof(s_short),
+			s_short);
+	return strcmp(f_short, s_short);
+}
+
+/* Compares symbolic link targets putting links after other entries.  Returns
+ * standard < 0, == 0, > 0 comparison result. */
+static int
+compare_targets(const sort_key_t *f, const sort_key_t *s)
+{
+	if(f->num != s->num)
+	{
+		return SORT_CMP(f->num, s->num);
+	}
+
+	/* Both entries are not symbolic links or target of one of them is
+	 * unknown. */
+	if(f->str == NULL || s->str == NULL)
+	{
+		return 0;
+	}
+
+	return stroscmp(f->str, s->str);
 }
 
 /* Compares two file names or their parts (e.g. extensions).  Returns positive
@@ -906,6 +1545,8 @@ get_secondary_key(SortingKey primary_key)
 #endif
 		case SK_BY_TYPE:
 		case SK_BY_NITEMS:
+		case SK_BY_USIZE:
+		case SK_BY_ASIZE:
 		case SK_BY_TARGET:
 		case SK_BY_TIME_MODIFIED:
 		case SK_BY_TIME_ACCESSED:
@@ -925,22 +1566,5 @@ get_secondary_key(SortingKey primary_key)
 	return SK_BY_SIZE;
 }
 
-//add by sim1  *******************************************************
-static int
-compare_rating(const dir_entry_t *f, const dir_entry_t *s)
-{
-	char path[PATH_MAX] = {0};
-	int  fstar, sstar;
-
-	get_full_path_of(f, sizeof(path), path);
-	fstar = get_rating_stars(path);
-
-	get_full_path_of(s, sizeof(path), path);
-	sstar = get_rating_stars(path);
-
-	return (fstar < sstar) ? -1 : (fstar > sstar);
-}
-//add by sim1  *******************************************************
-
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
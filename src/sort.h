@@ -32,6 +32,12 @@ void sort_view(view_t *view);
 /* Sorts specified entries using global settings of the view. */
 void sort_entries(view_t *view, entries_t entries);
 
+/* Finds position at which the entry should be inserted into flat (not a tree)
+ * sorted list of the view to keep it sorted.  The entry is placed after all
+ * entries that compare equal to it.  Returns the position, which is the end of
+ * the list if the view isn't sorted. */
+int sort_find_pos(view_t *view, const dir_entry_t *entry);
+
 /* Maps primary sort key to second column type.  Returns secondary key that
  * corresponds to the primary one. */
 SortingKey get_secondary_key(SortingKey primary_key);
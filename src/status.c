@@ -24,7 +24,9 @@
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MIN */
 #include <stddef.h> /* NULL */
-#include <string.h> /* memcpy() memmove() */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memcpy() memmove() strcmp() strdup() */
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
@@ -47,6 +49,7 @@
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "cmd_core.h"
+#include "dcache_file.h"
 #include "filelist.h"
 #include "filetype.h"
 #include "ipc.h"
@@ -84,9 +87,23 @@ static void load_def_values(status_t *stats, config_t *config);
 static void determine_fuse_umount_cmd(status_t *stats);
 static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
-static void dcache_get(const char path[], time_t mtime, uint64_t inode,
-		dcache_result_t *size, dcache_result_t *nitems);
+static void dcache_get(const char path[], DirSizeKind kind, time_t mtime,
+		uint64_t inode, dcache_result_t *size, dcache_result_t *nitems);
+static void get_value(fsdata_t *dcache, const char path[], time_t mtime,
+		uint64_t inode, dcache_result_t *result);
+static int set_value(fsdata_t *dcache, const char path[], uint64_t inode,
+		uint64_t value, time_t ts);
 static void size_updater(void *data, void *arg);
+static void load_from_file(const char path[]);
+static void apply_file_entry(const char path[], const dcf_entry_t *entry,
+		void *arg);
+static void apply_file_value(fsdata_t *dcache, const char path[],
+		const dcf_value_t *value);
+static void store_in_file(const char path[]);
+static void get_file_value(fsdata_t *dcache, const char path[],
+		dcf_value_t *value);
+static fsdata_t * get_file_slot(int slot, pthread_mutex_t **mutex);
+static void for_each_parent(const char path[], void (*func)(const char path[]));
 TSTATIC time_t dcache_get_size_timestamp(const char path[]);
 TSTATIC void dcache_set_size_timestamp(const char path[], time_t ts);
 
@@ -100,14 +117,22 @@ static int pending_refresh;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
+/* Thread-safety guard for dcache_sizes variable. */
 static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
 /* Thread-safety guard for dcache_nitems variable. */
 static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Cache for directory sizes. */
-static fsdata_t *dcache_size;
+/* Caches for directory sizes of each kind. */
+static fsdata_t *dcache_sizes[DSK_COUNT];
 /* Cache for directory item count. */
 static fsdata_t *dcache_nitems;
+/* Thread-safety guard for dcache_file and dcache_file_path variables.  Can be
+ * locked before locking dcache_size_mutex or dcache_nitems_mutex, but not
+ * after. */
+static pthread_mutex_t dcache_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* File that keeps the cache between sessions or NULL. */
+static dcf_t *dcache_file;
+/* Path to the dcache_file or NULL. */
+static char *dcache_file_path;
 
 /* Whether UI updates should be "paused" (a counter, not a flag). */
 static int silent_ui;
@@ -262,13 +287,32 @@ stats_reset(const config_t *config)
 static int
 reset_dircache(void)
 {
-	fsdata_free(dcache_size);
-	dcache_size = fsdata_create(0, 1);
+	int failed = 0;
+
+	int i;
+	for(i = 0; i < DSK_COUNT; ++i)
+	{
+		fsdata_free(dcache_sizes[i]);
+		dcache_sizes[i] = fsdata_create(0, 1);
+		failed |= (dcache_sizes[i] == NULL);
+	}
 
 	fsdata_free(dcache_nitems);
 	dcache_nitems = fsdata_create(0, 1);
+	failed |= (dcache_nitems == NULL);
 
-	return (dcache_size == NULL || dcache_nitems == NULL);
+	/* Contents of the file needs to be indexed anew. */
+	if(dcache_file_path != NULL)
+	{
+		char *const path = strdup(dcache_file_path);
+		if(path != NULL)
+		{
+			(void)dcache_attach(path);
+			free(path);
+		}
+	}
+
+	return failed;
 }
 
 void
@@ -583,8 +627,8 @@ dcache_get_at(const char path[], time_t mtime, uint64_t inode, uint64_t *size,
 		uint64_t *nitems)
 {
 	dcache_result_t size_res, nitems_res;
-	dcache_get(path, mtime, inode, (size == NULL ? NULL : &size_res),
-			(nitems == NULL ? NULL : &nitems_res));
+	dcache_get(path, DSK_APPARENT, mtime, inode,
+			(size == NULL ? NULL : &size_res), (nitems == NULL ? NULL : &nitems_res));
 
 	if(size != NULL)
 	{
@@ -596,6 +640,15 @@ dcache_get_at(const char path[], time_t mtime, uint64_t inode, uint64_t *size,
 	}
 }
 
+void
+dcache_get_size_at(const char path[], DirSizeKind kind, time_t mtime,
+		uint64_t inode, uint64_t *size)
+{
+	dcache_result_t size_res;
+	dcache_get(path, kind, mtime, inode, &size_res, NULL);
+	*size = (size_res.is_valid ? size_res.value : DCACHE_UNKNOWN);
+}
+
 void
 dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 		dcache_result_t *nitems)
@@ -609,62 +662,82 @@ dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 	get_full_path_of(entry, sizeof(full_path), full_path);
 
 	uint64_t inode = get_true_inode(entry);
-	dcache_get(full_path, entry->mtime, inode, size, nitems);
+	dcache_get(full_path, DSK_APPARENT, entry->mtime, inode, size, nitems);
+}
+
+void
+dcache_get_size_of(const dir_entry_t *entry, DirSizeKind kind,
+		dcache_result_t *size)
+{
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	uint64_t inode = get_true_inode(entry);
+	dcache_get(full_path, kind, entry->mtime, inode, size, NULL);
 }
 
 /* Retrieves information about the path checking whether it's outdated.  size
  * and/or nitems can be NULL. */
 static void
-dcache_get(const char path[], time_t mtime, uint64_t inode,
+dcache_get(const char path[], DirSizeKind kind, time_t mtime, uint64_t inode,
 		dcache_result_t *size, dcache_result_t *nitems)
 {
+	load_from_file(path);
+
 	if(size != NULL)
 	{
-		size->value = DCACHE_UNKNOWN;
-		size->is_valid = 0;
-
 		pthread_mutex_lock(&dcache_size_mutex);
-		dcache_data_t size_data;
-		if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
-		{
-			size->value = size_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			size->is_valid = (mtime < size_data.timestamp);
-#ifndef _WIN32
-			size->is_valid &= (inode == size_data.inode);
-#endif
-		}
+		get_value(dcache_sizes[kind], path, mtime, inode, size);
 		pthread_mutex_unlock(&dcache_size_mutex);
 	}
 
 	if(nitems != NULL)
 	{
-		nitems->value = DCACHE_UNKNOWN;
-		nitems->is_valid = 0;
-
 		pthread_mutex_lock(&dcache_nitems_mutex);
-		dcache_data_t nitems_data;
-		if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) == 0)
-		{
-			nitems->value = nitems_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			nitems->is_valid = (mtime < nitems_data.timestamp);
+		get_value(dcache_nitems, path, mtime, inode, nitems);
+		pthread_mutex_unlock(&dcache_nitems_mutex);
+	}
+}
+
+/* Retrieves single value of a cache checking whether it's outdated. */
+static void
+get_value(fsdata_t *dcache, const char path[], time_t mtime, uint64_t inode,
+		dcache_result_t *result)
+{
+	result->value = DCACHE_UNKNOWN;
+	result->is_valid = 0;
+
+	dcache_data_t data;
+	if(fsdata_get(dcache, path, &data, sizeof(data)) == 0)
+	{
+		result->value = data.value;
+		/* We check strictly for less than to handle scenario when multiple
+		 * changes occurred during the same second. */
+		result->is_valid = (mtime < data.timestamp);
 #ifndef _WIN32
-			nitems->is_valid &= (inode == nitems_data.inode);
+		result->is_valid &= (inode == data.inode);
 #endif
-		}
-		pthread_mutex_unlock(&dcache_nitems_mutex);
 	}
 }
 
 void
 dcache_update_parent_sizes(const char path[], uint64_t by)
 {
+	dcache_update_parent_sizes_of(path, DSK_APPARENT, by);
+}
+
+void
+dcache_update_parent_sizes_of(const char path[], DirSizeKind kind,
+		uint64_t by)
+{
+	load_from_file(path);
+	for_each_parent(path, &load_from_file);
+
 	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
+	(void)fsdata_map_parents(dcache_sizes[kind], path, &size_updater, &by);
 	pthread_mutex_unlock(&dcache_size_mutex);
+
+	for_each_parent(path, &store_in_file);
 }
 
 /* Updates cached value by a fixed amount. */
@@ -683,38 +756,275 @@ dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t nitems)
 	int ret = 0;
 	const time_t ts = time(NULL);
 
+	/* Make sure that the value which isn't updated won't be lost. */
+	load_from_file(path);
+
 	if(size != DCACHE_UNKNOWN)
 	{
-		dcache_data_t data = { .value = size, .timestamp = ts };
-#ifndef _WIN32
-		data.inode = (ino_t)inode;
-#endif
-
 		pthread_mutex_lock(&dcache_size_mutex);
-		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
+		ret |= set_value(dcache_sizes[DSK_APPARENT], path, inode, size, ts);
 		pthread_mutex_unlock(&dcache_size_mutex);
 	}
 
 	if(nitems != DCACHE_UNKNOWN)
 	{
-		dcache_data_t data = { .value = nitems, .timestamp = ts };
-#ifndef _WIN32
-		data.inode = (ino_t)inode;
-#endif
-
 		pthread_mutex_lock(&dcache_nitems_mutex);
-		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
+		ret |= set_value(dcache_nitems, path, inode, nitems, ts);
 		pthread_mutex_unlock(&dcache_nitems_mutex);
 	}
 
+	if(ret == 0)
+	{
+		store_in_file(path);
+	}
+
 	return ret;
 }
 
+int
+dcache_set_sizes_at(const char path[], uint64_t inode,
+		const uint64_t sizes[DSK_COUNT])
+{
+	int ret = 0;
+	const time_t ts = time(NULL);
+
+	/* Make sure that the values which aren't updated won't be lost. */
+	load_from_file(path);
+
+	pthread_mutex_lock(&dcache_size_mutex);
+	int i;
+	for(i = 0; i < DSK_COUNT; ++i)
+	{
+		if(sizes[i] != DCACHE_UNKNOWN)
+		{
+			ret |= set_value(dcache_sizes[i], path, inode, sizes[i], ts);
+		}
+	}
+	pthread_mutex_unlock(&dcache_size_mutex);
+
+	if(ret == 0)
+	{
+		store_in_file(path);
+	}
+
+	return ret;
+}
+
+/* Sets single value of a cache.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+set_value(fsdata_t *dcache, const char path[], uint64_t inode, uint64_t value,
+		time_t ts)
+{
+	dcache_data_t data = { .value = value, .timestamp = ts };
+#ifndef _WIN32
+	data.inode = (ino_t)inode;
+#endif
+	return fsdata_set(dcache, path, &data, sizeof(data));
+}
+
+void
+dcache_setup_file(const config_t *config)
+{
+	if(!(config->vifm_info & VINFO_DCACHE))
+	{
+		dcache_detach();
+		return;
+	}
+
+	char path[PATH_MAX + 16];
+	snprintf(path, sizeof(path), "%s/dcache", config->config_dir);
+
+	pthread_mutex_lock(&dcache_file_mutex);
+	const int attached = (dcache_file_path != NULL &&
+			strcmp(dcache_file_path, path) == 0);
+	pthread_mutex_unlock(&dcache_file_mutex);
+
+	if(!attached)
+	{
+		(void)dcache_attach(path);
+	}
+}
+
+int
+dcache_attach(const char path[])
+{
+	dcache_detach();
+
+	pthread_mutex_lock(&dcache_file_mutex);
+	dcache_file = dcf_open(path);
+	if(dcache_file != NULL)
+	{
+		(void)replace_string(&dcache_file_path, path);
+	}
+	const int failed = (dcache_file == NULL);
+	pthread_mutex_unlock(&dcache_file_mutex);
+
+	return failed;
+}
+
+void
+dcache_detach(void)
+{
+	pthread_mutex_lock(&dcache_file_mutex);
+	dcf_close(dcache_file);
+	dcache_file = NULL;
+	update_string(&dcache_file_path, NULL);
+	pthread_mutex_unlock(&dcache_file_mutex);
+}
+
+void
+dcache_sync(void)
+{
+	pthread_mutex_lock(&dcache_file_mutex);
+	if(dcache_file != NULL)
+	{
+		(void)dcf_sync(dcache_file, &apply_file_entry, NULL);
+	}
+	pthread_mutex_unlock(&dcache_file_mutex);
+}
+
+/* Moves information about the path from the file to in-memory cache, if the
+ * file has it. */
+static void
+load_from_file(const char path[])
+{
+	pthread_mutex_lock(&dcache_file_mutex);
+	dcf_entry_t entry;
+	if(dcache_file != NULL && dcf_take(dcache_file, path, &entry) == 0)
+	{
+		apply_file_entry(path, &entry, NULL);
+	}
+	pthread_mutex_unlock(&dcache_file_mutex);
+}
+
+/* Updates in-memory cache with an entry from the file unless it already has
+ * newer data. */
+static void
+apply_file_entry(const char path[], const dcf_entry_t *entry, void *arg)
+{
+	int i;
+	for(i = 0; i < DCF_NVALUES; ++i)
+	{
+		pthread_mutex_t *mutex;
+		fsdata_t *const dcache = get_file_slot(i, &mutex);
+
+		pthread_mutex_lock(mutex);
+		apply_file_value(dcache, path, &entry->values[i]);
+		pthread_mutex_unlock(mutex);
+	}
+}
+
+/* Updates single value of in-memory cache unless it already has newer
+ * data. */
+static void
+apply_file_value(fsdata_t *dcache, const char path[], const dcf_value_t *value)
+{
+	if(value->value == DCACHE_UNKNOWN)
+	{
+		return;
+	}
+
+	dcache_data_t data;
+	if(fsdata_get(dcache, path, &data, sizeof(data)) == 0 &&
+			data.timestamp > value->ts)
+	{
+		return;
+	}
+
+	(void)set_value(dcache, path, value->inode, value->value, value->ts);
+}
+
+/* Schedules writing of in-memory state of the path to the file. */
+static void
+store_in_file(const char path[])
+{
+	pthread_mutex_lock(&dcache_file_mutex);
+	if(dcache_file != NULL)
+	{
+		dcf_entry_t entry;
+		int known = 0;
+
+		int i;
+		for(i = 0; i < DCF_NVALUES; ++i)
+		{
+			pthread_mutex_t *mutex;
+			fsdata_t *const dcache = get_file_slot(i, &mutex);
+
+			pthread_mutex_lock(mutex);
+			get_file_value(dcache, path, &entry.values[i]);
+			pthread_mutex_unlock(mutex);
+
+			known |= (entry.values[i].value != DCACHE_UNKNOWN);
+		}
+
+		if(known)
+		{
+			dcf_put(dcache_file, path, &entry);
+		}
+	}
+	pthread_mutex_unlock(&dcache_file_mutex);
+}
+
+/* Retrieves single value of in-memory cache in a form suitable for the
+ * file. */
+static void
+get_file_value(fsdata_t *dcache, const char path[], dcf_value_t *value)
+{
+	value->value = DCACHE_UNKNOWN;
+	value->inode = 0;
+	value->ts = 0;
+
+	dcache_data_t data;
+	if(fsdata_get(dcache, path, &data, sizeof(data)) == 0)
+	{
+		value->value = data.value;
+		value->ts = data.timestamp;
+#ifndef _WIN32
+		value->inode = data.inode;
+#endif
+	}
+}
+
+/* Maps index of a value of dcache file onto in-memory cache.  Sets *mutex to
+ * the guard of the cache.  Returns the cache. */
+static fsdata_t *
+get_file_slot(int slot, pthread_mutex_t **mutex)
+{
+	/* Sizes of all kinds go first and are followed by number of items. */
+	if(slot < DSK_COUNT)
+	{
+		*mutex = &dcache_size_mutex;
+		return dcache_sizes[slot];
+	}
+
+	*mutex = &dcache_nitems_mutex;
+	return dcache_nitems;
+}
+
+/* Invokes the function for each parent directory of the path. */
+static void
+for_each_parent(const char path[], void (*func)(const char path[]))
+{
+	char parent[PATH_MAX + 1];
+	copy_str(parent, sizeof(parent), path);
+
+	while(parent[0] != '\0' && !is_root_dir(parent))
+	{
+		remove_last_path_component(parent);
+		if(parent[0] != '\0')
+		{
+			func(parent);
+		}
+	}
+}
+
 TSTATIC time_t
 dcache_get_size_timestamp(const char path[])
 {
 	dcache_data_t size_data;
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
+	if(fsdata_get(dcache_sizes[DSK_APPARENT], path, &size_data,
+				sizeof(size_data)) == 0)
 	{
 		return size_data.timestamp;
 	}
@@ -726,10 +1036,12 @@ TSTATIC void
 dcache_set_size_timestamp(const char path[], time_t ts)
 {
 	dcache_data_t size_data;
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
+	if(fsdata_get(dcache_sizes[DSK_APPARENT], path, &size_data,
+				sizeof(size_data)) == 0)
 	{
 		size_data.timestamp = ts;
-		(void)fsdata_set(dcache_size, path, &size_data, sizeof(size_data));
+		(void)fsdata_set(dcache_sizes[DSK_APPARENT], path, &size_data,
+				sizeof(size_data));
 	}
 }
 
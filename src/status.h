@@ -91,6 +91,17 @@ typedef enum
 }
 TermState;
 
+/* Kinds of directory sizes kept in the cache. */
+typedef enum
+{
+	DSK_APPARENT,  /* Sum of sizes of files. */
+	DSK_UNIQUE,    /* Same as DSK_APPARENT, but hard links are counted once. */
+	DSK_ALLOCATED, /* Space allocated for files and directories, hard links are
+	                  counted once. */
+	DSK_COUNT      /* Number of kinds. */
+}
+DirSizeKind;
+
 /* Type of output variables of dcache_get_of(), which represent state of cache
  * entries. */
 typedef struct
@@ -355,14 +366,47 @@ void dcache_get_at(const char path[], time_t mtime, uint64_t inode,
 void dcache_get_of(const struct dir_entry_t *entry, dcache_result_t *size,
 		dcache_result_t *nitems);
 
+/* Same as dcache_get_at(), but retrieves size of specified kind. */
+void dcache_get_size_at(const char path[], DirSizeKind kind, time_t mtime,
+		uint64_t inode, uint64_t *size);
+
+/* Same as dcache_get_of(), but retrieves size of specified kind. */
+void dcache_get_size_of(const struct dir_entry_t *entry, DirSizeKind kind,
+		dcache_result_t *size);
+
 /* Updates cached sizes of parents by specified amount. */
 void dcache_update_parent_sizes(const char path[], uint64_t by);
 
+/* Same as dcache_update_parent_sizes(), but for sizes of specified kind. */
+void dcache_update_parent_sizes_of(const char path[], DirSizeKind kind,
+		uint64_t by);
+
 /* Updates information about the path.  Returns zero on success, otherwise
  * non-zero is returned. */
 int dcache_set_at(const char path[], uint64_t inode, uint64_t size,
 		uint64_t nitems);
 
+/* Updates sizes of all kinds for the path, DCACHE_UNKNOWN elements are
+ * skipped.  Returns zero on success, otherwise non-zero is returned. */
+int dcache_set_sizes_at(const char path[], uint64_t inode,
+		const uint64_t sizes[DSK_COUNT]);
+
+/* Starts or stops keeping the cache in $VIFM/dcache between sessions depending
+ * on whether 'vifminfo' contains "dcache". */
+void dcache_setup_file(const struct config_t *config);
+
+/* Makes the cache persistent by loading it from the file and appending its
+ * updates there.  Returns zero on success, otherwise non-zero is returned. */
+int dcache_attach(const char path[]);
+
+/* Writes out pending updates and stops using file attached by
+ * dcache_attach(). */
+void dcache_detach(void);
+
+/* Exchanges updates with the file attached by dcache_attach(), which might
+ * have been updated by other instances. */
+void dcache_sync(void);
+
 /* Selection history. */
 
 /* Adds/updates saved selection of files for a particular directory.  Takes
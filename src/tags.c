@@ -80,9 +80,11 @@ const char *tags[] = {
 	"vifm-'ignorecase'",
 	"vifm-'incsearch'",
 	"vifm-'iooptions'",
+	"vifm-'ioworkers'",
 	"vifm-'is'",
 	"vifm-'keepsel'",
 	"vifm-'laststatus'",
+	"vifm-'lazylinks'",
 	"vifm-'lines'",
 	"vifm-'locateprg'",
 	"vifm-'ls'",
@@ -129,6 +131,7 @@ const char *tags[] = {
 	"vifm-'ssop'",
 	"vifm-'stal'",
 	"vifm-'statusline'",
+	"vifm-'statworkers'",
 	"vifm-'stl'",
 	"vifm-'suggestoptions'",
 	"vifm-'syncregs'",
@@ -40,6 +40,7 @@
 #include "../utils/fs.h"
 #include "../utils/fsddata.h"
 #include "../utils/macros.h"
+#include "../utils/matcher_set.h"
 #include "../utils/matchers.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
@@ -547,6 +548,8 @@ static void restore_primary_cs(const col_scheme_t *cs);
 static void reset_to_default_cs(col_scheme_t *cs);
 static void free_cs_highlights(col_scheme_t *cs);
 static file_hi_t * clone_file_highlights(const col_scheme_t *from);
+static void index_file_highlights(col_scheme_t *cs);
+static int find_file_hi(const col_scheme_t *cs, const char fname[]);
 static col_attr_t * clone_column_highlights(const col_scheme_t *from);
 static void reset_cs_colors(col_scheme_t *cs);
 static int source_cs(const char name[]);
@@ -954,6 +957,8 @@ cs_assign(col_scheme_t *to, const col_scheme_t *from)
 	free_cs_highlights(to);
 	*to = *from;
 	to->file_hi = clone_file_highlights(from);
+	to->file_hi_set = NULL;
+	index_file_highlights(to);
 	to->column_hi = clone_column_highlights(from);
 }
 
@@ -984,6 +989,9 @@ free_cs_highlights(col_scheme_t *cs)
 	cs->file_hi = NULL;
 	cs->file_hi_count = 0;
 
+	matcher_set_free(cs->file_hi_set);
+	cs->file_hi_set = NULL;
+
 	free(cs->column_hi);
 	cs->column_hi = NULL;
 	cs->column_hi_count = 0;
@@ -1008,6 +1016,37 @@ clone_file_highlights(const col_scheme_t *from)
 	return file_hi;
 }
 
+/* (Re)builds compiled form of file name specific highlights of the color
+ * scheme. */
+static void
+index_file_highlights(col_scheme_t *cs)
+{
+	matcher_set_free(cs->file_hi_set);
+	cs->file_hi_set = NULL;
+
+	if(cs->file_hi_count == 0)
+	{
+		return;
+	}
+
+	cs->file_hi_set = matcher_set_alloc();
+	if(cs->file_hi_set == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < cs->file_hi_count; ++i)
+	{
+		if(matcher_set_add(cs->file_hi_set, &cs->file_hi[i].matchers, 1) != 0)
+		{
+			matcher_set_free(cs->file_hi_set);
+			cs->file_hi_set = NULL;
+			break;
+		}
+	}
+}
+
 /* Clones column highlight array of the *from color scheme and returns it. */
 static col_attr_t *
 clone_column_highlights(const col_scheme_t *from)
@@ -1366,6 +1405,13 @@ cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi)
 	file_hi->hi = *hi;
 
 	++cs->file_hi_count;
+
+	/* New record goes last, so it can be appended to existing set. */
+	if(cs->file_hi_set == NULL ||
+			matcher_set_add(cs->file_hi_set, &file_hi->matchers, 1) != 0)
+	{
+		index_file_highlights(cs);
+	}
 }
 
 const col_attr_t *
@@ -1382,19 +1428,36 @@ cs_get_file_hi(const col_scheme_t *cs, const char fname[], int *hi_hint)
 		return &cs->file_hi[*hi_hint].hi;
 	}
 
+	const int i = find_file_hi(cs, fname);
+	if(i >= 0)
+	{
+		*hi_hint = i;
+		return &cs->file_hi[i].hi;
+	}
+
+	*hi_hint = INT_MAX;
+	return NULL;
+}
+
+/* Finds the first file name specific highlight that matches the file name.
+ * Returns index of the highlight or -1. */
+static int
+find_file_hi(const col_scheme_t *cs, const char fname[])
+{
+	if(cs->file_hi_set != NULL)
+	{
+		return matcher_set_match(cs->file_hi_set, fname, 0);
+	}
+
 	int i;
 	for(i = 0; i < cs->file_hi_count; ++i)
 	{
-		const file_hi_t *const file_hi = &cs->file_hi[i];
-		if(matchers_match(file_hi->matchers, fname))
+		if(matchers_match(cs->file_hi[i].matchers, fname))
 		{
-			*hi_hint = i;
-			return &file_hi->hi;
+			return i;
 		}
 	}
-
-	*hi_hint = INT_MAX;
-	return NULL;
+	return -1;
 }
 
 int
@@ -1411,6 +1474,7 @@ cs_del_file_hi(const char matchers_expr[])
 			memmove(&cs->file_hi[i], &cs->file_hi[i + 1],
 					sizeof(*cs->file_hi)*((cs->file_hi_count - 1) - i));
 			--cs->file_hi_count;
+			index_file_highlights(cs);
 			return 1;
 		}
 	}
@@ -41,6 +41,7 @@ typedef enum
 }
 ColorSchemeState;
 
+struct matcher_set_t;
 struct matchers_t;
 
 /* Single file highlight description. */
@@ -61,6 +62,8 @@ typedef struct
 
 	file_hi_t *file_hi; /* List of file highlight preferences. */
 	int file_hi_count;  /* Number of file highlight definitions. */
+	/* Compiled matchers of file_hi or NULL if there are none or on error. */
+	struct matcher_set_t *file_hi_set;
 
 	col_attr_t *column_hi; /* List of column highlight preferences.
 	                          Unused entries are filled with 0xff. */
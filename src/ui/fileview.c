@@ -35,6 +35,7 @@
 
 #include "../cfg/config.h"
 #include "../compat/pthread.h"
+#include "../int/file_magic.h"
 #include "../lua/vlua.h"
 #include "../utils/fs.h"
 #include "../utils/macros.h"
@@ -132,10 +133,17 @@ static void mix_in_file_hi(const view_t *view, dir_entry_t *entry, int type_hi,
 		col_attr_t *col);
 static void mix_in_file_name_hi(const view_t *view, dir_entry_t *entry,
 		col_attr_t *col);
+static void mimetypes_detected(void);
 TSTATIC void format_name(void *data, size_t buf_len, char buf[],
 		const format_info_t *info);
 static void format_size(void *data, size_t buf_len, char buf[],
 		const format_info_t *info);
+static void format_usize(void *data, size_t buf_len, char buf[],
+		const format_info_t *info);
+static void format_asize(void *data, size_t buf_len, char buf[],
+		const format_info_t *info);
+static void format_size_of(DirSizeKind kind, size_t buf_len, char buf[],
+		const format_info_t *info);
 static void format_nitems(void *data, size_t buf_len, char buf[],
 		const format_info_t *info);
 static void format_primary_group(void *data, size_t buf_len, char buf[],
@@ -222,6 +230,9 @@ fview_setup(void)
 #endif
 		//add by sim1
 		{ SK_BY_RATING, &format_rating },
+
+		{ SK_BY_USIZE, &format_usize },
+		{ SK_BY_ASIZE, &format_asize },
 	};
 	ARRAY_GUARD(sort_to_func, SK_COUNT);
 
@@ -1066,6 +1077,8 @@ compute_and_draw_cell(column_data_t *cdt, int cell, size_t col_count,
 
 	const int col = fpos_get_col(cdt->view, cell);
 
+	fentry_resolve_link(cdt->entry);
+
 	cdt->current_line = fpos_get_line(cdt->view, cell);
 	cdt->column_offset = ui_view_left_reserved(cdt->view) + col*col_width;
 	cdt->line_hi_group = get_entry_color(cdt->view, cdt->entry);
@@ -1542,14 +1555,38 @@ mix_in_file_name_hi(const view_t *view, dir_entry_t *entry, col_attr_t *col)
 {
 	const col_scheme_t *const cs = ui_view_get_cs(view);
 	char *const typed_fname = get_typed_entry_fpath(entry);
+
+	/* Detecting mime-types of many files can take a while, so don't block on
+	 * it. */
+	get_mimetype_defer(&mimetypes_detected);
 	const col_attr_t *color = cs_get_file_hi(cs, typed_fname, &entry->hi_num);
+	get_mimetype_defer(NULL);
+
 	free(typed_fname);
+
+	if(get_mimetype_deferred())
+	{
+		/* Highlight is unknown until mime-type is detected, so draw the entry as
+		 * if it doesn't match anything and don't cache the result. */
+		entry->hi_num = -1;
+		return;
+	}
+
 	if(color != NULL)
 	{
 		cs_mix_colors(col, color);
 	}
 }
 
+/* Schedules redraw of views to apply highlights that depend on newly detected
+ * mime-types.  Called from a background thread. */
+static void
+mimetypes_detected(void)
+{
+	ui_view_schedule_redraw(&lwin);
+	ui_view_schedule_redraw(&rwin);
+}
+
 /* File name format callback for column_view unit. */
 TSTATIC void
 format_name(void *data, size_t buf_len, char buf[], const format_info_t *info)
@@ -1675,6 +1712,35 @@ format_size(void *data, size_t buf_len, char buf[], const format_info_t *info)
 	snprintf(buf, buf_len + 1, " %s", str);
 }
 
+/* Hard-link aware file size format callback for column_view unit. */
+static void
+format_usize(void *data, size_t buf_len, char buf[], const format_info_t *info)
+{
+	format_size_of(DSK_UNIQUE, buf_len, buf, info);
+}
+
+/* Allocated file size format callback for column_view unit. */
+static void
+format_asize(void *data, size_t buf_len, char buf[], const format_info_t *info)
+{
+	format_size_of(DSK_ALLOCATED, buf_len, buf, info);
+}
+
+/* Formats file size of the specified kind. */
+static void
+format_size_of(DirSizeKind kind, size_t buf_len, char buf[],
+		const format_info_t *info)
+{
+	char str[64];
+	const column_data_t *cdt = info->data;
+
+	const uint64_t size = fentry_get_size_of(cdt->view, cdt->entry, kind);
+
+	str[0] = '\0';
+	friendly_size_notation(size, sizeof(str), str, 1);
+	snprintf(buf, buf_len + 1, " %s", str);
+}
+
 /* Item number format callback for column_view unit. */
 static void
 format_nitems(void *data, size_t buf_len, char buf[], const format_info_t *info)
@@ -1763,9 +1829,11 @@ format_time(void *data, size_t buf_len, char buf[], const format_info_t *info)
 			tm_ptr = localtime(&cdt->entry->mtime);
 			break;
 		case SK_BY_TIME_ACCESSED:
+			fentry_load_metadata(cdt->entry, FMD_ATIME);
 			tm_ptr = localtime(&cdt->entry->atime);
 			break;
 		case SK_BY_TIME_CHANGED:
+			fentry_load_metadata(cdt->entry, FMD_CTIME);
 			tm_ptr = localtime(&cdt->entry->ctime);
 			break;
 
@@ -1808,6 +1876,8 @@ format_group(void *data, size_t buf_len, char buf[], const format_info_t *info)
 {
 	const column_data_t *cdt = info->data;
 
+	fentry_load_metadata(cdt->entry, FMD_OWNER);
+
 	buf[0] = ' ';
 	get_gid_string(cdt->entry, info->id == SK_BY_GROUP_ID, buf_len - 1, buf + 1);
 }
@@ -1818,6 +1888,8 @@ format_owner(void *data, size_t buf_len, char buf[], const format_info_t *info)
 {
 	const column_data_t *cdt = info->data;
 
+	fentry_load_metadata(cdt->entry, FMD_OWNER);
+
 	buf[0] = ' ';
 	get_uid_string(cdt->entry, info->id == SK_BY_OWNER_ID, buf_len - 1, buf + 1);
 }
@@ -103,6 +103,13 @@ ui_stat_update(view_t *view, int lazy_redraw)
 
 	ui_stat_job_bar_check_for_updates();
 
+	/* Status line can display any metadata of the current file. */
+	const dir_entry_t *const curr = get_current_entry(view);
+	if(curr != NULL)
+	{
+		fentry_load_metadata(curr, FMD_ALL);
+	}
+
 	if(cfg.status_line[0] == '\0')
 	{
 		update_stat_window_old(view, lazy_redraw);
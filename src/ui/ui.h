@@ -94,6 +94,8 @@ typedef enum
 	SK_BY_INODE,          /* Inode number. */
 #endif
   SK_BY_RATING,         /* Star rating. */  //add by sim1
+	SK_BY_USIZE,          /* Size with hard-linked files counted once. */
+	SK_BY_ASIZE,          /* Size of allocated disk space. */
 	/* New elements *must* be added here to keep values stored in existing
 	 * vifminfo files valid.  Don't forget to update SK_LAST below. */
 }
@@ -109,7 +111,7 @@ enum
 #endif
 
 	/* Value of the last sort option. */
-	SK_LAST = SK_BY_RATING,  //mod by sim1
+	SK_LAST = SK_BY_ASIZE,
 
 	/* Number of sort options. */
 	SK_COUNT = SK_LAST,
@@ -143,6 +145,8 @@ int get_rating_stars(char path[]);
 int get_rating_string(char buf[], int len, char path[], int format);
 void update_rating_info_selected(int star_num);
 void copy_rating_info(const char src[], const char dst[], int op);
+/* Drops all rating records along with their unsaved changes. */
+void clear_ratings(void);
 //add by sim1 --- END
 
 /* Type of file numbering. */
@@ -236,6 +240,7 @@ struct dir_entry_t
 	time_t atime;     /* Access time. */
 	time_t ctime;     /* Change time. */
 #ifndef _WIN32
+	uint64_t asize;   /* Space allocated for the file in bytes. */
 	ino_t inode;      /* Inode number. */
 	uid_t uid;        /* Owning user id. */
 	gid_t gid;        /* Owning group id. */
@@ -277,6 +282,8 @@ struct dir_entry_t
 	unsigned int temporary : 1;    /* Whether this is temporary node. */
 	unsigned int dir_link : 1;     /* Whether this is symlink to a directory. */
 	unsigned int slow_target : 1;  /* Whether this symlink has a slow target. */
+	unsigned int link_pending : 1; /* Whether symlink target isn't resolved yet. */
+	unsigned int missing_md : 3;   /* Metadata that wasn't loaded (FileMetadata). */
 	unsigned int owns_origin : 1;  /* Whether this entry is custom one. */
 	unsigned int folded : 1;       /* Whether this entry is folded. */
 };
@@ -338,6 +345,13 @@ struct cv_data_t
 	/* List of paths to directories that are folded.  Used by tree-view. */
 	struct trie_t *folded_paths;
 
+	/* Listings of directories that are reused on reloading tree-view until
+	 * tree_watch reports their change (maps paths to tree_listing_t).  Used by
+	 * tree-view. */
+	struct trie_t *tree_listings;
+	/* Watcher of directories that have listings or NULL.  Used by tree-view. */
+	fswatch_t *tree_watch;
+
 	/* Names of files in custom view while it's being composed.  Used for
 	 * duplicate elimination during construction of custom list. */
 	struct trie_t *paths_cache;
@@ -516,6 +530,8 @@ struct view_t
 	                                      shouldn't be copied. */
 
 	int on_slow_fs; /* Whether current directory has access penalties. */
+	struct dir_loader_t *loader; /* State of loading current directory in
+	                                background or NULL. */
 	int has_dups;   /* Whether current directory has duplicated file entries (FS
 	                   issue). */
 
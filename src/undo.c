@@ -81,9 +81,11 @@ static OPS undo_op[] = {
 	OP_REMOVE,   /* OP_COPY */
 	OP_REMOVE,   /* OP_COPYF */
 	OP_REMOVE,   /* OP_COPYA */
+	OP_REMOVE,   /* OP_COPYR */
 	OP_MOVE,     /* OP_MOVE */
 	OP_MOVE,     /* OP_MOVEF */
 	OP_MOVE,     /* OP_MOVEA */
+	OP_MOVE,     /* OP_MOVER */
 	OP_MOVETMP1, /* OP_MOVETMP1 */
 	OP_MOVETMP2, /* OP_MOVETMP2 */
 	OP_MOVETMP3, /* OP_MOVETMP3 */
@@ -126,12 +128,16 @@ static enum
 		OPER_2ND, OPER_NON, OPER_2ND, OPER_NON, }, /* undo OP_REMOVE */
 	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_2ND,    /* redo OP_COPYA  */
 		OPER_2ND, OPER_NON, OPER_2ND, OPER_NON, }, /* undo OP_REMOVE */
+	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_2ND,    /* redo OP_COPYR  */
+		OPER_2ND, OPER_NON, OPER_2ND, OPER_NON, }, /* undo OP_REMOVE */
 	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_2ND,    /* redo OP_MOVE */
 		OPER_2ND, OPER_1ST, OPER_2ND, OPER_1ST, }, /* undo OP_MOVE */
 	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_NON,    /* redo OP_MOVEF */
 		OPER_2ND, OPER_1ST, OPER_2ND, OPER_1ST, }, /* undo OP_MOVE  */
 	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_2ND,    /* redo OP_MOVEA */
 		OPER_2ND, OPER_1ST, OPER_2ND, OPER_1ST, }, /* undo OP_MOVE  */
+	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_2ND,    /* redo OP_MOVER */
+		OPER_2ND, OPER_1ST, OPER_2ND, OPER_1ST, }, /* undo OP_MOVE  */
 	{ OPER_1ST, OPER_2ND, OPER_2ND, OPER_NON,    /* redo OP_MOVETMP1 */
 		OPER_2ND, OPER_1ST, OPER_2ND, OPER_NON, }, /* undo OP_MOVETMP1 */
 	{ OPER_1ST, OPER_2ND, OPER_1ST, OPER_NON,    /* redo OP_MOVETMP2 */
@@ -177,9 +183,11 @@ static const char data_is_ptr[] = {
 	0, /* OP_COPY */
 	0, /* OP_COPYF */
 	0, /* OP_COPYA */
+	0, /* OP_COPYR */
 	0, /* OP_MOVE */
 	0, /* OP_MOVEF */
 	0, /* OP_MOVEA */
+	0, /* OP_MOVER */
 	0, /* OP_MOVETMP1 */
 	0, /* OP_MOVETMP2 */
 	0, /* OP_MOVETMP3 */
@@ -800,6 +808,7 @@ get_op_desc(op_t op)
 			break;
 		case OP_COPY:
 		case OP_COPYA:
+		case OP_COPYR:
 			snprintf(buf, sizeof(buf), "cp %s to %s", op.src, op.dst);
 			break;
 		case OP_COPYF:
@@ -807,6 +816,7 @@ get_op_desc(op_t op)
 			break;
 		case OP_MOVE:
 		case OP_MOVEA:
+		case OP_MOVER:
 		case OP_MOVETMP1:
 		case OP_MOVETMP2:
 		case OP_MOVETMP3:
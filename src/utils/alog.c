@@ -0,0 +1,532 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "alog.h"
+
+#ifndef _WIN32
+
+#include <sys/file.h> /* flock() */
+#include <sys/stat.h> /* fstat() stat() */
+#include <sys/types.h> /* off_t */
+#include <fcntl.h> /* O_* open() */
+#include <unistd.h> /* close() ftruncate() getpid() pread() write() */
+
+#include <errno.h> /* EINTR errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* remove() rename() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memcmp() memcpy() memset() strdup() */
+
+#include "log.h"
+#include "str.h"
+
+/* Value of byte_order field of the header. */
+#define ALOG_BYTE_ORDER 0x01020304U
+
+/* Size of pending records after which they are written out. */
+#define ALOG_MAX_PENDING (64*1024)
+
+/* Opened log. */
+struct alog_t
+{
+	char *path;           /* Path to the file. */
+	int fd;               /* Descriptor of the file or -1. */
+	alog_header_t header; /* Expected header of the file. */
+
+	off_t read_offset; /* Position up to which records were processed. */
+
+	char *pending;      /* Records waiting to be written. */
+	size_t pending_len; /* Number of used bytes in the pending buffer. */
+};
+
+static int open_file(alog_t *log, alog_load_func load, alog_dump_func dump,
+		void *arg, int allow_compaction);
+static int lock_file(alog_t *log);
+static void unlock_file(alog_t *log);
+static int reopen_file(alog_t *log);
+static int is_file_at_path(int fd, const char path[]);
+static int prepare_file(alog_t *log, off_t *size);
+static void drop_tail(alog_t *log, off_t end);
+static int compact_file(alog_t *log, alog_dump_func dump, void *arg);
+static int read_tail(alog_t *log, off_t size, alog_read_func reader,
+		void *arg);
+static int write_pending(alog_t *log);
+
+alog_t *
+alog_open(const char path[], const char magic[], uint32_t version,
+		alog_load_func load, alog_dump_func dump, void *arg)
+{
+	alog_t *const log = malloc(sizeof(*log));
+	if(log == NULL)
+	{
+		return NULL;
+	}
+
+	log->path = strdup(path);
+	log->fd = -1;
+	log->read_offset = 0;
+	log->pending = NULL;
+	log->pending_len = 0U;
+
+	memset(&log->header, 0, sizeof(log->header));
+	copy_str(log->header.magic, sizeof(log->header.magic), magic);
+	log->header.version = version;
+	log->header.byte_order = ALOG_BYTE_ORDER;
+
+	if(log->path == NULL ||
+			open_file(log, load, dump, arg, /*allow_compaction=*/1) != 0)
+	{
+		alog_close(log);
+		return NULL;
+	}
+
+	return log;
+}
+
+/* Opens the file and loads its records.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+open_file(alog_t *log, alog_load_func load, alog_dump_func dump, void *arg,
+		int allow_compaction)
+{
+	if(reopen_file(log) != 0 || lock_file(log) != 0)
+	{
+		return 1;
+	}
+
+	off_t size;
+	if(prepare_file(log, &size) != 0)
+	{
+		unlock_file(log);
+		return 1;
+	}
+
+	int compact = 0;
+	const off_t end = load(log->fd, size, &compact, arg);
+	if(end < 0)
+	{
+		unlock_file(log);
+		return 1;
+	}
+
+	if(end < size)
+	{
+		/* Drop partially written record (e.g., if some instance crashed) to not
+		 * append after garbage. */
+		drop_tail(log, end);
+	}
+
+	if(allow_compaction && compact && compact_file(log, dump, arg) == 0)
+	{
+		unlock_file(log);
+		return open_file(log, load, dump, arg, /*allow_compaction=*/0);
+	}
+
+	log->read_offset = end;
+	unlock_file(log);
+	return 0;
+}
+
+/* Locks the file making sure that the lock is held on the file that's
+ * currently at the path (it could have been replaced by compaction in another
+ * instance).  Returns zero on success, otherwise non-zero is returned. */
+static int
+lock_file(alog_t *log)
+{
+	int reopened = 0;
+	const int error = alog_lock_file(log->path, &log->fd, &reopened);
+	if(reopened)
+	{
+		/* Position in the old file means nothing for the new one. */
+		log->read_offset = sizeof(alog_header_t);
+	}
+	return error;
+}
+
+/* Releases lock taken by lock_file(). */
+static void
+unlock_file(alog_t *log)
+{
+	alog_unlock_file(log->fd);
+}
+
+/* (Re)opens file descriptor for the path.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+reopen_file(alog_t *log)
+{
+	if(log->fd != -1)
+	{
+		close(log->fd);
+	}
+
+	log->fd = alog_open_file(log->path);
+	return (log->fd == -1);
+}
+
+int
+alog_open_file(const char path[])
+{
+	const int fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+	if(fd == -1)
+	{
+		LOG_SERROR_MSG(errno, "Failed to open %s", path);
+	}
+	return fd;
+}
+
+int
+alog_lock_file(const char path[], int *fd, int *reopened)
+{
+	*reopened = 0;
+
+	while(1)
+	{
+		if(flock(*fd, LOCK_EX) != 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			LOG_SERROR_MSG(errno, "Failed to lock %s", path);
+			return 1;
+		}
+
+		if(is_file_at_path(*fd, path))
+		{
+			return 0;
+		}
+
+		close(*fd);
+		*fd = alog_open_file(path);
+		if(*fd == -1)
+		{
+			return 1;
+		}
+		*reopened = 1;
+	}
+}
+
+/* Checks whether the file descriptor refers to the file that's at the path.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+is_file_at_path(int fd, const char path[])
+{
+	struct stat fd_st, path_st;
+	return fstat(fd, &fd_st) == 0
+	    && stat(path, &path_st) == 0
+	    && fd_st.st_dev == path_st.st_dev
+	    && fd_st.st_ino == path_st.st_ino;
+}
+
+void
+alog_unlock_file(int fd)
+{
+	(void)flock(fd, LOCK_UN);
+}
+
+/* Checks header of locked file and initializes empty or invalid files.  Sets
+ * *size to size of the file.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+prepare_file(alog_t *log, off_t *size)
+{
+	struct stat st;
+	if(fstat(log->fd, &st) != 0)
+	{
+		return 1;
+	}
+
+	alog_header_t header;
+	if(st.st_size >= (off_t)sizeof(header) &&
+			pread(log->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+			memcmp(&header, &log->header, sizeof(header)) == 0)
+	{
+		*size = st.st_size;
+		return 0;
+	}
+
+	/* Start from scratch on unknown format. */
+	if(ftruncate(log->fd, 0) != 0 ||
+			alog_write(log->fd, &log->header, sizeof(log->header)) != 0)
+	{
+		return 1;
+	}
+
+	*size = sizeof(log->header);
+	return 0;
+}
+
+/* Truncates locked file to the specified size. */
+static void
+drop_tail(alog_t *log, off_t end)
+{
+	LOG_INFO_MSG("Truncating %s to %lld", log->path, (long long)end);
+	if(ftruncate(log->fd, end) != 0)
+	{
+		LOG_SERROR_MSG(errno, "Failed to truncate %s", log->path);
+	}
+}
+
+/* Replaces locked file with a new one that contains only records produced by
+ * the callback.  Returns zero on success, otherwise non-zero is returned. */
+static int
+compact_file(alog_t *log, alog_dump_func dump, void *arg)
+{
+	char *const tmp_path = format_str("%s.%d", log->path, (int)getpid());
+	if(tmp_path == NULL)
+	{
+		return 1;
+	}
+
+	const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			0600);
+	if(fd == -1)
+	{
+		free(tmp_path);
+		return 1;
+	}
+
+	int error = alog_write(fd, &log->header, sizeof(log->header));
+	if(!error)
+	{
+		error = (dump(fd, arg) != 0);
+	}
+
+	error |= (close(fd) != 0);
+	if(!error && rename(tmp_path, log->path) != 0)
+	{
+		error = 1;
+	}
+	if(error)
+	{
+		(void)remove(tmp_path);
+	}
+
+	free(tmp_path);
+	return error;
+}
+
+void
+alog_close(alog_t *log)
+{
+	if(log == NULL)
+	{
+		return;
+	}
+
+	if(log->fd != -1)
+	{
+		(void)write_pending(log);
+		close(log->fd);
+	}
+
+	free(log->pending);
+	free(log->path);
+	free(log);
+}
+
+void
+alog_put(alog_t *log, const void *record, size_t len)
+{
+	char *const pending = realloc(log->pending, log->pending_len + len);
+	if(pending == NULL)
+	{
+		return;
+	}
+	log->pending = pending;
+
+	memcpy(log->pending + log->pending_len, record, len);
+	log->pending_len += len;
+
+	if(log->pending_len >= ALOG_MAX_PENDING)
+	{
+		(void)write_pending(log);
+	}
+}
+
+int
+alog_sync(alog_t *log, alog_read_func reader, void *arg)
+{
+	if(lock_file(log) != 0)
+	{
+		return 1;
+	}
+
+	off_t size;
+	int error = prepare_file(log, &size);
+	if(!error)
+	{
+		if(size < log->read_offset)
+		{
+			/* File was recreated due to unexpected contents. */
+			log->read_offset = sizeof(alog_header_t);
+		}
+		error = read_tail(log, size, reader, arg);
+	}
+
+	if(!error && log->pending_len != 0U)
+	{
+		error = alog_write(log->fd, log->pending, log->pending_len);
+		log->pending_len = 0U;
+	}
+
+	struct stat st;
+	if(!error && fstat(log->fd, &st) == 0)
+	{
+		/* Skip just written records. */
+		log->read_offset = st.st_size;
+	}
+
+	unlock_file(log);
+	return error;
+}
+
+/* Reports records appended to the locked file since the last read.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+read_tail(alog_t *log, off_t size, alog_read_func reader, void *arg)
+{
+	if(size == log->read_offset)
+	{
+		return 0;
+	}
+
+	const size_t len = size - log->read_offset;
+	char *const data = malloc(len);
+	if(data == NULL)
+	{
+		return 1;
+	}
+
+	if(pread(log->fd, data, len, log->read_offset) != (ssize_t)len)
+	{
+		free(data);
+		return 1;
+	}
+
+	const size_t valid = reader(data, len, arg);
+	free(data);
+
+	if(valid < len)
+	{
+		drop_tail(log, log->read_offset + valid);
+	}
+
+	log->read_offset += valid;
+	return 0;
+}
+
+/* Appends pending records to the file.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+write_pending(alog_t *log)
+{
+	if(log->pending_len == 0U)
+	{
+		return 0;
+	}
+
+	if(lock_file(log) != 0)
+	{
+		return 1;
+	}
+
+	const int error = alog_write(log->fd, log->pending, log->pending_len);
+	log->pending_len = 0U;
+
+	unlock_file(log);
+	return error;
+}
+
+int
+alog_write(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+	while(len != 0U)
+	{
+		const ssize_t written = write(fd, p, len);
+		if(written < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			LOG_SERROR_MSG(errno, "Failed to write to a file");
+			return 1;
+		}
+
+		p += written;
+		len -= written;
+	}
+	return 0;
+}
+
+#else
+
+alog_t *
+alog_open(const char path[], const char magic[], uint32_t version,
+		alog_load_func load, alog_dump_func dump, void *arg)
+{
+	return NULL;
+}
+
+void
+alog_close(alog_t *log)
+{
+}
+
+void
+alog_put(alog_t *log, const void *record, size_t len)
+{
+}
+
+int
+alog_sync(alog_t *log, alog_read_func reader, void *arg)
+{
+	return 1;
+}
+
+int
+alog_write(int fd, const void *data, size_t len)
+{
+	return 1;
+}
+
+int
+alog_open_file(const char path[])
+{
+	return -1;
+}
+
+int
+alog_lock_file(const char path[], int *fd, int *reopened)
+{
+	*reopened = 0;
+	return 1;
+}
+
+void
+alog_unlock_file(int fd)
+{
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
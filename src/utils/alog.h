@@ -0,0 +1,102 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__ALOG_H__
+#define VIFM__UTILS__ALOG_H__
+
+#include <sys/types.h> /* off_t */
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t */
+
+/* Append-only log of records in a file shared by several instances.  Every
+ * access to the file happens under flock(), the file starts with a header that
+ * identifies format of records and is rewritten via a temporary file when it
+ * needs to be compacted.  Format of records is up to the user of the log.
+ * On Windows the log can't be opened. */
+
+/* Declaration of opaque append-only log type. */
+typedef struct alog_t alog_t;
+
+/* Header at the start of the file. */
+typedef struct
+{
+	char magic[8];       /* Null-terminated identifier of the format. */
+	uint32_t version;    /* Version of the format. */
+	uint32_t byte_order; /* Constant which lets detect files from other
+	                        machines. */
+}
+alog_header_t;
+
+/* Type of function that loads records of locked file of the specified size.
+ * Should set *compact to non-zero value to request compaction of the file.
+ * Returns offset right past the last valid record or negative value on
+ * error. */
+typedef off_t (*alog_load_func)(int fd, off_t size, int *compact, void *arg);
+
+/* Type of function that writes records which should survive compaction by
+ * calling alog_write() on the descriptor.  Returns zero on success, otherwise
+ * non-zero is returned. */
+typedef int (*alog_dump_func)(int fd, void *arg);
+
+/* Type of function that processes records appended by other instances.
+ * Returns number of bytes occupied by valid records at the start of data. */
+typedef size_t (*alog_read_func)(const char data[], size_t len, void *arg);
+
+/* Opens or creates the log at the path, loads its records via the load
+ * callback and compacts the file via the dump callback if requested.  The magic
+ * must fit into magic field of the header.  Returns the log or NULL on
+ * error. */
+alog_t * alog_open(const char path[], const char magic[], uint32_t version,
+		alog_load_func load, alog_dump_func dump, void *arg);
+
+/* Writes out pending records and frees resources of the log.  The log can be
+ * NULL. */
+void alog_close(alog_t *log);
+
+/* Schedules appending of a record to the file.  Pending records are written out
+ * once there are enough of them. */
+void alog_put(alog_t *log, const void *record, size_t len);
+
+/* Reports records appended by other instances since the last read and writes
+ * out pending records.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int alog_sync(alog_t *log, alog_read_func reader, void *arg);
+
+/* Writes whole buffer to a file.  Returns zero on success, otherwise non-zero
+ * is returned. */
+int alog_write(int fd, const void *data, size_t len);
+
+/* Opens file at the path for appending creating it if necessary.  Returns file
+ * descriptor or -1 on error. */
+int alog_open_file(const char path[]);
+
+/* Locks file opened by alog_open_file() making sure that the lock is held on
+ * the file that's currently at the path (it could have been replaced or renamed
+ * by another instance), in which case *fd is reopened and *reopened is set to
+ * non-zero.  On error *fd can be -1.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int alog_lock_file(const char path[], int *fd, int *reopened);
+
+/* Releases lock taken by alog_lock_file(). */
+void alog_unlock_file(int fd);
+
+#endif /* VIFM__UTILS__ALOG_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
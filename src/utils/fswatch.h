@@ -21,6 +21,8 @@
 
 /* Implementation of file system changes checks via polling. */
 
+struct strlist_t;
+
 /* Kinds of state reports. */
 typedef enum
 {
@@ -31,6 +33,32 @@ typedef enum
 }
 FSWatchState;
 
+/* Kinds of changes of files of a watched directory. */
+typedef enum
+{
+	FSWC_CREATED,  /* File was created or moved into the directory. */
+	FSWC_DELETED,  /* File was deleted or moved out of the directory. */
+	FSWC_MODIFIED, /* Contents or metadata of the file has changed. */
+}
+FSWatchChange;
+
+/* Single change of a file of a watched directory. */
+typedef struct
+{
+	char *name;         /* Name of the file. */
+	FSWatchChange kind; /* What has happened to the file (the latest event). */
+}
+fswatch_change_t;
+
+/* List of changes of files of a watched directory. */
+typedef struct
+{
+	fswatch_change_t *items; /* Changes, at most one per file name. */
+	int nitems;              /* Number of elements in the items array. */
+	int lost;                /* Whether the list is incomplete. */
+}
+fswatch_changes_t;
+
 /* Opaque type of a watcher. */
 typedef struct fswatch_t fswatch_t;
 
@@ -45,6 +73,38 @@ void fswatch_free(fswatch_t *w);
  * query.  Returns latest state. */
 FSWatchState fswatch_poll(fswatch_t *w);
 
+/* Same as fswatch_poll(), but also appends changes of files to the list unless
+ * it's NULL.  The list is marked as lost if it can't describe all changes
+ * (e.g., on queue overflow, too many changes or when the directory itself has
+ * changed).  Returns latest state. */
+FSWatchState fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes);
+
+/* Frees contents of the list of changes and empties it. */
+void fswatch_changes_free(fswatch_changes_t *changes);
+
+/* Creates watcher for a set of directories, which is initially empty.  Returns
+ * the watcher or NULL if such watchers aren't supported or on error. */
+fswatch_t * fswatch_create_set(void);
+
+/* Starts updating set of directories watched by the watcher.  Directories that
+ * aren't added again before fswatch_end_update() stop being watched. */
+void fswatch_begin_update(fswatch_t *w);
+
+/* Adds directory to the set of the watcher or marks it as still being needed
+ * during an update.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int fswatch_add(fswatch_t *w, const char path[]);
+
+/* Finishes updating set of directories started by fswatch_begin_update(). */
+void fswatch_end_update(fswatch_t *w);
+
+/* Appends paths of directories of the set whose contents or files changed
+ * since last query to the list.  FSWS_UPDATED is returned if at least one of
+ * the changes deserves attention right away, FSWS_ERRORED means that some
+ * changes might have been lost and the whole set should be considered changed.
+ * Returns latest state. */
+FSWatchState fswatch_poll_set(fswatch_t *w, struct strlist_t *changed);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -29,21 +29,34 @@
 #include <errno.h> /* EAGAIN errno */
 #include <stddef.h> /* NULL */
 #include <stdint.h> /* uint32_t */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* memmove() strdup() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/reallocarray.h"
+#include "str.h"
+#include "string_array.h"
 #include "trie.h"
 
 /* TODO: consider implementation that could reuse already available descriptor
  *       by just removing old watch and then adding a new one. */
 
+/* Directory that's part of a set watched by a single watcher. */
+typedef struct
+{
+	char *path; /* Path to the directory. */
+	int wd;     /* Watch descriptor. */
+	int marked; /* Whether the directory was added during current update. */
+}
+watch_t;
+
 /* Watcher data. */
 struct fswatch_t
 {
-	/* Path that's being watched. */
+	/* Path that's being watched.  NULL for a set of directories. */
 	char *path;
 	/* File descriptor for inotify. */
 	int fd;
@@ -54,6 +67,11 @@ struct fswatch_t
 	/* To monitor mount events, which aren't reported by inotify. */
 	dev_t dev;
 	ino_t inode;
+
+	/* Directories of a set sorted by their watch descriptors. */
+	watch_t *watches;
+	/* Number of elements in the watches array. */
+	int nwatches;
 };
 
 /* Per file statistics information. */
@@ -68,8 +86,14 @@ typedef struct
 notif_stat_t;
 
 static FSWatchState poll_for_replacement(fswatch_t *w);
+static void note_change(fswatch_changes_t *changes,
+		const struct inotify_event *e);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
-		time_t now);
+		const char key[], time_t now);
+static void note_set_change(fswatch_t *w, const struct inotify_event *e,
+		strlist_t *changed, int *worth_attention, time_t now);
+static watch_t * find_watch(fswatch_t *w, int wd);
+static void remove_watch(fswatch_t *w, watch_t *watch);
 
 /* Events we're interested in. */
 static const uint32_t EVENTS_MASK = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE
@@ -93,6 +117,8 @@ fswatch_create(const char path[])
 
 	w->dev = st.st_dev;
 	w->inode = st.st_ino;
+	w->watches = NULL;
+	w->nwatches = 0;
 
 	/* Create tree to collect update frequency statistics. */
 	w->stats = trie_create(&free);
@@ -137,6 +163,13 @@ fswatch_free(fswatch_t *w)
 {
 	if(w != NULL)
 	{
+		int i;
+		for(i = 0; i < w->nwatches; ++i)
+		{
+			free(w->watches[i].path);
+		}
+		free(w->watches);
+
 		free(w->path);
 		trie_free(w->stats);
 		close(w->fd);
@@ -146,6 +179,12 @@ fswatch_free(fswatch_t *w)
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
@@ -181,9 +220,24 @@ fswatch_poll(fswatch_t *w)
 				return poll_for_replacement(w);
 			}
 
-			if((e->mask & EVENTS_MASK) != 0 && update_file_stats(w, e, now))
+			if(e->mask & IN_Q_OVERFLOW)
+			{
+				changed = 1;
+				if(changes != NULL)
+				{
+					changes->lost = 1;
+				}
+				continue;
+			}
+
+			const char *const fname = (e->len == 0U) ? "." : e->name;
+			if((e->mask & EVENTS_MASK) != 0 && update_file_stats(w, e, fname, now))
 			{
 				changed = 1;
+				if(changes != NULL)
+				{
+					note_change(changes, e);
+				}
 			}
 		}
 
@@ -199,6 +253,93 @@ fswatch_poll(fswatch_t *w)
 	return (changed ? FSWS_UPDATED : poll_for_replacement(w));
 }
 
+void
+fswatch_changes_free(fswatch_changes_t *changes)
+{
+	int i;
+	for(i = 0; i < changes->nitems; ++i)
+	{
+		free(changes->items[i].name);
+	}
+	free(changes->items);
+
+	changes->items = NULL;
+	changes->nitems = 0;
+	changes->lost = 0;
+}
+
+/* Records change described by the event in the list merging it with an earlier
+ * change of the same file. */
+static void
+note_change(fswatch_changes_t *changes, const struct inotify_event *e)
+{
+	/* Past this point reading the directory anew is cheaper. */
+	enum { MAX_CHANGES = 512 };
+
+	if(changes->lost)
+	{
+		return;
+	}
+
+	if(e->len == 0U)
+	{
+		/* It's the directory that has changed. */
+		fswatch_changes_free(changes);
+		changes->lost = 1;
+		return;
+	}
+
+	FSWatchChange kind = FSWC_MODIFIED;
+	if(e->mask & (IN_CREATE | IN_MOVED_TO))
+	{
+		kind = FSWC_CREATED;
+	}
+	else if(e->mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		kind = FSWC_DELETED;
+	}
+
+	int i;
+	for(i = 0; i < changes->nitems; ++i)
+	{
+		fswatch_change_t *const change = &changes->items[i];
+		if(strcmp(change->name, e->name) == 0)
+		{
+			/* Modification of a new file doesn't make it any less new. */
+			if(kind != FSWC_MODIFIED || change->kind == FSWC_DELETED)
+			{
+				change->kind = kind;
+			}
+			return;
+		}
+	}
+
+	fswatch_change_t *items = NULL;
+	if(changes->nitems < MAX_CHANGES)
+	{
+		items = reallocarray(changes->items, changes->nitems + 1, sizeof(*items));
+	}
+	if(items == NULL)
+	{
+		fswatch_changes_free(changes);
+		changes->lost = 1;
+		return;
+	}
+	changes->items = items;
+
+	char *const name = strdup(e->name);
+	if(name == NULL)
+	{
+		fswatch_changes_free(changes);
+		changes->lost = 1;
+		return;
+	}
+
+	changes->items[changes->nitems].name = name;
+	changes->items[changes->nitems].kind = kind;
+	++changes->nitems;
+}
+
 /* Detects replacement of path's target.  Returns watcher's state. */
 static FSWatchState
 poll_for_replacement(fswatch_t *w)
@@ -232,24 +373,24 @@ poll_for_replacement(fswatch_t *w)
 	return FSWS_REPLACED;
 }
 
-/* Updates information about a file event is about.  Returns non-zero if this is
- * an interesting event that's worth attention (e.g. re-reading information from
- * file system), otherwise zero is returned. */
+/* Updates information about a file event is about, key identifies the file.
+ * Returns non-zero if this is an interesting event that's worth attention (e.g.
+ * re-reading information from file system), otherwise zero is returned. */
 static int
-update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
+update_file_stats(fswatch_t *w, const struct inotify_event *e,
+		const char key[], time_t now)
 {
 	enum { HITS_TO_BAN_AFTER = 5, BAN_SECS = 5 };
 
 	const uint32_t IMPORTANT_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM
 	                                | IN_MOVED_TO | IN_Q_OVERFLOW;
 
-	const char *const fname = (e->len == 0U) ? "." : e->name;
 	void *data;
 	notif_stat_t *stats;
 
 	/* See if we already know this file and retrieve associated information if
 	 * so. */
-	if(trie_get(w->stats, fname, &data) != 0)
+	if(trie_get(w->stats, key, &data) != 0)
 	{
 		notif_stat_t *const stats = malloc(sizeof(*stats));
 		if(stats != NULL)
@@ -257,7 +398,7 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 			stats->last_update = now;
 			stats->banned_until = 0U;
 			stats->count = 1;
-			if(trie_set(w->stats, fname, stats) != 0)
+			if(trie_set(w->stats, key, stats) != 0)
 			{
 				free(stats);
 			}
@@ -298,6 +439,271 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	return 1;
 }
 
+fswatch_t *
+fswatch_create_set(void)
+{
+	fswatch_t *const w = malloc(sizeof(*w));
+	if(w == NULL)
+	{
+		return NULL;
+	}
+
+	w->path = NULL;
+	w->wd = -1;
+	w->dev = 0;
+	w->inode = 0;
+	w->watches = NULL;
+	w->nwatches = 0;
+
+	w->stats = trie_create(&free);
+	if(w->stats == NULL)
+	{
+		free(w);
+		return NULL;
+	}
+
+	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(w->fd == -1)
+	{
+		trie_free(w->stats);
+		free(w);
+		return NULL;
+	}
+
+	return w;
+}
+
+void
+fswatch_begin_update(fswatch_t *w)
+{
+	int i;
+	for(i = 0; i < w->nwatches; ++i)
+	{
+		w->watches[i].marked = 0;
+	}
+}
+
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	/* Adding a watch for the same directory again just returns its descriptor,
+	 * so there is no need to look it up by path. */
+	const int wd = inotify_add_watch(w->fd, path, EVENTS_MASK);
+	if(wd == -1)
+	{
+		return 1;
+	}
+
+	watch_t *watch = find_watch(w, wd);
+	if(watch != NULL)
+	{
+		/* The same directory can be reachable by multiple paths (e.g., via bind
+		 * mounts), but only one of them can be reported. */
+		if(stroscmp(watch->path, path) != 0)
+		{
+			return 1;
+		}
+
+		watch->marked = 1;
+		return 0;
+	}
+
+	char *const path_copy = strdup(path);
+	watch_t *const watches = reallocarray(w->watches, w->nwatches + 1,
+			sizeof(*watches));
+	if(path_copy == NULL || watches == NULL)
+	{
+		free(path_copy);
+		if(watches != NULL)
+		{
+			w->watches = watches;
+		}
+		(void)inotify_rm_watch(w->fd, wd);
+		return 1;
+	}
+	w->watches = watches;
+
+	/* Descriptors are usually allocated in increasing order, so this rarely
+	 * moves anything. */
+	int pos = w->nwatches;
+	while(pos > 0 && w->watches[pos - 1].wd > wd)
+	{
+		--pos;
+	}
+	memmove(&w->watches[pos + 1], &w->watches[pos],
+			sizeof(*w->watches)*(w->nwatches - pos));
+
+	w->watches[pos].path = path_copy;
+	w->watches[pos].wd = wd;
+	w->watches[pos].marked = 1;
+	++w->nwatches;
+	return 0;
+}
+
+void
+fswatch_end_update(fswatch_t *w)
+{
+	int i = 0;
+	while(i < w->nwatches)
+	{
+		if(w->watches[i].marked)
+		{
+			++i;
+			continue;
+		}
+
+		/* See comment in poll_for_replacement() on ignoring errors. */
+		(void)inotify_rm_watch(w->fd, w->watches[i].wd);
+		remove_watch(w, &w->watches[i]);
+	}
+}
+
+FSWatchState
+fswatch_poll_set(fswatch_t *w, strlist_t *changed)
+{
+	enum { MAX_READS = 100 };
+	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
+
+	char buf[BUF_LEN];
+	int nread;
+	int worth_attention = 0;
+	int overflow = 0;
+	int nreads = 0;
+	const time_t now = time(NULL);
+
+	do
+	{
+		char *p;
+		struct inotify_event *e;
+
+		nread = read(w->fd, buf, BUF_LEN);
+		if(nread < 0)
+		{
+			if(errno != EAGAIN)
+			{
+				return FSWS_ERRORED;
+			}
+			break;
+		}
+
+		for(p = buf; p < buf + nread; p += sizeof(struct inotify_event) + e->len)
+		{
+			e = (struct inotify_event *)p;
+			if(e->mask & IN_Q_OVERFLOW)
+			{
+				overflow = 1;
+				continue;
+			}
+
+			note_set_change(w, e, changed, &worth_attention, now);
+		}
+
+		if(++nreads > MAX_READS)
+		{
+			/* Unprocessed events would be reported by the next call, but their
+			 * directories have to be re-read right away. */
+			overflow = 1;
+			break;
+		}
+	}
+	while(nread != 0);
+
+	if(overflow)
+	{
+		return FSWS_ERRORED;
+	}
+	return (worth_attention ? FSWS_UPDATED : FSWS_UNCHANGED);
+}
+
+/* Processes single event of a set watcher.  Every change marks its directory as
+ * changed, while statistics decide whether it's worth attention. */
+static void
+note_set_change(fswatch_t *w, const struct inotify_event *e,
+		strlist_t *changed, int *worth_attention, time_t now)
+{
+	watch_t *const watch = find_watch(w, e->wd);
+	if(watch == NULL)
+	{
+		return;
+	}
+
+	if(e->mask & IN_IGNORED)
+	{
+		/* Directory was removed or unmounted, its parent is notified about this
+		 * separately. */
+		if(!is_in_string_array_os(changed->items, changed->nitems, watch->path))
+		{
+			changed->nitems = add_to_string_array(&changed->items, changed->nitems,
+					watch->path);
+		}
+		remove_watch(w, watch);
+		*worth_attention = 1;
+		return;
+	}
+
+	if((e->mask & EVENTS_MASK) == 0)
+	{
+		return;
+	}
+
+	if(!is_in_string_array_os(changed->items, changed->nitems, watch->path))
+	{
+		changed->nitems = add_to_string_array(&changed->items, changed->nitems,
+				watch->path);
+	}
+
+	char key[PATH_MAX + 1];
+	if(e->len == 0U)
+	{
+		copy_str(key, sizeof(key), watch->path);
+	}
+	else
+	{
+		snprintf(key, sizeof(key), "%s/%s", watch->path, e->name);
+	}
+
+	if(update_file_stats(w, e, key, now))
+	{
+		*worth_attention = 1;
+	}
+}
+
+/* Looks up directory of a set by its watch descriptor.  Returns pointer to the
+ * directory or NULL. */
+static watch_t *
+find_watch(fswatch_t *w, int wd)
+{
+	int l = 0, u = w->nwatches - 1;
+	while(l <= u)
+	{
+		const int i = l + (u - l)/2;
+		if(w->watches[i].wd == wd)
+		{
+			return &w->watches[i];
+		}
+
+		if(w->watches[i].wd < wd)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i - 1;
+		}
+	}
+	return NULL;
+}
+
+/* Removes directory from a set of the watcher. */
+static void
+remove_watch(fswatch_t *w, watch_t *watch)
+{
+	const int pos = watch - w->watches;
+	free(watch->path);
+	memmove(watch, watch + 1, sizeof(*watch)*(w->nwatches - pos - 1));
+	--w->nwatches;
+}
+
 #else
 
 #include "filemon.h"
@@ -348,6 +754,12 @@ fswatch_free(fswatch_t *w)
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
 {
 	filemon_t filemon;
 	if(filemon_from_file(w->path, FMT_MODIFIED, &filemon) != 0)
@@ -359,9 +771,54 @@ fswatch_poll(fswatch_t *w)
 
 	w->filemon = filemon;
 
+	if(changed && changes != NULL)
+	{
+		/* Timestamps say nothing about which files have changed. */
+		changes->lost = 1;
+	}
+
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+void
+fswatch_changes_free(fswatch_changes_t *changes)
+{
+	free(changes->items);
+	changes->items = NULL;
+	changes->nitems = 0;
+	changes->lost = 0;
+}
+
+fswatch_t *
+fswatch_create_set(void)
+{
+	/* Polling each directory is what the caller is expected to do without
+	 * notifications. */
+	return NULL;
+}
+
+void
+fswatch_begin_update(fswatch_t *w)
+{
+}
+
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	return 1;
+}
+
+void
+fswatch_end_update(fswatch_t *w)
+{
+}
+
+FSWatchState
+fswatch_poll_set(fswatch_t *w, struct strlist_t *changed)
+{
+	return FSWS_ERRORED;
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -88,6 +88,12 @@ fswatch_free(fswatch_t *w)
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	return fswatch_poll_changes(w, NULL);
+}
+
+FSWatchState
+fswatch_poll_changes(fswatch_t *w, fswatch_changes_t *changes)
 {
 	FILETIME ft;
 	if(get_dir_mtime(w->wpath, &ft) != 0)
@@ -104,9 +110,54 @@ fswatch_poll(fswatch_t *w)
 		changed = 1;
 	}
 
+	if(changed && changes != NULL)
+	{
+		/* Notifications say nothing about which files have changed. */
+		changes->lost = 1;
+	}
+
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+void
+fswatch_changes_free(fswatch_changes_t *changes)
+{
+	free(changes->items);
+	changes->items = NULL;
+	changes->nitems = 0;
+	changes->lost = 0;
+}
+
+fswatch_t *
+fswatch_create_set(void)
+{
+	/* Polling each directory is what the caller is expected to do without
+	 * notifications. */
+	return NULL;
+}
+
+void
+fswatch_begin_update(fswatch_t *w)
+{
+}
+
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	return 1;
+}
+
+void
+fswatch_end_update(fswatch_t *w)
+{
+}
+
+FSWatchState
+fswatch_poll_set(fswatch_t *w, struct strlist_t *changed)
+{
+	return FSWS_ERRORED;
+}
+
 /* Gets last directory modification time.  Returns non-zero on error, otherwise
  * zero is returned. */
 static int
@@ -18,12 +18,82 @@
 
 #include "globs.h"
 
-#include <stdlib.h> /* free() realloc() */
+#include <ctype.h> /* tolower() */
+#include <limits.h> /* INT_MAX */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() realloc() */
 #include <stdio.h> /* sprintf() */
-#include <string.h> /* strdup() */
+#include <string.h> /* memmove() strcspn() strdup() strlen() strncasecmp() */
 
+#include "../compat/reallocarray.h"
 #include "str.h"
 
+/* Initial value of a hash. */
+#define HASH_INIT 2166136261U
+
+/* Kinds of globs with regard to table of globs. */
+typedef enum
+{
+	GK_LITERAL, /* No special characters. */
+	GK_ESCAPED, /* Literal with escaped asterisk. */
+	GK_SUFFIX,  /* Asterisk followed by a literal. */
+	GK_INFIX,   /* Asterisk in the middle or at the end. */
+	GK_COMPLEX, /* Anything else, not supported by tables. */
+}
+GlobKind;
+
+/* Entry of a hash table that maps a string to ids of globs. */
+typedef struct
+{
+	char *key;         /* Literal or suffix, NULL for unused entries. */
+	size_t len;        /* Length of the key. */
+	unsigned int hash; /* Hash of the key. */
+	int *ids;          /* Ids of globs in ascending order. */
+	int nids;          /* Number of ids. */
+}
+gt_entry_t;
+
+/* Open addressing hash table with case insensitive keys. */
+typedef struct
+{
+	gt_entry_t *entries; /* Buckets. */
+	size_t size;         /* Number of buckets (zero or a power of two). */
+	size_t count;        /* Number of used buckets. */
+	size_t max_len;      /* Length of the longest key. */
+}
+gt_hash_t;
+
+/* Glob of the form "prefix*suffix" (suffix can be empty). */
+typedef struct
+{
+	char *prefix;       /* Part before the asterisk. */
+	size_t prefix_len;  /* Length of the prefix. */
+	const char *suffix; /* Part after the asterisk (points into prefix). */
+	int id;             /* Id of the glob. */
+}
+gt_infix_t;
+
+struct globs_table_t
+{
+	gt_hash_t literals;  /* Globs without wildcards. */
+	gt_hash_t suffixes;  /* Globs of the form "*suffix" keyed by the suffix. */
+	gt_infix_t *infixes; /* Globs of the form "prefix*suffix" ordered by id. */
+	int ninfixes;        /* Number of elements in infixes. */
+};
+
+static GlobKind classify_glob(const char glob[], size_t *star_pos);
+static int add_glob(globs_table_t *table, char glob[], int id);
+static int add_infix(globs_table_t *table, const char glob[], size_t star_pos,
+		int id);
+static int hash_add(gt_hash_t *hash, const char key[], size_t len, int id);
+static int hash_grow(gt_hash_t *hash);
+static void hash_free(gt_hash_t *hash);
+static gt_entry_t * hash_find(const gt_hash_t *hash, unsigned int h,
+		const char key[], size_t len);
+static int pick_id(const gt_entry_t *entry, int from, int best);
+static unsigned int hash_str(const char str[], size_t len);
+static unsigned int hash_step(unsigned int hash, char c);
+
 char *
 globs_to_regex(const char globs[])
 {
@@ -164,5 +234,386 @@ glob_to_regex(const char glob[], int extended)
 	return result;
 }
 
+globs_table_t *
+globs_table_alloc(void)
+{
+	return calloc(1, sizeof(globs_table_t));
+}
+
+void
+globs_table_free(globs_table_t *table)
+{
+	if(table == NULL)
+	{
+		return;
+	}
+
+	hash_free(&table->literals);
+	hash_free(&table->suffixes);
+
+	int i;
+	for(i = 0; i < table->ninfixes; ++i)
+	{
+		free(table->infixes[i].prefix);
+	}
+	free(table->infixes);
+
+	free(table);
+}
+
+int
+globs_table_accepts(const char globs[])
+{
+	if(globs[0] == '\0')
+	{
+		return 0;
+	}
+
+	char *globs_copy = strdup(globs);
+	if(globs_copy == NULL)
+	{
+		return 0;
+	}
+
+	size_t star_pos;
+	char *glob = globs_copy, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		if(classify_glob(glob, &star_pos) == GK_COMPLEX)
+		{
+			break;
+		}
+	}
+
+	free(globs_copy);
+	return (glob == NULL);
+}
+
+int
+globs_table_add(globs_table_t *table, const char globs[], int id)
+{
+	char *globs_copy = strdup(globs);
+	if(globs_copy == NULL)
+	{
+		return 1;
+	}
+
+	char *glob = globs_copy, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		if(add_glob(table, glob, id) != 0)
+		{
+			break;
+		}
+	}
+
+	free(globs_copy);
+	return (glob != NULL);
+}
+
+/* Determines kind of a single glob.  Sets *star_pos to position of the first
+ * asterisk if there is one.  Returns the kind. */
+static GlobKind
+classify_glob(const char glob[], size_t *star_pos)
+{
+	const size_t pos = strcspn(glob, "[?*");
+	if(glob[pos] == '\0')
+	{
+		return GK_LITERAL;
+	}
+
+	if(glob[pos] != '*' ||
+			glob[pos + 1 + strcspn(glob + pos + 1, "[?*")] != '\0')
+	{
+		return GK_COMPLEX;
+	}
+
+	*star_pos = pos;
+	if(pos == 0)
+	{
+		return GK_SUFFIX;
+	}
+	return (glob[pos - 1] == '\\') ? GK_ESCAPED : GK_INFIX;
+}
+
+/* Adds a single glob to the table.  Returns zero on success. */
+static int
+add_glob(globs_table_t *table, char glob[], int id)
+{
+	size_t star_pos;
+	switch(classify_glob(glob, &star_pos))
+	{
+		case GK_LITERAL:
+			return hash_add(&table->literals, glob, strlen(glob), id);
+		case GK_ESCAPED:
+			/* Drop the backslash to get the literal. */
+			memmove(glob + star_pos - 1, glob + star_pos,
+					strlen(glob + star_pos) + 1);
+			return hash_add(&table->literals, glob, strlen(glob), id);
+		case GK_SUFFIX:
+			return hash_add(&table->suffixes, glob + 1, strlen(glob + 1), id);
+		case GK_INFIX:
+			return add_infix(table, glob, star_pos, id);
+		case GK_COMPLEX:
+			break;
+	}
+	return 1;
+}
+
+/* Adds "prefix*suffix" glob to the table.  Returns zero on success. */
+static int
+add_infix(globs_table_t *table, const char glob[], size_t star_pos, int id)
+{
+	gt_infix_t *const infixes = reallocarray(table->infixes,
+			table->ninfixes + 1, sizeof(*infixes));
+	if(infixes == NULL)
+	{
+		return 1;
+	}
+	table->infixes = infixes;
+
+	char *const prefix = strdup(glob);
+	if(prefix == NULL)
+	{
+		return 1;
+	}
+	prefix[star_pos] = '\0';
+
+	gt_infix_t *const infix = &table->infixes[table->ninfixes++];
+	infix->prefix = prefix;
+	infix->prefix_len = star_pos;
+	infix->suffix = prefix + star_pos + 1;
+	infix->id = id;
+	return 0;
+}
+
+/* Adds id to an entry of the key creating the entry if needed.  Returns zero
+ * on success. */
+static int
+hash_add(gt_hash_t *hash, const char key[], size_t len, int id)
+{
+	const unsigned int h = hash_str(key, len);
+	gt_entry_t *entry = hash_find(hash, h, key, len);
+
+	if(entry == NULL)
+	{
+		if((hash->count + 1)*2 > hash->size && hash_grow(hash) != 0)
+		{
+			return 1;
+		}
+
+		char *const key_copy = strdup(key);
+		if(key_copy == NULL)
+		{
+			return 1;
+		}
+
+		size_t i = h & (hash->size - 1);
+		while(hash->entries[i].key != NULL)
+		{
+			i = (i + 1) & (hash->size - 1);
+		}
+
+		entry = &hash->entries[i];
+		entry->key = key_copy;
+		entry->len = len;
+		entry->hash = h;
+		++hash->count;
+
+		if(len > hash->max_len)
+		{
+			hash->max_len = len;
+		}
+	}
+	else if(entry->ids[entry->nids - 1] == id)
+	{
+		return 0;
+	}
+
+	int *const ids = reallocarray(entry->ids, entry->nids + 1, sizeof(*ids));
+	if(ids == NULL)
+	{
+		return 1;
+	}
+
+	entry->ids = ids;
+	entry->ids[entry->nids++] = id;
+	return 0;
+}
+
+/* Doubles number of buckets in the hash.  Returns zero on success. */
+static int
+hash_grow(gt_hash_t *hash)
+{
+	const size_t new_size = (hash->size == 0U ? 16U : hash->size*2U);
+	gt_entry_t *const entries = calloc(new_size, sizeof(*entries));
+	if(entries == NULL)
+	{
+		return 1;
+	}
+
+	size_t i;
+	for(i = 0U; i < hash->size; ++i)
+	{
+		if(hash->entries[i].key == NULL)
+		{
+			continue;
+		}
+
+		size_t j = hash->entries[i].hash & (new_size - 1U);
+		while(entries[j].key != NULL)
+		{
+			j = (j + 1U) & (new_size - 1U);
+		}
+		entries[j] = hash->entries[i];
+	}
+
+	free(hash->entries);
+	hash->entries = entries;
+	hash->size = new_size;
+	return 0;
+}
+
+/* Frees resources of the hash. */
+static void
+hash_free(gt_hash_t *hash)
+{
+	size_t i;
+	for(i = 0U; i < hash->size; ++i)
+	{
+		free(hash->entries[i].key);
+		free(hash->entries[i].ids);
+	}
+	free(hash->entries);
+}
+
+/* Looks up an entry by a key that isn't necessarily null-terminated.  Returns
+ * the entry or NULL. */
+static gt_entry_t *
+hash_find(const gt_hash_t *hash, unsigned int h, const char key[], size_t len)
+{
+	if(hash->count == 0U)
+	{
+		return NULL;
+	}
+
+	size_t i = h & (hash->size - 1U);
+	while(hash->entries[i].key != NULL)
+	{
+		gt_entry_t *const entry = &hash->entries[i];
+		if(entry->hash == h && entry->len == len &&
+				strncasecmp(entry->key, key, len) == 0)
+		{
+			return entry;
+		}
+		i = (i + 1U) & (hash->size - 1U);
+	}
+	return NULL;
+}
+
+int
+globs_table_match(const globs_table_t *table, const char name[], int from)
+{
+	int best = INT_MAX;
+	const size_t len = strlen(name);
+	const gt_hash_t *const literals = &table->literals;
+	const gt_hash_t *const suffixes = &table->suffixes;
+
+	/* Suffix globs don't match names starting with a dot and can't match the
+	 * first character. */
+	const int check_suffixes = (suffixes->count != 0U && len != 0U &&
+			name[0] != '.');
+	const int check_literals = (literals->count != 0U &&
+			len <= literals->max_len);
+
+	/* Lowest position in the name that needs to be hashed. */
+	size_t stop = len;
+	if(check_literals)
+	{
+		stop = 0U;
+	}
+	else if(check_suffixes)
+	{
+		stop = (len - 1U > suffixes->max_len) ? len - suffixes->max_len : 1U;
+	}
+
+	/* Walk from the end of the name computing hashes of all of its suffixes that
+	 * can be in the tables. */
+	unsigned int hash = HASH_INIT;
+	size_t pos = len;
+	while(1)
+	{
+		if(check_suffixes && pos != 0U && len - pos <= suffixes->max_len)
+		{
+			best = pick_id(hash_find(suffixes, hash, name + pos, len - pos), from,
+					best);
+		}
+		if(pos == stop)
+		{
+			break;
+		}
+		hash = hash_step(hash, name[--pos]);
+	}
+
+	if(check_literals)
+	{
+		best = pick_id(hash_find(literals, hash, name, len), from, best);
+	}
+
+	int i;
+	for(i = 0; i < table->ninfixes && table->infixes[i].id < best; ++i)
+	{
+		const gt_infix_t *const infix = &table->infixes[i];
+		if(infix->id >= from &&
+				strncasecmp(name, infix->prefix, infix->prefix_len) == 0 &&
+				ends_with_case(name + infix->prefix_len, infix->suffix))
+		{
+			best = infix->id;
+			break;
+		}
+	}
+
+	return (best == INT_MAX ? -1 : best);
+}
+
+/* Picks smallest id of the entry which isn't less than from if it's smaller
+ * than the best one.  Returns new best id. */
+static int
+pick_id(const gt_entry_t *entry, int from, int best)
+{
+	if(entry != NULL)
+	{
+		int i;
+		for(i = 0; i < entry->nids && entry->ids[i] < best; ++i)
+		{
+			if(entry->ids[i] >= from)
+			{
+				return entry->ids[i];
+			}
+		}
+	}
+	return best;
+}
+
+/* Computes hash of a string in the same way globs_table_match() does it for
+ * suffixes of names.  Returns the hash. */
+static unsigned int
+hash_str(const char str[], size_t len)
+{
+	unsigned int hash = HASH_INIT;
+	while(len-- != 0U)
+	{
+		hash = hash_step(hash, str[len]);
+	}
+	return hash;
+}
+
+/* Adds one more character in front of a hashed string.  Returns new hash. */
+static unsigned int
+hash_step(unsigned int hash, char c)
+{
+	return (hash ^ (unsigned char)tolower((unsigned char)c))*16777619U;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
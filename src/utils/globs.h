@@ -38,6 +38,35 @@ char * globs_to_regex(const char globs[]);
  * there is not enough memory. */
 char * glob_to_regex(const char glob[], int extended);
 
+/* Table of simple case insensitive globs, each of which is either a literal, a
+ * literal with an escaped asterisk ("a\*b") or has single asterisk (but
+ * "*suffix" doesn't match names that start with a dot).  Literals and suffixes
+ * are kept in hash tables, which allows matching a name against the whole table
+ * in a single pass over it.  Every glob has an id and match reports the
+ * smallest one. */
+
+/* Opaque table type. */
+typedef struct globs_table_t globs_table_t;
+
+/* Allocates an empty table.  Returns the table or NULL on error. */
+globs_table_t * globs_table_alloc(void);
+
+/* Frees the table.  table can be NULL. */
+void globs_table_free(globs_table_t *table);
+
+/* Checks whether all globs of comma-separated list can be put into a table.
+ * Returns non-zero if so, otherwise zero is returned. */
+int globs_table_accepts(const char globs[]);
+
+/* Adds comma-separated list of globs under the id, which must not be less than
+ * any id added before.  Returns zero on success, otherwise non-zero is returned
+ * and table might contain part of the globs. */
+int globs_table_add(globs_table_t *table, const char globs[], int id);
+
+/* Finds smallest id that is not less than from of a glob that matches the
+ * name.  Returns the id or -1 if there is no match. */
+int globs_table_match(const globs_table_t *table, const char name[], int from);
+
 #endif /* VIFM__UTILS__GLOBS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
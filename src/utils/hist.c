@@ -20,16 +20,19 @@
 
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* calloc() free() */
-#include <string.h> /* memmove() */
+#include <string.h> /* memcpy() memmove() strdup() */
 #include <time.h> /* time_t */
 
-#include "../compat/reallocarray.h"
 #include "macros.h"
+#include "trie.h"
 
-static int move_to_first_position(hist_t *hist, const char item[],
+static int allocate_storage(hist_t *hist, int capacity);
+static void move_to_first_position(hist_t *hist, const char text[],
 		time_t timestamp);
 static int insert_at_first_position(hist_t *hist, const char item[],
 		time_t timestamp);
+static void drop_last_item(hist_t *hist);
+static void rebuild_index(hist_t *hist);
 
 int
 hist_init(hist_t *hist, int capacity)
@@ -39,11 +42,14 @@ hist_init(hist_t *hist, int capacity)
 		capacity = 0;
 	}
 
+	hist->items = NULL;
 	hist->size = 0;
 	hist->capacity = 0;
+	hist->buf = NULL;
+	hist->index = NULL;
+	hist->nremoved = 0;
 
-	hist->items = calloc(capacity, sizeof(*hist->items));
-	if(hist->items == NULL)
+	if(allocate_storage(hist, capacity) != 0)
 	{
 		return 1;
 	}
@@ -60,11 +66,15 @@ hist_reset(hist_t *hist)
 	{
 		free(hist->items[i].text);
 	}
-	free(hist->items);
+	free(hist->buf);
+	trie_free(hist->index);
 
 	hist->items = NULL;
 	hist->size = 0;
 	hist->capacity = 0;
+	hist->buf = NULL;
+	hist->index = NULL;
+	hist->nremoved = 0;
 }
 
 int
@@ -83,15 +93,42 @@ hist_resize(hist_t *hist, int new_capacity)
 	}
 
 	/* Free truncated elements, if any. */
-	int i;
-	for(i = new_capacity; i < hist->size; ++i)
+	while(hist->size > new_capacity)
 	{
-		free(hist->items[i].text);
+		drop_last_item(hist);
+	}
+
+	if(allocate_storage(hist, new_capacity) == 0)
+	{
+		hist->capacity = new_capacity;
+	}
+}
+
+/* Replaces storage of the history with a new one of specified capacity, which
+ * must be enough to hold current items.  The storage is twice as large as the
+ * capacity and items are kept at its end, so adding an item just takes a slot
+ * in front of them and the room is restored once per capacity additions.
+ * Returns zero on success, otherwise non-zero is returned and the history is
+ * left unchanged. */
+static int
+allocate_storage(hist_t *hist, int capacity)
+{
+	hist_item_t *const buf = calloc(2*capacity, sizeof(*buf));
+	if(buf == NULL)
+	{
+		return 1;
 	}
 
-	hist->items = reallocarray(hist->items, new_capacity, sizeof(*hist->items));
-	hist->size = MIN(hist->size, new_capacity);
-	hist->capacity = new_capacity;
+	hist_item_t *const items = buf + capacity;
+	if(hist->size != 0)
+	{
+		memcpy(items, hist->items, sizeof(*items)*hist->size);
+	}
+
+	free(hist->buf);
+	hist->buf = buf;
+	hist->items = items;
+	return 0;
 }
 
 int
@@ -99,38 +136,39 @@ hist_add(hist_t *hist, const char item[], time_t timestamp)
 {
 	if(hist->capacity > 0 && item[0] != '\0')
 	{
-		if(move_to_first_position(hist, item, timestamp) != 0)
+		void *data;
+		if(trie_get(hist->index, item, &data) == 0 && data != NULL)
 		{
-			return insert_at_first_position(hist, item, timestamp);
+			move_to_first_position(hist, data, timestamp);
+			return 0;
 		}
+		return insert_at_first_position(hist, item, timestamp);
 	}
 	return 0;
 }
 
-/* Moves item to the first position.  Returns zero on success or non-zero when
- * item wasn't found in the history. */
-static int
-move_to_first_position(hist_t *hist, const char item[], time_t timestamp)
+/* Moves item to the first position.  The text must be a pointer to text of one
+ * of the items. */
+static void
+move_to_first_position(hist_t *hist, const char text[], time_t timestamp)
 {
-	if(hist->size > 0 && strcmp(hist->items[0].text, item) == 0)
+	if(hist->items[0].text == text)
 	{
-		return 0;
+		return;
 	}
 
-	int i;
-	for(i = 1; i < hist->size; ++i)
+	/* Items in front of this one need to be shifted anyway, so looking it up by
+	 * pointer doesn't change complexity. */
+	int i = 1;
+	while(hist->items[i].text != text)
 	{
-		if(strcmp(hist->items[i].text, item) == 0)
-		{
-			hist_item_t item = hist->items[i];
-			item.timestamp = timestamp;
-			memmove(hist->items + 1, hist->items, sizeof(*hist->items)*i);
-			hist->items[0] = item;
-			return 0;
-		}
+		++i;
 	}
 
-	return 1;
+	hist_item_t item = hist->items[i];
+	item.timestamp = timestamp;
+	memmove(hist->items + 1, hist->items, sizeof(*hist->items)*i);
+	hist->items[0] = item;
 }
 
 /* Inserts item at the first position.  Returns zero on success or non-zero on
@@ -144,21 +182,82 @@ insert_at_first_position(hist_t *hist, const char item[], time_t timestamp)
 		return 1;
 	}
 
+	if(hist->index == NULL)
+	{
+		hist->index = trie_create(/*free_func=*/NULL);
+		if(hist->index == NULL)
+		{
+			free(item_copy);
+			return 1;
+		}
+	}
+
 	if(hist->size == hist->capacity)
 	{
-		free(hist->items[hist->size - 1].text);
+		drop_last_item(hist);
+	}
+
+	/* Key might be left from a removed item. */
+	void *data;
+	const int reused = (trie_get(hist->index, item_copy, &data) == 0);
+	if(trie_set(hist->index, item_copy, item_copy) < 0)
+	{
+		free(item_copy);
+		return 1;
 	}
-	else
+	if(reused)
 	{
-		++hist->size;
+		--hist->nremoved;
 	}
-	memmove(hist->items + 1, hist->items,
-			sizeof(*hist->items)*(hist->size - 1));
+
+	if(hist->items == hist->buf)
+	{
+		/* Restore room in front of the items. */
+		hist_item_t *const items = hist->buf + hist->capacity;
+		memmove(items, hist->items, sizeof(*items)*hist->size);
+		hist->items = items;
+	}
+
+	--hist->items;
+	++hist->size;
 
 	hist->items[0].text = item_copy;
 	hist->items[0].timestamp = timestamp;
 	return 0;
 }
 
+/* Frees the last item of the history. */
+static void
+drop_last_item(hist_t *hist)
+{
+	char *const text = hist->items[hist->size - 1].text;
+	--hist->size;
+
+	/* Index lacks removal of keys, so they are marked as removed and dropped
+	 * once there are too many of them. */
+	(void)trie_set(hist->index, text, NULL);
+	free(text);
+
+	if(++hist->nremoved > MAX(hist->capacity, 16))
+	{
+		rebuild_index(hist);
+	}
+}
+
+/* Recreates index of the history from its items. */
+static void
+rebuild_index(hist_t *hist)
+{
+	trie_free(hist->index);
+	hist->index = trie_create(/*free_func=*/NULL);
+	hist->nremoved = 0;
+
+	int i;
+	for(i = 0; i < hist->size; ++i)
+	{
+		(void)trie_set(hist->index, hist->items[i].text, hist->items[i].text);
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
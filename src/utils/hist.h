@@ -19,10 +19,14 @@
 #ifndef VIFM__UTILS__HIST_H__
 #define VIFM__UTILS__HIST_H__
 
-/* Generic implementation of history represented as list of strings. */
+/* Generic implementation of history represented as list of strings.  Items
+ * are indexed by their text, which makes adding new items and looking up
+ * existing ones independent of the size of the history. */
 
 #include <time.h> /* time_t */
 
+struct trie_t;
+
 /* Single entry of hist_t. */
 typedef struct
 {
@@ -37,6 +41,11 @@ typedef struct
 	hist_item_t *items; /* List of history items.  Can be NULL for empty list. */
 	int size;           /* Current size of the list. */
 	int capacity;       /* Maximum size of the list. */
+
+	/* Private fields, which shouldn't be accessed outside of the unit. */
+	hist_item_t *buf;     /* Storage of items with room for new ones in front. */
+	struct trie_t *index; /* Text of an item -> the text or NULL if removed. */
+	int nremoved;         /* Number of keys of removed items in the index. */
 }
 hist_t;
 
@@ -22,7 +22,7 @@
 
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* free() malloc() */
-#include <string.h> /* strcspn() strdup() strlen() strrchr() */
+#include <string.h> /* strdup() strlen() strrchr() */
 
 #include "../int/file_magic.h"
 #include "globs.h"
@@ -53,6 +53,7 @@ struct matcher_t
 	unsigned int fglobs : 1;    /* Whether this matcher is a special case of
 	                               globs ("faster" globs) that is optimized. */
 	regex_t regex; /* The expression in compiled form, unless matcher is empty. */
+	globs_table_t *globs; /* Table of "faster" globs or NULL. */
 };
 
 static matcher_t * alloc_matcher(matcher_t m, const char expr[], int cs_by_def,
@@ -63,7 +64,7 @@ static MType determine_type(const char expr[], int re, int glob,
 static int compile_expr(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static int parse_glob(matcher_t *m, int strip, char **error);
-static int is_fglobs(char expr[]);
+static globs_table_t * make_globs_table(const char globs[]);
 static int parse_re(matcher_t *m, int strip, int cs_by_def,
 		const char on_empty_re[], char **error);
 static void free_matcher_items(matcher_t *matcher);
@@ -266,8 +267,15 @@ parse_glob(matcher_t *m, int strip, char **error)
 		return 1;
 	}
 
-	if(is_fglobs(m->raw))
+	if(globs_table_accepts(m->raw))
 	{
+		m->globs = make_globs_table(m->raw);
+		if(m->globs == NULL)
+		{
+			replace_string(error, "Failed to build table of globs.");
+			return 1;
+		}
+
 		m->fglobs = 1;
 		return 0;
 	}
@@ -286,37 +294,18 @@ parse_glob(matcher_t *m, int strip, char **error)
 	return 0;
 }
 
-/* Checks whether expression (command-separated list of glob patterns) can be
- * implemented without regular expressions.  Returns non-zero if so, otherwise
- * zero is returned. */
-static int
-is_fglobs(char expr[])
+/* Builds table of globs for a "faster" globs matcher.  Returns the table or
+ * NULL on error. */
+static globs_table_t *
+make_globs_table(const char globs[])
 {
-	if(expr[0] == '\0')
-	{
-		return 0;
-	}
-
-	expr = strdup(expr);
-
-	char *glob = expr, *state = NULL;
-	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	globs_table_t *table = globs_table_alloc();
+	if(table != NULL && globs_table_add(table, globs, 0) != 0)
 	{
-		const size_t pos = strcspn(glob, "[?*");
-		if(glob[pos] == '\0')
-		{
-			continue;
-		}
-		if(glob[pos] == '*' &&
-				glob[pos + 1 + strcspn(glob + pos + 1, "[?*")] == '\0')
-		{
-			continue;
-		}
-		break;
+		globs_table_free(table);
+		table = NULL;
 	}
-
-	free(expr);
-	return (glob == NULL);
+	return table;
 }
 
 /* Parses regexp flags.  Returns zero on success or non-zero on error with
@@ -370,6 +359,7 @@ matcher_clone(const matcher_t *matcher)
 	}
 
 	*clone = *matcher;
+	clone->globs = NULL;
 	clone->expr = strdup(matcher->expr);
 	clone->raw = strdup(matcher->raw);
 	clone->undec = strdup(matcher->undec);
@@ -380,8 +370,17 @@ matcher_clone(const matcher_t *matcher)
 		return NULL;
 	}
 
+	if(clone->fglobs)
+	{
+		clone->globs = make_globs_table(clone->raw);
+		if(clone->globs == NULL)
+		{
+			matcher_free(clone);
+			return NULL;
+		}
+	}
 	/* Don't compile regex for faster globs or empty matcher. */
-	if(!clone->fglobs && clone->raw[0] != '\0')
+	else if(clone->raw[0] != '\0')
 	{
 		if(regexp_compile(&clone->regex, matcher->raw, matcher->cflags) != 0)
 		{
@@ -413,6 +412,7 @@ free_matcher_items(matcher_t *matcher)
 		/* Regex is compiled only for non-empty matchers of unoptimized patterns. */
 		regfree(&matcher->regex);
 	}
+	globs_table_free(matcher->globs);
 	free(matcher->expr);
 	free(matcher->raw);
 	free(matcher->undec);
@@ -453,56 +453,7 @@ matcher_matches(const matcher_t *matcher, const char path[])
 static int
 fglobs_matches(const matcher_t *matcher, const char path[])
 {
-	char *globs = strdup(matcher->raw);
-	char *glob = globs, *state = NULL;
-	while((glob = split_and_get_dc(glob, &state)) != NULL)
-	{
-		const char *asterisk = until_first(glob, '*');
-
-		/* Literal with no special characters. */
-		if(*asterisk == '\0')
-		{
-			if(strcasecmp(path, glob) == 0)
-			{
-				break;
-			}
-			continue;
-		}
-
-		size_t pos = asterisk - glob;
-		/* `*something` */
-		if(pos == 0)
-		{
-			if(path[0] != '.' && ends_with_case(path + 1, glob + 1))
-			{
-				break;
-			}
-			continue;
-		}
-
-		/* Literal with one escaped asterisk. */
-		if(asterisk[-1] == '\\')
-		{
-			/* Compare parts around '\\' to ignore it. */
-			--pos;
-			if(strncasecmp(path, glob, pos) == 0 &&
-					strcasecmp(path + pos, glob + pos + 1) == 0)
-			{
-				break;
-			}
-			continue;
-		}
-
-		/* Either `something*` or `some*thing`.  First case work here by matching
-		 * its empty suffix. */
-		if(strncasecmp(path, glob, pos) == 0 &&
-				ends_with_case(path + pos, glob + pos + 1))
-		{
-			break;
-		}
-	}
-	free(globs);
-	return (glob != NULL)^matcher->negated;
+	return (globs_table_match(matcher->globs, path, 0) == 0)^matcher->negated;
 }
 
 int
@@ -630,6 +581,19 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+int
+matcher_is_mime(const matcher_t *matcher)
+{
+	return matcher->type == MT_MIME;
+}
+
+int
+matcher_is_name_globs(const matcher_t *matcher)
+{
+	return matcher->fglobs && matcher->type == MT_GLOBS && !matcher->negated
+	    && !matcher->full_path;
+}
+
 TSTATIC int
 matcher_is_fast(const matcher_t *matcher)
 {
@@ -84,6 +84,15 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Checks whether matcher matches mime-types of files.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int matcher_is_mime(const matcher_t *matcher);
+
+/* Checks whether matcher matches file names against a list of globs that can be
+ * put into globs_table_t (the list is what matcher_get_undec() returns).
+ * Returns non-zero if so, otherwise zero is returned. */
+int matcher_is_name_globs(const matcher_t *matcher);
+
 TSTATIC_DEFS(
 	int matcher_is_fast(const matcher_t *matcher);
 )
@@ -0,0 +1,308 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "matcher_set.h"
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* strcmp() strdup() */
+
+#include "../compat/reallocarray.h"
+#include "../int/file_magic.h"
+#include "globs.h"
+#include "matcher.h"
+#include "matchers.h"
+#include "path.h"
+
+/* Number of memoized lists of matching rules. */
+#define MEMO_SIZE 256
+
+/* Matchers of a rule that aren't in the table of globs. */
+typedef struct
+{
+	const struct matchers_t *matchers; /* Conjunction of matchers. */
+	int rule;                          /* Index of the rule. */
+}
+other_t;
+
+/* Memoized list of rules that match a path. */
+typedef struct
+{
+	char *path;  /* Path or NULL for unused entry. */
+	char *mime;  /* Mime-type of the file at the path or NULL. */
+	int *rules;  /* Indexes of matching rules. */
+	int nrules;  /* Number of elements in rules. */
+}
+memo_t;
+
+struct matcher_set_t
+{
+	globs_table_t *globs; /* Simple globs of all rules. */
+	other_t *others;      /* Remaining matchers ordered by rule index. */
+	int nothers;          /* Number of elements in others. */
+	int count;            /* Number of rules. */
+	int uses_mime;        /* Whether some of the rules match mime-types. */
+
+	memo_t memo[MEMO_SIZE]; /* Direct-mapped memoization by hash of paths. */
+	int *rules;             /* Storage of the last unmemoized result. */
+};
+
+static int add_other(matcher_set_t *set, const struct matchers_t *matchers,
+		int rule);
+static int find_first_other(const matcher_set_t *set, int from);
+static int find_all(const matcher_set_t *set, const char path[], int **rules);
+static void clear_memo(matcher_set_t *set);
+static void free_memo(memo_t *memo);
+static unsigned int hash_path(const char path[]);
+static int str_equal(const char a[], const char b[]);
+
+matcher_set_t *
+matcher_set_alloc(void)
+{
+	matcher_set_t *const set = calloc(1, sizeof(*set));
+	if(set == NULL)
+	{
+		return NULL;
+	}
+
+	set->globs = globs_table_alloc();
+	if(set->globs == NULL)
+	{
+		free(set);
+		return NULL;
+	}
+
+	return set;
+}
+
+void
+matcher_set_free(matcher_set_t *set)
+{
+	if(set != NULL)
+	{
+		clear_memo(set);
+		globs_table_free(set->globs);
+		free(set->others);
+		free(set->rules);
+		free(set);
+	}
+}
+
+int
+matcher_set_add(matcher_set_t *set, struct matchers_t *const list[], int count)
+{
+	const int rule = set->count++;
+
+	clear_memo(set);
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		const matcher_t *const m = matchers_get_single(list[i]);
+		if(m != NULL && matcher_is_name_globs(m))
+		{
+			if(globs_table_add(set->globs, matcher_get_undec(m), rule) != 0)
+			{
+				return 1;
+			}
+		}
+		else if(add_other(set, list[i], rule) != 0)
+		{
+			return 1;
+		}
+		else if(matchers_has_mime(list[i]))
+		{
+			set->uses_mime = 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Appends matchers that need to be checked one by one.  Returns zero on
+ * success. */
+static int
+add_other(matcher_set_t *set, const struct matchers_t *matchers, int rule)
+{
+	other_t *const others = reallocarray(set->others, set->nothers + 1,
+			sizeof(*others));
+	if(others == NULL)
+	{
+		return 1;
+	}
+
+	set->others = others;
+	set->others[set->nothers].matchers = matchers;
+	set->others[set->nothers].rule = rule;
+	++set->nothers;
+	return 0;
+}
+
+int
+matcher_set_match(const matcher_set_t *set, const char path[], int from)
+{
+	const int found = globs_table_match(set->globs,
+			get_last_path_component(path), from);
+	const int limit = (found < 0 ? set->count : found);
+
+	int i;
+	for(i = find_first_other(set, from);
+			i < set->nothers && set->others[i].rule < limit; ++i)
+	{
+		if(matchers_match(set->others[i].matchers, path))
+		{
+			return set->others[i].rule;
+		}
+	}
+
+	return found;
+}
+
+/* Finds the first element of set->others that corresponds to a rule with index
+ * not less than from.  Returns the index, which is set->nothers if there is no
+ * such element. */
+static int
+find_first_other(const matcher_set_t *set, int from)
+{
+	int l = 0, r = set->nothers;
+	while(l < r)
+	{
+		const int m = l + (r - l)/2;
+		if(set->others[m].rule < from)
+		{
+			l = m + 1;
+		}
+		else
+		{
+			r = m;
+		}
+	}
+	return l;
+}
+
+int
+matcher_set_match_all(matcher_set_t *set, const char path[], const int **rules)
+{
+	const char *mime = (set->uses_mime ? get_mimetype(path, 1) : NULL);
+
+	memo_t *const memo = &set->memo[hash_path(path)%MEMO_SIZE];
+	if(memo->path != NULL && strcmp(memo->path, path) == 0 &&
+			str_equal(memo->mime, mime))
+	{
+		*rules = memo->rules;
+		return memo->nrules;
+	}
+
+	int *found;
+	const int nfound = find_all(set, path, &found);
+
+	free_memo(memo);
+	memo->path = strdup(path);
+	memo->mime = (mime == NULL ? NULL : strdup(mime));
+	if(memo->path == NULL || (mime != NULL && memo->mime == NULL))
+	{
+		free_memo(memo);
+
+		/* Can't memoize, but the result is still valid. */
+		free(set->rules);
+		set->rules = found;
+		*rules = found;
+		return nfound;
+	}
+
+	memo->rules = found;
+	memo->nrules = nfound;
+	*rules = found;
+	return nfound;
+}
+
+/* Finds all rules that match the path.  Sets *rules to newly allocated list of
+ * their indexes.  Returns number of elements in the list. */
+static int
+find_all(const matcher_set_t *set, const char path[], int **rules)
+{
+	*rules = NULL;
+
+	int count = 0;
+	int rule = matcher_set_match(set, path, 0);
+	while(rule >= 0)
+	{
+		int *const p = reallocarray(*rules, count + 1, sizeof(**rules));
+		if(p == NULL)
+		{
+			break;
+		}
+
+		*rules = p;
+		(*rules)[count++] = rule;
+		rule = matcher_set_match(set, path, rule + 1);
+	}
+
+	return count;
+}
+
+/* Drops all memoized results. */
+static void
+clear_memo(matcher_set_t *set)
+{
+	int i;
+	for(i = 0; i < MEMO_SIZE; ++i)
+	{
+		free_memo(&set->memo[i]);
+	}
+}
+
+/* Frees memoized result and marks the entry as unused. */
+static void
+free_memo(memo_t *memo)
+{
+	free(memo->path);
+	free(memo->mime);
+	free(memo->rules);
+	memo->path = NULL;
+	memo->mime = NULL;
+	memo->rules = NULL;
+	memo->nrules = 0;
+}
+
+/* Computes hash of a path.  Returns the hash. */
+static unsigned int
+hash_path(const char path[])
+{
+	unsigned int hash = 2166136261U;
+	while(*path != '\0')
+	{
+		hash = (hash ^ (unsigned char)*path++)*16777619U;
+	}
+	return hash;
+}
+
+/* Compares two strings either of which can be NULL.  Returns non-zero if they
+ * are equal, otherwise zero is returned. */
+static int
+str_equal(const char a[], const char b[])
+{
+	if(a == NULL || b == NULL)
+	{
+		return (a == b);
+	}
+	return (strcmp(a, b) == 0);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,62 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__MATCHER_SET_H__
+#define VIFM__UTILS__MATCHER_SET_H__
+
+/* Compiled form of an ordered list of rules for finding rules that match a
+ * path.  Each rule is a disjunction of conjunctions of matchers (matchers_t).
+ * Simple globs of all rules are merged into a single table (globs_table_t),
+ * which is matched in one pass over file name, and other matchers are tried in
+ * order only while they can produce an earlier match.  Lists of all matching
+ * rules are memoized per path and its mime-type (only if some rule needs it)
+ * until the set is changed.
+ *
+ * The set refers to matchers of rules, which must outlive it. */
+
+struct matchers_t;
+
+/* Opaque set type. */
+typedef struct matcher_set_t matcher_set_t;
+
+/* Allocates an empty set.  Returns the set or NULL on error. */
+matcher_set_t * matcher_set_alloc(void);
+
+/* Frees the set.  set can be NULL. */
+void matcher_set_free(matcher_set_t *set);
+
+/* Appends a rule that matches if any of count matchers in the list does.  Index
+ * of the rule is the number of rules added before it.  Returns zero on success,
+ * otherwise non-zero is returned and the set must not be used anymore. */
+int matcher_set_add(matcher_set_t *set, struct matchers_t *const list[],
+		int count);
+
+/* Finds the first rule with index not less than from that matches the path.
+ * Returns index of the rule or -1 if there is no such rule. */
+int matcher_set_match(const matcher_set_t *set, const char path[], int from);
+
+/* Finds all rules that match the path.  Sets *rules to their indexes in
+ * ascending order, the list is valid until the next call or change of the set.
+ * Returns number of matching rules. */
+int matcher_set_match_all(matcher_set_t *set, const char path[],
+		const int **rules);
+
+#endif /* VIFM__UTILS__MATCHER_SET_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
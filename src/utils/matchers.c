@@ -316,6 +316,26 @@ matchers_is_full_path(const matchers_t *matchers)
 	return 0;
 }
 
+int
+matchers_has_mime(const matchers_t *matchers)
+{
+	int i;
+	for(i = 0; i < matchers->count; ++i)
+	{
+		if(matcher_is_mime(matchers->list[i]))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+const matcher_t *
+matchers_get_single(const matchers_t *matchers)
+{
+	return (matchers->count == 1 ? matchers->list[0] : NULL);
+}
+
 int
 matchers_is_expr(const char str[])
 {
@@ -76,6 +76,14 @@ int matchers_ignore_case(const matchers_t *matchers);
  * otherwise zero is returned. */
 int matchers_is_full_path(const matchers_t *matchers);
 
+/* Checks whether any matcher matches mime-types of files.  Returns non-zero if
+ * so, otherwise zero is returned. */
+int matchers_has_mime(const matchers_t *matchers);
+
+/* Retrieves the only matcher of the conjunction.  Returns the matcher or NULL
+ * if there is more than one of them. */
+const matcher_t * matchers_get_single(const matchers_t *matchers);
+
 /* Checks whether given string is a list of match expressions.  Returns non-zero
  * if so, otherwise zero is returned. */
 int matchers_is_expr(const char str[]);
@@ -0,0 +1,456 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "parallel.h"
+
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_* */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memmove() */
+
+#include "../compat/reallocarray.h"
+
+#include "macros.h"
+#include "utils.h"
+
+/* Maximum number of items claimed by a worker at once. */
+#define MAX_CHUNK 64
+
+/* State of a loop shared among workers. */
+typedef struct
+{
+	pthread_mutex_t lock;    /* Protects the next field. */
+	int next;                /* First item that wasn't claimed yet. */
+	int count;               /* Total number of items. */
+	int chunk;               /* Number of items claimed at once. */
+	parallel_body_func body; /* Processes items. */
+	void *arg;               /* Argument for the body. */
+}
+loop_t;
+
+/* Queue of tasks of a single worker.  The owner takes the newest tasks, while
+ * other workers steal the oldest ones. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Protects the rest of the fields. */
+	void **tasks;         /* Storage of tasks. */
+	int head;             /* Index of the oldest task. */
+	int tail;             /* Index past the newest task. */
+	int capacity;         /* Size of the storage. */
+}
+deque_t;
+
+/* State of parallel_run() shared among workers. */
+typedef struct
+{
+	pthread_mutex_t lock;    /* Protects the fields below. */
+	pthread_cond_t wakeup;   /* Signaled on new tasks and on completion. */
+	int outstanding;         /* Number of spawned tasks that aren't done. */
+	int nidle;               /* Number of workers waiting for tasks. */
+	unsigned int generation; /* Incremented on every spawn. */
+
+	deque_t *deques;         /* Queues of workers. */
+	int nworkers;            /* Number of queues. */
+	parallel_task_func func; /* Processes tasks. */
+	void *arg;               /* Argument for the func. */
+}
+pool_t;
+
+/* Per-worker state. */
+struct parallel_ctx_t
+{
+	pool_t *pool; /* Shared state. */
+	int index;    /* Index of worker's queue. */
+};
+
+static void * worker_thread(void *arg);
+static void run_worker(loop_t *loop);
+static void * task_worker_thread(void *arg);
+static void run_task_worker(parallel_ctx_t *ctx);
+static void * take_task(pool_t *pool, int index);
+static int deque_push(deque_t *deque, void *task);
+static void * deque_pop_newest(deque_t *deque);
+static void * deque_pop_oldest(deque_t *deque);
+
+void
+parallel_for(int count, int nworkers, parallel_body_func body, void *arg)
+{
+	int i;
+
+	loop_t loop = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.count = count,
+		.body = body,
+		.arg = arg,
+	};
+
+	nworkers = MIN(nworkers, count);
+	if(nworkers <= 1)
+	{
+		for(i = 0; i < count; ++i)
+		{
+			body(i, arg);
+		}
+		return;
+	}
+
+	/* Several chunks per worker balance the load and don't contend for the lock
+	 * too much. */
+	loop.chunk = MAX(1, MIN(MAX_CHUNK, count/(nworkers*8)));
+
+	pthread_t *const ids = malloc(sizeof(*ids)*(nworkers - 1));
+	int nstarted = 0;
+	if(ids != NULL)
+	{
+		for(nstarted = 0; nstarted < nworkers - 1; ++nstarted)
+		{
+			if(pthread_create(&ids[nstarted], NULL, &worker_thread, &loop) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	/* Calling thread is a worker too and handles everything if starting threads
+	 * failed. */
+	run_worker(&loop);
+
+	for(i = 0; i < nstarted; ++i)
+	{
+		(void)pthread_join(ids[i], NULL);
+	}
+
+	free(ids);
+	pthread_mutex_destroy(&loop.lock);
+}
+
+/* Entry point of an additional worker thread.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	block_all_thread_signals();
+	run_worker(arg);
+	return NULL;
+}
+
+/* Claims and processes chunks of items until there are none left. */
+static void
+run_worker(loop_t *loop)
+{
+	for(;;)
+	{
+		pthread_mutex_lock(&loop->lock);
+		const int first = loop->next;
+		const int last = MIN(first + loop->chunk, loop->count);
+		loop->next = last;
+		pthread_mutex_unlock(&loop->lock);
+
+		if(first >= last)
+		{
+			break;
+		}
+
+		int i;
+		for(i = first; i < last; ++i)
+		{
+			loop->body(i, loop->arg);
+		}
+	}
+}
+
+void
+parallel_run(void *task, int nworkers, parallel_task_func func, void *arg)
+{
+	parallel_run_many(&task, 1, nworkers, func, arg);
+}
+
+void
+parallel_run_many(void *tasks[], int ntasks, int nworkers,
+		parallel_task_func func, void *arg)
+{
+	int i;
+
+	nworkers = MAX(1, nworkers);
+
+	pool_t pool = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.wakeup = PTHREAD_COND_INITIALIZER,
+		.func = func,
+		.arg = arg,
+	};
+
+	pool.deques = malloc(sizeof(*pool.deques)*nworkers);
+	parallel_ctx_t *const ctxs = malloc(sizeof(*ctxs)*nworkers);
+	pthread_t *const ids = malloc(sizeof(*ids)*nworkers);
+	if(pool.deques == NULL || ctxs == NULL || ids == NULL)
+	{
+		free(pool.deques);
+		free(ctxs);
+		free(ids);
+
+		/* Process everything recursively in the calling thread. */
+		parallel_ctx_t ctx = { .pool = &pool, .index = -1 };
+		for(i = 0; i < ntasks; ++i)
+		{
+			func(&ctx, tasks[i], arg);
+		}
+		return;
+	}
+
+	pool.nworkers = nworkers;
+	for(i = 0; i < nworkers; ++i)
+	{
+		deque_t *const deque = &pool.deques[i];
+		pthread_mutex_init(&deque->lock, NULL);
+		deque->tasks = NULL;
+		deque->head = 0;
+		deque->tail = 0;
+		deque->capacity = 0;
+
+		ctxs[i].pool = &pool;
+		ctxs[i].index = i;
+	}
+
+	/* The calling thread is worker #0 and starts with the initial tasks, others
+	 * steal them. */
+	for(i = 0; i < ntasks; ++i)
+	{
+		parallel_spawn(&ctxs[0], tasks[i]);
+	}
+
+	int nstarted;
+	for(nstarted = 0; nstarted < nworkers - 1; ++nstarted)
+	{
+		if(pthread_create(&ids[nstarted], NULL, &task_worker_thread,
+					&ctxs[nstarted + 1]) != 0)
+		{
+			break;
+		}
+	}
+
+	run_task_worker(&ctxs[0]);
+
+	for(i = 0; i < nstarted; ++i)
+	{
+		(void)pthread_join(ids[i], NULL);
+	}
+
+	for(i = 0; i < nworkers; ++i)
+	{
+		free(pool.deques[i].tasks);
+		pthread_mutex_destroy(&pool.deques[i].lock);
+	}
+	free(pool.deques);
+	free(ctxs);
+	free(ids);
+	pthread_cond_destroy(&pool.wakeup);
+	pthread_mutex_destroy(&pool.lock);
+}
+
+void
+parallel_spawn(parallel_ctx_t *ctx, void *task)
+{
+	pool_t *const pool = ctx->pool;
+
+	if(ctx->index < 0)
+	{
+		pool->func(ctx, task, pool->arg);
+		return;
+	}
+
+	/* Account for the task before it becomes visible to other workers,
+	 * otherwise it can be stolen and finished before the increment, which makes
+	 * outstanding drop to zero while its parent is still running and lets idle
+	 * workers quit. */
+	pthread_mutex_lock(&pool->lock);
+	++pool->outstanding;
+	pthread_mutex_unlock(&pool->lock);
+
+	if(deque_push(&pool->deques[ctx->index], task) != 0)
+	{
+		pool->func(ctx, task, pool->arg);
+
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->outstanding == 0)
+		{
+			pthread_cond_broadcast(&pool->wakeup);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	++pool->generation;
+	if(pool->nidle != 0)
+	{
+		pthread_cond_signal(&pool->wakeup);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* Entry point of an additional worker thread of parallel_run().  Returns
+ * NULL. */
+static void *
+task_worker_thread(void *arg)
+{
+	block_all_thread_signals();
+	run_task_worker(arg);
+	return NULL;
+}
+
+/* Processes own and stolen tasks until all of them are done. */
+static void
+run_task_worker(parallel_ctx_t *ctx)
+{
+	pool_t *const pool = ctx->pool;
+
+	for(;;)
+	{
+		pthread_mutex_lock(&pool->lock);
+		const unsigned int generation = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		void *const task = take_task(pool, ctx->index);
+		if(task != NULL)
+		{
+			pool->func(ctx, task, pool->arg);
+
+			pthread_mutex_lock(&pool->lock);
+			if(--pool->outstanding == 0)
+			{
+				pthread_cond_broadcast(&pool->wakeup);
+			}
+			pthread_mutex_unlock(&pool->lock);
+			continue;
+		}
+
+		pthread_mutex_lock(&pool->lock);
+		if(pool->outstanding == 0)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		/* Don't sleep if something was spawned while queues were checked. */
+		if(pool->generation == generation)
+		{
+			++pool->nidle;
+			pthread_cond_wait(&pool->wakeup, &pool->lock);
+			--pool->nidle;
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+/* Takes the newest task of the worker or steals the oldest task of some other
+ * worker.  Returns the task or NULL if all queues are empty. */
+static void *
+take_task(pool_t *pool, int index)
+{
+	void *task = deque_pop_newest(&pool->deques[index]);
+
+	int i;
+	for(i = 1; i < pool->nworkers && task == NULL; ++i)
+	{
+		task = deque_pop_oldest(&pool->deques[(index + i)%pool->nworkers]);
+	}
+
+	return task;
+}
+
+/* Adds a task to the queue.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+deque_push(deque_t *deque, void *task)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	if(deque->tail == deque->capacity)
+	{
+		if(deque->head != 0)
+		{
+			memmove(deque->tasks, deque->tasks + deque->head,
+					sizeof(*deque->tasks)*(deque->tail - deque->head));
+			deque->tail -= deque->head;
+			deque->head = 0;
+		}
+		else
+		{
+			const int capacity = MAX(16, deque->capacity*2);
+			void **const tasks = reallocarray(deque->tasks, capacity,
+					sizeof(*tasks));
+			if(tasks == NULL)
+			{
+				pthread_mutex_unlock(&deque->lock);
+				return 1;
+			}
+			deque->tasks = tasks;
+			deque->capacity = capacity;
+		}
+	}
+
+	deque->tasks[deque->tail++] = task;
+
+	pthread_mutex_unlock(&deque->lock);
+	return 0;
+}
+
+/* Takes the newest task from the queue.  Returns the task or NULL if the queue
+ * is empty. */
+static void *
+deque_pop_newest(deque_t *deque)
+{
+	void *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->head != deque->tail)
+	{
+		task = deque->tasks[--deque->tail];
+		if(deque->head == deque->tail)
+		{
+			deque->head = 0;
+			deque->tail = 0;
+		}
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/* Takes the oldest task from the queue.  Returns the task or NULL if the queue
+ * is empty. */
+static void *
+deque_pop_oldest(deque_t *deque)
+{
+	void *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+	if(deque->head != deque->tail)
+	{
+		task = deque->tasks[deque->head++];
+		if(deque->head == deque->tail)
+		{
+			deque->head = 0;
+			deque->tail = 0;
+		}
+	}
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
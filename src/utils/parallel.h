@@ -0,0 +1,60 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__PARALLEL_H__
+#define VIFM__UTILS__PARALLEL_H__
+
+/* Type of function that processes a single item of a parallel loop.  It's
+ * invoked from multiple threads at the same time, each invocation gets a
+ * distinct index. */
+typedef void (*parallel_body_func)(int i, void *arg);
+
+/* Invokes the body for each index in the range [0; count) using up to nworkers
+ * threads including the calling one.  Indexes are handed out in small chunks to
+ * balance uneven load.  Runs the loop sequentially if threads can't be started.
+ * Returns after all indexes are processed. */
+void parallel_for(int count, int nworkers, parallel_body_func body, void *arg);
+
+/* Context of a worker executing tasks of parallel_run(). */
+typedef struct parallel_ctx_t parallel_ctx_t;
+
+/* Type of function that processes a single task of parallel_run().  It's
+ * invoked from multiple threads at the same time and can add more tasks via
+ * parallel_spawn(). */
+typedef void (*parallel_task_func)(parallel_ctx_t *ctx, void *task, void *arg);
+
+/* Processes the task and all tasks spawned while doing so using up to nworkers
+ * threads including the calling one.  Each worker has its own queue of tasks
+ * and steals the oldest ones from other workers when its queue is empty.  Tasks
+ * can't be NULL.  Returns after all tasks are processed. */
+void parallel_run(void *task, int nworkers, parallel_task_func func,
+		void *arg);
+
+/* Same as parallel_run(), but starts with several tasks which share the same
+ * set of workers. */
+void parallel_run_many(void *tasks[], int ntasks, int nworkers,
+		parallel_task_func func, void *arg);
+
+/* Adds a task to the queue of the worker described by the context.  Processes
+ * the task right away if it can't be queued. */
+void parallel_spawn(parallel_ctx_t *ctx, void *task);
+
+#endif /* VIFM__UTILS__PARALLEL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -81,6 +81,7 @@
 #include "flist_hist.h"
 #include "flist_pos.h"
 #include "fops_common.h"
+#include "hcache.h"
 #include "instance.h"
 #include "ipc.h"
 #include "marks.h"
@@ -316,6 +317,8 @@ vifm_main(int argc, char *argv[])
 	{
 		load_scheme();
 		instance_load_config();
+		dcache_setup_file(&cfg);
+		hcache_setup_file(&cfg);
 	}
 
 	if(lwin_cv || rwin_cv)
@@ -714,6 +717,8 @@ void _gnuc_noreturn
 vifm_exit(int exit_code)
 {
 	vcache_finish();
+	dcache_detach();
+	hcache_detach();
 	plugs_free(curr_stats.plugs);
 	vlua_finish(curr_stats.vlua);
 	ipc_free(curr_stats.ipc);
@@ -0,0 +1,651 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "vsearch.h"
+
+#include <regex.h> /* REG_ICASE regex_t regexec() regfree() */
+#include <unistd.h> /* usleep() */
+
+#include <ctype.h> /* tolower() */
+#include <pthread.h> /* pthread_* */
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* calloc() free() malloc() realloc() */
+#include <string.h> /* memchr() memcmp() memset() strchr() strdup() strlen()
+                       strncasecmp() strpbrk() */
+
+#include "ui/escape.h"
+#include "utils/macros.h"
+#include "utils/regexp.h"
+#include "utils/str.h"
+#include "utils/utf8.h"
+#include "utils/utils.h"
+#include "pager.h"
+
+/* Number of lines scanned before publishing results. */
+#define CHUNK_LINES 4096
+
+/* Number of chunks scanned synchronously on starting a search. */
+#define SYNC_CHUNKS 4
+
+/* Delay in microseconds between checks for new lines of a pager. */
+#define WAIT_DELAY 10000
+
+/* Characters which make a pattern a regular expression. */
+#define RE_SPECIAL ".[]()*+?{}|^$\\"
+
+/* Outcome of scanning a chunk. */
+typedef enum
+{
+	SS_SCANNED, /* Some lines were scanned. */
+	SS_IDLE,    /* Waiting for more lines to become available. */
+	SS_OVER,    /* Scanning is over. */
+}
+ScanState;
+
+/* Storage used while scanning a chunk of lines. */
+typedef struct
+{
+	char *part;                         /* Buffer for a part of a line. */
+	char *lines;                        /* Buffer for lines from a pager. */
+	size_t lines_len;                   /* Size of the lines buffer. */
+	unsigned char matched[CHUNK_LINES]; /* Whether lines of the chunk match. */
+}
+chunk_t;
+
+struct vsearch_t
+{
+	regex_t re;         /* Compiled pattern. */
+	char *literal;      /* Pattern to look for as a substring or NULL. */
+	size_t literal_len; /* Length of the literal. */
+	int icase;          /* Whether case of the literal should be ignored. */
+	int prefilter;      /* Whether whole line can be checked for the literal
+	                       before breaking it into parts. */
+
+	pager_t *pager; /* Source of lines or NULL. */
+	char **lines;   /* Source of lines if there is no pager. */
+	int width;      /* Width of parts of lines. */
+	int wrap;       /* Whether lines consist of several parts. */
+	int tab_stop;   /* Tabulation width. */
+
+	pthread_mutex_t lock; /* Protects fields below. */
+	unsigned char *bits;  /* Bit per line, which is set for matching lines. */
+	int capacity;         /* Number of lines the bits have room for. */
+	int lo, hi;           /* Range of scanned lines: [lo; hi). */
+	int total;            /* Number of lines available for scanning. */
+	int complete;         /* Whether total can't grow anymore. */
+	int backward;         /* Preferred direction of scanning. */
+	int over;             /* Whether scanning is over. */
+	int stop;             /* Request for scanning thread to stop. */
+
+	pthread_t thread; /* Thread that scans lines. */
+	int has_thread;   /* Whether the thread was started. */
+
+	char *part; /* Buffer for a part of a line for vsearch_match_part(). */
+};
+
+static void setup_literal(vsearch_t *search, const char pattern[], int cflags);
+static void * scan_thread(void *arg);
+static ScanState scan_chunk(vsearch_t *search, chunk_t *chunk);
+static int publish_chunk(vsearch_t *search, int from, int to,
+		const chunk_t *chunk);
+static void free_chunk(chunk_t *chunk);
+static int line_matches(const vsearch_t *search, const char line[],
+		char part[]);
+static int count_parts(const vsearch_t *search, const char line[]);
+static int part_matches(const vsearch_t *search, const char part[]);
+static int has_literal(const vsearch_t *search, const char text[],
+		size_t len);
+static int next_bit(const unsigned char bits[], int from, int to);
+static int prev_bit(const unsigned char bits[], int from, int to);
+
+vsearch_t *
+vsearch_start(const char pattern[], int cflags, pager_t *pager, char *lines[],
+		int nlines, int width, int wrap, int tab_stop, int origin, int backward)
+{
+	vsearch_t *const search = calloc(1, sizeof(*search));
+	if(search == NULL)
+	{
+		return NULL;
+	}
+
+	if(regexp_compile(&search->re, pattern, cflags) != 0)
+	{
+		regfree(&search->re);
+		free(search);
+		return NULL;
+	}
+
+	search->pager = pager;
+	search->lines = lines;
+	search->width = MAX(width, 1);
+	search->wrap = wrap;
+	search->tab_stop = tab_stop;
+	search->backward = backward;
+
+	search->total = nlines;
+	search->complete = 1;
+	if(pager != NULL)
+	{
+		search->total = pager_get_count(pager, &search->complete);
+	}
+
+	search->lo = MAX(MIN(origin, search->total), 0);
+	search->hi = search->lo;
+
+	search->part = malloc(search->width*4 + 1);
+	if(search->part == NULL || pthread_mutex_init(&search->lock, NULL) != 0)
+	{
+		free(search->part);
+		regfree(&search->re);
+		free(search);
+		return NULL;
+	}
+
+	setup_literal(search, pattern, cflags);
+
+	/* Scan lines around the origin right away to be able to report matches
+	 * there immediately. */
+	chunk_t chunk = {};
+	ScanState state = SS_SCANNED;
+	int i;
+	for(i = 0; i < SYNC_CHUNKS && state == SS_SCANNED; ++i)
+	{
+		state = scan_chunk(search, &chunk);
+	}
+	free_chunk(&chunk);
+
+	if(state != SS_OVER)
+	{
+		if(pthread_create(&search->thread, NULL, &scan_thread, search) == 0)
+		{
+			search->has_thread = 1;
+		}
+		else
+		{
+			search->over = 1;
+		}
+	}
+
+	return search;
+}
+
+/* Enables matching of the pattern as a substring if it contains no special
+ * characters. */
+static void
+setup_literal(vsearch_t *search, const char pattern[], int cflags)
+{
+	if(strpbrk(pattern, RE_SPECIAL) != NULL)
+	{
+		return;
+	}
+
+	search->icase = ((cflags & REG_ICASE) != 0);
+
+	const char *p;
+	for(p = pattern; *p != '\0'; ++p)
+	{
+		/* Case of non-ASCII characters is left to the regular expression. */
+		if(search->icase && (unsigned char)*p >= 0x80)
+		{
+			return;
+		}
+	}
+
+	search->literal = strdup(pattern);
+	if(search->literal == NULL)
+	{
+		return;
+	}
+
+	search->literal_len = strlen(pattern);
+	if(search->icase)
+	{
+		char *p;
+		for(p = search->literal; *p != '\0'; ++p)
+		{
+			*p = tolower((unsigned char)*p);
+		}
+	}
+
+	/* Spaces can come from expanded tabulation. */
+	search->prefilter = (strchr(pattern, ' ') == NULL);
+}
+
+void
+vsearch_free(vsearch_t *search)
+{
+	if(search == NULL)
+	{
+		return;
+	}
+
+	if(search->has_thread)
+	{
+		pthread_mutex_lock(&search->lock);
+		search->stop = 1;
+		pthread_mutex_unlock(&search->lock);
+
+		(void)pthread_join(search->thread, NULL);
+	}
+
+	pthread_mutex_destroy(&search->lock);
+	regfree(&search->re);
+	free(search->literal);
+	free(search->bits);
+	free(search->part);
+	free(search);
+}
+
+/* Entry point of a thread that scans the rest of the lines.  Returns NULL. */
+static void *
+scan_thread(void *arg)
+{
+	vsearch_t *const search = arg;
+
+	block_all_thread_signals();
+
+	chunk_t chunk = {};
+	while(1)
+	{
+		const ScanState state = scan_chunk(search, &chunk);
+		if(state == SS_OVER)
+		{
+			break;
+		}
+		if(state == SS_IDLE)
+		{
+			usleep(WAIT_DELAY);
+		}
+	}
+	free_chunk(&chunk);
+
+	return NULL;
+}
+
+/* Scans a chunk of lines next to already scanned ones and publishes the result.
+ * Must be called by a single thread at a time.  Returns state of scanning. */
+static ScanState
+scan_chunk(vsearch_t *search, chunk_t *chunk)
+{
+	int total = search->total;
+	int complete = 1;
+	if(search->pager != NULL)
+	{
+		total = pager_get_count(search->pager, &complete);
+	}
+
+	pthread_mutex_lock(&search->lock);
+	const int stop = search->stop;
+	search->total = total;
+	search->complete = complete;
+	const int backward = search->lo > 0
+	                  && (search->backward || search->hi == search->total);
+	const int from = backward ? MAX(search->lo - CHUNK_LINES, 0) : search->hi;
+	const int to = backward ? search->lo : MIN(from + CHUNK_LINES, total);
+	if(stop || (from == to && complete))
+	{
+		search->over = 1;
+	}
+	pthread_mutex_unlock(&search->lock);
+
+	if(stop || from == to)
+	{
+		return (stop || complete) ? SS_OVER : SS_IDLE;
+	}
+
+	if(chunk->part == NULL)
+	{
+		chunk->part = malloc(search->width*4 + 1);
+	}
+
+	int ok = (chunk->part != NULL);
+	if(ok && search->pager != NULL)
+	{
+		ok = (pager_get_lines(search->pager, from, to - from, &chunk->lines,
+					&chunk->lines_len) == 0);
+	}
+
+	const char *line = chunk->lines;
+	int i;
+	for(i = 0; i < to - from; ++i)
+	{
+		if(!ok)
+		{
+			chunk->matched[i] = 0;
+			continue;
+		}
+
+		if(search->pager == NULL)
+		{
+			chunk->matched[i] = line_matches(search, search->lines[from + i],
+					chunk->part);
+		}
+		else
+		{
+			chunk->matched[i] = line_matches(search, line, chunk->part);
+			line += strlen(line) + 1;
+		}
+	}
+
+	if(publish_chunk(search, from, to, chunk) != 0)
+	{
+		pthread_mutex_lock(&search->lock);
+		search->over = 1;
+		pthread_mutex_unlock(&search->lock);
+		return SS_OVER;
+	}
+	return SS_SCANNED;
+}
+
+/* Records results of scanning [from; to) range of lines and extends scanned
+ * range.  Returns zero on success, otherwise non-zero is returned. */
+static int
+publish_chunk(vsearch_t *search, int from, int to, const chunk_t *chunk)
+{
+	pthread_mutex_lock(&search->lock);
+
+	if(to > search->capacity)
+	{
+		const int capacity = MAX(to, search->total);
+		const size_t old_size = DIV_ROUND_UP(search->capacity, 8);
+		const size_t new_size = DIV_ROUND_UP(capacity, 8);
+		unsigned char *const bits = realloc(search->bits, new_size);
+		if(bits == NULL)
+		{
+			pthread_mutex_unlock(&search->lock);
+			return 1;
+		}
+
+		memset(bits + old_size, 0, new_size - old_size);
+		search->bits = bits;
+		search->capacity = capacity;
+	}
+
+	int i;
+	for(i = from; i < to; ++i)
+	{
+		if(chunk->matched[i - from])
+		{
+			search->bits[i/8] |= 1U << (i%8);
+		}
+	}
+
+	search->lo = MIN(search->lo, from);
+	search->hi = MAX(search->hi, to);
+
+	pthread_mutex_unlock(&search->lock);
+	return 0;
+}
+
+/* Frees resources of a chunk. */
+static void
+free_chunk(chunk_t *chunk)
+{
+	free(chunk->part);
+	free(chunk->lines);
+}
+
+VSearchResult
+vsearch_find(vsearch_t *search, int from, int backward, int limit, int *line)
+{
+	VSearchResult result = VSR_PENDING;
+	int found = -1;
+
+	pthread_mutex_lock(&search->lock);
+
+	if(backward)
+	{
+		const int end = MIN(from, limit);
+		if(end > search->hi)
+		{
+			/* Lines right before the starting point aren't scanned yet. */
+		}
+		else if(end > search->lo)
+		{
+			found = prev_bit(search->bits, search->lo, end);
+		}
+
+		if(found == -1 && (end <= 0 || (end <= search->hi && search->lo == 0)))
+		{
+			result = VSR_NOT_FOUND;
+		}
+	}
+	else
+	{
+		const int start = from + 1;
+		if(start < limit && start >= search->lo)
+		{
+			found = next_bit(search->bits, start, MIN(search->hi, limit));
+		}
+
+		const int scanned = (start >= limit)
+		                 || (start >= search->lo && search->hi >= limit);
+		if(found == -1 && scanned && limit >= search->total && search->complete)
+		{
+			result = VSR_NOT_FOUND;
+		}
+	}
+
+	if(found != -1)
+	{
+		result = VSR_FOUND;
+		*line = found;
+	}
+	else if(result == VSR_PENDING)
+	{
+		if(search->over)
+		{
+			result = VSR_NOT_FOUND;
+		}
+		else
+		{
+			search->backward = backward;
+		}
+	}
+
+	pthread_mutex_unlock(&search->lock);
+
+	return result;
+}
+
+int
+vsearch_match_part(vsearch_t *search, const char line[], int from,
+		int backward)
+{
+	char *const no_esc = esc_remove(line);
+	if(no_esc == NULL)
+	{
+		return -1;
+	}
+
+	const int nparts = count_parts(search, line);
+
+	int found = -1;
+	const char *p = no_esc;
+	int i;
+	for(i = 0; i < nparts && (!backward || i <= from); ++i)
+	{
+		p = expand_tabulation(p, search->width, search->tab_stop, search->part);
+		if((backward || i >= from) && part_matches(search, search->part))
+		{
+			found = i;
+			if(!backward)
+			{
+				break;
+			}
+		}
+	}
+
+	free(no_esc);
+	return found;
+}
+
+/* Checks whether any part of the line matches.  The part parameter is a
+ * buffer for parts.  Returns non-zero if so, otherwise zero is returned. */
+static int
+line_matches(const vsearch_t *search, const char line[], char part[])
+{
+	/* A literal can't be in any of the parts if the line doesn't contain it and
+	 * has no escape sequences which could break it. */
+	if(search->prefilter && strchr(line, '\033') == NULL &&
+			!has_literal(search, line, strlen(line)))
+	{
+		return 0;
+	}
+
+	char *const no_esc = esc_remove(line);
+	if(no_esc == NULL)
+	{
+		return 0;
+	}
+
+	const int nparts = count_parts(search, line);
+
+	int matches = 0;
+	const char *p = no_esc;
+	int i;
+	for(i = 0; i < nparts && !matches; ++i)
+	{
+		p = expand_tabulation(p, search->width, search->tab_stop, part);
+		matches = part_matches(search, part);
+	}
+
+	free(no_esc);
+	return matches;
+}
+
+/* Computes number of parts a line is broken into (same as number of virtual
+ * lines of view mode).  Returns the number. */
+static int
+count_parts(const vsearch_t *search, const char line[])
+{
+	if(!search->wrap)
+	{
+		return 1;
+	}
+
+	const int width = utf8_strsw_with_tabs(line, search->tab_stop)
+	                - esc_str_overhead(line);
+	return 1 + width/search->width;
+}
+
+/* Checks whether part of a line matches.  Returns non-zero if so, otherwise
+ * zero is returned. */
+static int
+part_matches(const vsearch_t *search, const char part[])
+{
+	if(search->literal != NULL)
+	{
+		return has_literal(search, part, strlen(part));
+	}
+	return (regexec(&search->re, part, 0, NULL, 0) == 0);
+}
+
+/* Looks for the literal in a text of the specified length.  Returns non-zero
+ * if it's there, otherwise zero is returned. */
+static int
+has_literal(const vsearch_t *search, const char text[], size_t len)
+{
+	const char *const literal = search->literal;
+	const size_t literal_len = search->literal_len;
+
+	if(literal_len == 0U)
+	{
+		return 1;
+	}
+	if(len < literal_len)
+	{
+		return 0;
+	}
+
+	const char *p = text;
+	const char *const last = text + (len - literal_len);
+
+	if(!search->icase)
+	{
+		while(p <= last)
+		{
+			p = memchr(p, literal[0], last - p + 1);
+			if(p == NULL)
+			{
+				return 0;
+			}
+			if(memcmp(p + 1, literal + 1, literal_len - 1U) == 0)
+			{
+				return 1;
+			}
+			++p;
+		}
+		return 0;
+	}
+
+	for(; p <= last; ++p)
+	{
+		if(tolower((unsigned char)*p) == literal[0] &&
+				strncasecmp(p + 1, literal + 1, literal_len - 1U) == 0)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Finds the first set bit in [from; to) range.  Returns its index or -1. */
+static int
+next_bit(const unsigned char bits[], int from, int to)
+{
+	int i = from;
+	while(i < to)
+	{
+		if(i%8 == 0 && bits[i/8] == 0)
+		{
+			i += 8;
+			continue;
+		}
+		if(bits[i/8] & (1U << (i%8)))
+		{
+			return i;
+		}
+		++i;
+	}
+	return -1;
+}
+
+/* Finds the last set bit in [from; to) range.  Returns its index or -1. */
+static int
+prev_bit(const unsigned char bits[], int from, int to)
+{
+	int i = to - 1;
+	while(i >= from)
+	{
+		if(i%8 == 7 && bits[i/8] == 0)
+		{
+			i -= 8;
+			continue;
+		}
+		if(bits[i/8] & (1U << (i%8)))
+		{
+			return i;
+		}
+		--i;
+	}
+	return -1;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
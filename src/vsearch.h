@@ -0,0 +1,72 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__VSEARCH_H__
+#define VIFM__VSEARCH_H__
+
+#include "pager.h"
+
+/* Search in lines of view mode.  Lines are scanned in chunks starting at some
+ * line, first chunks are processed synchronously and the rest in background.
+ * The result is an index of lines that contain a match, which can be queried
+ * while scanning is in progress.  Lines are matched the way view mode displays
+ * them: escape sequences are removed, tabulation is expanded and each line is
+ * broken into parts of fixed width, which are matched separately.  Patterns
+ * without special characters are matched as plain substrings. */
+
+/* Result of looking up a matching line. */
+typedef enum
+{
+	VSR_FOUND,     /* The line was found. */
+	VSR_NOT_FOUND, /* There is no such line. */
+	VSR_PENDING,   /* The lines in question aren't scanned yet. */
+}
+VSearchResult;
+
+/* Opaque search type. */
+typedef struct vsearch_t vsearch_t;
+
+/* Starts looking for the pattern (compiled with cflags) either in the pager or
+ * in nlines lines (when pager is NULL), both have to outlive the search.  Lines
+ * are broken into parts of the width (only the first part is matched if wrap
+ * is zero).  Scanning starts at the origin line and proceeds in the specified
+ * direction first.  Returns the search or NULL on error. */
+vsearch_t * vsearch_start(const char pattern[], int cflags,
+		pager_t *pager, char *lines[], int nlines, int width, int wrap,
+		int tab_stop, int origin, int backward);
+
+/* Stops scanning and frees all resources.  The search can be NULL. */
+void vsearch_free(vsearch_t *search);
+
+/* Looks up the closest matching line after (or before if backward) the from
+ * line among the first limit lines.  Scanning switches to the direction of
+ * the lookup if the result is pending.  Sets *line on success.  Returns result
+ * of the lookup. */
+VSearchResult vsearch_find(vsearch_t *search, int from, int backward,
+		int limit, int *line);
+
+/* Looks for a matching part of the line starting at part number from and
+ * moving forward (or backward).  Returns number of the part or -1 if there is
+ * no match. */
+int vsearch_match_part(vsearch_t *search, const char line[], int from,
+		int backward);
+
+#endif /* VIFM__VSEARCH_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
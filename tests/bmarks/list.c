@@ -46,6 +46,34 @@ TEST(path_is_canonicalized)
 	assert_int_equal(1, cb_called);
 }
 
+TEST(only_changed_items_are_listed)
+{
+	assert_success(bmarks_setup("fake/path1", "tag1", 10));
+	assert_success(bmarks_setup("fake/path2", "tag2", 20));
+
+	cb_called = 0;
+	bmarks_list_changed(20, &bmarks_cb, NULL);
+	assert_int_equal(1, cb_called);
+
+	cb_called = 0;
+	bmarks_list_changed(10, &bmarks_cb, NULL);
+	assert_int_equal(2, cb_called);
+}
+
+TEST(removed_items_are_listed_as_changed)
+{
+	assert_success(bmarks_setup("fake/path", "tag", 10));
+	bmarks_remove("fake/path");
+
+	cb_called = 0;
+	bmarks_list(&bmarks_cb, NULL);
+	assert_int_equal(0, cb_called);
+
+	cb_called = 0;
+	bmarks_list_changed(10, &bmarks_cb, NULL);
+	assert_int_equal(1, cb_called);
+}
+
 static void
 bmarks_cb(const char path[], const char tags[], time_t timestamp, void *arg)
 {
@@ -16,6 +16,16 @@ TEST(bmark_is_renamed)
 	assert_string_equal(NULL, get_tags("old"));
 }
 
+TEST(renaming_updates_timestamp)
+{
+	assert_success(bmarks_setup("old", "tag", 0U));
+
+	bmarks_file_moved("old", "new");
+
+	assert_false(bmark_is_older("new", 1));
+	assert_false(bmark_is_older("old", 1));
+}
+
 TEST(path_is_canonicalized)
 {
 	assert_success(bmarks_setup("old", "tag", 0U));
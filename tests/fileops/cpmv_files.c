@@ -5,6 +5,7 @@
 
 #include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
 #include <string.h> /* strcpy() */
 
 #include <test-utils.h>
@@ -512,6 +513,108 @@ TEST(bg_jog_has_correct_title)
 	cfg.home_dir[0] = '\0';
 }
 
+TEST(bg_files_are_processed_by_several_workers)
+{
+	static const char *const names[] = { "a", "b", "c", "d", "e", "f" };
+	char path[PATH_MAX + 1];
+	size_t i;
+
+	cfg.io_workers = 4;
+
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "dir",
+			saved_cwd);
+
+	create_dir("dir");
+	for(i = 0U; i < ARRAY_LEN(names); ++i)
+	{
+		snprintf(path, sizeof(path), "dir/%s", names[i]);
+		make_file(path, "contents");
+	}
+
+	int op;
+	for(op = 0; op < 2; ++op)
+	{
+		populate_dir_list(&lwin, 0);
+		assert_int_equal(ARRAY_LEN(names), lwin.list_rows);
+		for(i = 0U; i < ARRAY_LEN(names); ++i)
+		{
+			lwin.dir_entry[i].marked = 1;
+		}
+
+		wait_for_all_bg();
+		(void)fops_cpmv_bg(&lwin, NULL, 0, op == 0 ? CMLO_COPY : CMLO_MOVE,
+				CMLF_NONE);
+		wait_for_bg();
+		assert_int_equal(ARRAY_LEN(names), bg_jobs->bg_op.done);
+
+		for(i = 0U; i < ARRAY_LEN(names); ++i)
+		{
+			assert_int_equal(8, get_file_size(names[i]));
+			snprintf(path, sizeof(path), "dir/%s", names[i]);
+			assert_int_equal(op == 0, path_exists(path, NODEREF));
+			if(op == 0)
+			{
+				remove_file(names[i]);
+			}
+		}
+	}
+
+	for(i = 0U; i < ARRAY_LEN(names); ++i)
+	{
+		remove_file(names[i]);
+	}
+	remove_dir("dir");
+
+	cfg.io_workers = 0;
+}
+
+TEST(bg_conflicts_are_resolved_before_parallel_processing)
+{
+	static const char *const names[] = { "a", "b", "c", "d" };
+	char path[PATH_MAX + 1];
+	size_t i;
+
+	cfg.io_workers = 4;
+
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "dir",
+			saved_cwd);
+
+	create_dir("dir");
+	for(i = 0U; i < ARRAY_LEN(names); ++i)
+	{
+		snprintf(path, sizeof(path), "dir/%s", names[i]);
+		make_file(path, "contents");
+	}
+	make_file("b", "old");
+	make_file("d", "old");
+
+	populate_dir_list(&lwin, 0);
+	for(i = 0U; i < ARRAY_LEN(names); ++i)
+	{
+		lwin.dir_entry[i].marked = 1;
+	}
+
+	wait_for_all_bg();
+	(void)fops_cpmv_bg(&lwin, NULL, 0, CMLO_COPY, CMLF_SKIP);
+	wait_for_bg();
+	assert_int_equal(ARRAY_LEN(names), bg_jobs->bg_op.done);
+
+	assert_int_equal(8, get_file_size("a"));
+	assert_int_equal(3, get_file_size("b"));
+	assert_int_equal(8, get_file_size("c"));
+	assert_int_equal(3, get_file_size("d"));
+
+	for(i = 0U; i < ARRAY_LEN(names); ++i)
+	{
+		remove_file(names[i]);
+		snprintf(path, sizeof(path), "dir/%s", names[i]);
+		remove_file(path);
+	}
+	remove_dir("dir");
+
+	cfg.io_workers = 0;
+}
+
 TEST(broken_link_behaves_like_a_regular_file_on_conflict, IF(not_windows))
 {
 	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "src",
@@ -12,11 +12,13 @@
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
+#include "../../src/background.h"
 #include "../../src/filelist.h"
 #include "../../src/fops_misc.h"
 #include "../../src/status.h"
 
 static uint64_t wait_for_size(const char path[]);
+static int count_jobs(void);
 
 SETUP()
 {
@@ -43,6 +45,35 @@ TEST(directory_size_is_calculated_in_bg)
 	assert_int_equal(73728, wait_for_size(TEST_DATA_PATH "/various-sizes"));
 }
 
+TEST(all_selected_directories_are_handled_by_one_job)
+{
+	create_dir(SANDBOX_PATH "/dir1");
+	create_dir(SANDBOX_PATH "/dir2");
+	make_file(SANDBOX_PATH "/dir2/file", "text");
+
+	char cwd[PATH_MAX + 1];
+	get_cwd(cwd, sizeof(cwd));
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "", cwd);
+	append_view_entry(&lwin, "dir1")->type = FT_DIR;
+	append_view_entry(&lwin, "dir2")->type = FT_DIR;
+	append_view_entry(&lwin, "file")->type = FT_REG;
+	lwin.dir_entry[0].marked = 1;
+	lwin.dir_entry[1].marked = 1;
+	lwin.dir_entry[2].marked = 1;
+	lwin.pending_marking = 1;
+
+	const int njobs = count_jobs();
+	fops_size_bg(&lwin, 0);
+	assert_int_equal(njobs + 1, count_jobs());
+
+	assert_int_equal(0, wait_for_size(SANDBOX_PATH "/dir1"));
+	assert_int_equal(4, wait_for_size(SANDBOX_PATH "/dir2"));
+
+	remove_file(SANDBOX_PATH "/dir2/file");
+	remove_dir(SANDBOX_PATH "/dir2");
+	remove_dir(SANDBOX_PATH "/dir1");
+}
+
 TEST(parent_dir_entry_triggers_calculation_of_current_dir)
 {
 	strcpy(lwin.curr_dir, TEST_DATA_PATH "/various-sizes");
@@ -147,5 +178,18 @@ wait_for_size(const char path[])
 	return size;
 }
 
+/* Counts background jobs.  Returns the number. */
+static int
+count_jobs(void)
+{
+	int njobs = 0;
+	bg_job_t *job;
+	for(job = bg_jobs; job != NULL; job = job->next)
+	{
+		++njobs;
+	}
+	return njobs;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
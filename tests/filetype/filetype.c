@@ -194,6 +194,27 @@ TEST(existence_check)
 	assert_true(ft_assoc_exists(&filetypes, "{*.mp3},{*.flac}", "mplayer"));
 }
 
+TEST(lookups_reflect_new_associations)
+{
+	assert_null(ft_get_program("file.c"));
+
+	assoc_programs("*.c", "c prog", 0, 0);
+	assert_string_equal("c prog", ft_get_program("file.c"));
+
+	assoc_programs("file.*", "file prog", 0, 0);
+	assoc_records_t ft = ft_get_all_programs("file.c");
+	assert_int_equal(2, ft.count);
+	if(ft.count == 2)
+	{
+		assert_string_equal("c prog", ft.list[0].command);
+		assert_string_equal("file prog", ft.list[1].command);
+	}
+	ft_assoc_records_free(&ft);
+
+	ft_reset(0);
+	assert_null(ft_get_program("file.c"));
+}
+
 TEST(pattern_list, IF(has_mime_type_detection))
 {
 	char cmd[1024];
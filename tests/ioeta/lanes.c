@@ -0,0 +1,108 @@
+#include <stic.h>
+
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_t */
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/io/private/ioeta.h"
+#include "../../src/io/ioeta.h"
+#include "../../src/io/ionotif.h"
+
+static void progress_changed(const io_progress_t *progress);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static ioeta_estim_t *estim;
+static const ioeta_estim_t *notified;
+
+SETUP()
+{
+	const io_cancellation_t no_cancellation = {};
+	estim = ioeta_alloc(NULL, no_cancellation);
+	estim->total_items = 2;
+	estim->total_bytes = 300;
+
+	notified = NULL;
+	ionotif_register(&progress_changed);
+}
+
+TEARDOWN()
+{
+	ionotif_register(NULL);
+
+	ioeta_free(estim);
+	estim = NULL;
+}
+
+TEST(progress_of_lanes_is_added_to_parent)
+{
+	ioeta_estim_t *const a = ioeta_alloc_lane(estim, &lock);
+	ioeta_estim_t *const b = ioeta_alloc_lane(estim, &lock);
+
+	ioeta_update(a, "a", "x", 0, 100);
+	ioeta_update(b, "b", "y", 0, 50);
+	assert_true(notified == estim);
+	assert_int_equal(150, estim->current_byte);
+	assert_int_equal(100, a->current_byte);
+	assert_int_equal(50, b->current_byte);
+
+	ioeta_update(a, NULL, NULL, 1, 0);
+	assert_int_equal(1, estim->current_item);
+	assert_int_equal(2, estim->total_items);
+	assert_int_equal(300, estim->total_bytes);
+
+	ioeta_free(a);
+	ioeta_free(b);
+}
+
+TEST(parent_shows_file_of_last_updated_lane)
+{
+	ioeta_estim_t *const a = ioeta_alloc_lane(estim, &lock);
+	ioeta_estim_t *const b = ioeta_alloc_lane(estim, &lock);
+
+	ioeta_update(a, "a", "x", 0, 10);
+	ioeta_update(b, "b", "y", 0, 20);
+	assert_string_equal("b", estim->item);
+	assert_string_equal("y", estim->target);
+	assert_int_equal(20, estim->current_file_byte);
+
+	ioeta_update(a, NULL, NULL, 0, 10);
+	assert_string_equal("a", estim->item);
+	assert_string_equal("x", estim->target);
+	assert_int_equal(20, estim->current_file_byte);
+
+	ioeta_free(a);
+	ioeta_free(b);
+}
+
+TEST(restoring_lane_takes_back_its_progress_from_parent)
+{
+	ioeta_estim_t *const a = ioeta_alloc_lane(estim, &lock);
+	ioeta_estim_t *const b = ioeta_alloc_lane(estim, &lock);
+
+	ioeta_update(b, "b", "y", 0, 50);
+	ioeta_update(a, "a", "x", 0, 10);
+
+	ioeta_estim_t save = ioeta_save(a);
+	ioeta_update(a, "a", "x", 0, 90);
+	ioeta_update(a, "a", "x", 1, 0);
+	assert_int_equal(150, estim->current_byte);
+	assert_int_equal(1, estim->current_item);
+
+	ioeta_restore(a, &save);
+	assert_int_equal(60, estim->current_byte);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(10, a->current_byte);
+
+	ioeta_release(&save);
+	ioeta_free(a);
+	ioeta_free(b);
+}
+
+static void
+progress_changed(const io_progress_t *progress)
+{
+	notified = progress->estim;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
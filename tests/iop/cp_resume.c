@@ -0,0 +1,231 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fputc() fseek() fwrite() remove() */
+
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iop.h"
+#include "../../src/utils/fs.h"
+
+#include "utils.h"
+
+/* Size of files that are journaled while being copied. */
+#define BIG_SIZE (80*1024*1024)
+
+/* Size of destination after which copying is cancelled. */
+#define CANCEL_SIZE (40*1024*1024)
+
+static void make_file(const char path[], uint64_t size, char seed);
+static void interrupt_copying(void);
+static int cancel_after_size(void *arg);
+static int count_checks(void *arg);
+
+static const io_cancellation_t no_cancellation;
+
+TEARDOWN()
+{
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+	(void)remove(SANDBOX_PATH "/dst.vifm-journal");
+}
+
+TEST(terminated_copying_leaves_journal)
+{
+	make_file(SANDBOX_PATH "/src", BIG_SIZE, 'a');
+	assert_false(iop_can_resume_cp(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	interrupt_copying();
+	assert_true(iop_can_resume_cp(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+	assert_true(path_exists(SANDBOX_PATH "/dst.vifm-journal", NODEREF));
+}
+
+TEST(successful_copying_removes_journal)
+{
+	make_file(SANDBOX_PATH "/src", BIG_SIZE, 'a');
+	interrupt_copying();
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_REPLACE_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_false(path_exists(SANDBOX_PATH "/dst.vifm-journal", NODEREF));
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+}
+
+TEST(copying_is_resumed_after_verified_part)
+{
+	make_file(SANDBOX_PATH "/src", BIG_SIZE, 'a');
+
+	/* Count how much work copying from scratch takes. */
+	int full_checks = 0;
+	io_args_t full_args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+
+		.cancellation.hook = &count_checks,
+		.cancellation.arg = &full_checks,
+	};
+	ioe_errlst_init(&full_args.result.errors);
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&full_args));
+	delete_test_file(SANDBOX_PATH "/dst");
+
+	interrupt_copying();
+
+	int checks = 0;
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_RESUME_FILES,
+
+		.cancellation.hook = &count_checks,
+		.cancellation.arg = &checks,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	ioeta_calculate(args.estim, SANDBOX_PATH "/src", /*shallow=*/0, /*deep=*/0);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(checks < full_checks);
+	assert_ulong_equal(BIG_SIZE, args.estim->current_byte);
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+	assert_false(path_exists(SANDBOX_PATH "/dst.vifm-journal", NODEREF));
+
+	ioeta_free(args.estim);
+}
+
+TEST(corrupted_part_is_copied_again)
+{
+	make_file(SANDBOX_PATH "/src", BIG_SIZE, 'a');
+	interrupt_copying();
+
+	FILE *const f = fopen(SANDBOX_PATH "/dst", "r+b");
+	assert_non_null(f);
+	assert_success(fseek(f, 100, SEEK_SET));
+	assert_true(fputc('!', f) == '!');
+	assert_success(fclose(f));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_RESUME_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+}
+
+TEST(journal_of_different_source_is_not_used)
+{
+	make_file(SANDBOX_PATH "/src", BIG_SIZE, 'a');
+	interrupt_copying();
+
+	make_file(SANDBOX_PATH "/src", BIG_SIZE + 1, 'b');
+	assert_false(iop_can_resume_cp(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_RESUME_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+}
+
+TEST(resuming_without_journal_copies_whole_file)
+{
+	create_test_file(SANDBOX_PATH "/src");
+	make_file(SANDBOX_PATH "/dst", 10, 'x');
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_RESUME_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+}
+
+/* Creates file of specified size filled with non-repeating within a block
+ * pattern that depends on the seed. */
+static void
+make_file(const char path[], uint64_t size, char seed)
+{
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+
+	char block[4099];
+	size_t i;
+	for(i = 0U; i < sizeof(block); ++i)
+	{
+		block[i] = (char)(i*31U + i/256U + seed);
+	}
+
+	while(size != 0U)
+	{
+		const size_t len = (size < sizeof(block) ? size : sizeof(block));
+		assert_int_equal(len, fwrite(block, 1, len, f));
+		size -= len;
+	}
+
+	assert_success(fclose(f));
+}
+
+/* Copies src to dst cancelling the operation in the middle. */
+static void
+interrupt_copying(void)
+{
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_REPLACE_FILES,
+
+		.cancellation.hook = &cancel_after_size,
+		.cancellation.arg = SANDBOX_PATH "/dst",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_FAILED, iop_cp(&args));
+	ioe_errlst_free(&args.result.errors);
+
+	assert_true(get_file_size(SANDBOX_PATH "/dst") < BIG_SIZE);
+}
+
+/* Requests cancellation once destination file gets large enough. */
+static int
+cancel_after_size(void *arg)
+{
+	return get_file_size(arg) >= CANCEL_SIZE;
+}
+
+/* Counts checks for cancellation without ever requesting it. */
+static int
+count_checks(void *arg)
+{
+	int *const ncalls = arg;
+	++*ncalls;
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,184 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* ftruncate() unlink() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fileno() fopen() fseek() fwrite() */
+
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iop.h"
+#include "../../src/utils/fs.h"
+
+#include "utils.h"
+
+/* Apparent size of sparse files. */
+#define SPARSE_SIZE (8*1024*1024)
+/* Size of data chunk in the middle of sparse files. */
+#define DATA_SIZE (64*1024)
+
+static void make_sparse_file(const char path[]);
+static uint64_t allocated_size(const char path[]);
+static int holes_are_supported(void);
+
+static const io_cancellation_t no_cancellation;
+
+TEST(holes_are_preserved_for_sparse_file, IF(holes_are_supported))
+{
+	make_sparse_file(SANDBOX_PATH "/src");
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	ioeta_calculate(args.estim, SANDBOX_PATH "/src", /*shallow=*/0, /*deep=*/0);
+	assert_true(args.estim->total_bytes < SPARSE_SIZE/2);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_ulong_equal(SPARSE_SIZE, get_file_size(SANDBOX_PATH "/dst"));
+	assert_true(allocated_size(SANDBOX_PATH "/dst") < SPARSE_SIZE/2);
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	/* Only data is counted. */
+	assert_true(args.estim->current_byte >= DATA_SIZE);
+	assert_true(args.estim->current_byte < SPARSE_SIZE/2);
+
+	ioeta_free(args.estim);
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(trailing_hole_is_preserved, IF(holes_are_supported))
+{
+	FILE *const f = fopen(SANDBOX_PATH "/src", "wb");
+	assert_non_null(f);
+	assert_int_equal(4, fwrite("data", 1, 4, f));
+	assert_success(fflush(f));
+	assert_success(ftruncate(fileno(f), SPARSE_SIZE));
+	assert_success(fclose(f));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_ulong_equal(SPARSE_SIZE, get_file_size(SANDBOX_PATH "/dst"));
+	assert_true(allocated_size(SANDBOX_PATH "/dst") < SPARSE_SIZE/2);
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(sparse_copying_can_be_forced_for_dense_file)
+{
+	create_test_file(SANDBOX_PATH "/src");
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg4.sparse_copying = 1,
+		.arg4.data_sync = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(appending_to_sparse_file_works, IF(holes_are_supported))
+{
+	make_sparse_file(SANDBOX_PATH "/src");
+	make_sparse_file(SANDBOX_PATH "/dst");
+	assert_success(truncate(SANDBOX_PATH "/dst", SPARSE_SIZE/2 + DATA_SIZE));
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg3.crs = IO_CRS_APPEND_TO_FILES,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+/* Creates file of SPARSE_SIZE with DATA_SIZE bytes of data in the middle and
+ * holes around it. */
+static void
+make_sparse_file(const char path[])
+{
+	static char data[DATA_SIZE];
+	size_t i;
+	for(i = 0U; i < sizeof(data); ++i)
+	{
+		data[i] = (char)(i*31U + i/256U);
+	}
+
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	assert_success(fseek(f, SPARSE_SIZE/2, SEEK_SET));
+	assert_int_equal(sizeof(data), fwrite(data, 1, sizeof(data), f));
+	assert_success(fflush(f));
+	assert_success(ftruncate(fileno(f), SPARSE_SIZE));
+	assert_success(fclose(f));
+}
+
+/* Retrieves amount of space occupied by the file on disk.  Returns the size. */
+static uint64_t
+allocated_size(const char path[])
+{
+	struct stat st;
+	assert_success(stat(path, &st));
+	return (uint64_t)st.st_blocks*512U;
+}
+
+/* Checks whether sandbox is on a file system that supports holes in files.
+ * Returns non-zero if so, otherwise zero is returned. */
+static int
+holes_are_supported(void)
+{
+#ifndef _WIN32
+	const char *const path = SANDBOX_PATH "/holes-check";
+
+	FILE *const f = fopen(path, "wb");
+	if(f == NULL)
+	{
+		return 0;
+	}
+	const int truncated = (ftruncate(fileno(f), SPARSE_SIZE) == 0);
+	fclose(f);
+
+	struct stat st;
+	const int sparse = (truncated && stat(path, &st) == 0 &&
+			(uint64_t)st.st_blocks*512U < SPARSE_SIZE/2);
+	(void)unlink(path);
+	return sparse;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
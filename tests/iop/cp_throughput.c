@@ -0,0 +1,156 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() */
+
+#include <test-utils.h>
+
+#include "../../src/io/ioeta.h"
+#include "../../src/io/iop.h"
+#include "../../src/utils/fs.h"
+
+#include "utils.h"
+
+/* These tests copy files which span multiple chunks of kernel-side copying. */
+
+/* Size of a file for the benchmark. */
+#define BENCH_FILE_SIZE (64*1024*1024)
+
+static void make_sized_file(const char path[], uint64_t size);
+static int cancel_at_second_check(void *arg);
+
+static const io_cancellation_t no_cancellation;
+
+TEST(multi_chunk_file_is_copied_with_progress)
+{
+	/* Not a multiple of any reasonable block size. */
+	const uint64_t size = 9*1024*1024 + 13;
+	make_sized_file(SANDBOX_PATH "/src", size);
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	ioeta_calculate(args.estim, SANDBOX_PATH "/src", /*shallow=*/0, /*deep=*/0);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_ulong_equal(size, args.estim->current_byte);
+	assert_ulong_equal(size, get_file_size(SANDBOX_PATH "/dst"));
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	ioeta_free(args.estim);
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(data_sync_does_not_break_copying)
+{
+	const uint64_t size = 5*1024*1024;
+	make_sized_file(SANDBOX_PATH "/src", size);
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg4.data_sync = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/src", SANDBOX_PATH "/dst"));
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(copying_can_be_cancelled)
+{
+	const uint64_t size = 9*1024*1024;
+	make_sized_file(SANDBOX_PATH "/src", size);
+
+	int ncalls = 0;
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+
+		.cancellation.hook = &cancel_at_second_check,
+		.cancellation.arg = &ncalls,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_FAILED, iop_cp(&args));
+	ioe_errlst_free(&args.result.errors);
+
+	assert_true(get_file_size(SANDBOX_PATH "/dst") < size);
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+TEST(large_file_copying_benchmark, IF(benchmarks_enabled))
+{
+	make_sized_file(SANDBOX_PATH "/src", BENCH_FILE_SIZE);
+
+	int i;
+	for(i = 0; i < 4; ++i)
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/src",
+			.arg2.dst = SANDBOX_PATH "/dst",
+			.arg3.crs = IO_CRS_REPLACE_FILES,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+
+		assert_ulong_equal(BENCH_FILE_SIZE, get_file_size(SANDBOX_PATH "/dst"));
+	}
+
+	delete_test_file(SANDBOX_PATH "/src");
+	delete_test_file(SANDBOX_PATH "/dst");
+}
+
+/* Creates file of specified size filled with non-repeating within a block
+ * pattern. */
+static void
+make_sized_file(const char path[], uint64_t size)
+{
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+
+	char block[4099];
+	size_t i;
+	for(i = 0U; i < sizeof(block); ++i)
+	{
+		block[i] = (char)(i*31U + i/256U);
+	}
+
+	while(size != 0U)
+	{
+		const size_t len = (size < sizeof(block) ? size : sizeof(block));
+		assert_int_equal(len, fwrite(block, 1, len, f));
+		size -= len;
+	}
+
+	assert_success(fclose(f));
+}
+
+/* Requests cancellation on the second check. */
+static int
+cancel_at_second_check(void *arg)
+{
+	int *const ncalls = arg;
+	return ++*ncalls >= 2;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
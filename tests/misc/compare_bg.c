@@ -0,0 +1,147 @@
+#include <stic.h>
+
+#include <unistd.h> /* usleep() */
+
+#include <string.h> /* strcat() strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/ui/statusbar.h"
+#include "../../src/ui/ui.h"
+#include "../../src/compare.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+static void wait_for_comparison(void);
+
+SETUP()
+{
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	conf_setup();
+	view_setup(&lwin);
+	view_setup(&rwin);
+	opt_handlers_setup();
+
+	columns_setup_column(SK_BY_NAME);
+	columns_setup_column(SK_BY_SIZE);
+
+	curr_stats.load_stage = 3;
+}
+
+TEARDOWN()
+{
+	curr_stats.load_stage = 0;
+
+	columns_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+	opt_handlers_teardown();
+	conf_teardown();
+}
+
+TEST(contents_are_compared_in_background)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, CF_NONE));
+	assert_false(flist_custom_active(&lwin));
+
+	wait_for_comparison();
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(4, lwin.list_rows);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+	assert_int_equal(3, lwin.dir_entry[3].id);
+}
+
+TEST(two_panes_are_compared_in_background)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_two_panes(CT_CONTENTS, LT_DUPS, CF_SHOW));
+	assert_false(flist_custom_active(&lwin));
+	assert_false(flist_custom_active(&rwin));
+
+	wait_for_comparison();
+
+	assert_int_equal(CV_DIFF, lwin.custom.type);
+	assert_int_equal(CV_DIFF, rwin.custom.type);
+	assert_int_equal(lwin.list_rows, rwin.list_rows);
+	assert_int_equal(2, lwin.custom.diff_stats.identical);
+}
+
+TEST(results_are_for_initial_roles_of_views)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+
+	curr_view = &rwin;
+	other_view = &lwin;
+	wait_for_comparison();
+
+	assert_true(curr_view == &rwin);
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(2, lwin.list_rows);
+	assert_false(flist_custom_active(&rwin));
+}
+
+TEST(changing_location_drops_results)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, CF_NONE));
+
+	/* Record status bar message without trying to display it. */
+	curr_stats.load_stage = 0;
+
+	strcat(lwin.curr_dir, "/..");
+	wait_for_comparison();
+
+	assert_false(flist_custom_active(&lwin));
+	assert_string_equal("Comparison results were dropped due to change of "
+			"location", ui_sb_last());
+}
+
+TEST(new_comparison_replaces_running_one)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, CF_NONE));
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+
+	wait_for_comparison();
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(2, lwin.list_rows);
+}
+
+TEST(comparison_without_reading_files_is_synchronous)
+{
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_one_pane(&lwin, CT_SIZE, LT_ALL, CF_NONE));
+
+	assert_false(compare_update_from_job());
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_int_equal(4, lwin.list_rows);
+}
+
+/* Processes results of background comparison until it's done. */
+static void
+wait_for_comparison(void)
+{
+	int counter = 0;
+	while(compare_update_from_job())
+	{
+		usleep(5000);
+		if(++counter > 200)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
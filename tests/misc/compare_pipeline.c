@@ -0,0 +1,165 @@
+#include <stic.h>
+
+#include <stddef.h> /* size_t */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() */
+#include <string.h> /* memset() strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/ui/ui.h"
+#include "../../src/compare.h"
+#include "../../src/hcache.h"
+
+/* Size of files that are bigger than all samples taken together. */
+#define BIG_SIZE (64*1024)
+
+static void make_big_file(const char path[], size_t diff_pos);
+
+SETUP()
+{
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	conf_setup();
+	view_setup(&lwin);
+	view_setup(&rwin);
+	opt_handlers_setup();
+
+	hcache_clear();
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+}
+
+TEARDOWN()
+{
+	hcache_clear();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+	opt_handlers_teardown();
+	conf_teardown();
+}
+
+TEST(only_files_of_same_size_are_sampled)
+{
+	make_file(SANDBOX_PATH "/a", "abc1");
+	make_file(SANDBOX_PATH "/b", "abc1");
+	make_file(SANDBOX_PATH "/c", "abc2");
+	make_file(SANDBOX_PATH "/d", "xx");
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(2, lwin.list_rows);
+
+	const compare_counters_t *counters = compare_get_counters();
+	assert_int_equal(4, counters->files);
+	assert_int_equal(3, counters->sampled);
+	assert_int_equal(2, counters->hashed);
+	assert_int_equal(0, counters->cached);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+	remove_file(SANDBOX_PATH "/d");
+}
+
+TEST(difference_in_middle_is_found_by_sampling)
+{
+	make_big_file(SANDBOX_PATH "/a", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/b", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/c", BIG_SIZE/2);
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+
+	const compare_counters_t *counters = compare_get_counters();
+	assert_int_equal(3, counters->sampled);
+	assert_int_equal(2, counters->hashed);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+}
+
+TEST(difference_between_samples_is_found_by_full_hashing)
+{
+	make_big_file(SANDBOX_PATH "/a", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/b", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/c", BIG_SIZE/4);
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, CF_NONE));
+	assert_int_equal(3, lwin.list_rows);
+	assert_int_equal(lwin.dir_entry[0].id, lwin.dir_entry[1].id);
+	assert_true(lwin.dir_entry[1].id != lwin.dir_entry[2].id);
+
+	const compare_counters_t *counters = compare_get_counters();
+	assert_int_equal(3, counters->sampled);
+	assert_int_equal(3, counters->hashed);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+}
+
+TEST(files_of_both_views_are_hashed_together)
+{
+	create_dir(SANDBOX_PATH "/left");
+	create_dir(SANDBOX_PATH "/right");
+	make_big_file(SANDBOX_PATH "/left/a", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/right/a", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/right/b", BIG_SIZE/4);
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH "/left");
+	strcpy(rwin.curr_dir, SANDBOX_PATH "/right");
+	assert_success(compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW));
+	assert_int_equal(1, lwin.custom.diff_stats.identical);
+	assert_int_equal(1, lwin.custom.diff_stats.unique_right);
+
+	const compare_counters_t *counters = compare_get_counters();
+	assert_int_equal(3, counters->files);
+	assert_int_equal(3, counters->sampled);
+	assert_int_equal(3, counters->hashed);
+
+	remove_file(SANDBOX_PATH "/left/a");
+	remove_file(SANDBOX_PATH "/right/a");
+	remove_file(SANDBOX_PATH "/right/b");
+	remove_dir(SANDBOX_PATH "/left");
+	remove_dir(SANDBOX_PATH "/right");
+}
+
+TEST(digests_are_reused_by_next_comparison)
+{
+	make_big_file(SANDBOX_PATH "/a", BIG_SIZE);
+	make_big_file(SANDBOX_PATH "/b", BIG_SIZE);
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(0, compare_get_counters()->cached);
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(2, lwin.list_rows);
+	assert_int_equal(4, compare_get_counters()->cached);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+}
+
+/* Creates file of BIG_SIZE bytes which has a different byte at the specified
+ * position (or nowhere if it's out of range). */
+static void
+make_big_file(const char path[], size_t diff_pos)
+{
+	static char data[BIG_SIZE];
+	memset(data, 'x', sizeof(data));
+	if(diff_pos < sizeof(data))
+	{
+		data[diff_pos] = 'y';
+	}
+
+	FILE *const f = fopen(path, "wb");
+	assert_non_null(f);
+	assert_int_equal(sizeof(data), fwrite(data, 1, sizeof(data), f));
+	assert_success(fclose(f));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
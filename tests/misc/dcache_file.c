@@ -0,0 +1,261 @@
+#include <stic.h>
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() remove() */
+#include <time.h> /* time() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/dcache_file.h"
+#include "../../src/status.h"
+
+static void count_records(const char path[], const dcf_entry_t *entry,
+		void *arg);
+static dcf_entry_t make_entry(uint64_t size, uint64_t nitems);
+
+static const char *const file = SANDBOX_PATH "/dcache";
+
+SETUP()
+{
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+}
+
+TEARDOWN()
+{
+	dcache_detach();
+	update_string(&cfg.shell, NULL);
+	(void)remove(file);
+}
+
+TEST(records_survive_reopening, IF(not_windows))
+{
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+	dcf_entry_t entry = make_entry(10, 11);
+	dcf_put(dcf, "/some/path", &entry);
+	entry = make_entry(12, 13);
+	dcf_put(dcf, "/some/path", &entry);
+	dcf_close(dcf);
+
+	dcf = dcf_open(file);
+	assert_non_null(dcf);
+	assert_success(dcf_take(dcf, "/some/path", &entry));
+	assert_ulong_equal(12, entry.values[0].value);
+	assert_ulong_equal(13, entry.values[DCF_NVALUES - 1].value);
+	assert_failure(dcf_take(dcf, "/some/path", &entry));
+	assert_failure(dcf_take(dcf, "/some", &entry));
+	dcf_close(dcf);
+}
+
+TEST(records_are_exchanged_on_sync, IF(not_windows))
+{
+	dcf_t *a = dcf_open(file);
+	dcf_t *b = dcf_open(file);
+	assert_non_null(a);
+	assert_non_null(b);
+
+	dcf_entry_t entry = make_entry(1, 2);
+	dcf_put(a, "/path", &entry);
+
+	int count = 0;
+	assert_success(dcf_sync(a, &count_records, &count));
+	assert_int_equal(0, count);
+	assert_success(dcf_sync(b, &count_records, &count));
+	assert_int_equal(1, count);
+	assert_success(dcf_sync(b, &count_records, &count));
+	assert_int_equal(1, count);
+
+	dcf_close(a);
+	dcf_close(b);
+}
+
+TEST(partial_record_is_dropped, IF(not_windows))
+{
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+	dcf_entry_t entry = make_entry(10, 11);
+	dcf_put(dcf, "/path", &entry);
+	dcf_close(dcf);
+
+	const uint64_t size = get_file_size(file);
+
+	FILE *fp = fopen(file, "ab");
+	assert_non_null(fp);
+	assert_int_equal(5, fwrite("trash", 1, 5, fp));
+	fclose(fp);
+
+	dcf = dcf_open(file);
+	assert_non_null(dcf);
+	assert_ulong_equal(size, get_file_size(file));
+	assert_success(dcf_take(dcf, "/path", &entry));
+	assert_ulong_equal(10, entry.values[0].value);
+	dcf_close(dcf);
+}
+
+TEST(file_of_unknown_format_is_reset, IF(not_windows))
+{
+	make_file(file, "not a cache file");
+
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+	dcf_entry_t entry;
+	assert_failure(dcf_take(dcf, "/path", &entry));
+	dcf_close(dcf);
+}
+
+TEST(records_are_available_after_file_is_truncated, IF(not_windows))
+{
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+	dcf_entry_t entry = make_entry(10, 11);
+	dcf_put(dcf, "/path", &entry);
+	dcf_close(dcf);
+
+	dcf = dcf_open(file);
+	assert_non_null(dcf);
+
+	/* Like an instance that doesn't recognize format of the file. */
+	make_file(file, "");
+
+	assert_success(dcf_take(dcf, "/path", &entry));
+	assert_ulong_equal(10, entry.values[0].value);
+	dcf_close(dcf);
+}
+
+TEST(outdated_records_are_compacted, IF(not_windows))
+{
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+
+	int i;
+	dcf_entry_t entry;
+	for(i = 0; i < 5000; ++i)
+	{
+		entry = make_entry(i, i);
+		dcf_put(dcf, "/path", &entry);
+	}
+	entry = make_entry(1, 1);
+	dcf_put(dcf, "/other", &entry);
+	dcf_close(dcf);
+
+	const uint64_t size = get_file_size(file);
+
+	dcf = dcf_open(file);
+	assert_non_null(dcf);
+	assert_true(get_file_size(file) < size/100);
+	assert_success(dcf_take(dcf, "/path", &entry));
+	assert_ulong_equal(4999, entry.values[0].value);
+	assert_success(dcf_take(dcf, "/other", &entry));
+	assert_ulong_equal(1, entry.values[DCF_NVALUES - 1].value);
+	dcf_close(dcf);
+}
+
+TEST(dcache_is_restored_from_file, IF(not_windows))
+{
+	uint64_t size, nitems;
+
+	assert_success(dcache_attach(file));
+	assert_success(dcache_set_at(TEST_DATA_PATH, 0, 10, 11));
+	dcache_detach();
+
+	assert_success(stats_init(&cfg));
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	assert_ulong_equal(DCACHE_UNKNOWN, nitems);
+
+	assert_success(dcache_attach(file));
+	/* Tests are executed fast, so decrease mtime. */
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(11, nitems);
+}
+
+TEST(newer_data_in_memory_is_not_overwritten, IF(not_windows))
+{
+	uint64_t size, nitems;
+
+	assert_success(dcache_attach(file));
+	assert_success(dcache_set_at(TEST_DATA_PATH, 0, 10, 11));
+	dcache_detach();
+
+	assert_success(dcache_attach(file));
+	assert_success(dcache_set_at(TEST_DATA_PATH, 0, DCACHE_UNKNOWN, 12));
+
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(12, nitems);
+}
+
+TEST(dcache_is_synchronized_between_instances, IF(not_windows))
+{
+	uint64_t size, nitems;
+
+	assert_success(dcache_attach(file));
+
+	dcf_t *dcf = dcf_open(file);
+	assert_non_null(dcf);
+	dcf_entry_t entry = make_entry(20, 21);
+	entry.values[0].ts = time(NULL);
+	entry.values[DCF_NVALUES - 1].ts = time(NULL);
+	dcf_put(dcf, TEST_DATA_PATH, &entry);
+	dcf_close(dcf);
+
+	dcache_sync();
+
+	dcache_get_at(TEST_DATA_PATH, time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(20, size);
+	assert_ulong_equal(21, nitems);
+}
+
+TEST(file_is_used_only_when_enabled_in_vifminfo, IF(not_windows))
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+
+	cfg.vifm_info = 0;
+	dcache_setup_file(&cfg);
+	assert_success(dcache_set_at(TEST_DATA_PATH, 0, 10, 11));
+	dcache_detach();
+	assert_false(path_exists(file, NODEREF));
+
+	cfg.vifm_info = VINFO_DCACHE;
+	dcache_setup_file(&cfg);
+	assert_success(dcache_set_at(TEST_DATA_PATH, 0, 10, 11));
+	dcache_detach();
+	assert_true(path_exists(file, NODEREF));
+
+	cfg.vifm_info = 0;
+	cfg.config_dir[0] = '\0';
+}
+
+static void
+count_records(const char path[], const dcf_entry_t *entry, void *arg)
+{
+	int *count = arg;
+	++*count;
+}
+
+/* Makes an entry with apparent size and number of items set.  Sizes of other
+ * kinds are unknown. */
+static dcf_entry_t
+make_entry(uint64_t size, uint64_t nitems)
+{
+	dcf_entry_t entry;
+
+	int i;
+	for(i = 0; i < DCF_NVALUES; ++i)
+	{
+		const dcf_value_t unknown = { .value = DCACHE_UNKNOWN, .inode = 0, .ts = 1 };
+		entry.values[i] = unknown;
+	}
+
+	entry.values[0].value = size;
+	entry.values[DCF_NVALUES - 1].value = nitems;
+	return entry;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,340 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* link() rmdir() */
+#include <utime.h> /* utimbuf utime() */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* remove() snprintf() */
+#include <string.h> /* memset() */
+#include <time.h> /* time() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/cancellation.h"
+#include "../../src/utils/str.h"
+#include "../../src/fops_misc.h"
+#include "../../src/status.h"
+
+/* Number of subdirectories in a wide tree. */
+#define NDIRS 50
+
+static void make_sized_file(const char path[], int size);
+static uint64_t cached_size(const char path[]);
+static uint64_t cached_size_of(const char path[], DirSizeKind kind);
+static int always_cancelled(void *arg);
+static void make_wide_tree(void);
+static void remove_wide_tree(void);
+
+SETUP()
+{
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	/* Views are redrawn as sizes become known. */
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	assert_success(os_mkdir(SANDBOX_PATH "/top", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/a", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/a/b", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/c", 0700));
+	make_sized_file(SANDBOX_PATH "/top/a/f1", 10);
+	make_sized_file(SANDBOX_PATH "/top/a/b/f2", 20);
+	make_sized_file(SANDBOX_PATH "/top/c/f3", 30);
+	make_sized_file(SANDBOX_PATH "/top/f4", 5);
+}
+
+TEARDOWN()
+{
+	cfg.stat_workers = 0;
+	update_string(&cfg.shell, NULL);
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	assert_success(remove(SANDBOX_PATH "/top/a/f1"));
+	assert_success(remove(SANDBOX_PATH "/top/a/b/f2"));
+	assert_success(remove(SANDBOX_PATH "/top/c/f3"));
+	assert_success(remove(SANDBOX_PATH "/top/f4"));
+	assert_success(rmdir(SANDBOX_PATH "/top/a/b"));
+	assert_success(rmdir(SANDBOX_PATH "/top/a"));
+	assert_success(rmdir(SANDBOX_PATH "/top/c"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
+TEST(size_of_nested_directories_is_calculated_serially)
+{
+	cfg.stat_workers = 1;
+
+	assert_ulong_equal(65, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+	assert_ulong_equal(65, cached_size(SANDBOX_PATH "/top"));
+	assert_ulong_equal(30, cached_size(SANDBOX_PATH "/top/a"));
+	assert_ulong_equal(20, cached_size(SANDBOX_PATH "/top/a/b"));
+	assert_ulong_equal(30, cached_size(SANDBOX_PATH "/top/c"));
+}
+
+TEST(size_of_nested_directories_is_calculated_in_parallel)
+{
+	cfg.stat_workers = 4;
+
+	assert_ulong_equal(65, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+	assert_ulong_equal(65, cached_size(SANDBOX_PATH "/top"));
+	assert_ulong_equal(30, cached_size(SANDBOX_PATH "/top/a"));
+	assert_ulong_equal(20, cached_size(SANDBOX_PATH "/top/a/b"));
+	assert_ulong_equal(30, cached_size(SANDBOX_PATH "/top/c"));
+}
+
+TEST(wide_tree_is_summed_up_correctly)
+{
+	make_wide_tree();
+
+	cfg.stat_workers = 4;
+	const uint64_t expected = 65 + NDIRS*(NDIRS + 1)/2;
+	assert_ulong_equal(expected, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+
+	assert_success(stats_init(&cfg));
+	cfg.stat_workers = 1;
+	assert_ulong_equal(expected, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+
+	remove_wide_tree();
+}
+
+TEST(cached_sizes_are_used_unless_forced)
+{
+	/* Make cached value newer than the directory. */
+	const struct utimbuf times = { .actime = 0, .modtime = time(NULL) - 100 };
+	assert_success(utime(SANDBOX_PATH "/top", &times));
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/top", &st));
+	const uint64_t sizes[DSK_COUNT] = { 1000, 1000, 1000 };
+	assert_success(dcache_set_sizes_at(SANDBOX_PATH "/top", st.st_ino, sizes));
+
+	cfg.stat_workers = 4;
+	assert_ulong_equal(1000, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+	assert_ulong_equal(65, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+	assert_ulong_equal(65, cached_size(SANDBOX_PATH "/top"));
+}
+
+TEST(cached_apparent_sizes_of_subdirectories_are_reused)
+{
+	/* Make cached value newer than the directory. */
+	const struct utimbuf times = { .actime = 0, .modtime = time(NULL) - 100 };
+	assert_success(utime(SANDBOX_PATH "/top/c", &times));
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/top/c", &st));
+	const uint64_t sizes[DSK_COUNT] = { 1000, 1000, 1000 };
+	assert_success(dcache_set_sizes_at(SANDBOX_PATH "/top/c", st.st_ino, sizes));
+
+	cfg.stat_workers = 4;
+	assert_ulong_equal(1035, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+	assert_ulong_equal(1035, cached_size(SANDBOX_PATH "/top"));
+	assert_ulong_equal(DCACHE_UNKNOWN,
+			cached_size_of(SANDBOX_PATH "/top", DSK_UNIQUE));
+}
+
+TEST(cached_sizes_of_subdirectories_are_not_reused_for_all_kinds)
+{
+	/* Make cached value newer than the directory. */
+	const struct utimbuf times = { .actime = 0, .modtime = time(NULL) - 100 };
+	assert_success(utime(SANDBOX_PATH "/top/c", &times));
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/top/c", &st));
+	const uint64_t sizes[DSK_COUNT] = { 1000, 1000, 1000 };
+	assert_success(dcache_set_sizes_at(SANDBOX_PATH "/top/c", st.st_ino, sizes));
+
+	cfg.stat_workers = 4;
+
+	uint64_t all_sizes[DSK_COUNT];
+	fops_dir_sizes(SANDBOX_PATH "/top", 0, &no_cancellation, all_sizes);
+	assert_ulong_equal(65, all_sizes[DSK_APPARENT]);
+	assert_ulong_equal(65, all_sizes[DSK_UNIQUE]);
+	assert_ulong_equal(30, cached_size(SANDBOX_PATH "/top/c"));
+}
+
+TEST(cancellation_stops_calculation)
+{
+	const cancellation_t cancellation = { .hook = &always_cancelled };
+
+	cfg.stat_workers = 4;
+	assert_ulong_equal(0, fops_dir_size(SANDBOX_PATH "/top", 0, &cancellation));
+	assert_ulong_equal(DCACHE_UNKNOWN, cached_size(SANDBOX_PATH "/top"));
+	assert_ulong_equal(DCACHE_UNKNOWN, cached_size(SANDBOX_PATH "/top/a"));
+}
+
+TEST(hard_links_are_counted_once_in_unique_size, IF(not_windows))
+{
+	assert_success(link(SANDBOX_PATH "/top/c/f3", SANDBOX_PATH "/top/a/f3"));
+	assert_success(link(SANDBOX_PATH "/top/c/f3", SANDBOX_PATH "/top/f3"));
+
+	cfg.stat_workers = 4;
+
+	uint64_t sizes[DSK_COUNT];
+	fops_dir_sizes(SANDBOX_PATH "/top", 1, &no_cancellation, sizes);
+	assert_ulong_equal(125, sizes[DSK_APPARENT]);
+	assert_ulong_equal(65, sizes[DSK_UNIQUE]);
+
+	assert_ulong_equal(125, cached_size_of(SANDBOX_PATH "/top", DSK_APPARENT));
+	assert_ulong_equal(65, cached_size_of(SANDBOX_PATH "/top", DSK_UNIQUE));
+
+	assert_success(remove(SANDBOX_PATH "/top/a/f3"));
+	assert_success(remove(SANDBOX_PATH "/top/f3"));
+}
+
+TEST(unique_size_of_subdirectory_is_not_reused_for_parent, IF(not_windows))
+{
+	assert_success(link(SANDBOX_PATH "/top/c/f3", SANDBOX_PATH "/top/a/f3"));
+
+	/* Make cached value newer than the directory. */
+	const struct utimbuf times = { .actime = 0, .modtime = time(NULL) - 100 };
+	assert_success(utime(SANDBOX_PATH "/top/a", &times));
+
+	cfg.stat_workers = 4;
+
+	uint64_t sizes[DSK_COUNT];
+	fops_dir_sizes(SANDBOX_PATH "/top/a", 0, &no_cancellation, sizes);
+	assert_ulong_equal(60, sizes[DSK_UNIQUE]);
+	assert_ulong_equal(60, cached_size_of(SANDBOX_PATH "/top/a", DSK_UNIQUE));
+
+	fops_dir_sizes(SANDBOX_PATH "/top", 0, &no_cancellation, sizes);
+	assert_ulong_equal(95, sizes[DSK_APPARENT]);
+	assert_ulong_equal(65, sizes[DSK_UNIQUE]);
+	assert_ulong_equal(65, cached_size_of(SANDBOX_PATH "/top", DSK_UNIQUE));
+
+	/* Unique size of a subdirectory depends on the order of traversal. */
+	assert_ulong_equal(DCACHE_UNKNOWN,
+			cached_size_of(SANDBOX_PATH "/top/c", DSK_UNIQUE));
+
+	assert_success(remove(SANDBOX_PATH "/top/a/f3"));
+}
+
+TEST(allocated_size_includes_directories, IF(not_windows))
+{
+	struct stat st;
+	uint64_t expected = 0;
+	const char *const paths[] = {
+		SANDBOX_PATH "/top", SANDBOX_PATH "/top/a", SANDBOX_PATH "/top/a/b",
+		SANDBOX_PATH "/top/c", SANDBOX_PATH "/top/a/f1",
+		SANDBOX_PATH "/top/a/b/f2", SANDBOX_PATH "/top/c/f3",
+		SANDBOX_PATH "/top/f4",
+	};
+
+	size_t i;
+	for(i = 0; i < sizeof(paths)/sizeof(paths[0]); ++i)
+	{
+		assert_success(os_lstat(paths[i], &st));
+		expected += (uint64_t)st.st_blocks*512U;
+	}
+
+	uint64_t sizes[DSK_COUNT];
+	fops_dir_sizes(SANDBOX_PATH "/top", 1, &no_cancellation, sizes);
+	assert_ulong_equal(expected, sizes[DSK_ALLOCATED]);
+	assert_ulong_equal(expected,
+			cached_size_of(SANDBOX_PATH "/top", DSK_ALLOCATED));
+}
+
+TEST(partially_cached_sizes_are_recalculated)
+{
+	/* Make cached value newer than the directory. */
+	const struct utimbuf times = { .actime = 0, .modtime = time(NULL) - 100 };
+	assert_success(utime(SANDBOX_PATH "/top", &times));
+
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/top", &st));
+	assert_success(dcache_set_at(SANDBOX_PATH "/top", st.st_ino, 1000,
+				DCACHE_UNKNOWN));
+
+	uint64_t sizes[DSK_COUNT];
+	fops_dir_sizes(SANDBOX_PATH "/top", 0, &no_cancellation, sizes);
+	assert_ulong_equal(65, sizes[DSK_APPARENT]);
+	assert_ulong_equal(65, sizes[DSK_UNIQUE]);
+}
+
+static void
+make_sized_file(const char path[], int size)
+{
+	char data[128];
+	assert_true(size < (int)sizeof(data));
+	memset(data, 'x', size);
+	data[size] = '\0';
+	make_file(path, data);
+}
+
+/* Retrieves cached size of a directory.  Returns the size or DCACHE_UNKNOWN. */
+static uint64_t
+cached_size(const char path[])
+{
+	struct stat st;
+	assert_success(os_stat(path, &st));
+
+	uint64_t size;
+	/* Tests are executed fast, so decrease mtime. */
+	dcache_get_at(path, time(NULL) - 10, st.st_ino, &size, NULL);
+	return size;
+}
+
+/* Retrieves cached size of a directory of the specified kind.  Returns the size
+ * or DCACHE_UNKNOWN. */
+static uint64_t
+cached_size_of(const char path[], DirSizeKind kind)
+{
+	struct stat st;
+	assert_success(os_stat(path, &st));
+
+	uint64_t size;
+	/* Tests are executed fast, so decrease mtime. */
+	dcache_get_size_at(path, kind, time(NULL) - 10, st.st_ino, &size);
+	return size;
+}
+
+static int
+always_cancelled(void *arg)
+{
+	return 1;
+}
+
+/* Creates NDIRS subdirectories with files of sizes from 1 to NDIRS. */
+static void
+make_wide_tree(void)
+{
+	int i;
+	for(i = 1; i <= NDIRS; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/top/c/%d", SANDBOX_PATH, i);
+		assert_success(os_mkdir(path, 0700));
+		snprintf(path, sizeof(path), "%s/top/c/%d/f", SANDBOX_PATH, i);
+		make_sized_file(path, i);
+	}
+}
+
+static void
+remove_wide_tree(void)
+{
+	int i;
+	for(i = 1; i <= NDIRS; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/top/c/%d/f", SANDBOX_PATH, i);
+		assert_success(remove(path));
+		snprintf(path, sizeof(path), "%s/top/c/%d", SANDBOX_PATH, i);
+		assert_success(rmdir(path));
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -1,6 +1,7 @@
 #include <stic.h>
 
-#include <unistd.h> /* unlink() */
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_* */
+#include <unistd.h> /* unlink() usleep() */
 
 #include <stdio.h> /* fopen() fclose() */
 #include <string.h> /* strcmp() */
@@ -15,11 +16,16 @@
 #include "../../src/utils/path.h"
 
 static void check_empty_file(const char fname[]);
+static void on_detected(void);
+static void wait_for_detection(void);
 static int has_mime_type_detection_and_symlinks(void);
 static int has_mime_type_detection_and_can_test_cache(void);
 static int has_mime_type_detection(void);
 static int has_no_mime_type_detection(void);
 
+static pthread_mutex_t detected_lock = PTHREAD_MUTEX_INITIALIZER;
+static int detected;
+
 TEST(escaping_for_determining_mime_type, IF(has_mime_type_detection))
 {
 	check_empty_file(SANDBOX_PATH "/start'end");
@@ -41,6 +47,32 @@ TEST(mimetype_cache_can_be_invalidated,
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(detection_can_be_deferred, IF(has_mime_type_detection))
+{
+	copy_file(TEST_DATA_PATH "/read/very-long-line", SANDBOX_PATH "/file");
+
+	get_mimetype_defer(&on_detected);
+	assert_null(get_mimetype(SANDBOX_PATH "/file", 0));
+	assert_true(get_mimetype_deferred());
+	assert_false(get_mimetype_deferred());
+
+	wait_for_detection();
+
+	assert_string_equal("text/plain", get_mimetype(SANDBOX_PATH "/file", 0));
+	assert_false(get_mimetype_deferred());
+	get_mimetype_defer(NULL);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(missing_files_are_not_deferred)
+{
+	get_mimetype_defer(&on_detected);
+	(void)get_mimetype(SANDBOX_PATH "/no-such-file", 0);
+	assert_false(get_mimetype_deferred());
+	get_mimetype_defer(NULL);
+}
+
 TEST(relatively_large_file_name_does_not_crash,
 		IF(has_mime_type_detection_and_symlinks))
 {
@@ -96,6 +128,32 @@ check_empty_file(const char fname[])
 	}
 }
 
+static void
+on_detected(void)
+{
+	pthread_mutex_lock(&detected_lock);
+	detected = 1;
+	pthread_mutex_unlock(&detected_lock);
+}
+
+static void
+wait_for_detection(void)
+{
+	while(1)
+	{
+		pthread_mutex_lock(&detected_lock);
+		const int done = detected;
+		detected = 0;
+		pthread_mutex_unlock(&detected_lock);
+
+		if(done)
+		{
+			break;
+		}
+		usleep(5000);
+	}
+}
+
 static int
 has_mime_type_detection_and_symlinks(void)
 {
@@ -0,0 +1,191 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() usleep() */
+
+#include <stdio.h> /* snprintf() */
+#include <string.h> /* strcat() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+static void wait_for_loader(view_t *view);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	assert_success(chdir(SANDBOX_PATH));
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+
+	conf_setup();
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+	view->on_slow_fs = 1;
+
+	curr_stats.load_stage = 3;
+
+	create_file("c");
+	create_file("a");
+	assert_success(os_mkdir("b", 0700));
+}
+
+TEARDOWN()
+{
+	curr_stats.load_stage = 0;
+
+	view_teardown(view);
+	conf_teardown();
+
+	remove_file("a");
+	(void)rmdir("b");
+	remove_file("c");
+}
+
+TEST(directory_is_loaded_in_background)
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(1, view->list_rows);
+	assert_string_equal("..", view->dir_entry[0].name);
+
+	wait_for_loader(view);
+
+	assert_int_equal(3, view->list_rows);
+	assert_string_equal("b", view->dir_entry[0].name);
+	assert_string_equal("a", view->dir_entry[1].name);
+	assert_string_equal("c", view->dir_entry[2].name);
+}
+
+TEST(old_list_is_kept_until_reload_is_done)
+{
+	assert_success(populate_dir_list(view, 0));
+	wait_for_loader(view);
+
+	view->list_pos = 2;
+	view->dir_entry[2].selected = 1;
+	view->selected_files = 1;
+	remove_file("a");
+
+	assert_success(populate_dir_list(view, 1));
+	assert_int_equal(3, view->list_rows);
+
+	wait_for_loader(view);
+
+	assert_int_equal(2, view->list_rows);
+	assert_string_equal("b", view->dir_entry[0].name);
+	assert_string_equal("c", view->dir_entry[1].name);
+	assert_int_equal(1, view->list_pos);
+	assert_true(view->dir_entry[1].selected);
+	assert_int_equal(1, view->selected_files);
+
+	create_file("a");
+}
+
+TEST(filters_are_applied_to_loaded_entries)
+{
+	view->hide_dot = 1;
+	create_file(".hidden");
+
+	assert_success(populate_dir_list(view, 0));
+	wait_for_loader(view);
+
+	assert_int_equal(3, view->list_rows);
+	assert_int_equal(1, view->filtered);
+
+	remove_file(".hidden");
+}
+
+TEST(postponed_reload_keeps_number_of_filtered_entries)
+{
+	enum { NHIDDEN = 1000 };
+
+	/* Many entries make it likely that loading is still in progress after the
+	 * first batch is processed. */
+	int i;
+	char name[32];
+	for(i = 0; i < NHIDDEN; ++i)
+	{
+		snprintf(name, sizeof(name), ".hidden%d", i);
+		create_file(name);
+	}
+
+	view->hide_dot = 1;
+	assert_success(populate_dir_list(view, 0));
+
+	int counter = 0;
+	while(view->filtered == 0 && flist_update_from_loader(view))
+	{
+		usleep(100);
+		if(++counter > 10000)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+	const int filtered = view->filtered;
+	assert_true(filtered > 0);
+
+	/* Reload of the same directory is just remembered by an active loader. */
+	const int loading = (view->loader != NULL);
+	assert_success(populate_dir_list(view, 1));
+	if(loading)
+	{
+		assert_int_equal(filtered, view->filtered);
+	}
+
+	wait_for_loader(view);
+	assert_int_equal(NHIDDEN, view->filtered);
+
+	for(i = 0; i < NHIDDEN; ++i)
+	{
+		snprintf(name, sizeof(name), ".hidden%d", i);
+		remove_file(name);
+	}
+}
+
+TEST(changing_location_drops_loader)
+{
+	assert_success(populate_dir_list(view, 0));
+
+	assert_success(chdir("b"));
+	strcat(view->curr_dir, "/b");
+	assert_false(flist_update_from_loader(view));
+	assert_success(chdir(".."));
+}
+
+TEST(fast_filesystems_are_read_synchronously)
+{
+	view->on_slow_fs = 0;
+
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(3, view->list_rows);
+	assert_false(flist_update_from_loader(view));
+}
+
+/* Processes results of background loading until it's done. */
+static void
+wait_for_loader(view_t *view)
+{
+	int counter = 0;
+	while(flist_update_from_loader(view))
+	{
+		usleep(5000);
+		if(++counter > 200)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,173 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() rmdir() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+static void load_and_drain(void);
+static int using_inotify(void);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	assert_success(chdir(SANDBOX_PATH));
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+
+	conf_setup();
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+
+	curr_view = view;
+	other_view = view;
+	curr_stats.load_stage = 2;
+
+	create_file("b");
+	create_file("d");
+	assert_success(os_mkdir("c", 0700));
+}
+
+TEARDOWN()
+{
+	curr_stats.load_stage = 0;
+	curr_view = NULL;
+	other_view = NULL;
+
+	view_teardown(view);
+	conf_teardown();
+
+	(void)remove("b");
+	(void)remove("d");
+	(void)rmdir("c");
+}
+
+TEST(created_and_deleted_files_are_applied_in_place, IF(using_inotify))
+{
+	load_and_drain();
+	view->list_pos = 1;
+	view->dir_entry[1].selected = 1;
+	view->selected_files = 1;
+
+	create_file("a");
+	create_file("e");
+	assert_success(remove("d"));
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+
+	assert_int_equal(4, view->list_rows);
+	assert_string_equal("c", view->dir_entry[0].name);
+	assert_string_equal("a", view->dir_entry[1].name);
+	assert_string_equal("b", view->dir_entry[2].name);
+	assert_string_equal("e", view->dir_entry[3].name);
+
+	assert_int_equal(2, view->list_pos);
+	assert_true(view->dir_entry[2].selected);
+	assert_int_equal(1, view->selected_files);
+
+	assert_success(remove("a"));
+	assert_success(remove("e"));
+}
+
+TEST(modified_files_are_updated_and_resorted, IF(using_inotify))
+{
+	/* Sizes of directories are looked up in a cache. */
+	assert_success(stats_init(&cfg));
+	curr_stats.load_stage = 2;
+	view_set_sort(view->sort, SK_BY_SIZE, SK_BY_NAME);
+
+	load_and_drain();
+	assert_string_equal("b", view->dir_entry[1].name);
+	view->list_pos = 1;
+
+	make_file("b", "content");
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+
+	assert_int_equal(3, view->list_rows);
+	assert_string_equal("d", view->dir_entry[1].name);
+	assert_string_equal("b", view->dir_entry[2].name);
+	assert_ulong_equal(7, view->dir_entry[2].size);
+	assert_int_equal(2, view->list_pos);
+}
+
+TEST(hidden_files_are_counted_as_filtered, IF(using_inotify))
+{
+	view->hide_dot = 1;
+
+	load_and_drain();
+	assert_int_equal(0, view->filtered);
+
+	create_file(".hidden");
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+	assert_int_equal(3, view->list_rows);
+	assert_int_equal(1, view->filtered);
+
+	assert_success(remove(".hidden"));
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+	assert_int_equal(3, view->list_rows);
+	assert_int_equal(0, view->filtered);
+}
+
+TEST(removing_all_files_leaves_parent_entry, IF(using_inotify))
+{
+	load_and_drain();
+
+	assert_success(remove("b"));
+	assert_success(remove("d"));
+	assert_success(rmdir("c"));
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_REDRAW, ui_view_query_scheduled_event(view));
+	assert_int_equal(1, view->list_rows);
+	assert_string_equal("..", view->dir_entry[0].name);
+}
+
+TEST(change_of_directory_itself_causes_reload, IF(using_inotify))
+{
+	load_and_drain();
+
+	assert_success(os_chmod(".", 0750));
+
+	check_if_filelist_has_changed(view);
+	assert_int_equal(UUE_RELOAD, ui_view_query_scheduled_event(view));
+}
+
+/* Loads file list and consumes events that were generated before or during
+ * that. */
+static void
+load_and_drain(void)
+{
+	assert_success(populate_dir_list(view, 0));
+	check_if_filelist_has_changed(view);
+	(void)ui_view_query_scheduled_event(view);
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,133 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* chdir() getgid() getuid() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/sort.h"
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	assert_success(chdir(SANDBOX_PATH));
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+
+	conf_setup();
+	view_setup(view);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+
+	create_file("a");
+	create_file("b");
+}
+
+TEARDOWN()
+{
+	view_teardown(view);
+	conf_teardown();
+
+	remove_file("a");
+	remove_file("b");
+}
+
+TEST(sorting_keys_are_mapped_to_metadata)
+{
+	assert_int_equal(FMD_OWNER, flist_metadata_of_key(SK_BY_OWNER_ID));
+	assert_int_equal(FMD_OWNER, flist_metadata_of_key(SK_BY_OWNER_NAME));
+	assert_int_equal(FMD_OWNER, flist_metadata_of_key(SK_BY_GROUP_ID));
+	assert_int_equal(FMD_OWNER, flist_metadata_of_key(SK_BY_GROUP_NAME));
+	assert_int_equal(FMD_ATIME, flist_metadata_of_key(SK_BY_TIME_ACCESSED));
+	assert_int_equal(FMD_CTIME, flist_metadata_of_key(SK_BY_TIME_CHANGED));
+
+	assert_int_equal(0, flist_metadata_of_key(SK_BY_NAME));
+	assert_int_equal(0, flist_metadata_of_key(SK_BY_SIZE));
+	assert_int_equal(0, flist_metadata_of_key(SK_BY_TIME_MODIFIED));
+}
+
+TEST(basic_metadata_is_always_loaded)
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(2, view->list_rows);
+
+	struct stat s;
+	assert_success(os_lstat("a", &s));
+	assert_int_equal(s.st_size, view->dir_entry[0].size);
+	assert_int_equal(s.st_mtime, view->dir_entry[0].mtime);
+	assert_int_equal(s.st_mode, view->dir_entry[0].mode);
+	assert_int_equal(FT_REG, view->dir_entry[0].type);
+}
+
+TEST(metadata_needed_for_sorting_is_loaded, IF(not_windows))
+{
+	view->sort[0] = SK_BY_OWNER_ID;
+	view->sort[1] = SK_BY_NAME;
+	view->sort[2] = SK_NONE;
+
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(2, view->list_rows);
+
+	assert_int_equal(0, view->dir_entry[0].missing_md & FMD_OWNER);
+	assert_int_equal(getuid(), view->dir_entry[0].uid);
+	assert_int_equal(getgid(), view->dir_entry[0].gid);
+}
+
+TEST(metadata_needed_for_columns_is_loaded, IF(not_windows))
+{
+	update_string(&view->view_columns, "{name},{atime},{gid}");
+
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(2, view->list_rows);
+
+	assert_int_equal(0,
+			view->dir_entry[0].missing_md & (FMD_OWNER | FMD_ATIME));
+	assert_int_equal(getgid(), view->dir_entry[0].gid);
+}
+
+TEST(missing_metadata_is_loaded_on_request, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(2, view->list_rows);
+
+	dir_entry_t *const entry = &view->dir_entry[1];
+	entry->missing_md = FMD_ALL;
+	entry->uid = -1;
+	entry->gid = -1;
+	entry->atime = 0;
+	entry->ctime = 0;
+
+	fentry_load_metadata(entry, FMD_OWNER);
+
+	assert_int_equal(0, entry->missing_md);
+	assert_int_equal(getuid(), entry->uid);
+	assert_int_equal(getgid(), entry->gid);
+	assert_true(entry->atime != 0);
+	assert_true(entry->ctime != 0);
+}
+
+TEST(loaded_metadata_is_not_requeried, IF(not_windows))
+{
+	assert_success(populate_dir_list(view, 0));
+	assert_int_equal(2, view->list_rows);
+
+	dir_entry_t *const entry = &view->dir_entry[1];
+	entry->missing_md = FMD_ATIME;
+	entry->uid = 12345;
+
+	fentry_load_metadata(entry, FMD_OWNER);
+
+	assert_int_equal(FMD_ATIME, entry->missing_md);
+	assert_int_equal(12345, entry->uid);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,145 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() rmdir() */
+
+#include <stdio.h> /* snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+
+#include "utils.h"
+
+/* Enough files to make querying information about them parallel. */
+#define NFILES 300
+
+static void create_files(const char dir[]);
+static void remove_files(const char dir[]);
+
+static char cwd[PATH_MAX + 1];
+
+SETUP()
+{
+	assert_success(chdir(SANDBOX_PATH));
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+
+	conf_setup();
+	view_setup(&lwin);
+	copy_str(lwin.curr_dir, sizeof(lwin.curr_dir), cwd);
+
+	curr_view = &lwin;
+	other_view = &lwin;
+}
+
+TEARDOWN()
+{
+	cfg.stat_workers = 0;
+	cfg.lazy_links = 0;
+
+	view_teardown(&lwin);
+	conf_teardown();
+}
+
+TEST(large_directory_is_filled_in_parallel)
+{
+	int i;
+
+	create_files(".");
+
+	cfg.stat_workers = 1;
+	assert_success(populate_dir_list(&lwin, 0));
+	assert_int_equal(NFILES, lwin.list_rows);
+
+	entries_t serial = { .nentries = lwin.list_rows };
+	serial.entries = lwin.dir_entry;
+	lwin.dir_entry = NULL;
+	lwin.list_rows = 0;
+
+	cfg.stat_workers = 4;
+	assert_success(populate_dir_list(&lwin, 0));
+	assert_int_equal(NFILES, lwin.list_rows);
+
+	for(i = 0; i < NFILES; ++i)
+	{
+		assert_string_equal(serial.entries[i].name, lwin.dir_entry[i].name);
+		assert_int_equal(FT_REG, lwin.dir_entry[i].type);
+		assert_true(serial.entries[i].inode == lwin.dir_entry[i].inode);
+	}
+
+	free_dir_entries(&serial.entries, &serial.nentries);
+	remove_files(".");
+}
+
+TEST(tree_is_built_in_parallel)
+{
+	cfg.stat_workers = 4;
+
+	create_dir("dir");
+	create_files("dir");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH "/dir", cwd));
+	assert_int_equal(NFILES, lwin.list_rows);
+	assert_string_equal("file000", lwin.dir_entry[0].name);
+	validate_tree(&lwin);
+
+	remove_files("dir");
+	remove_dir("dir");
+}
+
+TEST(links_are_resolved_on_demand, IF(not_windows))
+{
+	cfg.lazy_links = 1;
+
+	create_dir("dir");
+	assert_success(make_symlink("dir", "link"));
+
+	assert_success(populate_dir_list(&lwin, 0));
+	assert_int_equal(2, lwin.list_rows);
+
+	dir_entry_t *const link = &lwin.dir_entry[1];
+	assert_string_equal("link", link->name);
+	assert_true(link->link_pending);
+	assert_false(fentry_is_dir(link));
+
+	fentry_resolve_link(link);
+	assert_false(link->link_pending);
+	assert_true(fentry_is_dir(link));
+
+	remove_file("link");
+	remove_dir("dir");
+}
+
+/* Creates NFILES empty files in the directory. */
+static void
+create_files(const char dir[])
+{
+	int i;
+	for(i = 0; i < NFILES; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%03d", dir, i);
+		create_file(path);
+	}
+}
+
+/* Removes files created by create_files(). */
+static void
+remove_files(const char dir[])
+{
+	int i;
+	for(i = 0; i < NFILES; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%03d", dir, i);
+		remove_file(path);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
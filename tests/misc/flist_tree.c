@@ -32,6 +32,7 @@ static void verify_tree_node(column_data_t *cdt, int idx,
 static void column_line_print(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info);
 static int remove_selected(view_t *view, const dir_entry_t *entry, void *arg);
+static int using_inotify(void);
 
 static char cwd[PATH_MAX + 1], test_data[PATH_MAX + 1];
 
@@ -225,6 +226,46 @@ TEST(nested_directory_change_detection)
 	assert_success(rmdir(SANDBOX_PATH "/nested-dir"));
 }
 
+TEST(file_updates_in_nested_directories_are_detected, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/nested-dir", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/other-dir", 0700));
+	create_file(SANDBOX_PATH "/nested-dir/a");
+	create_file(SANDBOX_PATH "/other-dir/b");
+
+	assert_success(load_tree(&lwin, SANDBOX_PATH, cwd));
+	assert_int_equal(4, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_ulong_equal(0, lwin.dir_entry[1].size);
+
+	check_if_filelist_has_changed(&lwin);
+	ui_view_query_scheduled_event(&lwin);
+
+	/* Directory's modification time doesn't change on updating its files. */
+	make_file(SANDBOX_PATH "/nested-dir/a", "content");
+	check_if_filelist_has_changed(&lwin);
+
+	curr_stats.load_stage = 2;
+	assert_true(process_scheduled_updates_of_view(&lwin));
+	curr_stats.load_stage = 0;
+
+	assert_int_equal(4, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+	assert_ulong_equal(7, lwin.dir_entry[1].size);
+	assert_string_equal("b", lwin.dir_entry[3].name);
+	validate_tree(&lwin);
+
+	/* Nothing changed since the last check. */
+	ui_view_query_scheduled_event(&lwin);
+	check_if_filelist_has_changed(&lwin);
+	assert_int_equal(UUE_NONE, ui_view_query_scheduled_event(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/nested-dir/a"));
+	assert_success(remove(SANDBOX_PATH "/other-dir/b"));
+	assert_success(rmdir(SANDBOX_PATH "/nested-dir"));
+	assert_success(rmdir(SANDBOX_PATH "/other-dir"));
+}
+
 TEST(excluding_dir_in_tree_excludes_its_children)
 {
 	assert_success(os_mkdir(SANDBOX_PATH "/nested-dir", 0700));
@@ -678,5 +719,15 @@ remove_selected(view_t *view, const dir_entry_t *entry, void *arg)
 	return !entry->selected;
 }
 
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,291 @@
+#include <stic.h>
+
+#include <unistd.h> /* F_OK */
+
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() remove() */
+#include <string.h> /* strcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+#include "../../src/compare.h"
+#include "../../src/hcache.h"
+
+static hcache_key_t make_key(uint64_t inode, int64_t mtime_ns);
+
+static const char *const file = SANDBOX_PATH "/hcache";
+
+SETUP()
+{
+	hcache_clear();
+}
+
+TEARDOWN()
+{
+	hcache_detach();
+	hcache_clear();
+	(void)remove(file);
+}
+
+TEST(records_are_found_by_full_key)
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+
+	assert_failure(hcache_get(&key, &digests));
+	hcache_put_sample(&key, 4096, 123);
+
+	assert_success(hcache_get(&key, &digests));
+	assert_ulong_equal(4096, digests.sample_size);
+	assert_ulong_equal(123, digests.sample);
+	assert_false(digests.has_full);
+
+	const hcache_key_t changed = make_key(1, 11);
+	assert_failure(hcache_get(&changed, &digests));
+}
+
+TEST(digests_of_unchanged_file_are_merged)
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+	const uint64_t full[2] = { 1, 2 };
+
+	hcache_put_sample(&key, 4096, 123);
+	hcache_put_full(&key, full);
+
+	assert_success(hcache_get(&key, &digests));
+	assert_ulong_equal(123, digests.sample);
+	assert_true(digests.has_full);
+	assert_ulong_equal(1, digests.full[0]);
+	assert_ulong_equal(2, digests.full[1]);
+
+	const hcache_key_t changed = make_key(1, 11);
+	hcache_put_sample(&changed, 4096, 321);
+
+	assert_success(hcache_get(&changed, &digests));
+	assert_ulong_equal(321, digests.sample);
+	assert_false(digests.has_full);
+	assert_failure(hcache_get(&key, &digests));
+}
+
+TEST(many_records_can_be_stored)
+{
+	int i;
+	for(i = 0; i < 5000; ++i)
+	{
+		const hcache_key_t key = make_key(i, i);
+		hcache_put_sample(&key, 4096, i);
+	}
+
+	for(i = 0; i < 5000; ++i)
+	{
+		hcache_digests_t digests;
+		const hcache_key_t key = make_key(i, i);
+		assert_success(hcache_get(&key, &digests));
+		assert_ulong_equal(i, digests.sample);
+	}
+}
+
+TEST(key_reflects_file_state)
+{
+	hcache_key_t a, b;
+
+	make_file(SANDBOX_PATH "/file", "abc");
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &a));
+	assert_ulong_equal(3, a.size);
+
+	make_file(SANDBOX_PATH "/file", "abcd");
+	assert_success(hcache_key_of(SANDBOX_PATH "/file", &b));
+	assert_ulong_equal(4, b.size);
+	assert_ulong_equal(a.inode, b.inode);
+
+	assert_failure(hcache_key_of(SANDBOX_PATH "/no-such-file", &a));
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(records_survive_reattaching, IF(not_windows))
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+	const uint64_t full[2] = { 1, 2 };
+
+	assert_success(hcache_attach(file));
+	hcache_put_full(&key, full);
+	hcache_detach();
+
+	hcache_clear();
+	assert_failure(hcache_get(&key, &digests));
+
+	assert_success(hcache_attach(file));
+	assert_success(hcache_get(&key, &digests));
+	assert_true(digests.has_full);
+	assert_ulong_equal(2, digests.full[1]);
+}
+
+TEST(records_are_written_on_sync, IF(not_windows))
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+
+	assert_success(hcache_attach(file));
+	hcache_put_sample(&key, 4096, 123);
+	hcache_sync();
+	const uint64_t size = get_file_size(file);
+	hcache_sync();
+	assert_ulong_equal(size, get_file_size(file));
+
+	/* Simulate crash by not detaching. */
+	hcache_clear();
+	assert_success(hcache_attach(file));
+	assert_success(hcache_get(&key, &digests));
+	assert_ulong_equal(123, digests.sample);
+}
+
+TEST(partial_record_is_dropped, IF(not_windows))
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+
+	assert_success(hcache_attach(file));
+	hcache_put_sample(&key, 4096, 123);
+	hcache_detach();
+
+	const uint64_t size = get_file_size(file);
+
+	FILE *fp = fopen(file, "ab");
+	assert_non_null(fp);
+	assert_int_equal(5, fwrite("trash", 1, 5, fp));
+	fclose(fp);
+
+	hcache_clear();
+	assert_success(hcache_attach(file));
+	assert_ulong_equal(size, get_file_size(file));
+	assert_success(hcache_get(&key, &digests));
+	assert_ulong_equal(123, digests.sample);
+}
+
+TEST(file_of_unknown_format_is_reset, IF(not_windows))
+{
+	hcache_digests_t digests;
+	const hcache_key_t key = make_key(1, 10);
+
+	make_file(file, "not a cache file");
+
+	assert_success(hcache_attach(file));
+	assert_failure(hcache_get(&key, &digests));
+}
+
+TEST(outdated_records_are_compacted, IF(not_windows))
+{
+	hcache_digests_t digests;
+
+	assert_success(hcache_attach(file));
+	int i;
+	for(i = 0; i < 5000; ++i)
+	{
+		const hcache_key_t key = make_key(1, i);
+		hcache_put_sample(&key, 4096, i);
+	}
+	hcache_detach();
+
+	const uint64_t size = get_file_size(file);
+
+	hcache_clear();
+	assert_success(hcache_attach(file));
+	assert_true(get_file_size(file) < size/100);
+
+	const hcache_key_t key = make_key(1, 4999);
+	assert_success(hcache_get(&key, &digests));
+	assert_ulong_equal(4999, digests.sample);
+}
+
+TEST(file_is_used_only_when_enabled_in_vifminfo, IF(not_windows))
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+
+	cfg.vifm_info = 0;
+	hcache_setup_file(&cfg);
+	assert_failure(os_access(file, F_OK));
+
+	cfg.vifm_info = VINFO_HCACHE;
+	hcache_setup_file(&cfg);
+	assert_success(os_access(file, F_OK));
+
+	cfg.vifm_info = 0;
+}
+
+TEST(comparison_uses_and_fills_the_cache)
+{
+	hcache_key_t a, c;
+	hcache_digests_t digests;
+
+	curr_view = &lwin;
+	other_view = &rwin;
+	conf_setup();
+	view_setup(&lwin);
+	view_setup(&rwin);
+	opt_handlers_setup();
+
+	make_file(SANDBOX_PATH "/a", "abc1");
+	make_file(SANDBOX_PATH "/b", "abc1");
+	make_file(SANDBOX_PATH "/c", "abc2");
+	make_file(SANDBOX_PATH "/d", "abc3");
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(2, lwin.list_rows);
+
+	/* Digests of identical files are remembered. */
+	assert_success(hcache_key_of(SANDBOX_PATH "/a", &a));
+	assert_success(hcache_get(&a, &digests));
+	assert_true(digests.has_full);
+	assert_success(hcache_key_of(SANDBOX_PATH "/c", &c));
+	assert_success(hcache_get(&c, &digests));
+	assert_ulong_equal(4096, digests.sample_size);
+	assert_false(digests.has_full);
+
+	/* Make cache claim that different files are the same to check that files
+	 * aren't read. */
+	const uint64_t full[2] = { 1, 2 };
+	hcache_put_sample(&a, 4096, 1);
+	hcache_put_full(&a, full);
+	hcache_put_sample(&c, 4096, 1);
+	hcache_put_full(&c, full);
+
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("c", lwin.dir_entry[1].name);
+
+	remove_file(SANDBOX_PATH "/a");
+	remove_file(SANDBOX_PATH "/b");
+	remove_file(SANDBOX_PATH "/c");
+	remove_file(SANDBOX_PATH "/d");
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+	opt_handlers_teardown();
+	conf_teardown();
+}
+
+/* Makes a key for a fake file. */
+static hcache_key_t
+make_key(uint64_t inode, int64_t mtime_ns)
+{
+	const hcache_key_t key = {
+		.dev = 1,
+		.inode = inode,
+		.size = 100,
+		.mtime_ns = mtime_ns,
+		.ctime_ns = mtime_ns,
+	};
+	return key;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
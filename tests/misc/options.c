@@ -623,6 +623,11 @@ TEST(iooptions)
 	assert_success(cmds_dispatch("set iooptions=datasync", &lwin, CIT_COMMAND));
 	assert_false(cfg.fast_file_cloning);
 	assert_true(cfg.data_sync);
+	assert_false(cfg.sparse_copying);
+
+	assert_success(cmds_dispatch("set iooptions+=sparse", &lwin, CIT_COMMAND));
+	assert_true(cfg.data_sync);
+	assert_true(cfg.sparse_copying);
 }
 
 TEST(mouse)
@@ -768,6 +773,33 @@ TEST(keepsel)
 	assert_true(cfg.keep_sel);
 }
 
+TEST(statworkers)
+{
+	assert_success(cmds_dispatch("set statworkers=8", &lwin, CIT_COMMAND));
+	assert_int_equal(8, cfg.stat_workers);
+
+	assert_failure(cmds_dispatch("set statworkers=0", &lwin, CIT_COMMAND));
+	assert_int_equal(1, cfg.stat_workers);
+}
+
+TEST(ioworkers)
+{
+	assert_success(cmds_dispatch("set ioworkers=2", &lwin, CIT_COMMAND));
+	assert_int_equal(2, cfg.io_workers);
+
+	assert_failure(cmds_dispatch("set ioworkers=-1", &lwin, CIT_COMMAND));
+	assert_int_equal(1, cfg.io_workers);
+}
+
+TEST(lazylinks)
+{
+	assert_success(cmds_dispatch("set lazylinks", &lwin, CIT_COMMAND));
+	assert_true(cfg.lazy_links);
+
+	assert_success(cmds_dispatch("set nolazylinks", &lwin, CIT_COMMAND));
+	assert_false(cfg.lazy_links);
+}
+
 static void
 print_func(const char buf[], int offset, AlignType align,
 		const char full_column[], const format_info_t *info)
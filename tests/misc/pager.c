@@ -0,0 +1,284 @@
+#include <stic.h>
+
+#include <sys/types.h> /* off_t */
+#include <unistd.h> /* truncate() usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() rename() */
+#include <stdlib.h> /* free() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/fs.h"
+#include "../../src/pager.h"
+
+static void make_large_file(const char path[], int nlines);
+static int wait_for_indexing(pager_t *pager);
+
+static pager_t *pager;
+
+TEARDOWN()
+{
+	pager_close(pager);
+	pager = NULL;
+}
+
+TEST(closing_null_pager_does_nothing)
+{
+	pager_close(NULL);
+}
+
+TEST(missing_file_is_not_opened, IF(not_windows))
+{
+	assert_null(pager_open(SANDBOX_PATH "/no-such-file", 8));
+}
+
+TEST(empty_file_has_no_lines, IF(not_windows))
+{
+	create_file(SANDBOX_PATH "/file");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	int complete;
+	assert_int_equal(0, pager_get_count(pager, &complete));
+	assert_true(complete);
+	assert_null(pager_get_line(pager, 0));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(lines_are_split_like_by_read_line, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "\xef\xbb\xbf" "a\nbb\r\nccc\rdddd\n\nlast");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	int complete;
+	assert_int_equal(6, pager_get_count(pager, &complete));
+	assert_true(complete);
+
+	assert_string_equal("a", pager_get_line(pager, 0));
+	assert_string_equal("bb", pager_get_line(pager, 1));
+	assert_string_equal("ccc", pager_get_line(pager, 2));
+	assert_string_equal("dddd", pager_get_line(pager, 3));
+	assert_string_equal("", pager_get_line(pager, 4));
+	assert_string_equal("last", pager_get_line(pager, 5));
+	assert_null(pager_get_line(pager, 6));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(widths_account_for_tabs, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "\tx\nab\tc\n");
+
+	pager = pager_open(SANDBOX_PATH "/file", 4);
+	assert_non_null(pager);
+
+	int complete;
+	assert_int_equal(2, pager_get_count(pager, &complete));
+
+	int widths[2];
+	pager_get_widths(pager, 0, 2, widths);
+	assert_int_equal(5, widths[0]);
+	assert_int_equal(5, widths[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(large_file_is_indexed_in_background, IF(not_windows))
+{
+	enum { NLINES = 300*1000 };
+	make_large_file(SANDBOX_PATH "/file", NLINES);
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	int complete;
+	const int initial = pager_get_count(pager, &complete);
+	assert_true(initial > 0);
+	assert_string_equal("line 0", pager_get_line(pager, 0));
+
+	assert_int_equal(NLINES, wait_for_indexing(pager));
+	assert_string_equal("line 299999", pager_get_line(pager, NLINES - 1));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(truncated_file_is_not_accessed, IF(not_windows))
+{
+	make_large_file(SANDBOX_PATH "/file", 300*1000);
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	assert_success(truncate(SANDBOX_PATH "/file", 0));
+
+	(void)wait_for_indexing(pager);
+	assert_string_equal("", pager_get_line(pager, 0));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(truncating_file_while_it_is_indexed_is_safe, IF(not_windows))
+{
+	make_large_file(SANDBOX_PATH "/file", 1000*1000);
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	char *buf = NULL;
+	size_t buf_len = 0U;
+
+	/* Shrink the file in steps while lines are indexed and read. */
+	off_t size = get_file_size(SANDBOX_PATH "/file");
+	while(size > 0)
+	{
+		size = (size > 64*1024 ? size - size/8 : 0);
+		assert_success(truncate(SANDBOX_PATH "/file", size));
+
+		int complete;
+		const int count = pager_get_count(pager, &complete);
+		const int from = (count > 100 ? count - 100 : 0);
+		assert_success(pager_get_lines(pager, from, count - from, &buf, &buf_len));
+		assert_non_null(pager_get_line(pager, count - 1));
+	}
+
+	const int count = wait_for_indexing(pager);
+	assert_string_equal("", pager_get_line(pager, count - 1));
+	assert_success(pager_get_lines(pager, 0, 1, &buf, &buf_len));
+	assert_string_equal("", buf);
+
+	free(buf);
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(appended_lines_are_picked_up, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "a\nb");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	int first;
+	assert_success(pager_refresh(pager, &first));
+	assert_int_equal(2, first);
+
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "a");
+	assert_non_null(fp);
+	fputs("c\nd\n", fp);
+	fclose(fp);
+
+	assert_success(pager_refresh(pager, &first));
+	assert_int_equal(1, first);
+
+	int complete;
+	assert_int_equal(3, pager_get_count(pager, &complete));
+	assert_true(complete);
+	assert_string_equal("a", pager_get_line(pager, 0));
+	assert_string_equal("bc", pager_get_line(pager, 1));
+	assert_string_equal("d", pager_get_line(pager, 2));
+
+	int widths[3];
+	pager_get_widths(pager, 0, 3, widths);
+	assert_int_equal(2, widths[1]);
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(refreshing_truncated_file_fails, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "a\nb\n");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	assert_success(truncate(SANDBOX_PATH "/file", 1));
+
+	int first;
+	assert_failure(pager_refresh(pager, &first));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(refreshing_overwritten_file_fails, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "line 1\nline 2\n");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	/* Truncation followed by writing past the old size (like with copytruncate
+	 * of logrotate) between two refreshes. */
+	make_file(SANDBOX_PATH "/file", "new line 1\nnew line 2\n");
+
+	int first;
+	assert_failure(pager_refresh(pager, &first));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(refreshing_file_with_overwritten_tail_fails, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "header\nline 1\n");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	make_file(SANDBOX_PATH "/file", "header\nline 2\nline 3\n");
+
+	int first;
+	assert_failure(pager_refresh(pager, &first));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(refreshing_replaced_file_fails, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "a\n");
+
+	pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	make_file(SANDBOX_PATH "/file2", "a\nb\n");
+	assert_success(rename(SANDBOX_PATH "/file2", SANDBOX_PATH "/file"));
+
+	int first;
+	assert_failure(pager_refresh(pager, &first));
+
+	remove_file(SANDBOX_PATH "/file");
+}
+
+/* Creates a file with the specified number of numbered lines. */
+static void
+make_large_file(const char path[], int nlines)
+{
+	FILE *const fp = fopen(path, "w");
+	assert_non_null(fp);
+
+	int i;
+	for(i = 0; i < nlines; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+
+	fclose(fp);
+}
+
+/* Waits until pager finishes indexing.  Returns number of lines. */
+static int
+wait_for_indexing(pager_t *pager)
+{
+	int complete;
+	int count = pager_get_count(pager, &complete);
+	while(!complete)
+	{
+		usleep(5000);
+		count = pager_get_count(pager, &complete);
+	}
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
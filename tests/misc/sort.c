@@ -3,11 +3,13 @@
 #include <unistd.h> /* chdir() unlink() */
 
 #include <stdarg.h> /* va_list va_arg() va_copy() va_end() va_start() */
+#include <stdio.h> /* snprintf() */
 #include <string.h> /* strcpy() */
 
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/dynarray.h"
@@ -20,6 +22,8 @@
 #define ASSERT_STRCMP_EQUAL(a, b) \
 		do { assert_int_equal(SIGN(a), SIGN(b)); } while(0)
 
+static void check_custom_view_sorting(int nentries);
+static void check_rating_sorting(int nentries, int nrated);
 static void set_file_list(view_t *view, FileType def_ftype, ...);
 static int on_case_sensitive_fs(void);
 
@@ -47,6 +51,8 @@ TEARDOWN()
 
 	view_teardown(&lwin);
 	view_teardown(&rwin);
+
+	clear_ratings();
 }
 
 TEST(special_chars_ignore_case_sort)
@@ -328,6 +334,32 @@ TEST(sorting_uses_dcache_for_dirs)
 	assert_string_equal("read", lwin.dir_entry[1].name);
 }
 
+TEST(size_kinds_are_sorted_independently)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+	assert_success(stats_init(&cfg));
+
+	strcpy(lwin.curr_dir, TEST_DATA_PATH);
+	set_file_list(&lwin, FT_DIR, "read", "rename", NULL);
+
+	const uint64_t read_sizes[DSK_COUNT] = { 10, 100, 20 };
+	const uint64_t rename_sizes[DSK_COUNT] = { 100, 10, 200 };
+	assert_success(dcache_set_sizes_at(TEST_DATA_PATH "/read", 1, read_sizes));
+	assert_success(dcache_set_sizes_at(TEST_DATA_PATH "/rename", 2,
+				rename_sizes));
+
+	view_set_sort(lwin.sort, SK_BY_USIZE, SK_NONE);
+	sort_view(&lwin);
+	assert_string_equal("rename", lwin.dir_entry[0].name);
+	assert_string_equal("read", lwin.dir_entry[1].name);
+
+	view_set_sort(lwin.sort, SK_BY_ASIZE, SK_NONE);
+	sort_view(&lwin);
+	assert_string_equal("read", lwin.dir_entry[0].name);
+	assert_string_equal("rename", lwin.dir_entry[1].name);
+}
+
 TEST(nitems_sorting_works)
 {
 	view_teardown(&lwin);
@@ -412,6 +444,84 @@ TEST(global_groups_sorts_entries_list)
 	assert_string_equal("a1", entries.entries[1].name);
 }
 
+TEST(insertion_position_is_found_according_to_all_keys)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	set_file_list(&lwin, FT_REG, "..", "c", "a.txt", "b.txt", "d.txt", NULL);
+	lwin.dir_entry[0].type = FT_DIR;
+	lwin.dir_entry[1].type = FT_DIR;
+	view_set_sort(lwin.sort, SK_BY_EXTENSION, SK_BY_NAME);
+	sort_view(&lwin);
+
+	dir_entry_t entry = { .name = "c.txt", .type = FT_REG };
+	assert_int_equal(4, sort_find_pos(&lwin, &entry));
+
+	/* Files without extension go last. */
+	entry.name = "z";
+	assert_int_equal(5, sort_find_pos(&lwin, &entry));
+
+	entry.name = "b";
+	entry.type = FT_DIR;
+	assert_int_equal(1, sort_find_pos(&lwin, &entry));
+
+	view_set_sort(lwin.sort, -SK_BY_NAME, SK_NONE);
+	sort_view(&lwin);
+
+	entry.name = "e";
+	entry.type = FT_REG;
+	assert_int_equal(2, sort_find_pos(&lwin, &entry));
+}
+
+TEST(insertion_position_is_found_according_to_groups)
+{
+	view_teardown(&lwin);
+	view_setup(&lwin);
+
+	update_string(&lwin.sort_groups, "-(done|todo).*,([0-9]+)");
+	if(lwin.primary_group_set)
+	{
+		regfree(&lwin.primary_group);
+	}
+	(void)regcomp(&lwin.primary_group, "-(done|todo).*",
+			REG_EXTENDED | REG_ICASE);
+	lwin.primary_group_set = 1;
+
+	set_file_list(&lwin, FT_REG, "3-done", "1-done", "2-todo", "5-todo", NULL);
+	view_set_sort(lwin.sort, SK_BY_GROUPS, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("1-done", lwin.dir_entry[0].name);
+	assert_string_equal("3-done", lwin.dir_entry[1].name);
+	assert_string_equal("2-todo", lwin.dir_entry[2].name);
+	assert_string_equal("5-todo", lwin.dir_entry[3].name);
+
+	dir_entry_t entry = { .name = "2-done", .type = FT_REG };
+	assert_int_equal(1, sort_find_pos(&lwin, &entry));
+	entry.name = "4-todo";
+	assert_int_equal(3, sort_find_pos(&lwin, &entry));
+	entry.name = "9-todo";
+	assert_int_equal(4, sort_find_pos(&lwin, &entry));
+}
+
+TEST(insertion_position_is_after_equal_entries)
+{
+	view_set_sort(lwin.sort, SK_BY_SIZE, SK_NONE);
+	sort_view(&lwin);
+
+	dir_entry_t entry = { .name = "b", .type = FT_REG };
+	assert_int_equal(3, sort_find_pos(&lwin, &entry));
+}
+
+TEST(insertion_position_is_at_the_end_of_unsorted_list)
+{
+	view_set_sort(lwin.sort, SK_NONE, SK_NONE);
+
+	dir_entry_t entry = { .name = "0", .type = FT_REG };
+	assert_int_equal(3, sort_find_pos(&lwin, &entry));
+}
+
 /* Not a proper collation, but a sensible ordering that is consistent whether
  * case is ignored or not. */
 TEST(case_sensitive_unicode_sorting, IF(utf8_locale))
@@ -543,6 +653,166 @@ TEST(inode_sorting_works)
 
 #endif
 
+TEST(rating_sorting_works)
+{
+	curr_view = &lwin;
+	strcpy(lwin.curr_dir, "/rating-sort");
+	set_file_list(&lwin, FT_REG, "one", "two", "three", NULL);
+
+	lwin.dir_entry[0].marked = 1;
+	update_rating_info_selected(2);
+	lwin.dir_entry[0].marked = 0;
+	lwin.dir_entry[2].marked = 1;
+	update_rating_info_selected(1);
+	lwin.dir_entry[2].marked = 0;
+
+	view_set_sort(lwin.sort, -SK_BY_RATING, SK_NONE);
+	sort_view(&lwin);
+
+	assert_string_equal("one", lwin.dir_entry[0].name);
+	assert_string_equal("three", lwin.dir_entry[1].name);
+	assert_string_equal("two", lwin.dir_entry[2].name);
+
+	curr_view = NULL;
+}
+
+TEST(rating_sorting_of_list)
+{
+	check_rating_sorting(60, 12);
+}
+
+TEST(rating_sorting_benchmark, IF(benchmarks_enabled))
+{
+	check_rating_sorting(50000, 10000);
+}
+
+TEST(custom_view_is_sorted_by_several_keys)
+{
+	check_custom_view_sorting(5000);
+}
+
+TEST(large_custom_view_sorting_benchmark, IF(benchmarks_enabled))
+{
+	/* Like long results of find or locate. */
+	check_custom_view_sorting(500000);
+}
+
+/* Fills custom view with the specified number of entries from several
+ * directories and checks sorting it by several keys. */
+static void
+check_custom_view_sorting(int nentries)
+{
+	enum { NDIRS = 16 };
+	static const char *const origins[NDIRS] = {
+		"/src/a", "/src/b", "/src/c", "/src/d", "/src/e", "/src/f", "/src/g",
+		"/src/h", "/src/i", "/src/j", "/src/k", "/src/l", "/src/m", "/src/n",
+		"/src/o", "/src/p",
+	};
+
+	lwin.curr_dir[0] = '\0';
+	update_string(&lwin.custom.orig_dir, "/src");
+
+	dynarray_free(lwin.dir_entry);
+	lwin.list_rows = nentries;
+	lwin.dir_entry = dynarray_cextend(NULL, nentries*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < nentries; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "file%u.ext%d", (i*7919U)%nentries, i%5);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].type = FT_REG;
+		lwin.dir_entry[i].origin = (char *)origins[(i*31)%NDIRS];
+		lwin.dir_entry[i].size = (i*104729U)%1000U;
+		lwin.dir_entry[i].mtime = (i*13)%997 - 500;
+	}
+
+	assert_true(flist_custom_active(&lwin));
+
+	view_set_sort(lwin.sort, -SK_BY_SIZE, SK_BY_NAME);
+	sort_view(&lwin);
+
+	for(i = 1; i < nentries; ++i)
+	{
+		const dir_entry_t *const prev = &lwin.dir_entry[i - 1];
+		const dir_entry_t *const curr = &lwin.dir_entry[i];
+		assert_true(prev->size >= curr->size);
+		if(prev->size == curr->size && prev->origin == curr->origin)
+		{
+			assert_true(strnumcmp(prev->name, curr->name) < 0);
+		}
+	}
+
+	view_set_sort(lwin.sort, SK_BY_EXTENSION, -SK_BY_TIME_MODIFIED);
+	sort_view(&lwin);
+
+	for(i = 1; i < nentries; ++i)
+	{
+		const dir_entry_t *const prev = &lwin.dir_entry[i - 1];
+		const dir_entry_t *const curr = &lwin.dir_entry[i];
+		const int cmp = strcmp(strrchr(prev->name, '.'), strrchr(curr->name, '.'));
+		assert_true(cmp <= 0);
+		if(cmp == 0)
+		{
+			assert_true(prev->mtime >= curr->mtime);
+		}
+	}
+}
+
+/* Fills the view with the specified number of entries some of which are rated
+ * and checks sorting it by rating. */
+static void
+check_rating_sorting(int nentries, int nrated)
+{
+	curr_view = &lwin;
+	strcpy(lwin.curr_dir, "/rating-sort-list");
+
+	dynarray_free(lwin.dir_entry);
+	lwin.list_rows = nentries;
+	lwin.dir_entry = dynarray_cextend(NULL, nentries*sizeof(*lwin.dir_entry));
+
+	int i;
+	for(i = 0; i < nentries; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "f%05d", nentries - i);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].type = FT_REG;
+		lwin.dir_entry[i].origin = lwin.curr_dir;
+	}
+
+	int star;
+	for(star = 1; star <= 3; ++star)
+	{
+		for(i = 0; i < nentries; i += nentries/nrated)
+		{
+			lwin.dir_entry[i].marked = ((i/(nentries/nrated))%3 == star - 1);
+		}
+		update_rating_info_selected(star);
+	}
+	for(i = 0; i < nentries; ++i)
+	{
+		lwin.dir_entry[i].marked = 0;
+	}
+
+	view_set_sort(lwin.sort, SK_BY_RATING, SK_NONE);
+	sort_view(&lwin);
+
+	int prev_stars = 0;
+	for(i = 0; i < nentries; ++i)
+	{
+		char path[PATH_MAX + 1];
+		get_full_path_of(&lwin.dir_entry[i], sizeof(path), path);
+		const int stars = get_rating_stars(path);
+		assert_true(stars >= prev_stars);
+		assert_true(stars != 0 || i < nentries - nrated);
+		prev_stars = stars;
+	}
+
+	curr_view = NULL;
+}
+
 static void
 set_file_list(view_t *view, FileType def_ftype, ...)
 {
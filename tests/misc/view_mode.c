@@ -1,5 +1,9 @@
 #include <stic.h>
 
+#include <unistd.h> /* usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() */
+
 #include <test-utils.h>
 
 #include "../../src/cfg/config.h"
@@ -11,6 +15,7 @@
 #include "../../src/modes/view.h"
 #include "../../src/modes/wk.h"
 #include "../../src/ui/quickview.h"
+#include "../../src/ui/statusbar.h"
 #include "../../src/ui/statusline.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/str.h"
@@ -303,6 +308,92 @@ TEST(searching_in_view_mode)
 	remove_file(SANDBOX_PATH "/file");
 }
 
+TEST(large_files_are_viewed_while_being_indexed, IF(not_windows))
+{
+	enum { NLINES = 500*1000 };
+
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < NLINES; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+	fclose(fp);
+
+	lwin.window_cols = 20;
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+
+	strlist_t lines = modview_lines(lwin.vi);
+	assert_true(lines.nitems > 0);
+	assert_true(lines.nitems <= NLINES);
+
+	while(modview_lines(lwin.vi).nitems != NLINES)
+	{
+		usleep(5000);
+		modview_check_for_updates();
+	}
+
+	(void)vle_keys_exec_timed_out(WK_G);
+	assert_int_equal(NLINES - 1, modview_current_line(lwin.vi));
+
+	(void)vle_keys_exec_timed_out(L"?^line 1$");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	assert_string_equal("Searching...", ui_sb_last());
+
+	while(modview_current_line(lwin.vi) != 1)
+	{
+		usleep(5000);
+		modview_check_for_updates();
+	}
+
+	modview_leave();
+	remove_file(SANDBOX_PATH "/file");
+}
+
+TEST(appended_lines_are_followed, IF(not_windows))
+{
+	make_file(SANDBOX_PATH "/file", "line 0\nline 1\n");
+
+	lwin.window_cols = 20;
+	assert_true(start_view_mode("*", NULL, SANDBOX_PATH, ""));
+	assert_int_equal(2, modview_lines(lwin.vi).nitems);
+
+	(void)vle_keys_exec_timed_out(WK_F);
+	assert_int_equal(1, modview_current_line(lwin.vi));
+
+	FILE *fp = fopen(SANDBOX_PATH "/file", "a");
+	assert_non_null(fp);
+	fputs("line 2\nline", fp);
+	fclose(fp);
+
+	modview_check_for_updates();
+	assert_int_equal(4, modview_lines(lwin.vi).nitems);
+	assert_int_equal(3, modview_current_line(lwin.vi));
+
+	fp = fopen(SANDBOX_PATH "/file", "a");
+	assert_non_null(fp);
+	fputs(" 3\n", fp);
+	fclose(fp);
+
+	modview_check_for_updates();
+	assert_int_equal(4, modview_lines(lwin.vi).nitems);
+
+	(void)vle_keys_exec_timed_out(L"/line 3");
+	(void)vle_keys_exec_timed_out(WK_CR);
+	(void)vle_keys_exec_timed_out(WK_g);
+	(void)vle_keys_exec_timed_out(WK_n);
+	assert_int_equal(3, modview_current_line(lwin.vi));
+
+	/* Truncation causes reload. */
+	make_file(SANDBOX_PATH "/file", "line\n");
+	modview_check_for_updates();
+	assert_int_equal(1, modview_lines(lwin.vi).nitems);
+
+	modview_leave();
+	remove_file(SANDBOX_PATH "/file");
+}
+
 TEST(operations_with_empty_output)
 {
 	assert_true(start_view_mode("*", "true", TEST_DATA_PATH, "read"));
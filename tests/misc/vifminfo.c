@@ -251,7 +251,9 @@ TEST(histories_are_merged_correctly)
 	hist_add(&curr_stats.exprreg_hist, "exprreg1", 1);
 	hist_add(&curr_stats.menucmd_hist, "menucmd1", 1);
 
-	/* Second time, touched vifminfo.json file, merging is necessary. */
+	/* Second time, touched vifminfo.json file, merging is necessary.  Changed
+	 * 'vifminfo' makes vifminfo.json be rewritten instead of journaling. */
+	cfg.vifm_info |= VINFO_REGISTERS;
 	reset_timestamp(SANDBOX_PATH "/vifminfo.json");
 	write_info_file();
 
@@ -0,0 +1,423 @@
+#include <stic.h>
+
+#ifndef _WIN32
+#include <sys/file.h> /* flock() */
+#include <fcntl.h> /* O_RDWR open() */
+#endif
+#include <unistd.h> /* close() rmdir() usleep() */
+
+#include <pthread.h> /* pthread_create() pthread_join() */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() rename() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcpy() strlen() strstr() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/cfg/info.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/parson.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/bmarks.h"
+#include "../../src/marks.h"
+#include "../../src/status.h"
+
+#define INFO_FILE SANDBOX_PATH "/vifminfo.json"
+#define JOURNAL_FILE SANDBOX_PATH "/vifminfo.journal"
+#define CLAIMED_FILE SANDBOX_PATH "/vifminfo.journal_claimed"
+
+static void bmarks_cb(const char path[], const char tags[], time_t timestamp,
+		void *arg);
+static void * store_thread(void *arg);
+static void store_with_large_info(int nratings, int nstores);
+static int count_records(const char path[]);
+static void encrypt(char str[]);
+
+static char *saved_locale;
+
+SETUP_ONCE()
+{
+	make_abs_path(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH, "", NULL);
+	saved_locale = drop_locale();
+}
+
+TEARDOWN_ONCE()
+{
+	cfg.config_dir[0] = '\0';
+	restore_locale(saved_locale);
+}
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	histories_init(10);
+
+	/* Forget about vifminfo.json written by other tests. */
+	cfg.vifm_info = 0;
+	state_load(0);
+}
+
+TEARDOWN()
+{
+	curr_view = NULL;
+	other_view = NULL;
+
+	histories_init(0);
+	marks_clear_all();
+	bmarks_clear();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+
+	cfg.vifm_info = 0;
+
+	if(path_exists(JOURNAL_FILE, NODEREF))
+	{
+		remove_file(JOURNAL_FILE);
+	}
+	if(path_exists(INFO_FILE, NODEREF))
+	{
+		remove_file(INFO_FILE);
+	}
+}
+
+TEST(first_store_writes_snapshot)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+
+	state_store();
+
+	assert_true(path_exists(INFO_FILE, NODEREF));
+	assert_false(path_exists(JOURNAL_FILE, NODEREF));
+}
+
+TEST(changes_are_appended_to_journal)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	state_store();
+	const uint64_t size = get_file_size(INFO_FILE);
+
+	hist_add(&curr_stats.cmd_hist, "command1", -1);
+	state_store();
+	hist_add(&curr_stats.cmd_hist, "command2", -1);
+	state_store();
+
+	assert_ulong_equal(size, get_file_size(INFO_FILE));
+	assert_int_equal(2, count_records(JOURNAL_FILE));
+}
+
+TEST(journal_is_replayed_on_load)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	hist_add(&curr_stats.cmd_hist, "command1", -1);
+	state_store();
+
+	hist_add(&curr_stats.cmd_hist, "command2", -1);
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	state_store();
+	assert_true(path_exists(JOURNAL_FILE, NODEREF));
+
+	histories_init(10);
+	state_load(0);
+
+	assert_int_equal(3, curr_stats.cmd_hist.size);
+	assert_string_equal("command0", curr_stats.cmd_hist.items[0].text);
+	assert_string_equal("command2", curr_stats.cmd_hist.items[1].text);
+	assert_string_equal("command1", curr_stats.cmd_hist.items[2].text);
+}
+
+TEST(removed_marks_are_not_restored)
+{
+	cfg.vifm_info = VINFO_MARKS;
+	assert_success(marks_set_user(&lwin, 'a', "/dir-a", "file-a"));
+	assert_success(marks_set_user(&lwin, 'b', "/dir-b", "file-b"));
+	state_store();
+
+	marks_clear_one(&lwin, 'a');
+	assert_success(marks_set_user(&lwin, 'c', "/dir-c", "file-c"));
+	state_store();
+	assert_true(path_exists(JOURNAL_FILE, NODEREF));
+
+	marks_clear_all();
+	state_load(0);
+
+	assert_true(marks_is_empty(&lwin, 'a'));
+	assert_false(marks_is_empty(&lwin, 'b'));
+	assert_false(marks_is_empty(&lwin, 'c'));
+}
+
+TEST(removed_bookmarks_are_not_restored)
+{
+	cfg.vifm_info = VINFO_BOOKMARKS;
+	assert_success(bmarks_set("/path-a", "tag"));
+	assert_success(bmarks_set("/path-b", "tag"));
+	state_store();
+
+	bmarks_remove("/path-a");
+	state_store();
+	assert_true(path_exists(JOURNAL_FILE, NODEREF));
+
+	bmarks_clear();
+	state_load(0);
+
+	int count = 0;
+	bmarks_find("tag", &bmarks_cb, &count);
+	assert_int_equal(1, count);
+}
+
+TEST(moved_bookmarks_are_not_duplicated)
+{
+	cfg.vifm_info = VINFO_BOOKMARKS;
+	assert_success(bmarks_set("/path-a", "tag"));
+	state_store();
+
+	bmarks_file_moved("/path-a", "/path-b");
+	state_store();
+	assert_true(path_exists(JOURNAL_FILE, NODEREF));
+
+	bmarks_clear();
+	state_load(0);
+
+	int count = 0;
+	bmarks_find("tag", &bmarks_cb, &count);
+	assert_int_equal(1, count);
+}
+
+TEST(rating_changes_are_journaled)
+{
+	/* Encrypted form of the path must be a valid UTF-8 string. */
+	char path[] = "/dir-rank/file";
+	char stored_path[] = "/dir-rank/file";
+	encrypt(stored_path);
+
+	cfg.vifm_info = VINFO_RATINGS;
+	state_store();
+
+	strcpy(lwin.curr_dir, "/dir-rank");
+	init_view_list(&lwin);
+	replace_string(&lwin.dir_entry[0].name, "file");
+	lwin.dir_entry[0].marked = 1;
+	update_rating_info_selected(3);
+	lwin.dir_entry[0].marked = 0;
+	state_store();
+
+	copy_rating_info(path, path, 0);
+	state_store();
+
+	/* Second record contains removal. */
+	int nrecords;
+	char **records = read_file_of_lines(JOURNAL_FILE, &nrecords);
+	assert_int_equal(2, nrecords);
+
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		JSON_Value *record = json_parse_string(records[i]);
+		JSON_Array *ratings = json_object_get_array(json_object(record), "ratings");
+		assert_int_equal(1, json_array_get_count(ratings));
+		JSON_Object *rating = json_array_get_object(ratings, 0);
+		assert_string_equal(stored_path, json_object_get_string(rating, "path"));
+		assert_int_equal(i == 0 ? 3 : 0, json_object_get_number(rating, "star"));
+		json_value_free(record);
+	}
+
+	free_string_array(records, nrecords);
+}
+
+TEST(changing_vifminfo_option_compacts_journal)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	state_store();
+	hist_add(&curr_stats.cmd_hist, "command1", -1);
+	state_store();
+	assert_true(path_exists(JOURNAL_FILE, NODEREF));
+
+	cfg.vifm_info |= VINFO_MARKS;
+	state_store();
+	assert_false(path_exists(JOURNAL_FILE, NODEREF));
+
+	JSON_Value *state = json_parse_file(INFO_FILE);
+	JSON_Array *hist = json_object_get_array(json_object(state), "cmd-hist");
+	assert_int_equal(2, json_array_get_count(hist));
+	assert_int_equal(cfg.vifm_info,
+			json_object_get_number(json_object(state), "vifminfo"));
+	json_value_free(state);
+}
+
+TEST(large_journal_is_compacted)
+{
+	char text[8*1024];
+	memset(text, 'x', sizeof(text) - 1);
+	text[sizeof(text) - 1] = '\0';
+
+	cfg.vifm_info = VINFO_CHISTORY;
+	state_store();
+
+	int i;
+	int compacted = 0;
+	for(i = 0; i < 20 && !compacted; ++i)
+	{
+		text[0] = 'a' + i;
+		hist_add(&curr_stats.cmd_hist, text, -1);
+		state_store();
+		compacted = !path_exists(JOURNAL_FILE, NODEREF);
+	}
+
+	assert_true(compacted);
+	assert_true(i > 1);
+
+	histories_init(10);
+	state_load(0);
+	assert_int_equal(i, curr_stats.cmd_hist.size);
+}
+
+TEST(failed_compaction_keeps_records_in_order)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	state_store();
+	hist_add(&curr_stats.cmd_hist, "command1", -1);
+	state_store();
+	hist_add(&curr_stats.cmd_hist, "command2", -1);
+	state_store();
+	assert_int_equal(2, count_records(JOURNAL_FILE));
+
+	/* Make storing fail. */
+	remove_file(INFO_FILE);
+	create_dir(INFO_FILE);
+
+	cfg.vifm_info |= VINFO_MARKS;
+	state_store();
+
+	int nrecords;
+	char **records = read_file_of_lines(JOURNAL_FILE, &nrecords);
+	assert_int_equal(2, nrecords);
+	assert_non_null(strstr(records[0], "command1"));
+	assert_non_null(strstr(records[1], "command2"));
+	free_string_array(records, nrecords);
+
+	assert_success(rmdir(INFO_FILE));
+}
+
+TEST(appending_waits_for_journal_to_be_claimed, IF(not_windows))
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	hist_add(&curr_stats.cmd_hist, "command0", -1);
+	state_store();
+	hist_add(&curr_stats.cmd_hist, "command1", -1);
+
+	/* Pretend that another instance is claiming the journal. */
+	create_file(JOURNAL_FILE);
+	const int fd = open(JOURNAL_FILE, O_RDWR);
+	assert_true(fd != -1);
+	assert_success(flock(fd, LOCK_EX));
+
+	pthread_t thread;
+	assert_success(pthread_create(&thread, NULL, &store_thread, NULL));
+	usleep(50*1000);
+
+	assert_success(rename(JOURNAL_FILE, CLAIMED_FILE));
+	close(fd);
+	assert_success(pthread_join(thread, NULL));
+
+	assert_ulong_equal(0, get_file_size(CLAIMED_FILE));
+	assert_int_equal(1, count_records(JOURNAL_FILE));
+
+	remove_file(CLAIMED_FILE);
+}
+
+TEST(large_vifminfo_is_not_rewritten_on_store)
+{
+	/* About 130 KiB of data that is never parsed. */
+	store_with_large_info(1000, 10);
+}
+
+TEST(large_vifminfo_storing_benchmark, IF(benchmarks_enabled))
+{
+	/* About 50 MiB of data that is never parsed. */
+	store_with_large_info(400*1000, 100);
+}
+
+/* Counts bookmarks. */
+static void
+bmarks_cb(const char path[], const char tags[], time_t timestamp, void *arg)
+{
+	++*(int *)arg;
+}
+
+/* Stores state in a separate thread.  Returns NULL. */
+static void *
+store_thread(void *arg)
+{
+	state_store();
+	return NULL;
+}
+
+/* Replaces vifminfo.json with a file that has the specified number of ratings
+ * and checks that storing state doesn't rewrite it. */
+static void
+store_with_large_info(int nratings, int nstores)
+{
+	cfg.vifm_info = VINFO_CHISTORY;
+	state_store();
+
+	FILE *fp = fopen(INFO_FILE, "w");
+	assert_non_null(fp);
+	fprintf(fp, "{\"vifminfo\":%d,\"ratings\":[", cfg.vifm_info);
+	int i;
+	for(i = 0; i < nratings; ++i)
+	{
+		fprintf(fp, "%s{\"star\":%d,\"path\":\"<%0105d>\"}", (i == 0 ? "" : ","),
+				1 + i%7, i);
+	}
+	fputs("]}", fp);
+	fclose(fp);
+
+	const uint64_t size = get_file_size(INFO_FILE);
+
+	for(i = 0; i < nstores; ++i)
+	{
+		char cmd[32];
+		snprintf(cmd, sizeof(cmd), "command%d", i);
+		hist_add(&curr_stats.cmd_hist, cmd, -1);
+		state_store();
+	}
+
+	assert_ulong_equal(size, get_file_size(INFO_FILE));
+	assert_int_equal(nstores, count_records(JOURNAL_FILE));
+}
+
+/* Counts records in a journal file.  Returns the number. */
+static int
+count_records(const char path[])
+{
+	int nlines;
+	char **lines = read_file_of_lines(path, &nlines);
+	assert_non_null(lines);
+	free_string_array(lines, nlines);
+	return nlines;
+}
+
+/* Encrypts path the way it's stored in vifminfo. */
+static void
+encrypt(char str[])
+{
+	size_t i;
+	for(i = 0U; i < strlen(str); ++i)
+	{
+		str[i] += 13;
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,175 @@
+#include <stic.h>
+
+#include <regex.h> /* REG_EXTENDED REG_ICASE */
+#include <unistd.h> /* usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() fprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/macros.h"
+#include "../../src/pager.h"
+#include "../../src/vsearch.h"
+
+static void start(const char pattern[], int cflags, int width, int wrap);
+static int find(int from, int backward);
+
+static char *lines[] = {
+	"first line",
+	"\tsecond",
+	"th\033[1mird\033[0m",
+	"a rather long fourth line",
+	"FiFtH",
+};
+
+static vsearch_t *search;
+
+TEARDOWN()
+{
+	vsearch_free(search);
+	search = NULL;
+}
+
+TEST(freeing_null_search_does_nothing)
+{
+	vsearch_free(NULL);
+}
+
+TEST(matching_lines_are_found_in_both_directions)
+{
+	start("i[rf]", REG_EXTENDED, 80, 1);
+
+	assert_int_equal(0, find(-1, 0));
+	assert_int_equal(2, find(0, 0));
+	assert_int_equal(-1, find(2, 0));
+
+	assert_int_equal(2, find(5, 1));
+	assert_int_equal(0, find(2, 1));
+	assert_int_equal(-1, find(0, 1));
+}
+
+TEST(empty_list_has_no_matches)
+{
+	search = vsearch_start("x", REG_EXTENDED, NULL, NULL, 0, 80, 1, 8,
+			/*origin=*/0, /*backward=*/0);
+	assert_non_null(search);
+
+	assert_int_equal(-1, find(-1, 0));
+	assert_int_equal(-1, find(0, 1));
+}
+
+TEST(literals_are_found_through_tabs_and_escape_sequences)
+{
+	start("third", REG_EXTENDED, 80, 1);
+	assert_int_equal(2, find(-1, 0));
+	vsearch_free(search);
+
+	start("    second", REG_EXTENDED, 80, 1);
+	assert_int_equal(1, find(-1, 0));
+}
+
+TEST(case_of_literals_can_be_ignored)
+{
+	start("fifth", REG_EXTENDED, 80, 1);
+	assert_int_equal(-1, find(-1, 0));
+	vsearch_free(search);
+
+	start("fifth", REG_EXTENDED | REG_ICASE, 80, 1);
+	assert_int_equal(4, find(-1, 0));
+}
+
+TEST(parts_of_wrapped_lines_are_matched_separately)
+{
+	start("fourth", REG_EXTENDED, 10, 1);
+
+	assert_int_equal(3, find(-1, 0));
+	assert_int_equal(1, vsearch_match_part(search, lines[3], 0, 0));
+	assert_int_equal(-1, vsearch_match_part(search, lines[3], 2, 0));
+	assert_int_equal(1, vsearch_match_part(search, lines[3], 2, 1));
+	assert_int_equal(-1, vsearch_match_part(search, lines[3], 0, 1));
+
+	/* "long fourth" is broken as "a rather l" and "ong fourth". */
+	vsearch_free(search);
+	start("long fourth", REG_EXTENDED, 10, 1);
+	assert_int_equal(-1, find(-1, 0));
+}
+
+TEST(only_beginning_of_lines_is_matched_without_wrapping)
+{
+	start("line", REG_EXTENDED, 10, 0);
+
+	assert_int_equal(0, find(-1, 0));
+	assert_int_equal(-1, find(0, 0));
+}
+
+TEST(large_file_is_scanned_in_background, IF(not_windows))
+{
+	enum { NLINES = 300*1000 };
+
+	FILE *const fp = fopen(SANDBOX_PATH "/file", "w");
+	assert_non_null(fp);
+	int i;
+	for(i = 0; i < NLINES; ++i)
+	{
+		fprintf(fp, "line %d\n", i);
+	}
+	fclose(fp);
+
+	pager_t *const pager = pager_open(SANDBOX_PATH "/file", 8);
+	assert_non_null(pager);
+
+	int complete;
+	while(pager_get_count(pager, &complete), !complete)
+	{
+		usleep(5000);
+	}
+
+	search = vsearch_start("line 5", REG_EXTENDED, pager, NULL, 0, 80, 1, 8,
+			/*origin=*/NLINES - 10, /*backward=*/0);
+	assert_non_null(search);
+
+	int line;
+	VSearchResult result;
+	while((result = vsearch_find(search, 0, 0, NLINES, &line)) == VSR_PENDING)
+	{
+		usleep(5000);
+	}
+	assert_int_equal(VSR_FOUND, result);
+	assert_int_equal(5, line);
+
+	assert_int_equal(VSR_FOUND, vsearch_find(search, NLINES - 1, 1, NLINES,
+				&line));
+	assert_int_equal(59999, line);
+
+	vsearch_free(search);
+	search = NULL;
+	pager_close(pager);
+	remove_file(SANDBOX_PATH "/file");
+}
+
+/* Starts search over the lines. */
+static void
+start(const char pattern[], int cflags, int width, int wrap)
+{
+	search = vsearch_start(pattern, cflags, NULL, lines, ARRAY_LEN(lines), width,
+			wrap, 4, /*origin=*/0, /*backward=*/0);
+	assert_non_null(search);
+}
+
+/* Looks up the closest matching line while waiting for scanning to finish.
+ * Returns the line or -1. */
+static int
+find(int from, int backward)
+{
+	int line;
+	VSearchResult result;
+	while((result = vsearch_find(search, from, backward, ARRAY_LEN(lines),
+					&line)) == VSR_PENDING)
+	{
+		usleep(5000);
+	}
+	return (result == VSR_FOUND ? line : -1);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -101,6 +101,16 @@ conf_setup(void)
 	update_string(&cfg.vborder_filler, "");
 	update_string(&cfg.hborder_filler, "");
 	update_string(&cfg.millersep_filler, "");
+	update_string(&cfg.top_mid_filler, "");
+	update_string(&cfg.bot_mid_filler, "");
+	update_string(&cfg.clipboard_prg, "");
+	update_string(&cfg.pane_one_tag, "");
+	update_string(&cfg.pane_two_tag, "");
+	update_string(&cfg.sbar_one_tag, "");
+	update_string(&cfg.sbar_two_tag, "");
+	update_string(&cfg.systime_prefix, "");
+	update_string(&cfg.systime_suffix, "");
+	update_string(&cfg.vimabs_cmd, "");
 	update_string(&cfg.tab_prefix, "");
 	update_string(&cfg.tab_label, "");
 	update_string(&cfg.tab_suffix, "");
@@ -161,6 +171,16 @@ conf_teardown(void)
 	update_string(&cfg.vborder_filler, NULL);
 	update_string(&cfg.hborder_filler, NULL);
 	update_string(&cfg.millersep_filler, NULL);
+	update_string(&cfg.top_mid_filler, NULL);
+	update_string(&cfg.bot_mid_filler, NULL);
+	update_string(&cfg.clipboard_prg, NULL);
+	update_string(&cfg.pane_one_tag, NULL);
+	update_string(&cfg.pane_two_tag, NULL);
+	update_string(&cfg.sbar_one_tag, NULL);
+	update_string(&cfg.sbar_two_tag, NULL);
+	update_string(&cfg.systime_prefix, NULL);
+	update_string(&cfg.systime_suffix, NULL);
+	update_string(&cfg.vimabs_cmd, NULL);
 	update_string(&cfg.tab_prefix, NULL);
 	update_string(&cfg.tab_label, NULL);
 	update_string(&cfg.tab_suffix, NULL);
@@ -630,6 +650,12 @@ have_cat(void)
 	return (find_cmd_in_path("cat", 0, NULL) == 0);
 }
 
+int
+benchmarks_enabled(void)
+{
+	return !is_null_or_empty(env_get("VIFM_BENCHMARKS"));
+}
+
 void
 try_enable_utf8_locale(void)
 {
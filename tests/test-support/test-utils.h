@@ -136,6 +136,11 @@ int regular_unix_user(void);
  * so, otherwise zero is returned. */
 int have_cat(void);
 
+/* Whether benchmarks were requested by setting $VIFM_BENCHMARKS environment
+ * variable to a non-empty value.  Returns non-zero if so, otherwise zero is
+ * returned. */
+int benchmarks_enabled(void);
+
 struct matcher_t;
 
 /* Changes *matcher to have the value of the expr.  The operation is assumed to
@@ -0,0 +1,219 @@
+#include <stic.h>
+
+#ifndef _WIN32
+#include <unistd.h> /* pread() */
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint32_t */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() remove() */
+#include <string.h> /* memcpy() */
+
+#include <test-utils.h>
+
+#include "../../src/utils/alog.h"
+#include "../../src/utils/fs.h"
+
+/* State of a user of the log. */
+typedef struct
+{
+	int compact;   /* Whether compaction should be requested on loading. */
+	int nrecords;  /* Number of seen records. */
+	uint32_t last; /* Value of the last seen record. */
+}
+state_t;
+
+static alog_t * open_log(state_t *state);
+static void put(alog_t *log, uint32_t value);
+static off_t load(int fd, off_t size, int *compact, void *arg);
+static int dump(int fd, void *arg);
+static size_t read_records(const char data[], size_t len, void *arg);
+
+static const char *const file = SANDBOX_PATH "/alog";
+
+TEARDOWN()
+{
+	(void)remove(file);
+}
+
+TEST(records_are_loaded_on_reopening, IF(not_windows))
+{
+	state_t state = {};
+	alog_t *log = open_log(&state);
+	assert_int_equal(0, state.nrecords);
+	put(log, 1);
+	put(log, 2);
+	alog_close(log);
+
+	log = open_log(&state);
+	assert_int_equal(2, state.nrecords);
+	assert_int_equal(2, state.last);
+	alog_close(log);
+}
+
+TEST(records_of_other_instances_are_read_on_sync, IF(not_windows))
+{
+	state_t state1 = {}, state2 = {};
+	alog_t *log1 = open_log(&state1);
+	alog_t *log2 = open_log(&state2);
+
+	put(log1, 1);
+	assert_success(alog_sync(log1, &read_records, &state1));
+	assert_success(alog_sync(log2, &read_records, &state2));
+	assert_int_equal(0, state1.nrecords);
+	assert_int_equal(1, state2.nrecords);
+	assert_int_equal(1, state2.last);
+
+	alog_close(log1);
+	alog_close(log2);
+}
+
+TEST(partial_record_is_dropped, IF(not_windows))
+{
+	state_t state = {};
+	alog_t *log = open_log(&state);
+	put(log, 1);
+	alog_close(log);
+
+	const uint64_t size = get_file_size(file);
+
+	FILE *fp = fopen(file, "ab");
+	assert_non_null(fp);
+	assert_int_equal(2, fwrite("xx", 1, 2, fp));
+	fclose(fp);
+
+	log = open_log(&state);
+	assert_ulong_equal(size, get_file_size(file));
+	assert_int_equal(1, state.nrecords);
+	alog_close(log);
+}
+
+TEST(file_of_unknown_format_is_reset, IF(not_windows))
+{
+	make_file(file, "not a log file");
+
+	state_t state = {};
+	alog_t *log = open_log(&state);
+	assert_int_equal(0, state.nrecords);
+	assert_ulong_equal(sizeof(alog_header_t), get_file_size(file));
+	alog_close(log);
+}
+
+TEST(compaction_keeps_only_dumped_records, IF(not_windows))
+{
+	state_t state = {};
+	alog_t *log = open_log(&state);
+	put(log, 1);
+	put(log, 2);
+	put(log, 3);
+	alog_close(log);
+
+	state.compact = 1;
+	log = open_log(&state);
+	alog_close(log);
+
+	assert_ulong_equal(sizeof(alog_header_t) + sizeof(uint32_t),
+			get_file_size(file));
+
+	state.compact = 0;
+	log = open_log(&state);
+	assert_int_equal(1, state.nrecords);
+	assert_int_equal(3, state.last);
+	alog_close(log);
+}
+
+TEST(file_replaced_by_other_instance_is_reopened, IF(not_windows))
+{
+	state_t state1 = {}, state2 = { .compact = 1 };
+	alog_t *log1 = open_log(&state1);
+	put(log1, 1);
+	assert_success(alog_sync(log1, &read_records, &state1));
+
+	/* Compaction replaces the file. */
+	alog_t *log2 = open_log(&state2);
+	put(log2, 2);
+	assert_success(alog_sync(log2, &read_records, &state2));
+
+	/* New file is read from the start, including compacted record. */
+	put(log1, 3);
+	assert_success(alog_sync(log1, &read_records, &state1));
+	assert_int_equal(2, state1.nrecords);
+	assert_int_equal(2, state1.last);
+
+	assert_success(alog_sync(log2, &read_records, &state2));
+	assert_int_equal(3, state2.nrecords);
+	assert_int_equal(3, state2.last);
+
+	alog_close(log1);
+	alog_close(log2);
+}
+
+/* Opens the log resetting the state.  Returns the log. */
+static alog_t *
+open_log(state_t *state)
+{
+	state->nrecords = 0;
+	state->last = 0;
+
+	alog_t *const log = alog_open(file, "TESTLOG", 1U, &load, &dump, state);
+	assert_non_null(log);
+	return log;
+}
+
+/* Appends a record to the log. */
+static void
+put(alog_t *log, uint32_t value)
+{
+	alog_put(log, &value, sizeof(value));
+}
+
+/* Loads records of the file. */
+static off_t
+load(int fd, off_t size, int *compact, void *arg)
+{
+	state_t *const state = arg;
+
+	off_t offset = sizeof(alog_header_t);
+	uint32_t value;
+	while(size - offset >= (off_t)sizeof(value) &&
+			pread(fd, &value, sizeof(value), offset) == sizeof(value))
+	{
+		++state->nrecords;
+		state->last = value;
+		offset += sizeof(value);
+	}
+
+	*compact = state->compact;
+	return offset;
+}
+
+/* Writes out the last record. */
+static int
+dump(int fd, void *arg)
+{
+	state_t *const state = arg;
+	if(state->nrecords == 0)
+	{
+		return 0;
+	}
+	return alog_write(fd, &state->last, sizeof(state->last));
+}
+
+/* Processes records appended by other instances. */
+static size_t
+read_records(const char data[], size_t len, void *arg)
+{
+	state_t *const state = arg;
+
+	size_t offset = 0U;
+	while(len - offset >= sizeof(state->last))
+	{
+		memcpy(&state->last, data + offset, sizeof(state->last));
+		++state->nrecords;
+		offset += sizeof(state->last);
+	}
+	return offset;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
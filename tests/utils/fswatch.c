@@ -1,14 +1,20 @@
 #include <stic.h>
 
+#include <unistd.h> /* rmdir() */
+
 #include <stdio.h> /* remove() snprintf() */
 
+#include <test-utils.h>
+
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/fswatch.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/string_array.h"
 
 static int using_inotify(void);
+static int not_using_inotify(void);
 
 static char sandbox[PATH_MAX + 1];
 
@@ -182,6 +188,162 @@ TEST(file_recreation_removes_ban, IF(using_inotify))
 	assert_success(remove(SANDBOX_PATH "/testdir"));
 }
 
+TEST(changes_of_files_are_reported, IF(using_inotify))
+{
+	create_file(SANDBOX_PATH "/existing");
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	fswatch_changes_t changes = {};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_changes(watch, &changes));
+	assert_int_equal(0, changes.nitems);
+
+	create_file(SANDBOX_PATH "/new");
+	make_file(SANDBOX_PATH "/new", "content");
+	create_file(SANDBOX_PATH "/temp");
+	assert_success(remove(SANDBOX_PATH "/temp"));
+	make_file(SANDBOX_PATH "/existing", "content");
+
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(watch, &changes));
+	assert_false(changes.lost);
+	assert_int_equal(3, changes.nitems);
+	assert_string_equal("new", changes.items[0].name);
+	assert_int_equal(FSWC_CREATED, changes.items[0].kind);
+	assert_string_equal("temp", changes.items[1].name);
+	assert_int_equal(FSWC_DELETED, changes.items[1].kind);
+	assert_string_equal("existing", changes.items[2].name);
+	assert_int_equal(FSWC_MODIFIED, changes.items[2].kind);
+	fswatch_changes_free(&changes);
+
+	assert_int_equal(0, changes.nitems);
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_changes(watch, &changes));
+	assert_int_equal(0, changes.nitems);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/existing"));
+	assert_success(remove(SANDBOX_PATH "/new"));
+}
+
+TEST(changes_of_directory_itself_make_list_lost, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(SANDBOX_PATH "/dir"));
+
+	create_file(SANDBOX_PATH "/dir/file");
+	assert_success(os_chmod(SANDBOX_PATH "/dir", 0750));
+
+	fswatch_changes_t changes = {};
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_changes(watch, &changes));
+	assert_true(changes.lost);
+	assert_int_equal(0, changes.nitems);
+	fswatch_changes_free(&changes);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/dir/file"));
+	assert_success(rmdir(SANDBOX_PATH "/dir"));
+}
+
+TEST(set_reports_changed_directories, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/a", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/b", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create_set());
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/a"));
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/b"));
+
+	strlist_t changed = {};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_set(watch, &changed));
+	assert_int_equal(0, changed.nitems);
+
+	create_file(SANDBOX_PATH "/b/file");
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_set(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	assert_string_equal(SANDBOX_PATH "/b", changed.items[0]);
+	free_string_array(changed.items, changed.nitems);
+
+	changed = (strlist_t){};
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll_set(watch, &changed));
+	assert_int_equal(0, changed.nitems);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/b/file"));
+	assert_success(rmdir(SANDBOX_PATH "/a"));
+	assert_success(rmdir(SANDBOX_PATH "/b"));
+}
+
+TEST(directories_not_readded_on_update_are_dropped, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/a", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/b", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create_set());
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/a"));
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/b"));
+
+	fswatch_begin_update(watch);
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/b"));
+	fswatch_end_update(watch);
+
+	strlist_t changed = {};
+	(void)fswatch_poll_set(watch, &changed);
+	free_string_array(changed.items, changed.nitems);
+
+	create_file(SANDBOX_PATH "/a/file");
+	create_file(SANDBOX_PATH "/b/file");
+
+	changed = (strlist_t){};
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_set(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	assert_string_equal(SANDBOX_PATH "/b", changed.items[0]);
+	free_string_array(changed.items, changed.nitems);
+
+	fswatch_free(watch);
+
+	assert_success(remove(SANDBOX_PATH "/a/file"));
+	assert_success(remove(SANDBOX_PATH "/b/file"));
+	assert_success(rmdir(SANDBOX_PATH "/a"));
+	assert_success(rmdir(SANDBOX_PATH "/b"));
+}
+
+TEST(removal_of_directory_from_set_is_reported, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/a", 0700));
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create_set());
+	assert_success(fswatch_add(watch, SANDBOX_PATH "/a"));
+
+	assert_success(rmdir(SANDBOX_PATH "/a"));
+
+	strlist_t changed = {};
+	assert_int_equal(FSWS_UPDATED, fswatch_poll_set(watch, &changed));
+	assert_int_equal(1, changed.nitems);
+	assert_string_equal(SANDBOX_PATH "/a", changed.items[0]);
+	free_string_array(changed.items, changed.nitems);
+
+	fswatch_free(watch);
+}
+
+TEST(set_is_not_supported_without_inotify, IF(not_using_inotify))
+{
+	assert_null(fswatch_create_set());
+}
+
+static int
+not_using_inotify(void)
+{
+	return !using_inotify();
+}
+
 static int
 using_inotify(void)
 {
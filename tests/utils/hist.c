@@ -0,0 +1,114 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+
+#include "../../src/utils/hist.h"
+
+static hist_t hist;
+
+SETUP()
+{
+	assert_success(hist_init(&hist, 3));
+}
+
+TEARDOWN()
+{
+	hist_reset(&hist);
+}
+
+TEST(items_are_added_to_the_front)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+
+	assert_int_equal(2, hist.size);
+	assert_string_equal("b", hist.items[0].text);
+	assert_int_equal(2, hist.items[0].timestamp);
+	assert_string_equal("a", hist.items[1].text);
+	assert_int_equal(1, hist.items[1].timestamp);
+}
+
+TEST(empty_items_are_rejected)
+{
+	assert_success(hist_add(&hist, "", -1));
+	assert_true(hist_is_empty(&hist));
+}
+
+TEST(existing_item_is_moved_to_the_front)
+{
+	assert_success(hist_add(&hist, "a", 1));
+	assert_success(hist_add(&hist, "b", 2));
+	assert_success(hist_add(&hist, "c", 3));
+	assert_success(hist_add(&hist, "a", 4));
+
+	assert_int_equal(3, hist.size);
+	assert_string_equal("a", hist.items[0].text);
+	assert_int_equal(4, hist.items[0].timestamp);
+	assert_string_equal("c", hist.items[1].text);
+	assert_string_equal("b", hist.items[2].text);
+}
+
+TEST(oldest_item_is_dropped_when_full)
+{
+	assert_success(hist_add(&hist, "a", -1));
+	assert_success(hist_add(&hist, "b", -1));
+	assert_success(hist_add(&hist, "c", -1));
+	assert_success(hist_add(&hist, "d", -1));
+
+	assert_int_equal(3, hist.size);
+	assert_string_equal("d", hist.items[0].text);
+	assert_string_equal("b", hist.items[2].text);
+
+	/* Dropped item is added anew rather than moved. */
+	assert_success(hist_add(&hist, "a", -1));
+	assert_int_equal(3, hist.size);
+	assert_string_equal("a", hist.items[0].text);
+	assert_string_equal("d", hist.items[1].text);
+	assert_string_equal("c", hist.items[2].text);
+}
+
+TEST(resizing_keeps_newest_items)
+{
+	assert_success(hist_add(&hist, "a", -1));
+	assert_success(hist_add(&hist, "b", -1));
+	assert_success(hist_add(&hist, "c", -1));
+
+	hist_resize(&hist, 2);
+	assert_int_equal(2, hist.size);
+	assert_string_equal("c", hist.items[0].text);
+	assert_string_equal("b", hist.items[1].text);
+
+	hist_resize(&hist, 4);
+	assert_success(hist_add(&hist, "a", -1));
+	assert_success(hist_add(&hist, "b", -1));
+	assert_int_equal(3, hist.size);
+	assert_string_equal("b", hist.items[0].text);
+	assert_string_equal("a", hist.items[1].text);
+	assert_string_equal("c", hist.items[2].text);
+}
+
+TEST(many_items_are_deduplicated)
+{
+	enum { CAPACITY = 10000, NITEMS = 100000 };
+
+	hist_resize(&hist, CAPACITY);
+
+	int i;
+	for(i = 0; i < NITEMS; ++i)
+	{
+		char item[32];
+		snprintf(item, sizeof(item), "cd dir%d", i%(CAPACITY + CAPACITY/2));
+		assert_success(hist_add(&hist, item, -1));
+	}
+
+	assert_int_equal(CAPACITY, hist.size);
+	assert_string_equal("cd dir9999", hist.items[0].text);
+
+	assert_success(hist_add(&hist, "cd dir5000", -1));
+	assert_int_equal(CAPACITY, hist.size);
+	assert_string_equal("cd dir5000", hist.items[0].text);
+	assert_string_equal("cd dir9999", hist.items[1].text);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
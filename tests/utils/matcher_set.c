@@ -0,0 +1,173 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() */
+
+#include "../../src/utils/macros.h"
+#include "../../src/utils/matcher_set.h"
+#include "../../src/utils/matchers.h"
+
+static void make_set(const char *exprs[], int count);
+static matchers_t * make_matchers(const char expr[]);
+
+static matchers_t *list[16];
+static int nlist;
+static matcher_set_t *set;
+
+SETUP()
+{
+	nlist = 0;
+	assert_non_null(set = matcher_set_alloc());
+}
+
+TEARDOWN()
+{
+	matcher_set_free(set);
+
+	int i;
+	for(i = 0; i < nlist; ++i)
+	{
+		matchers_free(list[i]);
+	}
+}
+
+TEST(freeing_null_set_does_nothing)
+{
+	matcher_set_free(NULL);
+}
+
+TEST(empty_set_matches_nothing)
+{
+	assert_int_equal(-1, matcher_set_match(set, "file", 0));
+}
+
+TEST(first_matching_rule_is_found)
+{
+	const char *exprs[] = { "{*.c}", "/^a/", "{*.c,*.h}", "{abc.h}" };
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	assert_int_equal(0, matcher_set_match(set, "abc.c", 0));
+	assert_int_equal(1, matcher_set_match(set, "abc.h", 0));
+	assert_int_equal(2, matcher_set_match(set, "b.h", 0));
+	assert_int_equal(-1, matcher_set_match(set, "b.cpp", 0));
+}
+
+TEST(all_matching_rules_are_found)
+{
+	const char *exprs[] = { "{*.c}", "/^a/", "{*.c,*.h}", "{abc.c}", "{a*}" };
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	assert_int_equal(0, matcher_set_match(set, "abc.c", 0));
+	assert_int_equal(1, matcher_set_match(set, "abc.c", 1));
+	assert_int_equal(2, matcher_set_match(set, "abc.c", 2));
+	assert_int_equal(3, matcher_set_match(set, "abc.c", 3));
+	assert_int_equal(4, matcher_set_match(set, "abc.c", 4));
+	assert_int_equal(-1, matcher_set_match(set, "abc.c", 5));
+}
+
+TEST(globs_are_matched_as_by_matchers)
+{
+	const char *exprs[] = {
+		"{literal}", "{*suffix}", "{prefix*}", "{mid*dle}", "{esc\\*aped}", "{*}"
+	};
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	assert_int_equal(0, matcher_set_match(set, "LiTeRaL", 0));
+	assert_int_equal(5, matcher_set_match(set, "literal0", 0));
+
+	assert_int_equal(1, matcher_set_match(set, "0SUFFIX", 0));
+	assert_int_equal(5, matcher_set_match(set, "suffix", 0));
+	assert_int_equal(-1, matcher_set_match(set, ".suffix", 0));
+
+	assert_int_equal(2, matcher_set_match(set, "prefix", 0));
+	assert_int_equal(2, matcher_set_match(set, "prefix.txt", 0));
+
+	assert_int_equal(3, matcher_set_match(set, "middle", 0));
+	assert_int_equal(3, matcher_set_match(set, "mid-dle", 0));
+	assert_int_equal(5, matcher_set_match(set, "midle", 0));
+
+	assert_int_equal(4, matcher_set_match(set, "esc*aped", 0));
+	assert_int_equal(5, matcher_set_match(set, "escaped", 0));
+}
+
+TEST(only_last_path_component_is_matched_by_name_globs)
+{
+	const char *exprs[] = { "{dir}", "{*.c}", "{{/src/*}}" };
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	assert_int_equal(0, matcher_set_match(set, "/path/dir", 0));
+	assert_int_equal(1, matcher_set_match(set, "/path.c/file.c", 0));
+	assert_int_equal(2, matcher_set_match(set, "/src/file", 0));
+	assert_int_equal(-1, matcher_set_match(set, "/dir/file", 0));
+}
+
+TEST(negated_and_combined_matchers_are_respected)
+{
+	const char *exprs[] = { "!{*.c}", "{*.h}{abc*}" };
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	assert_int_equal(-1, matcher_set_match(set, "file.c", 0));
+	assert_int_equal(0, matcher_set_match(set, "file.h", 0));
+	assert_int_equal(1, matcher_set_match(set, "abc.h", 1));
+}
+
+TEST(rule_can_consist_of_several_alternatives)
+{
+	matchers_t *alts[] = { make_matchers("/^a/"), make_matchers("{*.h}") };
+	list[nlist++] = alts[0];
+	list[nlist++] = alts[1];
+	assert_success(matcher_set_add(set, alts, ARRAY_LEN(alts)));
+
+	assert_int_equal(0, matcher_set_match(set, "a", 0));
+	assert_int_equal(0, matcher_set_match(set, "b.h", 0));
+	assert_int_equal(-1, matcher_set_match(set, "b.c", 0));
+}
+
+TEST(all_matches_are_listed_and_updated_on_change)
+{
+	const char *exprs[] = { "{*.c}", "/^a/" };
+	make_set(exprs, ARRAY_LEN(exprs));
+
+	const int *rules;
+	assert_int_equal(2, matcher_set_match_all(set, "abc.c", &rules));
+	assert_int_equal(0, rules[0]);
+	assert_int_equal(1, rules[1]);
+
+	/* Memoized result. */
+	assert_int_equal(2, matcher_set_match_all(set, "abc.c", &rules));
+	assert_int_equal(0, matcher_set_match_all(set, "b.h", &rules));
+
+	const char *more_exprs[] = { "{abc.c}" };
+	make_set(more_exprs, ARRAY_LEN(more_exprs));
+
+	assert_int_equal(3, matcher_set_match_all(set, "abc.c", &rules));
+	assert_int_equal(2, rules[2]);
+}
+
+/* Fills the set with rules of single matchers. */
+static void
+make_set(const char *exprs[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		list[nlist] = make_matchers(exprs[i]);
+		assert_success(matcher_set_add(set, &list[nlist], 1));
+		++nlist;
+	}
+}
+
+/* Parses matchers expression.  Returns the matchers. */
+static matchers_t *
+make_matchers(const char expr[])
+{
+	char *error;
+	matchers_t *const matchers = matchers_alloc(expr, expr, /*cs_by_def=*/0,
+			/*glob_by_def=*/1, /*on_empty_re=*/"", &error);
+	assert_non_null(matchers);
+	assert_null(error);
+	return matchers;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */